@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include "../../../src/bootstrap/ast/moduleScope.hxx"
+
+/**
+ * @file benchModuleScope.cxx
+ * @brief Module scope contention benchmark - runs declare and resolve workloads against ModuleScope at
+ * 1, 8 and 64 threads, alongside a mutex-guarded std::unordered_map for comparison, reporting operations/s.
+ */
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using mangrove::core::utf8::String;
+using mangrove::core::utf8::StringView;
+using mangrove::ast::symbolTable::ModuleScope;
+using mangrove::ast::symbolTable::Symbol;
+using mangrove::ast::symbolTable::SymbolType;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t identCount{100000U};
+constexpr static size_t lookupsPerThread{1000000U};
+constexpr static std::array<size_t, 3U> threadCounts{1U, 8U, 64U};
+
+// The baseline - what a module scope looks like with the obvious single lock around it
+struct LockedScope final
+{
+private:
+	mutable std::mutex _lock{};
+	std::unordered_map<std::string, std::unique_ptr<Symbol>> _table{};
+	std::vector<std::unique_ptr<String>> _idents{};
+
+public:
+	LockedScope(size_t) { }
+
+	std::pair<Symbol *, bool> insert(const StringView &ident, const SymbolType &type = {})
+	{
+		const std::lock_guard<std::mutex> guard{_lock};
+		const auto [entry, inserted]{_table.try_emplace(std::string{ident.data(), ident.byteLength()})};
+		if (inserted)
+		{
+			const auto &storedIdent{*_idents.emplace_back(std::make_unique<String>(ident))};
+			entry->second = std::make_unique<Symbol>(storedIdent, type);
+		}
+		return {entry->second.get(), inserted};
+	}
+
+	Symbol *find(const StringView &ident) const
+	{
+		const std::lock_guard<std::mutex> guard{_lock};
+		const auto entry{_table.find(std::string{ident.data(), ident.byteLength()})};
+		return entry == _table.end() ? nullptr : entry->second.get();
+	}
+};
+
+// Runs work(thread) on threads threads at once, returning how long it took for them all to finish
+template<typename Work> static double runThreads(const size_t threads, Work work)
+{
+	std::atomic<size_t> ready{};
+	std::atomic<bool> start{false};
+	std::vector<std::thread> workers{};
+	workers.reserve(threads);
+	for (size_t thread{}; thread < threads; ++thread)
+	{
+		workers.emplace_back([&, thread]()
+		{
+			ready.fetch_add(1U);
+			while (!start.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			work(thread);
+		});
+	}
+	while (ready.load() != threads)
+		std::this_thread::yield();
+	const auto begin{benchClock::now()};
+	start.store(true, std::memory_order_release);
+	for (auto &worker : workers)
+		worker.join();
+	return std::chrono::duration<double>{benchClock::now() - begin}.count();
+}
+
+template<typename Scope> static void benchmarkScope(const std::string_view name, const std::vector<String> &idents)
+{
+	for (const auto threads : threadCounts)
+	{
+		// Declare: the threads split the module's names between them
+		Scope scope{identCount};
+		const auto declareTime{runThreads(threads, [&](const size_t thread)
+		{
+			for (size_t ident{thread}; ident < idents.size(); ident += threads)
+				static_cast<void>(scope.insert(idents[ident]));
+		})};
+
+		// Contended declare: every thread declares every name, racing the others for each
+		Scope racedScope{identCount};
+		const auto raceTime{runThreads(threads, [&](const size_t)
+		{
+			for (const auto &ident : idents)
+				static_cast<void>(racedScope.insert(ident));
+		})};
+
+		// Resolve: every thread looks up names at random
+		std::atomic<size_t> found{};
+		const auto resolveTime{runThreads(threads, [&](const size_t thread)
+		{
+			std::minstd_rand rng{static_cast<uint32_t>(thread + 1U)};
+			std::uniform_int_distribution<size_t> identIndex{0U, idents.size() - 1U};
+			size_t hits{};
+			for (size_t lookup{}; lookup < lookupsPerThread; ++lookup)
+				hits += scope.find(idents[identIndex(rng)]) ? 1U : 0U;
+			found.fetch_add(hits);
+		})};
+		if (found.load() != threads * lookupsPerThread)
+			console.error("Lookups failed to resolve declared symbols"sv);
+
+		const auto declares{static_cast<double>(identCount)};
+		const auto races{static_cast<double>(identCount * threads)};
+		const auto resolves{static_cast<double>(lookupsPerThread * threads)};
+		console.info(fmt::format("{:>13} {:>2} threads: {:>6.2f} M declares/s, {:>6.2f} M contended declares/s, "
+			"{:>7.2f} M resolves/s"sv, name, threads, declares / declareTime / 1e6, races / raceTime / 1e6,
+			resolves / resolveTime / 1e6));
+	}
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	std::vector<String> idents{};
+	idents.reserve(identCount);
+	for (size_t ident{}; ident < identCount; ++ident)
+		idents.emplace_back(std::string_view{fmt::format("moduleSymbol{}"sv, ident)});
+	console.info(fmt::format("{} symbols, {} lookups per thread, {} hardware threads"sv,
+		identCount, lookupsPerThread, std::thread::hardware_concurrency()));
+	benchmarkScope<ModuleScope>("ModuleScope"sv, idents);
+	benchmarkScope<LockedScope>("mutex + map"sv, idents);
+	return 0;
+}
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include "../../../src/bootstrap/build/buildGraph.hxx"
+
+/**
+ * @file benchBuildGraph.cxx
+ * @brief Incremental build scheduling benchmark - generates a project of layered modules, each importing
+ * a few from the layer below, then times a clean build, a no-op rebuild, a rebuild after touching
+ * (but not changing) every file, and a rebuild after editing one module near the bottom of the graph.
+ * The build action itself does nothing, so this measures just the graph's own overhead.
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::core::loader::SourceLoader;
+using mangrove::build::BuildGraph;
+using mangrove::build::BuildResult;
+using mangrove::build::Module;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t layers{20U};
+constexpr static size_t modulesPerLayer{500U};
+
+[[nodiscard]] static std::string moduleSource(const size_t layer, const size_t index)
+{
+	std::string source{};
+	if (layer)
+	{
+		for (size_t import{}; import < 3U; ++import)
+			source += fmt::format("import layer{}.module{}\n"sv, layer - 1U, (index * 7U + import * 13U) % modulesPerLayer);
+	}
+	for (size_t line{}; line < 40U; ++line)
+		source += fmt::format("Int32 value{} = {} + {}\n"sv, line, layer, index);
+	return source;
+}
+
+static bool writeProject(const path &directory, std::vector<path> &files)
+{
+	for (size_t layer{}; layer < layers; ++layer)
+	{
+		const auto layerDirectory{directory / fmt::format("layer{}"sv, layer)};
+		std::filesystem::create_directories(layerDirectory);
+		for (size_t index{}; index < modulesPerLayer; ++index)
+		{
+			const auto &fileName{files.emplace_back(layerDirectory / fmt::format("module{}.mgv"sv, index))};
+			const auto source{moduleSource(layer, index)};
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			if (!file.valid() || !file.write(source.data(), source.size()))
+				return false;
+		}
+	}
+	return true;
+}
+
+static void timeBuild(const std::string_view name, const path &directory, const std::vector<path> &files)
+{
+	const SourceLoader loader{};
+	std::atomic<size_t> actions{};
+	const auto begin{benchClock::now()};
+	BuildGraph graph{directory / "build.cache", directory};
+	graph.scan(files, loader);
+	const auto scanned{benchClock::now()};
+	const auto result{graph.build([&](const Module &) { ++actions; return true; }, loader.workers())};
+	static_cast<void>(graph.save());
+	const auto end{benchClock::now()};
+	console.info(fmt::format("{:>16}: {:8.3f}ms total, {:8.3f}ms scanning, {} of {} modules rebuilt"sv, name,
+		std::chrono::duration<double, std::milli>{end - begin}.count(),
+		std::chrono::duration<double, std::milli>{scanned - begin}.count(), result.built, files.size()));
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	try
+	{
+		const auto directory{std::filesystem::temp_directory_path() / "mangroveBenchBuildGraph"};
+		std::filesystem::remove_all(directory);
+		std::vector<path> files{};
+		if (!writeProject(directory, files))
+		{
+			console.error("Failed to write synthetic project to "sv, directory.c_str());
+			return 1;
+		}
+
+		timeBuild("clean"sv, directory, files);
+		timeBuild("no-op"sv, directory, files);
+		timeBuild("no-op"sv, directory, files);
+		for (const auto &file : files)
+			std::filesystem::last_write_time(file, std::filesystem::last_write_time(file) + std::chrono::hours{1});
+		timeBuild("touched all"sv, directory, files);
+		timeBuild("no-op"sv, directory, files);
+		{
+			const auto &fileName{files[1U]};
+			const fd_t file{fileName.c_str(), O_WRONLY | O_APPEND | O_NOCTTY};
+			if (!file.valid() || !file.write("Int32 edited = 1\n", 17U))
+				return 1;
+		}
+		timeBuild("edited one"sv, directory, files);
+		timeBuild("no-op"sv, directory, files);
+		std::filesystem::remove_all(directory);
+		return 0;
+	}
+	catch (const std::exception &error)
+	{
+		console.error("Benchmark failed: "sv, error.what());
+		return 1;
+	}
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/core/sourceLoader.hxx"
+#include "../../../src/bootstrap/parser/tokeniser.hxx"
+
+/**
+ * @file benchLoader.cxx
+ * @brief Project load benchmark - reads and tokenises either every file under the directories given on the
+ * command line or a synthetic corpus of small source files, with each of the source loader's backends.
+ * Each run starts from a cold page cache (as far as posix_fadvise() can arrange without privileges),
+ * and reports files/s, MB/s and the speed-up over loading the files serially.
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::core::loader::SourceLoader;
+using mangrove::core::loader::LoadedSource;
+using mangrove::core::loader::LoaderBackend;
+using mangrove::core::loader::ioUringAvailable;
+using mangrove::parser::Tokeniser;
+using mangrove::parser::TriviaMode;
+using mangrove::parser::types::Token;
+using mangrove::parser::types::TokenType;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t iterations{5U};
+constexpr static size_t syntheticFiles{2000U};
+
+// Builds a small module's worth of source, different for each file
+static std::string syntheticSource(const size_t index)
+{
+	std::string source{fmt::format("import std.io as io\n# Module {}\n\n"sv, index)};
+	for (size_t block{}; block < 20U + (index % 40U); ++block)
+	{
+		source += fmt::format(
+			"const Int32 value{0} = {0} + 2 * (other - 0x{1:x}) << 1 // trailing comment\n"
+			"if value{0} >= 0b101 and not flag {{ name = \"value\\t{1}\\n\"; chr = '\\u3bb' }}\n"
+			"while value{0} != 0 {{ value{0} >>= 1; count++ }}\n"sv, block, index);
+	}
+	return source;
+}
+
+static bool writeCorpus(const path &directory, std::vector<path> &files)
+{
+	std::filesystem::create_directories(directory);
+	for (size_t index{}; index < syntheticFiles; ++index)
+	{
+		const auto &fileName{files.emplace_back(directory / fmt::format("module{}.mgv"sv, index))};
+		const auto source{syntheticSource(index)};
+		const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		// Dirty pages can't be dropped from the cache, so make sure they're written back
+		if (!file.valid() || !file.write(source.data(), source.size()) || ::fdatasync(file))
+			return false;
+	}
+	return true;
+}
+
+static void dropCaches(const std::vector<path> &files)
+{
+	for (const auto &fileName : files)
+	{
+		const fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+		if (file.valid())
+			static_cast<void>(::posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED));
+	}
+}
+
+static double benchmarkBackend(const std::vector<path> &files, const LoaderBackend backend,
+	const std::string_view backendName, const double baseline)
+{
+	std::atomic<size_t> bytes{};
+	std::atomic<size_t> tokens{};
+	std::atomic<size_t> failures{};
+	benchClock::duration elapsed{};
+	const SourceLoader loader{backend};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+	{
+		dropCaches(files);
+		bytes = tokens = failures = 0U;
+		const auto begin{benchClock::now()};
+		loader.load(files, [&](LoadedSource &&source)
+		{
+			if (!source.valid())
+			{
+				++failures;
+				return;
+			}
+			bytes += source.buffer.length();
+			// Tokenise each file as it arrives, as the compiler would
+			Tokeniser lexer{std::move(source.buffer), TriviaMode::coalesce};
+			std::array<Token, 64U> batch{};
+			size_t count{};
+			size_t lexed{};
+			do
+			{
+				count = lexer.next(batch);
+				lexed += count;
+			}
+			while (batch[count - 1U].type() != TokenType::eof);
+			tokens += lexed;
+		});
+		elapsed += benchClock::now() - begin;
+	}
+
+	const auto seconds{std::chrono::duration<double>{elapsed}.count() / iterations};
+	console.info(fmt::format("  {:>11}: {:.3f}s per load, {:.0f} files/s, {:.2f} MB/s, {} tokens, {} failures, {:.2f}x serial"sv,
+		backendName, seconds, static_cast<double>(files.size()) / seconds, static_cast<double>(bytes) / seconds / 1e6,
+		tokens.load(), failures.load(), baseline > 0.0 ? baseline / seconds : 1.0));
+	return seconds;
+}
+
+static void benchmarkFiles(const std::vector<path> &files)
+{
+	const SourceLoader loader{};
+	console.info(fmt::format("{} files, {} iterations, {} workers"sv, files.size(), iterations, loader.workers()));
+	const auto baseline{benchmarkBackend(files, LoaderBackend::serial, "serial"sv, 0.0)};
+	static_cast<void>(benchmarkBackend(files, LoaderBackend::threadPool, "thread pool"sv, baseline));
+	if (ioUringAvailable())
+		static_cast<void>(benchmarkBackend(files, LoaderBackend::ioUring, "io_uring"sv, baseline));
+	else
+		console.info("     io_uring: not available on this system"sv);
+}
+
+int main(int argCount, char **argList)
+{
+	console = {stdout, stderr};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	try
+	{
+		std::vector<path> files{};
+		if (!args.empty())
+		{
+			for (const std::string_view arg : args)
+			{
+				for (const auto &entry : std::filesystem::recursive_directory_iterator{arg})
+				{
+					if (entry.is_regular_file())
+						files.emplace_back(entry.path());
+				}
+			}
+			benchmarkFiles(files);
+			return 0;
+		}
+
+		const auto directory{std::filesystem::temp_directory_path() / "mangroveBenchLoader"};
+		if (!writeCorpus(directory, files))
+		{
+			console.error("Failed to write synthetic corpus to "sv, directory.c_str());
+			return 1;
+		}
+		benchmarkFiles(files);
+		std::filesystem::remove_all(directory);
+		return 0;
+	}
+	catch (const std::exception &error)
+	{
+		console.error("Benchmark failed: "sv, error.what());
+		return 1;
+	}
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/formats/ar/archive.hxx"
+
+/**
+ * @file benchArchive.cxx
+ * @brief Archive symbol resolution benchmark - writes a GNU archive of objects each defining a batch of
+ * symbols, then reports lookups/s for finding the member defining a symbol through the archive's index,
+ * against walking the members and searching each one's symbol table in turn as a reader without the
+ * index has to
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::ar::Archive;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::elf::types::StringTableBuilder;
+namespace elf64 = mangrove::elf::types::elf64;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t memberCount{2000U};
+constexpr static size_t symbolsPerMember{32U};
+// Scanning costs a walk of half the archive per lookup, so gets far fewer lookups to time
+constexpr static size_t indexedLookups{200000U};
+constexpr static size_t scannedLookups{200U};
+
+[[nodiscard]] static std::string symbolName(const size_t member, const size_t symbol)
+	{ return fmt::format("function{}_{}"sv, member, symbol); }
+
+// Builds an x86-64 object with a .text section and symbolsPerMember global functions defined in it
+[[nodiscard]] static std::vector<uint8_t> makeObject(const path &fileName, const size_t member)
+{
+	StringTableBuilder names{};
+	std::vector<uint8_t> symbols((symbolsPerMember + 1U) * elf64::ELFSymbol::size());
+	const Memory symbolStorage{span{symbols.data(), symbols.size()}};
+	for (size_t symbol{}; symbol < symbolsPerMember; ++symbol)
+	{
+		const auto offset{(symbol + 1U) * elf64::ELFSymbol::size()};
+		symbolStorage.write(offset, names.add(symbolName(member, symbol)), Endian::little);
+		symbolStorage.write(offset + 4U, uint8_t{0x12U});
+		symbolStorage.write(offset + 6U, uint16_t{2U}, Endian::little);
+		symbolStorage.write(offset + 8U, uint64_t{symbol * 16U}, Endian::little);
+	}
+	const std::vector<uint8_t> text(symbolsPerMember * 16U, 0xc3U);
+	const auto stringData{names.storage()};
+
+	ELF elf{Class::elf64Bit, Endian::little, Machine::x86_64};
+	static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+		{SectionFlag::allocate, SectionFlag::execuable}, span{text.data(), text.size()}, 16U));
+	const auto strtab{elf.addSection(".strtab"sv, SectionHeaderType::stringTable, {},
+		span{stringData.data(), stringData.length()})};
+	const auto symtab{elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+		span{symbols.data(), symbols.size()}, 8U)};
+	elf.sectionHeaders()[symtab].link(static_cast<uint32_t>(strtab));
+	elf.sectionHeaders()[symtab].info(1U);
+	elf.sectionHeaders()[symtab].entityLength(elf64::ELFSymbol::size());
+	{
+		const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		if (!file.valid() || !elf.write(file))
+			return {};
+	}
+	const fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+	std::vector<uint8_t> contents(static_cast<size_t>(file.length()));
+	return file.read(contents.data(), contents.size()) ? contents : std::vector<uint8_t>{};
+}
+
+// Writes the archive as GNU ar does, with the "/" index listing every member's symbols
+[[nodiscard]] static bool writeArchive(const path &fileName, const path &objectName)
+{
+	std::vector<std::vector<uint8_t>> members{};
+	std::string symbolNames{};
+	for (size_t member{}; member < memberCount; ++member)
+	{
+		members.emplace_back(makeObject(objectName, member));
+		if (members.back().empty())
+			return false;
+		for (size_t symbol{}; symbol < symbolsPerMember; ++symbol)
+		{
+			symbolNames += symbolName(member, symbol);
+			symbolNames += '\0';
+		}
+	}
+	const auto symbolCount{memberCount * symbolsPerMember};
+	std::vector<uint8_t> index((symbolCount + 1U) * 4U);
+	index.insert(index.end(), symbolNames.begin(), symbolNames.end());
+	const Memory indexStorage{span{index.data(), index.size()}};
+	indexStorage.write(0U, static_cast<uint32_t>(symbolCount), Endian::big);
+	auto offset{8U + 60U + index.size() + (index.size() & 1U)};
+	for (size_t member{}; member < memberCount; ++member)
+	{
+		for (size_t symbol{}; symbol < symbolsPerMember; ++symbol)
+			indexStorage.write((1U + (member * symbolsPerMember) + symbol) * 4U, static_cast<uint32_t>(offset),
+				Endian::big);
+		offset += 60U + members[member].size() + (members[member].size() & 1U);
+	}
+
+	std::string archive{"!<arch>\n"};
+	const auto appendMember{[&](const std::string_view name, const std::vector<uint8_t> &data)
+	{
+		archive += fmt::format("{:<16}{:<12}{:<6}{:<6}{:<8}{:<10}`\n"sv, name, 0, 0, 0, 644, data.size());
+		archive.append(data.begin(), data.end());
+		if (archive.size() & 1U)
+			archive += '\n';
+	}};
+	appendMember("/"sv, index);
+	for (size_t member{}; member < memberCount; ++member)
+		appendMember(fmt::format("m{}.o/"sv, member), members[member]);
+	const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+	return file.valid() && file.write(archive.data(), archive.size());
+}
+
+// Finds the member defining name by loading each member in turn and searching its symbol table
+[[nodiscard]] static const uint8_t *scan(const std::vector<mangrove::ar::Member> &members,
+	const std::string_view name)
+{
+	for (const auto &member : members)
+	{
+		const ELF elf{member.data};
+		if (!elf.valid())
+			continue;
+		const auto &headers{elf.sectionHeaders()};
+		for (size_t section{}; section < headers.size(); ++section)
+		{
+			if (headers[section].type() != SectionHeaderType::symbolTable)
+				continue;
+			const auto names{elf.stringTable(headers[section].link())};
+			const auto count{elf.symbolCount(section)};
+			for (size_t index{1U}; index < count; ++index)
+			{
+				const auto symbol{elf.symbol(section, index)};
+				if (symbol.sectionIndex() && names.stringFromOffset(symbol.nameOffset()) == name)
+					return member.data.data();
+			}
+		}
+	}
+	return nullptr;
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	const auto directory{std::filesystem::temp_directory_path() / "mangroveBenchArchive"};
+	std::filesystem::create_directories(directory);
+	const auto fileName{directory / "library.a"};
+	if (!writeArchive(fileName, directory / "object.o"))
+	{
+		console.error("Failed to write "sv, fileName.string());
+		return 1;
+	}
+	// A spread of symbols from across the whole archive
+	std::vector<std::string> queries{};
+	for (size_t query{}; query < 1024U; ++query)
+		queries.emplace_back(symbolName((query * 7919U) % memberCount, query % symbolsPerMember));
+
+	auto begin{benchClock::now()};
+	Archive archive{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+	const auto openTime{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+	if (!archive.valid() || archive.symbolCount() != memberCount * symbolsPerMember)
+	{
+		console.error("Failed to read the archive's index"sv);
+		return 1;
+	}
+	console.info(fmt::format("Opened {} member archive, reading {} symbols into the index, in {:.2f} ms"sv,
+		memberCount, archive.symbolCount(), openTime * 1e3));
+
+	size_t found{};
+	begin = benchClock::now();
+	for (size_t lookup{}; lookup < indexedLookups; ++lookup)
+	{
+		const auto *const object{archive.resolve(queries[lookup % queries.size()])};
+		found += object && object->valid();
+	}
+	const auto indexed{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+
+	const auto members{archive.members()};
+	begin = benchClock::now();
+	for (size_t lookup{}; lookup < scannedLookups; ++lookup)
+		found += scan(members, queries[lookup % queries.size()]) != nullptr;
+	const auto scanned{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+	if (found != indexedLookups + scannedLookups)
+	{
+		console.error("Failed to find every symbol"sv);
+		return 1;
+	}
+
+	console.info(fmt::format("index: {:.2f} M lookups/s"sv, static_cast<double>(indexedLookups) / indexed / 1e6));
+	console.info(fmt::format("scan:  {:.2f} k lookups/s"sv, static_cast<double>(scannedLookups) / scanned / 1e3));
+	console.info(fmt::format("speedup: {:.0f}x"sv, (scanned / scannedLookups) / (indexed / indexedLookups)));
+	std::filesystem::remove_all(directory);
+	return 0;
+}
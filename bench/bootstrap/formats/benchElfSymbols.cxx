@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/formats/elf/elf.hxx"
+
+/**
+ * @file benchElfSymbols.cxx
+ * @brief Symbol table decoding benchmark - writes a 100k entry symbol table in each ELF class and endian,
+ * then reports symbols/s for reading every field of every symbol through the per-field accessors
+ * against decoding the table in bulk with ELF::readTable()
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::io::hostEndian;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionHeaderType;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t symbolCount{100000U};
+constexpr static size_t iterations{50U};
+
+[[nodiscard]] static bool writeObject(const path &fileName, const Class elfClass, const Endian endian)
+{
+	const auto symbolSize{elfClass == Class::elf32Bit ? elf32::ELFSymbol::size() : elf64::ELFSymbol::size()};
+	std::vector<uint8_t> table(symbolCount * symbolSize);
+	const Memory storage{span{table.data(), table.size()}};
+	for (size_t index{}; index < symbolCount; ++index)
+	{
+		const auto offset{index * symbolSize};
+		const auto info{static_cast<uint8_t>(((index % 3U) << 4U) | (index % 3U))};
+		if (elfClass == Class::elf32Bit)
+		{
+			storage.write(offset, static_cast<uint32_t>(index * 12U), endian);
+			storage.write(offset + 4U, static_cast<uint32_t>(0x1000U + (index * 16U)), endian);
+			storage.write(offset + 8U, static_cast<uint32_t>(index % 256U), endian);
+			storage.write(offset + 12U, info);
+			storage.write(offset + 14U, static_cast<uint16_t>(index % 7U), endian);
+		}
+		else
+		{
+			storage.write(offset, static_cast<uint32_t>(index * 12U), endian);
+			storage.write(offset + 4U, info);
+			storage.write(offset + 6U, static_cast<uint16_t>(index % 7U), endian);
+			storage.write(offset + 8U, static_cast<uint64_t>(0x400000U + (index * 16U)), endian);
+			storage.write(offset + 16U, static_cast<uint64_t>(index % 256U), endian);
+		}
+	}
+	ELF elf{elfClass, endian, Machine::nonSpecific};
+	static_cast<void>(elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+		span{table.data(), table.size()}, 8U));
+	const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+	return file.valid() && elf.write(file);
+}
+
+// Reads every field of every symbol through the ELFSymbol accessors, as the code using them does
+[[nodiscard]] static uint64_t perField(const ELF &elf, const size_t section)
+{
+	uint64_t checksum{};
+	const auto count{elf.symbolCount(section)};
+	for (size_t index{}; index < count; ++index)
+	{
+		const auto symbol{elf.symbol(section, index)};
+		checksum += symbol.nameOffset() + symbol.value() + symbol.symbolLength() + symbol.info() +
+			symbol.other() + symbol.sectionIndex();
+	}
+	return checksum;
+}
+
+template<typename Record> [[nodiscard]] static uint64_t bulk(const ELF &elf, const size_t section,
+	std::vector<Record> &symbols)
+{
+	uint64_t checksum{};
+	static_cast<void>(elf.readTable(section, symbols));
+	for (const auto &symbol : symbols)
+		checksum += symbol.nameOffset + symbol.value + symbol.symbolLength + symbol.info + symbol.other +
+			symbol.sectionIndex;
+	return checksum;
+}
+
+template<typename F> [[nodiscard]] static double symbolsPerSecond(const F &decode, uint64_t &checksum)
+{
+	const auto begin{benchClock::now()};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+		checksum += decode();
+	const auto seconds{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+	return static_cast<double>(symbolCount * iterations) / seconds;
+}
+
+template<typename Record> static bool benchmark(const path &fileName, const Class elfClass, const Endian endian)
+{
+	if (!writeObject(fileName, elfClass, endian))
+		return false;
+	const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+	const auto section{elf.sectionIndex(".symtab"sv)};
+	if (!elf.valid() || !section)
+		return false;
+
+	std::vector<Record> symbols{};
+	uint64_t fieldChecksum{};
+	uint64_t bulkChecksum{};
+	const auto fieldRate{symbolsPerSecond([&]() { return perField(elf, *section); }, fieldChecksum)};
+	const auto bulkRate{symbolsPerSecond([&]() { return bulk(elf, *section, symbols); }, bulkChecksum)};
+	console.info(fmt::format("{}-bit {:>6} endian{}: {:7.2f} M symbols/s per-field, {:7.2f} M symbols/s bulk, {:.2f}x"sv,
+		elfClass == Class::elf32Bit ? 32 : 64, endian == Endian::little ? "little"sv : "big"sv,
+		endian == hostEndian ? " (native)"sv : " (swapped)"sv, fieldRate / 1e6, bulkRate / 1e6, bulkRate / fieldRate));
+	if (fieldChecksum != bulkChecksum)
+	{
+		console.error("Bulk and per-field decoding disagree"sv);
+		return false;
+	}
+	return true;
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	const auto fileName{std::filesystem::temp_directory_path() / "mangroveBenchElfSymbols.o"};
+	const auto result
+	{
+		benchmark<elf32::SymbolRecord>(fileName, Class::elf32Bit, Endian::little) &&
+		benchmark<elf32::SymbolRecord>(fileName, Class::elf32Bit, Endian::big) &&
+		benchmark<elf64::SymbolRecord>(fileName, Class::elf64Bit, Endian::little) &&
+		benchmark<elf64::SymbolRecord>(fileName, Class::elf64Bit, Endian::big)
+	};
+	std::filesystem::remove(fileName);
+	return result ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <chrono>
+#include <random>
+#include <string_view>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/span>
+#include "../../../src/bootstrap/formats/elf/relocation.hxx"
+
+/**
+ * @file benchRelocation.cxx
+ * @brief Relocation application benchmark - applies a table of 2M x86-64 relocations of randomly
+ * mixed types to a section, comparing the batched Relocator against a loop that switches on each entry's
+ * type and writes it through io::Memory, the way the relocation would be done without the engine
+ */
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using substrate::span;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::relocation::Relocator;
+namespace elf64 = mangrove::elf::types::elf64;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t relocationCount{2000000U};
+constexpr static size_t symbolCount{4096U};
+constexpr static size_t iterations{10U};
+constexpr static uint64_t address{0x400000U};
+
+// R_X86_64_64, R_X86_64_PC32, R_X86_64_PLT32, R_X86_64_32 and R_X86_64_32S
+constexpr static std::array<uint32_t, 5> types{{1U, 2U, 4U, 10U, 11U}};
+
+[[nodiscard]] static bool applyNaive(const Memory &section, const std::vector<elf64::RelaRecord> &relocations,
+	const std::vector<uint64_t> &symbols, const Endian endian)
+{
+	for (const auto &relocation : relocations)
+	{
+		const auto value{symbols[relocation.symbol()] + static_cast<uint64_t>(relocation.addend)};
+		const auto place{address + relocation.offset};
+		switch (relocation.type())
+		{
+			case 1U:
+				section.write(relocation.offset, value, endian);
+				break;
+			case 2U:
+			case 4U:
+				section.write(relocation.offset, static_cast<uint32_t>(value - place), endian);
+				break;
+			case 10U:
+			case 11U:
+				section.write(relocation.offset, static_cast<uint32_t>(value), endian);
+				break;
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+static void benchmark(const Endian endian)
+{
+	std::minstd_rand random{};
+	std::vector<elf64::RelaRecord> relocations(relocationCount);
+	// Every relocation gets its own 8 byte field, in offset order as compilers emit them, but of random type
+	for (size_t index{}; index < relocationCount; ++index)
+	{
+		const auto type{types[random() % types.size()]};
+		const auto symbol{random() % symbolCount};
+		relocations[index] = {index * 8U, (uint64_t{symbol} << 32U) | type, static_cast<int64_t>(random() % 64U)};
+	}
+	std::vector<uint64_t> symbols(symbolCount);
+	for (size_t index{}; index < symbolCount; ++index)
+		symbols[index] = address + (index * 64U);
+	std::vector<uint8_t> section(relocationCount * 8U);
+	const span<uint8_t> contents{section.data(), section.size()};
+
+	Relocator relocator{Machine::x86_64, endian};
+	const auto batchBegin{benchClock::now()};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+	{
+		if (!relocator.apply(contents, address, span<const elf64::RelaRecord>{relocations.data(), relocations.size()},
+			span<const uint64_t>{symbols.data(), symbols.size()}).success())
+			console.error("Batched relocation failed"sv);
+	}
+	const auto batchEnd{benchClock::now()};
+	const auto batched{section};
+
+	const Memory storage{contents};
+	const auto naiveBegin{benchClock::now()};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+	{
+		if (!applyNaive(storage, relocations, symbols, endian))
+			console.error("Naive relocation failed"sv);
+	}
+	const auto naiveEnd{benchClock::now()};
+	if (section != batched)
+		console.error("Batched and naive relocation disagree"sv);
+
+	const auto rate{[](const benchClock::time_point begin, const benchClock::time_point end)
+		{ return static_cast<double>(relocationCount * iterations) / std::chrono::duration<double>{end - begin}.count(); }};
+	const auto batchRate{rate(batchBegin, batchEnd)};
+	const auto naiveRate{rate(naiveBegin, naiveEnd)};
+	console.info(fmt::format("{:>6} endian: {:7.2f} M relocations/s naive, {:7.2f} M relocations/s batched, {:.2f}x"sv,
+		endian == Endian::little ? "little"sv : "big"sv, naiveRate / 1e6, batchRate / 1e6, batchRate / naiveRate));
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	benchmark(Endian::little);
+	benchmark(Endian::big);
+	return 0;
+}
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/link/linker.hxx"
+#include "../../../src/bootstrap/formats/elf/elf.hxx"
+
+/**
+ * @file benchLinker.cxx
+ * @brief Static linking benchmark - generates a program of x86-64 objects built as if with
+ * -ffunction-sections, each defining functions that call into and read globals from other objects,
+ * then times linking it with a single worker and with one per hardware thread, both as is and with
+ * unreachable sections collected and identical ones folded
+ */
+
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::elf::types::StringTableBuilder;
+using mangrove::link::LinkOptions;
+using mangrove::link::LinkResult;
+namespace elf64 = mangrove::elf::types::elf64;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t objectCount{512U};
+constexpr static size_t functionsPerObject{128U};
+constexpr static size_t globalsPerObject{128U};
+constexpr static size_t functionLength{64U};
+// How many other objects' functions and globals each object refers to
+constexpr static size_t importsPerObject{256U};
+constexpr static size_t callsPerFunction{6U};
+constexpr static size_t iterations{5U};
+// Where each object's .data goes, after the null section, .shstrtab and a section per function
+constexpr static uint16_t dataSection{2U + functionsPerObject};
+
+// x86-64 relocation types
+constexpr static uint32_t R_X86_64_64{1U};
+constexpr static uint32_t R_X86_64_PC32{2U};
+constexpr static uint32_t R_X86_64_PLT32{4U};
+
+[[nodiscard]] static bool writeObject(const path &fileName, const size_t object)
+{
+	StringTableBuilder names{};
+	// The null symbol, the object's definitions, the function _start lives in, then its imports
+	const auto symbolCount{1U + functionsPerObject + globalsPerObject + importsPerObject};
+	std::vector<uint8_t> symbols(symbolCount * elf64::ELFSymbol::size());
+	const Memory symbolStorage{span{symbols.data(), symbols.size()}};
+	const auto addSymbol{[&](const size_t index, const std::string &name, const uint16_t section, const uint64_t value)
+	{
+		const auto offset{index * elf64::ELFSymbol::size()};
+		symbolStorage.write(offset, names.add(name), Endian::little);
+		symbolStorage.write(offset + 4U, uint8_t{0x10U});
+		symbolStorage.write(offset + 6U, section, Endian::little);
+		symbolStorage.write(offset + 8U, value, Endian::little);
+	}};
+	for (size_t function{}; function < functionsPerObject; ++function)
+	{
+		const auto name{object || function ? fmt::format("f{}_{}"sv, object, function) : std::string{"_start"sv}};
+		addSymbol(1U + function, name, static_cast<uint16_t>(2U + function), 0U);
+	}
+	for (size_t global{}; global < globalsPerObject; ++global)
+		addSymbol(1U + functionsPerObject + global, fmt::format("g{}_{}"sv, object, global), dataSection, global * 8U);
+	// Half the imports are functions, half globals, from objects spread across the program
+	for (size_t import{}; import < importsPerObject; ++import)
+	{
+		const auto other{(object + 1U + (import * 37U)) % objectCount};
+		const auto index{(import * 13U) % functionsPerObject};
+		const auto name{import % 2U ? fmt::format("g{}_{}"sv, other, index) :
+			other || index ? fmt::format("f{}_{}"sv, other, index) : std::string{"_start"sv}};
+		addSymbol(1U + functionsPerObject + globalsPerObject + import, name, 0U, 0U);
+	}
+
+	// Each function makes some calls and loads some globals, the rest of it being int3 padding, except
+	// every fourth, which is an identical leaf function that just returns
+	std::vector<std::vector<uint8_t>> text(functionsPerObject, std::vector<uint8_t>(functionLength, 0xccU));
+	std::vector<std::vector<uint8_t>> textRelocations(functionsPerObject);
+	const auto addRelocation{[](std::vector<uint8_t> &table, const uint64_t offset, const size_t symbol,
+		const uint32_t type, const int64_t addend)
+	{
+		const auto position{table.size()};
+		table.resize(position + elf64::ELFRelocation::size(true));
+		const Memory storage{span{table.data() + position, elf64::ELFRelocation::size(true)}};
+		storage.write(0U, offset, Endian::little);
+		storage.write(8U, (uint64_t{symbol} << 32U) | type, Endian::little);
+		storage.write(16U, static_cast<uint64_t>(addend), Endian::little);
+	}};
+	const auto firstImport{1U + functionsPerObject + globalsPerObject};
+	for (size_t function{}; function < functionsPerObject; ++function)
+	{
+		if (function % 4U == 3U)
+		{
+			text[function][0] = 0xc3U;
+			continue;
+		}
+		for (size_t call{}; call < callsPerFunction; ++call)
+		{
+			const auto offset{call * 10U};
+			const auto import{((function * callsPerFunction) + call) % importsPerObject};
+			// call rel32 to a function, or mov eax, [rip + rel32] from a global
+			text[function][offset] = import % 2U ? 0x8bU : 0xe8U;
+			if (import % 2U)
+				text[function][offset + 1U] = 0x05U;
+			const auto field{offset + (import % 2U ? 2U : 1U)};
+			addRelocation(textRelocations[function], field, firstImport + import,
+				import % 2U ? R_X86_64_PC32 : R_X86_64_PLT32, -4);
+		}
+	}
+	// And every global holds a pointer to one of this object's leaf functions
+	std::vector<uint8_t> data(globalsPerObject * 8U);
+	std::vector<uint8_t> dataRelocations{};
+	for (size_t global{}; global < globalsPerObject; ++global)
+		addRelocation(dataRelocations, global * 8U, 1U + (((global * 4U) + 3U) % functionsPerObject), R_X86_64_64, 0);
+	const auto stringData{names.storage()};
+
+	ELF elf{Class::elf64Bit, Endian::little, Machine::x86_64};
+	for (size_t function{}; function < functionsPerObject; ++function)
+		static_cast<void>(elf.addSection(fmt::format(".text.f{}"sv, function), SectionHeaderType::program,
+			{SectionFlag::allocate, SectionFlag::execuable}, span{text[function].data(), text[function].size()}, 16U));
+	static_cast<void>(elf.addSection(".data"sv, SectionHeaderType::program,
+		{SectionFlag::allocate, SectionFlag::writeable}, span{data.data(), data.size()}, 8U));
+	const auto strtab{elf.addSection(".strtab"sv, SectionHeaderType::stringTable, {},
+		span{stringData.data(), stringData.length()})};
+	const auto symtab{elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+		span{symbols.data(), symbols.size()}, 8U)};
+	elf.sectionHeaders()[symtab].link(static_cast<uint32_t>(strtab));
+	elf.sectionHeaders()[symtab].info(1U);
+	const auto addRelocations{[&](const std::string &name, const std::vector<uint8_t> &table, const uint32_t target)
+	{
+		if (table.empty())
+			return;
+		const auto index{elf.addSection(name, SectionHeaderType::relocAddend, {SectionFlag::infoLink},
+			span{table.data(), table.size()}, 8U)};
+		elf.sectionHeaders()[index].link(static_cast<uint32_t>(symtab));
+		elf.sectionHeaders()[index].info(target);
+	}};
+	for (size_t function{}; function < functionsPerObject; ++function)
+		addRelocations(fmt::format(".rela.text.f{}"sv, function), textRelocations[function],
+			static_cast<uint32_t>(2U + function));
+	addRelocations(".rela.data"s, dataRelocations, dataSection);
+	const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+	return file.valid() && elf.write(file);
+}
+
+static void benchmark(const std::vector<path> &objects, const path &output, const size_t workers,
+	const bool reduce)
+{
+	LinkOptions options{};
+	options.output = output;
+	options.workers = workers;
+	options.collectGarbage = reduce;
+	options.foldIdentical = reduce;
+	LinkResult result{};
+	const auto begin{benchClock::now()};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+		result = mangrove::link::link(objects, options);
+	const auto elapsed{std::chrono::duration<double>{benchClock::now() - begin}.count() / iterations};
+	for (const auto &error : result.errors)
+		console.error(error);
+	console.info(fmt::format("{:>3} workers{}: {:.2f} ms per link, {:.0f} objects/s, {:.2f} M relocations/s, "
+		"{:.2f} MiB/s written"sv, workers, reduce ? " (collect, fold)"sv : ""sv, elapsed * 1e3,
+		static_cast<double>(result.objects) / elapsed, static_cast<double>(result.relocations) / elapsed / 1e6,
+		static_cast<double>(result.outputLength) / elapsed / 1048576.0));
+	for (const auto &saving : result.savings)
+		console.info(fmt::format("    {}: {} bytes collected, {} bytes folded"sv, saving.name, saving.collected,
+			saving.folded));
+}
+
+int main(int, char **)
+{
+	console = {stdout, stderr};
+	const auto directory{std::filesystem::temp_directory_path() / "mangroveBenchLinker"};
+	std::filesystem::create_directories(directory);
+	std::vector<path> objects{};
+	for (size_t object{}; object < objectCount; ++object)
+	{
+		const auto &fileName{objects.emplace_back(directory / fmt::format("object{}.o"sv, object))};
+		if (!writeObject(fileName, object))
+		{
+			console.error("Failed to write "sv, fileName.string());
+			return 1;
+		}
+	}
+
+	const auto output{directory / "program"sv};
+	const auto threads{std::max(std::thread::hardware_concurrency(), 1U)};
+	for (const auto reduce : {false, true})
+	{
+		benchmark(objects, output, 1U, reduce);
+		benchmark(objects, output, threads, reduce);
+	}
+	std::filesystem::remove_all(directory);
+	return 0;
+}
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/parser/tokeniser.hxx"
+
+/**
+ * @file benchLexer.cxx
+ * @brief Lexer throughput benchmark - tokenises either the files given on the command line or a
+ * set of synthetic source files (mixed code, a numeric table and a string table) with both the scalar and table-driven
+ * engines, both keeping and coalescing trivia, reporting tokens/s and MB/s.
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::parser::Tokeniser;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::TriviaMode;
+using mangrove::parser::types::Token;
+using mangrove::parser::types::TokenType;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t iterations{10U};
+constexpr static size_t syntheticBlocks{5000U};
+
+static std::string syntheticSource()
+{
+	std::string source{"import std.io as io\nfrom std.math import min, max\n\n"};
+	for (size_t block{}; block < syntheticBlocks; ++block)
+	{
+		source += fmt::format(
+			"# Block {0}\n"
+			"const Int32 value{0} = {0} + 2 * (other - 0x{0:x}) << 1 // trailing comment\n"
+			"if value{0} >= 0b101 and not flag {{ name = \"value\\t{0}\\n\"; chr = '\\u3bb' }}\n"
+			"/* a block comment spanning\n   more than one line */\n"
+			"while value{0} != 0 {{ value{0} >>= 1; count++ }}\n"sv, block);
+	}
+	return source;
+}
+
+// Builds a source file that's almost entirely integer literals, like a lookup table or initialiser data
+static std::string numericSource()
+{
+	std::string source{"const UInt64 table = {\n"};
+	for (uint64_t row{}; row < syntheticBlocks * 4U; ++row)
+	{
+		const auto value{row * UINT64_C(0x9e3779b97f4a7c15)};
+		source += fmt::format("\t{}, 0x{:x}, 0b{:b}, 0c{:o}, {},\n"sv,
+			value, value, value >> 40U, value >> 16U, value >> 32U);
+	}
+	return source + "}\n";
+}
+
+// Builds a source file that's mostly long string literals, like a message catalogue
+static std::string stringSource()
+{
+	std::string source{"const String messages = {\n"};
+	for (size_t row{}; row < syntheticBlocks * 4U; ++row)
+		source += fmt::format("\t\"Message {0}: the operation on 'item {0}' could not be completed, "
+			"please try again later (código {0:x}) \u2014 or don't\\n\",\n"sv, row);
+	return source + "}\n";
+}
+
+static bool writeSource(const path &fileName, const std::string &source)
+{
+	const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+	return file.valid() && file.write(source.data(), source.size());
+}
+
+static void benchmarkEngine(const path &fileName, const LexerEngine engine, const std::string_view engineName,
+	const bool batched = false, const TriviaMode trivia = TriviaMode::preserve)
+{
+	const auto fileSize{std::filesystem::file_size(fileName)};
+	size_t tokens{};
+	benchClock::duration elapsed{};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+	{
+		const auto begin{benchClock::now()};
+		Tokeniser tokeniser{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, trivia};
+		tokens = 0U;
+		if (batched)
+		{
+			std::array<Token, 64U> batch{};
+			size_t count{};
+			do
+			{
+				count = tokeniser.next(batch);
+				tokens += count;
+			}
+			while (batch[count - 1U].type() != TokenType::eof);
+			// Don't count the EOF token
+			--tokens;
+		}
+		else
+		{
+			while (tokeniser.next().type() != TokenType::eof)
+				++tokens;
+		}
+		elapsed += benchClock::now() - begin;
+	}
+
+	const auto seconds{std::chrono::duration<double>{elapsed}.count()};
+	console.info(fmt::format("  {:>16}: {} tokens, {:.0f} tokens/s, {:.2f} MB/s"sv, engineName, tokens,
+		static_cast<double>(tokens * iterations) / seconds, static_cast<double>(fileSize * iterations) / seconds / 1e6));
+}
+
+static void benchmarkFile(const path &fileName)
+{
+	console.info(fmt::format("{}: {} bytes, {} iterations"sv, fileName.filename().string(),
+		std::filesystem::file_size(fileName), iterations));
+	benchmarkEngine(fileName, LexerEngine::scalar, "scalar"sv);
+	benchmarkEngine(fileName, LexerEngine::table, "table"sv);
+	benchmarkEngine(fileName, LexerEngine::table, "batched"sv, true);
+	benchmarkEngine(fileName, LexerEngine::scalar, "scalar coalesced"sv, false, TriviaMode::coalesce);
+	benchmarkEngine(fileName, LexerEngine::table, "table coalesced"sv, true, TriviaMode::coalesce);
+}
+
+int main(int argCount, char **argList)
+{
+	console = {stdout, stderr};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	try
+	{
+		if (!args.empty())
+		{
+			for (const std::string_view arg : args)
+				benchmarkFile(arg);
+			return 0;
+		}
+
+		const auto codeFileName{std::filesystem::temp_directory_path() / "mangroveBenchLexer.mg"};
+		const auto numericFileName{std::filesystem::temp_directory_path() / "mangroveBenchLexerNumeric.mg"};
+		const auto stringFileName{std::filesystem::temp_directory_path() / "mangroveBenchLexerString.mg"};
+		if (!writeSource(codeFileName, syntheticSource()) || !writeSource(numericFileName, numericSource()) ||
+			!writeSource(stringFileName, stringSource()))
+		{
+			console.error("Failed to write synthetic sources to "sv, codeFileName.parent_path().c_str());
+			return 1;
+		}
+		benchmarkFile(codeFileName);
+		benchmarkFile(numericFileName);
+		benchmarkFile(stringFileName);
+		std::filesystem::remove(codeFileName);
+		std::filesystem::remove(numericFileName);
+		std::filesystem::remove(stringFileName);
+		return 0;
+	}
+	catch (const std::exception &error)
+	{
+		console.error("Benchmark failed: "sv, error.what());
+		return 1;
+	}
+}
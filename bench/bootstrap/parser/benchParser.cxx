@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "../../../src/bootstrap/parser/parser.hxx"
+
+/**
+ * @file benchParser.cxx
+ * @brief Parse throughput benchmark - parses either the files given on the command line or a
+ * synthetic source file repeatedly, both lexing in step with the parser and with the lexer pipelined
+ * onto its own thread, reporting nodes/s, MB/s and AST bytes per source byte.
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::parser::Parser;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::Pipelining;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static size_t iterations{10U};
+constexpr static size_t syntheticBlocks{5000U};
+
+// Builds a source file exercising each of the statement forms and most of the operator table
+static std::string syntheticSource()
+{
+	std::string source{"import std.io as io\nfrom std.math import min, max\n\n"};
+	for (size_t block{}; block < syntheticBlocks; ++block)
+	{
+		source += fmt::format(
+			"{{\n"
+			"\tconst Int32 a{0} = {0} + 2 * (b - c) << 1\n"
+			"\tUInt64 b{0} = 0x{0:x} | 0b101 & 0c17\n"
+			"\tif a{0} >= b{0} and not flag {{\n"
+			"\t\ta{0} += f(a{0}, b{0})[1].value++\n"
+			"\t}}\n"
+			"\telif a{0} == 0 {{ return }}\n"
+			"\telse {{ b{0} = -a{0} }}\n"
+			"\tfor (Int32 i = 0; i < 10; ++i) {{ total = total + i * a{0} }}\n"
+			"\twhile a{0} != 0 {{ a{0} = a{0} / 2 }}\n"
+			"}}\n"sv, block);
+	}
+	return source;
+}
+
+static bool writeSource(const path &fileName, const std::string &source)
+{
+	const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+	return file.valid() && file.write(source.data(), source.size());
+}
+
+static bool benchmarkMode(const path &fileName, const Pipelining pipelining, const std::string_view modeName)
+{
+	const auto fileSize{std::filesystem::file_size(fileName)};
+	size_t nodes{};
+	size_t astBytes{};
+	benchClock::duration elapsed{};
+	for (size_t iteration{}; iteration < iterations; ++iteration)
+	{
+		const auto begin{benchClock::now()};
+		Parser parser{fileName, LexerEngine::scalar, pipelining};
+		if (!parser.parse())
+		{
+			console.error("Failed to parse "sv, fileName.c_str());
+			return false;
+		}
+		elapsed += benchClock::now() - begin;
+		nodes = parser.ast().nodeCount();
+		astBytes = parser.ast().bytesUsed();
+	}
+
+	const auto seconds{std::chrono::duration<double>{elapsed}.count()};
+	const auto totalNodes{static_cast<double>(nodes * iterations)};
+	const auto totalBytes{static_cast<double>(fileSize * iterations)};
+	console.info(fmt::format("  {:>9}: {} nodes in {:.3f}s, {:.0f} nodes/s, {:.2f} MB/s, {:.2f} AST bytes per source byte"sv,
+		modeName, nodes, seconds, totalNodes / seconds, totalBytes / seconds / 1e6,
+		static_cast<double>(astBytes) / static_cast<double>(fileSize)));
+	return true;
+}
+
+static bool benchmarkFile(const path &fileName)
+{
+	console.info(fmt::format("{}: {} bytes, {} iterations"sv, fileName.filename().string(),
+		std::filesystem::file_size(fileName), iterations));
+	return benchmarkMode(fileName, Pipelining::none, "direct"sv) &&
+		benchmarkMode(fileName, Pipelining::threaded, "pipelined"sv);
+}
+
+int main(int argCount, char **argList)
+{
+	console = {stdout, stderr};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	try
+	{
+		if (!args.empty())
+		{
+			for (const std::string_view arg : args)
+			{
+				if (!benchmarkFile(arg))
+					return 1;
+			}
+			return 0;
+		}
+
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveBenchParser.mg"};
+		if (!writeSource(fileName, syntheticSource()))
+		{
+			console.error("Failed to write synthetic source to "sv, fileName.c_str());
+			return 1;
+		}
+		const auto result{benchmarkFile(fileName)};
+		std::filesystem::remove(fileName);
+		return result ? 0 : 1;
+	}
+	catch (const std::exception &error)
+	{
+		console.error("Benchmark failed: "sv, error.what());
+		return 1;
+	}
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <functional>
+#include <string_view>
+#include "moduleScope.hxx"
+#include "../core/trace.hxx"
+#include "../core/memory.hxx"
+
+using namespace mangrove::ast::symbolTable;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
+
+static size_t hashOf(const StringView &ident) noexcept
+	{ return std::hash<std::string_view>{}({ident.data(), ident.byteLength()}); }
+
+static size_t roundUpToPowerOf2(const size_t value) noexcept
+{
+	size_t result{1U};
+	while (result < value)
+		result <<= 1U;
+	return result;
+}
+
+ModuleScope::ModuleScope(const size_t bucketCount) :
+	// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+	_buckets{std::make_unique<std::atomic<Entry *> []>(roundUpToPowerOf2(bucketCount))},
+	_bucketMask{roundUpToPowerOf2(bucketCount) - 1U}
+{
+	for (size_t bucket{}; bucket <= _bucketMask; ++bucket)
+		_buckets[bucket].store(nullptr, std::memory_order_relaxed);
+}
+
+ModuleScope::~ModuleScope() noexcept
+{
+	// By the time the scope's being destroyed, all the threads using it must be done with it
+	for (size_t bucket{}; bucket <= _bucketMask; ++bucket)
+	{
+		for (auto *entry{_buckets[bucket].load(std::memory_order_acquire)}; entry; )
+			delete std::exchange(entry, entry->next);
+	}
+}
+
+// Searches the chain from entry up to (but not including) end for ident
+ModuleScope::Entry *ModuleScope::findIn(Entry *entry, const Entry *const end, const size_t hash,
+	const StringView &ident) noexcept
+{
+	for (; entry != end; entry = entry->next)
+	{
+		if (entry->hash == hash && StringView{entry->ident} == ident)
+			return entry;
+	}
+	return nullptr;
+}
+
+std::pair<Symbol *, bool> ModuleScope::insert(const StringView &ident, const SymbolType &type)
+{
+	const PhaseScope phase{Phase::symbol};
+	count(Counter::symbolsInserted);
+	const auto hash{hashOf(ident)};
+	auto &bucket{_buckets[hash & _bucketMask]};
+	auto *head{bucket.load(std::memory_order_acquire)};
+	// Check before allocating anything, as redeclarations usually find the symbol already there
+	if (auto *const existing{findIn(head, nullptr, hash, ident)}; existing)
+		return {&existing->symbol, false};
+
+	auto entry{std::make_unique<Entry>(hash, ident, type)};
+	entry->next = head;
+	// Publish the entry at the head of the chain. When another thread gets in first, the failed
+	// exchange hands us the new head, and only the entries between it and the head we'd already
+	// searched from can be a competing declaration of the same name
+	while (!bucket.compare_exchange_weak(entry->next, entry.get(), std::memory_order_release,
+		std::memory_order_acquire))
+	{
+		if (auto *const existing{findIn(entry->next, head, hash, ident)}; existing)
+			return {&existing->symbol, false};
+		head = entry->next;
+	}
+	_entryCount.fetch_add(1U, std::memory_order_relaxed);
+	return {&entry.release()->symbol, true};
+}
+
+Symbol *ModuleScope::find(const StringView &ident) const noexcept
+{
+	count(Counter::symbolsLookedUp);
+	const auto hash{hashOf(ident)};
+	auto *const entry{findIn(_buckets[hash & _bucketMask].load(std::memory_order_acquire), nullptr, hash, ident)};
+	return entry ? &entry->symbol : nullptr;
+}
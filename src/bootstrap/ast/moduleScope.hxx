@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef AST_MODULE_SCOPE_HXX
+#define AST_MODULE_SCOPE_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include "symbolTable.hxx"
+
+/**
+ * @file moduleScope.hxx
+ * @brief Concurrent insert-once symbol table for a module's top-level scope
+ */
+
+namespace mangrove::ast::symbolTable
+{
+	/**
+	 * Holds a module's top-level symbols so that worker threads analysing different files of the
+	 * module can declare and resolve them concurrently.
+	 *
+	 * The table is a fixed array of buckets, each the head of an immutable singly-linked chain.
+	 * Inserting publishes a fully constructed entry at the head of its chain with a single
+	 * compare-and-swap, and entries are never removed or moved, so lookups are wait-free: they take
+	 * no locks and never retry, just walking a chain that can only grow at its head.
+	 * Pointers to symbols remain valid for the lifetime of the table.
+	 */
+	struct ModuleScope final
+	{
+	private:
+		struct Entry final
+		{
+			size_t hash;
+			String ident;
+			Symbol symbol;
+			// Only ever written before the entry is published
+			Entry *next;
+
+			Entry(const size_t identHash, const StringView &identValue, const SymbolType &type) noexcept :
+				hash{identHash}, ident{identValue}, symbol{ident, type}, next{nullptr} { }
+		};
+
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		std::unique_ptr<std::atomic<Entry *> []> _buckets;
+		size_t _bucketMask;
+		std::atomic<size_t> _entryCount{};
+
+		[[nodiscard]] static Entry *findIn(Entry *entry, const Entry *end, size_t hash,
+			const StringView &ident) noexcept;
+
+	public:
+		/** Constructs a scope with at least bucketCount buckets (rounded up to a power of 2) */
+		ModuleScope(size_t bucketCount = 4096U);
+		ModuleScope(const ModuleScope &) = delete;
+		ModuleScope(ModuleScope &&) = delete;
+		ModuleScope &operator =(const ModuleScope &) = delete;
+		ModuleScope &operator =(ModuleScope &&) = delete;
+		~ModuleScope() noexcept;
+
+		/**
+		 * Declares ident with the given type if nothing by that name exists in the scope yet.
+		 * Returns the symbol for ident along with whether this call was the one that inserted it -
+		 * when several threads race to declare the same name, exactly one of them wins.
+		 */
+		[[nodiscard]] std::pair<Symbol *, bool> insert(const StringView &ident, const SymbolType &type = {});
+		[[nodiscard]] Symbol *find(const StringView &ident) const noexcept;
+
+		[[nodiscard]] auto entryCount() const noexcept { return _entryCount.load(std::memory_order_relaxed); }
+		[[nodiscard]] auto bucketCount() const noexcept { return _bucketMask + 1U; }
+	};
+} // namespace mangrove::ast::symbolTable
+
+#endif /*AST_MODULE_SCOPE_HXX*/
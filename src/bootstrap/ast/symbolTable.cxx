@@ -2,10 +2,16 @@
 #include <substrate/console>
 #include "symbolTable.hxx"
 #include "../parser/parser.hxx"
+#include "../core/trace.hxx"
+#include "../core/memory.hxx"
 
 using substrate::console;
 using namespace mangrove::ast::symbolTable;
 using mangrove::parser::Parser;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
 
 // XXX: Because C++ needs use of std::shared_ptr here, we cannot auto-push the table
 // onto the parser stack.
@@ -19,6 +25,8 @@ void SymbolTable::pop(Parser &parser) const noexcept
 
 Symbol *SymbolTable::add(String ident)
 {
+	const PhaseScope phase{Phase::symbol};
+	count(Counter::symbolsInserted);
 	// Check if the ident is already in the table, if it is this must fail.
 	if (_table.find(ident) != _table.end())
 	{
@@ -40,6 +48,8 @@ Symbol *SymbolTable::add(String ident)
 
 bool SymbolTable::insert(const Symbol &symbol)
 {
+	const PhaseScope phase{Phase::symbol};
+	count(Counter::symbolsInserted);
 	auto entry{std::make_unique<Symbol>(symbol)};
 	const auto result{_table.emplace(entry->value(), std::move(entry))};
 	return result.second;
@@ -47,6 +57,7 @@ bool SymbolTable::insert(const Symbol &symbol)
 
 Symbol *SymbolTable::findLocal(const StringView &ident) const noexcept
 {
+	count(Counter::symbolsLookedUp);
 	const auto entry{_table.find(ident)};
 	if (entry == _table.end())
 		return nullptr;
@@ -6,7 +6,7 @@
 #include <map>
 #include <memory>
 #include <fmt/core.h>
-#include "../core/flags.hxx"
+#include "typePool.hxx"
 #include "../core/utf8/string.hxx"
 
 // This isn't great practice, but we don't get much choice here.
@@ -19,154 +19,55 @@ namespace mangrove::parser
 
 namespace mangrove::ast::symbolTable
 {
-	using mangrove::core::BitFlags;
 	using mangrove::core::utf8::String;
 	using mangrove::core::utf8::StringView;
 	using mangrove::parser::Parser;
 
-	enum class SymbolTypes : uint16_t
-	{
-		// Flags for integral types
-		// Integer kind flags
-		signedVal = 0U,
-		unsignedVal = 1U,
-		// Integer width flags
-		int8Bit = 0U, // Alias signedVal for 8-bit
-		int16Bit = 2U,
-		int32Bit = 3U,
-		int64Bit = 4U,
-		// Flags for other core types
-		character = 8U,
-		list = 9U,
-		// strings are character | list
-		structVal = 10U,
-		array = 11U,
-		// dictionaries are structVal | list
-		// sets are structVal | array
-		boolVal = 12U,
-		function = 13U,
-		reference = 14U,
-		pointer = 15U,
-		// This is for template type/value packs
-		pack = 16U,
-		// Placeholder for a type to be determined by the RHS of an assignment
-		autoVal = 17U,
-		none = 18U,
-		type = 19U
-	};
-
-	using TypeFlags = BitFlags<uint32_t, SymbolTypes>;
-} // namespace mangrove::ast::symbolTable
-
-template<> struct fmt::formatter<mangrove::ast::symbolTable::TypeFlags>
-{
-	using SymbolTypes = mangrove::ast::symbolTable::SymbolTypes;
-	using TypeFlags = mangrove::ast::symbolTable::TypeFlags;
-
-	[[nodiscard]] constexpr auto flagsToValue(const TypeFlags &flags) const noexcept
-	{
-		switch (flags.toRaw())
-		{
-			case TypeFlags{SymbolTypes::int8Bit}.toRaw():
-				return "Int8"sv;
-			case TypeFlags{SymbolTypes::int16Bit}.toRaw():
-				return "Int16"sv;
-			case TypeFlags{SymbolTypes::int32Bit}.toRaw():
-				return "Int32"sv;
-			case TypeFlags{SymbolTypes::int64Bit}.toRaw():
-				return "Int64"sv;
-			case TypeFlags{SymbolTypes::character}.toRaw():
-				return "Char"sv;
-			case TypeFlags{SymbolTypes::character, SymbolTypes::list}.toRaw():
-				return "String"sv;
-			case TypeFlags{SymbolTypes::boolVal}.toRaw():
-				return "Bool"sv;
-			case TypeFlags{SymbolTypes::structVal}.toRaw():
-				return "class"sv;
-			case TypeFlags{SymbolTypes::list}.toRaw():
-				return "List"sv;
-			case TypeFlags{SymbolTypes::array}.toRaw():
-				return "Array"sv;
-			case TypeFlags{SymbolTypes::structVal, SymbolTypes::list}.toRaw():
-				return "Dict"sv;
-			case TypeFlags{SymbolTypes::structVal, SymbolTypes::array}.toRaw():
-				return "Set"sv;
-			case TypeFlags{SymbolTypes::autoVal}.toRaw():
-				return "auto"sv;
-			case TypeFlags{SymbolTypes::none}.toRaw():
-				return "none"sv;
-			case TypeFlags{SymbolTypes::type}.toRaw():
-				return "type"sv;
-			case TypeFlags{SymbolTypes::function}.toRaw():
-				return "function"sv;
-			default:
-				return "invalid"sv;
-		}
-	}
-
-	constexpr auto parse(format_parse_context &ctx)
-	{
-		if (ctx.begin() != ctx.end())
-			throw format_error{"invalid format"};
-		return ctx.end();
-	}
-
-	template<typename FormatContext> auto format(const TypeFlags &flags, FormatContext &ctx) const
-		{ return fmt::format_to(ctx.out(), "{}"sv, flagsToValue(flags)); }
-};
-
-namespace mangrove::ast::symbolTable
-{
+	/**
+	 * A symbol's type, held as its ID in the type pool so comparing types is comparing IDs, and
+	 * names and properties are table lookups rather than being re-derived from the flags each time
+	 */
 	struct SymbolType final
 	{
 	private:
-		TypeFlags _type{};
+		TypeID _id{TypeID::invalid};
+
+		constexpr SymbolType(const TypeID id) noexcept : _id{id} { }
+		[[nodiscard]] const TypeInfo &info() const noexcept { return typePool().info(_id); }
 
 	public:
 		constexpr SymbolType() noexcept = default;
-		constexpr SymbolType(const SymbolTypes symbolType) noexcept : _type{symbolType} { }
-		constexpr SymbolType(const TypeFlags &symbolType) noexcept : _type{symbolType} { }
+		SymbolType(const SymbolTypes symbolType) noexcept : _id{typePool().intern(symbolType)} { }
+		SymbolType(const TypeFlags &symbolType) noexcept : _id{typePool().intern(symbolType)} { }
 
 		// NOLINTNEXTLINE(misc-unconventional-assign-operator)
-		constexpr void operator =(const SymbolTypes symbolType) noexcept { _type = symbolType; }
+		void operator =(const SymbolTypes symbolType) noexcept { _id = typePool().intern(symbolType); }
 
-		[[nodiscard]] constexpr SymbolType forValue() const noexcept
-		{
-			if (_type == SymbolTypes::type)
-				return *this;
-			return {_type.without(SymbolTypes::type)};
-		}
+		[[nodiscard]] SymbolType forValue() const noexcept { return {info().valueType}; }
 
 		constexpr bool operator ==(const SymbolType &symbolType) const noexcept
-			{ return _type == symbolType._type; }
-		constexpr bool operator ==(const SymbolTypes &symbolType) const noexcept
-			{ return _type == symbolType; }
+			{ return _id == symbolType._id; }
+		bool operator ==(const SymbolTypes &symbolType) const noexcept
+			{ return info().flags == symbolType; }
 
-		[[nodiscard]] constexpr auto isInvalid() const noexcept { return _type == TypeFlags{}; }
+		[[nodiscard]] constexpr auto isInvalid() const noexcept { return _id == TypeID::invalid; }
 		[[nodiscard]] constexpr SymbolType clone() const noexcept { return *this; }
 
 		template<typename... SymbolTypes>
-		[[nodiscard]] constexpr auto includes(SymbolTypes ...types) const noexcept
-			{ return _type.includes(types...); }
+		[[nodiscard]] auto includes(SymbolTypes ...types) const noexcept
+			{ return info().flags.includes(types...); }
 		template<typename... SymbolTypes>
-		[[nodiscard]] constexpr SymbolType without(SymbolTypes ...types) const noexcept
-			{ return {_type.without(types...)}; }
+		[[nodiscard]] SymbolType without(SymbolTypes ...types) const noexcept
+			{ return {typePool().intern(info().flags.without(types...))}; }
 
-		[[nodiscard]] std::string toString() const noexcept
-		{
-			const auto reference{_type.includes(SymbolTypes::reference) ? "reference "sv : ""sv};
-			const auto pointer{_type.includes(SymbolTypes::pointer) ? "pointer "sv : ""sv};
-			const auto kind{reference.empty() ? pointer : reference};
-			const auto signdness{_type.includes(SymbolTypes::unsignedVal) ? "u"sv : ""sv};
-			const auto isType{_type != SymbolTypes::type && _type.includes(SymbolTypes::type)};
-			auto type{_type.without(SymbolTypes::reference, SymbolTypes::pointer, SymbolTypes::unsignedVal)};
-			if (isType)
-			{
-				type.clear(SymbolTypes::type);
-				return fmt::format("type {}'{}{}'"sv, kind, signdness, type);
-			}
-			return fmt::format("{}{}{}"sv, kind, signdness, type);
-		}
+		[[nodiscard]] constexpr auto id() const noexcept { return _id; }
+		[[nodiscard]] const auto &flags() const noexcept { return info().flags; }
+		[[nodiscard]] auto isType() const noexcept { return info().isType; }
+		[[nodiscard]] auto isInteger() const noexcept { return info().isInteger; }
+		[[nodiscard]] auto isSigned() const noexcept { return info().isSigned; }
+		[[nodiscard]] auto width() const noexcept { return info().width; }
+
+		[[nodiscard]] std::string toString() const noexcept { return info().name; }
 	};
 
 	struct Symbol final
@@ -186,7 +87,7 @@ namespace mangrove::ast::symbolTable
 		[[nodiscard]] const auto &value() const noexcept { return _ident; }
 		void type(const SymbolType &type) noexcept { _type = type; }
 		[[nodiscard]] auto type() const noexcept { return _type; }
-		[[nodiscard]] auto isType() { return _type.includes(SymbolTypes::type); }
+		[[nodiscard]] auto isType() const noexcept { return _type.isType(); }
 		[[nodiscard]] Symbol clone() const noexcept { return *this; }
 
 		[[nodiscard]] std::string toString() const noexcept
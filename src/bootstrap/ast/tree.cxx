@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include "tree.hxx"
+
+using namespace mangrove::ast;
+
+NodeIndex Tree::make(const NodeType type, const SourceRange source, const Operator op)
+{
+	// If the current block is full (or there isn't one yet), grab a fresh one
+	if ((_nodeCount & blockMask) == 0U && (_nodeCount >> blockShift) == _blocks.size())
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		_blocks.emplace_back(std::make_unique<Node []>(nodesPerBlock));
+	const auto index{static_cast<NodeIndex>(_nodeCount++)};
+	auto &result{node(index)};
+	result.type = type;
+	result.op = op;
+	result.source = source;
+	return index;
+}
+
+StringRef Tree::intern(const std::string_view value)
+{
+	const auto offset{_strings.size()};
+	_strings.append(value);
+	return {static_cast<uint32_t>(offset), static_cast<uint32_t>(value.length())};
+}
+
+NodeIndex Tree::appendChild(const NodeIndex parent, const NodeIndex tail, const NodeIndex child) noexcept
+{
+	if (tail == noNode)
+		node(parent).firstChild = child;
+	else
+		node(tail).nextSibling = child;
+	++node(parent).childCount;
+	return child;
+}
+
+NodeIndex Tree::child(const NodeIndex parent, const size_t childIndex) const noexcept
+{
+	auto result{node(parent).firstChild};
+	for (size_t index{}; index < childIndex && result != noNode; ++index)
+		result = node(result).nextSibling;
+	return result;
+}
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef AST_TREE_HXX
+#define AST_TREE_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../parser/types.hxx"
+
+/**
+ * @file tree.hxx
+ * @brief Arena-allocated abstract syntax tree representation
+ */
+
+namespace mangrove::ast
+{
+	inline namespace internal
+	{
+		using mangrove::parser::types::SourceRange;
+	} // namespace internal
+
+	using NodeIndex = uint32_t;
+	constexpr inline NodeIndex noNode{UINT32_MAX};
+
+	enum class NodeType : uint8_t
+	{
+		invalid,
+		empty,
+		ident,
+		intLit,
+		binLit,
+		octLit,
+		hexLit,
+		stringLit,
+		charLit,
+		boolLit,
+		nullptrLit,
+		unaryOp,
+		postfixOp,
+		binaryOp,
+		assignment,
+		call,
+		index,
+		member,
+		block,
+		specifier,
+		declaration,
+		ifStmt,
+		whileStmt,
+		doStmt,
+		forStmt,
+		returnStmt,
+		importStmt,
+		fromImportStmt,
+		importName,
+	};
+
+	enum class Operator : uint8_t
+	{
+		none,
+		add,
+		subtract,
+		multiply,
+		divide,
+		modulo,
+		shiftLeft,
+		shiftRight,
+		bitAnd,
+		bitOr,
+		bitXor,
+		logicAnd,
+		logicOr,
+		less,
+		lessEqual,
+		greater,
+		greaterEqual,
+		equal,
+		notEqual,
+		assign,
+		plus,
+		negate,
+		logicNot,
+		invert,
+		increment,
+		decrement,
+	};
+
+	// Reference to a run of bytes in a Tree's string storage
+	struct StringRef final
+	{
+		uint32_t offset{};
+		uint32_t length{};
+	};
+
+	/**
+	 * A single AST node. Children are held as an intrusive singly-linked list of node indices
+	 * (firstChild, then each child's nextSibling) so that every node is the same size and no
+	 * node needs any storage beyond its slot in the arena. Integer literal nodes have no text, so
+	 * their value field instead holds the literal's decoded 64-bit value (see Tree::integer()).
+	 */
+	struct Node final
+	{
+		NodeType type{NodeType::invalid};
+		Operator op{Operator::none};
+		uint32_t childCount{};
+		NodeIndex firstChild{noNode};
+		NodeIndex nextSibling{noNode};
+		SourceRange source{};
+		StringRef value{};
+	};
+
+	/**
+	 * Per-file bump arena holding all the nodes of a file's AST. Nodes are carved out of fixed-size
+	 * blocks so references to them remain valid as the tree grows, and are linked by index.
+	 * Node values (identifiers, literal text) are bump-allocated in a single string buffer.
+	 */
+	struct Tree final
+	{
+	private:
+		constexpr static size_t blockShift{12U};
+		constexpr static size_t nodesPerBlock{size_t{1U} << blockShift};
+		constexpr static size_t blockMask{nodesPerBlock - 1U};
+
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		std::vector<std::unique_ptr<Node []>> _blocks{};
+		size_t _nodeCount{};
+		std::string _strings{};
+
+	public:
+		Tree() = default;
+		Tree(const Tree &) = delete;
+		Tree(Tree &&) noexcept = default;
+		Tree &operator =(const Tree &) = delete;
+		Tree &operator =(Tree &&) noexcept = default;
+		~Tree() noexcept = default;
+
+		[[nodiscard]] NodeIndex make(NodeType type, SourceRange source, Operator op = Operator::none);
+		[[nodiscard]] StringRef intern(std::string_view value);
+		/** Appends child to parent's children, where tail is the last child appended (or noNode) */
+		NodeIndex appendChild(NodeIndex parent, NodeIndex tail, NodeIndex child) noexcept;
+
+		[[nodiscard]] Node &node(const NodeIndex index) noexcept
+			{ return _blocks[index >> blockShift][index & blockMask]; }
+		[[nodiscard]] const Node &node(const NodeIndex index) const noexcept
+			{ return _blocks[index >> blockShift][index & blockMask]; }
+		[[nodiscard]] Node &operator [](const NodeIndex index) noexcept { return node(index); }
+		[[nodiscard]] const Node &operator [](const NodeIndex index) const noexcept { return node(index); }
+
+		[[nodiscard]] NodeIndex child(NodeIndex parent, size_t childIndex) const noexcept;
+		[[nodiscard]] std::string_view value(const NodeIndex index) const noexcept
+			{ return value(node(index).value); }
+		[[nodiscard]] std::string_view value(const StringRef &value) const noexcept
+			{ return std::string_view{_strings}.substr(value.offset, value.length); }
+
+		[[nodiscard]] uint64_t integer(const NodeIndex index) const noexcept
+		{
+			const auto &value{node(index).value};
+			return (uint64_t{value.length} << 32U) | value.offset;
+		}
+		void integer(const NodeIndex index, const uint64_t value) noexcept
+			{ node(index).value = {static_cast<uint32_t>(value), static_cast<uint32_t>(value >> 32U)}; }
+
+		[[nodiscard]] auto nodeCount() const noexcept { return _nodeCount; }
+		/** Number of bytes of node and string storage in use */
+		[[nodiscard]] size_t bytesUsed() const noexcept { return _nodeCount * sizeof(Node) + _strings.size(); }
+		/** Number of bytes of node and string storage allocated */
+		[[nodiscard]] size_t bytesAllocated() const noexcept
+			{ return _blocks.size() * nodesPerBlock * sizeof(Node) + _strings.capacity(); }
+	};
+} // namespace mangrove::ast
+
+#endif /*AST_TREE_HXX*/
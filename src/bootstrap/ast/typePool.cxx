@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <fmt/format.h>
+#include <substrate/console>
+#include "typePool.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using namespace mangrove::ast::symbolTable;
+
+namespace mangrove::ast::symbolTable
+{
+	// Names for the integral types, indexed by log2(width) - 3
+	constexpr static std::array<std::string_view, 4U> integerNames{"Int8"sv, "Int16"sv, "Int32"sv, "Int64"sv};
+
+	// Names for everything else, by the exact flags once qualifiers have been stripped
+	constexpr static std::array<std::pair<TypeFlags, std::string_view>, 12U> typeNames
+	{{
+		{{SymbolTypes::character}, "Char"sv},
+		{{SymbolTypes::character, SymbolTypes::list}, "String"sv},
+		{{SymbolTypes::boolVal}, "Bool"sv},
+		{{SymbolTypes::structVal}, "class"sv},
+		{{SymbolTypes::list}, "List"sv},
+		{{SymbolTypes::array}, "Array"sv},
+		{{SymbolTypes::structVal, SymbolTypes::list}, "Dict"sv},
+		{{SymbolTypes::structVal, SymbolTypes::array}, "Set"sv},
+		{{SymbolTypes::autoVal}, "auto"sv},
+		{{SymbolTypes::none}, "none"sv},
+		{{SymbolTypes::type}, "type"sv},
+		{{SymbolTypes::function}, "function"sv},
+	}};
+} // namespace mangrove::ast::symbolTable
+
+TypePool::TypePool() noexcept
+{
+	// Function-local statics are constructed exactly once, so nothing else can be interning yet.
+	// Interning the empty type first guarantees it ID 0, which is what default-constructed types hold
+	static_cast<void>(internLocked(TypeFlags{}));
+}
+
+TypePool &TypePool::instance() noexcept
+{
+	static TypePool pool{};
+	return pool;
+}
+
+size_t TypePool::slotFor(const uint32_t flags) noexcept
+{
+	// Fibonacci hashing spreads the handful of set bits in a type across the whole table
+	const auto hash{uint64_t{flags} * UINT64_C(0x9e3779b97f4a7c15)};
+	return static_cast<size_t>(hash >> 32U) & (slotCount - 1U);
+}
+
+// Finds the ID for flags if they've been interned, leaving slot at the matching or first free slot
+std::optional<TypeID> TypePool::lookup(const uint32_t flags, size_t &slot) const noexcept
+{
+	// The table is never more than half full, so there's always a free slot to end the probe
+	for (slot = slotFor(flags); ; slot = (slot + 1U) & (slotCount - 1U))
+	{
+		const auto entry{_slots[slot].load(std::memory_order_acquire)};
+		if (!entry)
+			return std::nullopt;
+		if (static_cast<uint32_t>(entry >> 32U) == flags)
+			return static_cast<TypeID>(entry & UINT64_C(0xffff));
+	}
+}
+
+TypeID TypePool::intern(const TypeFlags &flags) noexcept
+{
+	size_t slot{};
+	if (const auto type{lookup(flags.toRaw(), slot)}; type)
+		return *type;
+	const std::lock_guard<std::mutex> lock{_internLock};
+	return internLocked(flags);
+}
+
+TypeID TypePool::internLocked(const TypeFlags &flags) noexcept
+{
+	size_t slot{};
+	// Another thread may have interned the type while we waited for the lock
+	if (const auto existing{lookup(flags.toRaw(), slot)}; existing)
+		return *existing;
+	const auto index{_typeCount.load(std::memory_order_relaxed)};
+	if (index == capacity)
+	{
+		console.error("Too many distinct types in program, type pool exhausted"sv);
+		return TypeID::invalid;
+	}
+	const auto type{static_cast<TypeID>(index)};
+	_types[index].flags = flags;
+	_typeCount.store(index + 1U, std::memory_order_release);
+	describe(type);
+	// describe() may have interned this type's value type, taking our slot, so probe again
+	static_cast<void>(lookup(flags.toRaw(), slot));
+	_slots[slot].store((uint64_t{flags.toRaw()} << 32U) | slotUsed | index, std::memory_order_release);
+	return type;
+}
+
+void TypePool::describe(const TypeID type) noexcept
+{
+	auto &info{_types[static_cast<size_t>(type)]};
+	const auto &flags{info.flags};
+	info.isType = flags.includes(SymbolTypes::type);
+	info.isInteger = flags.includes(SymbolTypes::int8Bit, SymbolTypes::int16Bit, SymbolTypes::int32Bit,
+		SymbolTypes::int64Bit);
+	if (info.isInteger)
+	{
+		info.isSigned = !flags.includes(SymbolTypes::unsignedVal);
+		if (flags.includes(SymbolTypes::int64Bit))
+			info.width = 64U;
+		else if (flags.includes(SymbolTypes::int32Bit))
+			info.width = 32U;
+		else if (flags.includes(SymbolTypes::int16Bit))
+			info.width = 16U;
+		else
+			info.width = 8U;
+	}
+
+	// A type-of-a-type's values are of the type itself, anything else's values are of that same type
+	const auto isTypeOfType{info.isType && flags != SymbolTypes::type};
+	info.valueType = isTypeOfType ? internLocked(flags.without(SymbolTypes::type)) : type;
+
+	auto baseType{flags.without(SymbolTypes::reference, SymbolTypes::pointer, SymbolTypes::unsignedVal)};
+	if (isTypeOfType)
+		baseType.clear(SymbolTypes::type);
+	if (info.isInteger)
+		info.baseName = integerNames[static_cast<size_t>(__builtin_ctz(info.width)) - 3U];
+	for (const auto &[typeFlags, name] : typeNames)
+	{
+		if (baseType == typeFlags)
+			info.baseName = name;
+	}
+
+	const auto kind{flags.includes(SymbolTypes::reference) ? "reference "sv :
+		flags.includes(SymbolTypes::pointer) ? "pointer "sv : ""sv};
+	const auto signedness{flags.includes(SymbolTypes::unsignedVal) ? "u"sv : ""sv};
+	if (isTypeOfType)
+		info.name = fmt::format("type {}'{}{}'"sv, kind, signedness, info.baseName);
+	else
+		info.name = fmt::format("{}{}{}"sv, kind, signedness, info.baseName);
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef AST_TYPE_POOL_HXX
+#define AST_TYPE_POOL_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include "../core/flags.hxx"
+
+/**
+ * @file typePool.hxx
+ * @brief Canonical intern pool mapping each distinct symbol type to a small ID
+ */
+
+namespace mangrove::ast::symbolTable
+{
+	using mangrove::core::BitFlags;
+
+	enum class SymbolTypes : uint16_t
+	{
+		// Flags for integral types
+		// Integer kind flags
+		signedVal = 0U,
+		unsignedVal = 1U,
+		// Integer width flags
+		int8Bit = 0U, // Alias signedVal for 8-bit
+		int16Bit = 2U,
+		int32Bit = 3U,
+		int64Bit = 4U,
+		// Flags for other core types
+		character = 8U,
+		list = 9U,
+		// strings are character | list
+		structVal = 10U,
+		array = 11U,
+		// dictionaries are structVal | list
+		// sets are structVal | array
+		boolVal = 12U,
+		function = 13U,
+		reference = 14U,
+		pointer = 15U,
+		// This is for template type/value packs
+		pack = 16U,
+		// Placeholder for a type to be determined by the RHS of an assignment
+		autoVal = 17U,
+		none = 18U,
+		type = 19U
+	};
+
+	using TypeFlags = BitFlags<uint32_t, SymbolTypes>;
+
+	/** Small, dense handle on an interned type - two types are the same type exactly when their IDs are equal */
+	enum class TypeID : uint16_t
+	{
+		// The type with no flags set, which is always interned first
+		invalid = 0U,
+	};
+
+	/** Everything about a type that's derivable from its flags, computed once when the type is interned */
+	struct TypeInfo final
+	{
+		TypeFlags flags{};
+		// The name of the underlying type ignoring qualifiers, as used to format TypeFlags
+		std::string_view baseName{"invalid"};
+		// The fully qualified name, as returned by SymbolType::toString()
+		std::string name{};
+		// The type values of this type have - identical to this type unless it's a type-of-a-type
+		TypeID valueType{TypeID::invalid};
+		// Width of an integral type in bits, or 0 for non-integral types
+		uint8_t width{};
+		bool isInteger{false};
+		bool isSigned{false};
+		bool isType{false};
+	};
+
+	/**
+	 * Interns symbol types so each distinct set of type flags is handed out exactly one small ID, with
+	 * its names and properties precomputed alongside it in a table indexed by that ID.
+	 *
+	 * Lookups probe an open-addressed table of atomically published slots, taking no locks. Interning
+	 * a type the pool hasn't seen before takes a lock, but there are only ever a handful of distinct
+	 * types in a program so this is rare, and a type's table entry is complete before its ID is
+	 * published so any ID a thread can see is safe to look up.
+	 */
+	struct TypePool final
+	{
+	public:
+		constexpr static size_t capacity{4096U};
+
+	private:
+		// Twice as many slots as types so probe sequences stay short
+		constexpr static size_t slotCount{capacity * 2U};
+		constexpr static uint64_t slotUsed{UINT64_C(1) << 16U};
+
+		std::array<TypeInfo, capacity> _types{};
+		std::array<std::atomic<uint64_t>, slotCount> _slots{};
+		std::atomic<size_t> _typeCount{};
+		std::mutex _internLock{};
+
+		TypePool() noexcept;
+		[[nodiscard]] static size_t slotFor(uint32_t flags) noexcept;
+		[[nodiscard]] std::optional<TypeID> lookup(uint32_t flags, size_t &slot) const noexcept;
+		[[nodiscard]] TypeID internLocked(const TypeFlags &flags) noexcept;
+		void describe(TypeID type) noexcept;
+
+	public:
+		TypePool(const TypePool &) = delete;
+		TypePool(TypePool &&) = delete;
+		TypePool &operator =(const TypePool &) = delete;
+		TypePool &operator =(TypePool &&) = delete;
+		~TypePool() noexcept = default;
+
+		/** Returns the process-wide type pool */
+		[[nodiscard]] static TypePool &instance() noexcept;
+
+		/** Returns the canonical ID for the given type flags, interning them on first sight */
+		[[nodiscard]] TypeID intern(const TypeFlags &flags) noexcept;
+		[[nodiscard]] const TypeInfo &info(const TypeID type) const noexcept
+			{ return _types[static_cast<size_t>(type)]; }
+		[[nodiscard]] size_t typeCount() const noexcept { return _typeCount.load(std::memory_order_acquire); }
+	};
+
+	[[nodiscard]] inline TypePool &typePool() noexcept { return TypePool::instance(); }
+} // namespace mangrove::ast::symbolTable
+
+template<> struct fmt::formatter<mangrove::ast::symbolTable::TypeFlags>
+{
+	using TypeFlags = mangrove::ast::symbolTable::TypeFlags;
+
+	[[nodiscard]] auto flagsToValue(const TypeFlags &flags) const noexcept
+	{
+		auto &pool{mangrove::ast::symbolTable::typePool()};
+		return pool.info(pool.intern(flags)).baseName;
+	}
+
+	constexpr auto parse(format_parse_context &ctx)
+	{
+		if (ctx.begin() != ctx.end())
+			throw format_error{"invalid format"};
+		return ctx.end();
+	}
+
+	template<typename FormatContext> auto format(const TypeFlags &flags, FormatContext &ctx) const
+		{ return fmt::format_to(ctx.out(), "{}", flagsToValue(flags)); }
+};
+
+#endif /*AST_TYPE_POOL_HXX*/
@@ -0,0 +1,554 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "buildGraph.hxx"
+#include "importScanner.hxx"
+#include "../core/trace.hxx"
+#include "../formats/elf/io.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::core::loader::LoadedSource;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::nameThread;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Endian;
+
+namespace mangrove::build
+{
+	namespace
+	{
+		/*
+		 * The cache is a little-endian header of magic, version and entry count, followed by an entry per file:
+		 * its size, modification time and content hash (all 64-bit), whether it last built successfully (8-bit),
+		 * its path, the number of imports and each import, then the number of modules in the build those
+		 * imports resolved to and each of their names. Strings are a 32-bit length then the bytes.
+		 */
+		constexpr uint32_t cacheMagic{0x4347424dU}; // "MBGC"
+		constexpr uint32_t cacheVersion{2U};
+
+		struct CacheEntry final
+		{
+			uint64_t size{};
+			int64_t modified{};
+			uint64_t hash{};
+			bool built{};
+			std::vector<std::string> imports{};
+			std::vector<std::string> resolvedImports{};
+		};
+
+		/** Reads the cache's fields in order, failing (rather than reading out of bounds) if it's truncated */
+		struct CacheReader final
+		{
+		private:
+			Memory _storage;
+			size_t _offset{};
+
+		public:
+			CacheReader(const span<uint8_t> storage) noexcept : _storage{storage} { }
+
+			template<typename T> [[nodiscard]] bool read(T &value) noexcept
+			{
+				if (_storage.length() - _offset < sizeof(T))
+					return false;
+				if constexpr (sizeof(T) == 1U)
+					value = _storage.read<T>(_offset);
+				else
+					value = _storage.read<T>(_offset, Endian::little);
+				_offset += sizeof(T);
+				return true;
+			}
+
+			[[nodiscard]] bool read(std::string &value)
+			{
+				uint32_t length{};
+				if (!read(length) || _storage.length() - _offset < length)
+					return false;
+				value.assign(reinterpret_cast<const char *>(_storage.data() + _offset), length);
+				_offset += length;
+				return true;
+			}
+
+			[[nodiscard]] bool atEnd() const noexcept { return _offset == _storage.length(); }
+		};
+
+		struct CacheWriter final
+		{
+		private:
+			std::vector<uint8_t> _data{};
+
+		public:
+			template<typename T> void write(const T &value)
+			{
+				const auto offset{_data.size()};
+				_data.resize(offset + sizeof(T));
+				const Memory storage{span{_data.data(), _data.size()}};
+				if constexpr (sizeof(T) == 1U)
+					storage.write(offset, value);
+				else
+					storage.write(offset, value, Endian::little);
+			}
+
+			void writeString(const std::string_view value)
+			{
+				write(static_cast<uint32_t>(value.length()));
+				_data.insert(_data.end(), value.begin(), value.end());
+			}
+
+			[[nodiscard]] const auto &data() const noexcept { return _data; }
+		};
+
+		// Reads count strings, never reserving more of them than the cache has bytes to hold
+		[[nodiscard]] bool readStrings(CacheReader &reader, const uint32_t count, const size_t cacheLength,
+			std::vector<std::string> &strings)
+		{
+			strings.resize(std::min<size_t>(count, cacheLength));
+			for (auto &string : strings)
+			{
+				if (!reader.read(string))
+					return false;
+			}
+			return strings.size() == count;
+		}
+
+		[[nodiscard]] std::unordered_map<std::string, CacheEntry> readCache(const path &cacheFile)
+		{
+			const ScopedTimer timer{"readCache"sv};
+			const fd_t file{cacheFile.c_str(), O_RDONLY | O_NOCTTY | O_CLOEXEC};
+			const auto length{file.valid() ? file.length() : -1};
+			if (length <= 0)
+				return {};
+			std::vector<uint8_t> data(static_cast<size_t>(length));
+			if (!file.read(data.data(), data.size()))
+				return {};
+
+			// A cache that doesn't read back cleanly is dropped entirely, which just makes for a full rebuild
+			CacheReader reader{span{data.data(), data.size()}};
+			uint32_t magic{};
+			uint32_t version{};
+			uint32_t entryCount{};
+			if (!reader.read(magic) || magic != cacheMagic || !reader.read(version) || version != cacheVersion ||
+				!reader.read(entryCount))
+				return {};
+			std::unordered_map<std::string, CacheEntry> entries{};
+			entries.reserve(entryCount);
+			for (uint32_t index{}; index < entryCount; ++index)
+			{
+				std::string fileName{};
+				CacheEntry entry{};
+				uint64_t modified{};
+				uint8_t built{};
+				uint32_t importCount{};
+				if (!reader.read(entry.size) || !reader.read(modified) || !reader.read(entry.hash) ||
+					!reader.read(built) || !reader.read(fileName) || !reader.read(importCount))
+					return {};
+				entry.modified = static_cast<int64_t>(modified);
+				entry.built = built != 0U;
+				if (!readStrings(reader, importCount, data.size(), entry.imports) ||
+					!reader.read(importCount) ||
+					!readStrings(reader, importCount, data.size(), entry.resolvedImports))
+					return {};
+				entries.emplace(std::move(fileName), std::move(entry));
+			}
+			if (!reader.atEnd())
+				return {};
+			return entries;
+		}
+
+		/** A queue of modules ready to build, fed as the modules they import finish */
+		struct ReadyQueue final
+		{
+		private:
+			std::mutex _lock{};
+			std::condition_variable _ready{};
+			std::deque<size_t> _modules{};
+			size_t _outstanding;
+
+		public:
+			ReadyQueue(const size_t outstanding) noexcept : _outstanding{outstanding} { }
+
+			[[nodiscard]] std::mutex &lock() noexcept { return _lock; }
+
+			// Must be called with the lock held
+			void push(const size_t module)
+			{
+				_modules.emplace_back(module);
+				_ready.notify_one();
+			}
+
+			// Must be called with the lock held, once per module either built or given up on
+			void finished() noexcept
+			{
+				if (!--_outstanding)
+					_ready.notify_all();
+			}
+
+			[[nodiscard]] std::optional<size_t> pop()
+			{
+				std::unique_lock lock{_lock};
+				_ready.wait(lock, [this]() noexcept { return !_modules.empty() || !_outstanding; });
+				if (_modules.empty())
+					return std::nullopt;
+				const auto module{_modules.front()};
+				_modules.pop_front();
+				return module;
+			}
+		};
+
+		// Whether a path has empty, "." or ".." components that lexically_normal() would have to remove
+		[[nodiscard]] bool isDenormal(const std::string_view fileName) noexcept
+		{
+			return fileName.find("//"sv) != std::string_view::npos || fileName.find("/."sv) != std::string_view::npos ||
+				fileName.front() == '.' || fileName.back() == '/';
+		}
+	} // namespace
+
+	std::string moduleNameFor(const path &fileName, const path &root)
+	{
+		// The common case of a normalised file under a normalised root needs no path decomposition
+		const auto &file{fileName.native()};
+		const auto &prefix{root.native()};
+		if (file.length() > prefix.length() + 1U && file.compare(0, prefix.length(), prefix) == 0 &&
+			file[prefix.length()] == '/' && !isDenormal(file))
+		{
+			auto name{file.substr(prefix.length() + 1U)};
+			const auto separator{name.rfind('/')};
+			const auto extension{name.rfind('.')};
+			if (extension != std::string::npos && (separator == std::string::npos || extension > separator + 1U))
+				name.erase(extension);
+			std::replace(name.begin(), name.end(), '/', '.');
+			return name;
+		}
+
+		auto relative{fileName.lexically_relative(root)};
+		if (relative.empty() || *relative.begin() == "..")
+			relative = fileName.filename();
+		relative.replace_extension();
+		std::string name{};
+		for (const auto &component : relative)
+		{
+			if (!name.empty())
+				name += '.';
+			name += component.string();
+		}
+		return name;
+	}
+
+	BuildGraph::BuildGraph(path cacheFile, path root) :
+		_cacheFile{std::move(cacheFile)}, _root{std::filesystem::absolute(root).lexically_normal()} { }
+
+	void BuildGraph::scan(const std::vector<path> &files, const SourceLoader &loader)
+	{
+		const ScopedTimer timer{"BuildGraph::scan"sv};
+		auto cache{readCache(_cacheFile)};
+		_modules.clear();
+		_modules.reserve(files.size());
+		_modified = cache.size() != files.size();
+
+		std::unordered_map<std::string, size_t> moduleIndex{};
+		moduleIndex.reserve(files.size());
+		std::vector<path> changedFiles{};
+		// std::filesystem::absolute() asks the kernel for the working directory every call, so do that once
+		const auto workingDirectory{std::filesystem::current_path()};
+		for (const auto &file : files)
+		{
+			auto fileName{file.is_absolute() ? file : workingDirectory / file};
+			if (isDenormal(fileName.native()))
+				fileName = fileName.lexically_normal();
+			// The same file given twice is the same module
+			if (!moduleIndex.try_emplace(fileName.native(), _modules.size()).second)
+				continue;
+			auto &module{_modules.emplace_back()};
+			module.name = moduleNameFor(fileName, _root);
+			module.fileName = std::move(fileName);
+
+			struct stat fileStat{};
+			if (::stat(module.fileName.c_str(), &fileStat))
+			{
+				module.error = errno;
+				_modified = true;
+				continue;
+			}
+			module.size = static_cast<uint64_t>(fileStat.st_size);
+			module.modified = (int64_t{fileStat.st_mtim.tv_sec} * 1000000000) + fileStat.st_mtim.tv_nsec;
+
+			// If the file looks untouched, take everything else from the cache without reading it
+			const auto entry{cache.find(module.fileName.native())};
+			if (entry != cache.end() && entry->second.size == module.size && entry->second.modified == module.modified)
+			{
+				module.hash = entry->second.hash;
+				module.imports = std::move(entry->second.imports);
+				module.resolvedImports = std::move(entry->second.resolvedImports);
+				module.changed = !entry->second.built;
+				_modified |= module.changed;
+			}
+			else
+			{
+				changedFiles.emplace_back(module.fileName);
+				_modified = true;
+			}
+		}
+
+		// The rest must be read, but their headers only rescanned if their contents actually changed
+		loader.load(changedFiles, [&](LoadedSource &&source)
+		{
+			auto &module{_modules[moduleIndex.at(source.fileName.native())]};
+			if (!source.valid())
+			{
+				module.error = source.error;
+				return;
+			}
+			module.hash = hashSource(source.buffer.view());
+			const auto entry{cache.find(module.fileName.native())};
+			if (entry != cache.end() && entry->second.hash == module.hash)
+			{
+				module.imports = entry->second.imports;
+				module.resolvedImports = entry->second.resolvedImports;
+				module.changed = !entry->second.built;
+			}
+			else
+				module.imports = scanImports(std::move(source.buffer));
+		});
+
+		resolveImports();
+		sortModules();
+	}
+
+	void BuildGraph::resolveImports()
+	{
+		// Imports naming modules outside the build (the standard library, say) don't affect scheduling
+		std::unordered_map<std::string_view, size_t> modulesByName{};
+		modulesByName.reserve(_modules.size());
+		for (size_t index{}; index < _modules.size(); ++index)
+			modulesByName.try_emplace(_modules[index].name, index);
+		std::vector<std::string> resolvedImports{};
+		for (size_t index{}; index < _modules.size(); ++index)
+		{
+			auto &module{_modules[index]};
+			resolvedImports.clear();
+			for (const auto &import : module.imports)
+			{
+				const auto dependency{modulesByName.find(import)};
+				if (dependency == modulesByName.end() || dependency->second == index ||
+					std::find(module.dependencies.begin(), module.dependencies.end(), dependency->second) !=
+						module.dependencies.end())
+					continue;
+				module.dependencies.emplace_back(dependency->second);
+				_modules[dependency->second].dependents.emplace_back(index);
+				resolvedImports.emplace_back(import);
+			}
+			// An import that now finds a module it didn't, or no longer finds one it did, changes what this
+			// module builds against even though its own file is untouched
+			if (resolvedImports != module.resolvedImports)
+			{
+				module.resolvedImports.swap(resolvedImports);
+				module.changed = true;
+				_modified = true;
+			}
+		}
+	}
+
+	void BuildGraph::sortModules()
+	{
+		// Kahn's algorithm - anything left unplaced at the end is in, or depends on, an import cycle
+		_order.clear();
+		_order.reserve(_modules.size());
+		std::vector<size_t> pending(_modules.size());
+		for (size_t index{}; index < _modules.size(); ++index)
+		{
+			pending[index] = _modules[index].dependencies.size();
+			if (!pending[index])
+				_order.emplace_back(index);
+		}
+		for (size_t next{}; next < _order.size(); ++next)
+		{
+			auto &module{_modules[_order[next]]};
+			// Visiting in dependency order means each module's dependencies are all settled by now
+			module.dirty = module.changed || module.error || std::any_of(module.dependencies.begin(),
+				module.dependencies.end(), [&](const size_t dependency) { return _modules[dependency].dirty; });
+			for (const auto dependent : module.dependents)
+			{
+				if (!--pending[dependent])
+					_order.emplace_back(dependent);
+			}
+		}
+		for (size_t index{}; index < _modules.size(); ++index)
+		{
+			if (pending[index])
+			{
+				_modules[index].cyclic = true;
+				_modules[index].dirty = true;
+			}
+		}
+	}
+
+	size_t BuildGraph::dirtyCount() const noexcept
+	{
+		return static_cast<size_t>(std::count_if(_modules.begin(), _modules.end(),
+			[](const Module &module) noexcept { return module.dirty; }));
+	}
+
+	BuildResult BuildGraph::build(const BuildAction &action, const size_t workers)
+	{
+		const ScopedTimer timer{"BuildGraph::build"sv};
+		BuildResult result{};
+		// For each module, how many of its dirty dependencies are yet to finish, and whether any failed
+		std::vector<size_t> pending(_modules.size());
+		std::vector<bool> blocked(_modules.size());
+		size_t dirty{};
+		for (const auto &module : _modules)
+		{
+			if (module.cyclic)
+			{
+				console.error("Module "sv, module.name, " is part of, or imports, an import cycle"sv);
+				++result.failed;
+			}
+			else if (module.dirty)
+				++dirty;
+			else
+				++result.upToDate;
+		}
+		if (!dirty)
+			return result;
+		_modified = true;
+
+		ReadyQueue queue{dirty};
+		std::vector<bool> succeeded(_modules.size());
+		{
+			const std::lock_guard lock{queue.lock()};
+			for (const auto index : _order)
+			{
+				const auto &module{_modules[index]};
+				if (!module.dirty)
+					continue;
+				pending[index] = static_cast<size_t>(std::count_if(module.dependencies.begin(),
+					module.dependencies.end(), [&](const size_t dependency) { return _modules[dependency].dirty; }));
+				if (!pending[index])
+					queue.push(index);
+			}
+		}
+
+		// Settles a module with the queue lock held, releasing (or, on failure, blocking) its dependents
+		const auto finish{[&](const size_t index, const bool success)
+		{
+			// Modules whose dependencies failed are settled too, without being built, so walk those here
+			std::vector<size_t> settled{index};
+			succeeded[index] = success;
+			while (!settled.empty())
+			{
+				const auto current{settled.back()};
+				settled.pop_back();
+				queue.finished();
+				for (const auto dependent : _modules[current].dependents)
+				{
+					if (!succeeded[current])
+						blocked[dependent] = true;
+					if (--pending[dependent])
+						continue;
+					if (blocked[dependent])
+					{
+						++result.skipped;
+						settled.emplace_back(dependent);
+					}
+					else
+						queue.push(dependent);
+				}
+			}
+		}};
+
+		const auto worker{[&](const size_t id)
+		{
+			nameThread(fmt::format("build worker {}"sv, id));
+			while (const auto index{queue.pop()})
+			{
+				const auto &module{_modules[*index]};
+				bool success{false};
+				if (module.error)
+					console.error("Failed to read "sv, module.fileName.c_str(), ": "sv, std::strerror(module.error));
+				else
+					success = action(module);
+				const std::lock_guard lock{queue.lock()};
+				if (success)
+					++result.built;
+				else
+					++result.failed;
+				finish(*index, success);
+			}
+		}};
+
+		const auto threadCount{std::max<size_t>(1U, std::min(workers, dirty))};
+		std::vector<std::thread> threads{};
+		threads.reserve(threadCount - 1U);
+		for (size_t id{1U}; id < threadCount; ++id)
+			threads.emplace_back(worker, id);
+		worker(0U);
+		for (auto &thread : threads)
+			thread.join();
+
+		// Modules that built are clean as far as the next run is concerned; the rest get retried
+		for (size_t index{}; index < _modules.size(); ++index)
+		{
+			auto &module{_modules[index]};
+			if (module.dirty && !module.cyclic)
+				module.changed = !succeeded[index];
+		}
+		return result;
+	}
+
+	bool BuildGraph::save()
+	{
+		if (!_modified)
+			return true;
+		const ScopedTimer timer{"BuildGraph::save"sv};
+		CacheWriter writer{};
+		writer.write(cacheMagic);
+		writer.write(cacheVersion);
+		const auto entryCount{static_cast<size_t>(std::count_if(_modules.begin(), _modules.end(),
+			[](const Module &module) noexcept { return !module.error; }))};
+		writer.write(static_cast<uint32_t>(entryCount));
+		for (const auto &module : _modules)
+		{
+			if (module.error)
+				continue;
+			writer.write(module.size);
+			writer.write(static_cast<uint64_t>(module.modified));
+			writer.write(module.hash);
+			writer.write(static_cast<uint8_t>(!module.changed && !module.cyclic));
+			writer.writeString(module.fileName.native());
+			writer.write(static_cast<uint32_t>(module.imports.size()));
+			for (const auto &import : module.imports)
+				writer.writeString(import);
+			writer.write(static_cast<uint32_t>(module.resolvedImports.size()));
+			for (const auto &import : module.resolvedImports)
+				writer.writeString(import);
+		}
+
+		// Write the new cache alongside the old then swap it in, so an interrupted write can't leave a torn cache
+		auto tempFile{_cacheFile};
+		tempFile += ".tmp";
+		{
+			const fd_t file{tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY | O_CLOEXEC, 0644};
+			if (!file.valid() || !file.write(writer.data().data(), writer.data().size()))
+				return false;
+		}
+		if (std::rename(tempFile.c_str(), _cacheFile.c_str()))
+			return false;
+		_modified = false;
+		return true;
+	}
+} // namespace mangrove::build
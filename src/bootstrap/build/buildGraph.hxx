@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef BUILD_BUILD_GRAPH_HXX
+#define BUILD_BUILD_GRAPH_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/sourceLoader.hxx"
+
+/**
+ * @file buildGraph.hxx
+ * @brief Incremental builds driven by the graph of imports between a project's modules
+ *
+ * Each run stats every source file and compares the results against the cache left by the last
+ * run. Only files whose size or modification time moved are read again, and only those whose
+ * contents then hash differently have their import headers rescanned. So a no-op rebuild costs
+ * one cache read and a stat() per file. A module is rebuilt if it changed, if its imports now resolve
+ * to a different set of modules in the build (one was removed, or added), or if any module it imports
+ * (transitively) is being rebuilt, and the rebuilds are run across worker threads in dependency
+ * order - each module only starts once everything it imports has finished.
+ */
+
+namespace mangrove::build
+{
+	inline namespace internal
+	{
+		using std::filesystem::path;
+		using mangrove::core::loader::SourceLoader;
+	} // namespace internal
+
+	struct Module final
+	{
+		path fileName{};
+		// The module's dotted name, from its path relative to the project root
+		std::string name{};
+		// Identity of the file's contents when last scanned - its stat() results and content hash
+		uint64_t size{};
+		int64_t modified{};
+		uint64_t hash{};
+		// The errno value reading the file failed with, if any
+		int error{};
+		std::vector<std::string> imports{};
+		// The names of the modules in the build its imports resolved to. Which files are in the build can
+		// change without this file changing, so this is cached too, and a different set marks it changed
+		std::vector<std::string> resolvedImports{};
+		// Indices of the modules in the build this one imports, and of those that import it
+		std::vector<size_t> dependencies{};
+		std::vector<size_t> dependents{};
+		// Whether the contents differ from the last successful build of the file
+		bool changed{true};
+		// Whether the module needs rebuilding - because it changed, or something it imports is being rebuilt
+		bool dirty{true};
+		// Whether the module is part of, or only reachable through, an import cycle
+		bool cyclic{false};
+	};
+
+	/** Builds a single module, returning whether that succeeded. Called concurrently from the worker threads */
+	using BuildAction = std::function<bool (const Module &)>;
+
+	struct BuildResult final
+	{
+		size_t built{};
+		size_t failed{};
+		// Modules not attempted because something they import failed
+		size_t skipped{};
+		size_t upToDate{};
+
+		[[nodiscard]] bool success() const noexcept { return !failed && !skipped; }
+	};
+
+	struct BuildGraph final
+	{
+	private:
+		path _cacheFile;
+		path _root;
+		std::vector<Module> _modules{};
+		// Every module, ordered so each comes after all those it imports. Cyclic modules are left out
+		std::vector<size_t> _order{};
+		// Whether the cache needs writing back - nothing changing means nothing to write
+		bool _modified{false};
+
+		void resolveImports();
+		void sortModules();
+
+	public:
+		/** Creates a graph persisted to cacheFile, naming modules by their paths relative to root */
+		BuildGraph(path cacheFile, path root);
+
+		/**
+		 * Stats every file, rescans those that changed since the cached run, then resolves the imports
+		 * between them and works out which need rebuilding. Files that can't be read are flagged with
+		 * their error and fail when built.
+		 */
+		void scan(const std::vector<path> &files, const SourceLoader &loader);
+		/** Runs action on every dirty module across the given number of worker threads, in dependency order */
+		[[nodiscard]] BuildResult build(const BuildAction &action, size_t workers);
+		/** Writes the graph's state back to the cache file, if anything changed since it was read */
+		[[nodiscard]] bool save();
+
+		[[nodiscard]] const auto &modules() const noexcept { return _modules; }
+		[[nodiscard]] const auto &order() const noexcept { return _order; }
+		[[nodiscard]] size_t dirtyCount() const noexcept;
+	};
+
+	/** The dotted module name for a file: its path relative to root, less the extension, with '/'s as '.'s */
+	[[nodiscard]] std::string moduleNameFor(const path &fileName, const path &root);
+} // namespace mangrove::build
+
+#endif /*BUILD_BUILD_GRAPH_HXX*/
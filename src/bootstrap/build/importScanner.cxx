@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <optional>
+#include <system_error>
+#include "importScanner.hxx"
+#include "../parser/tokeniser.hxx"
+#include "../parser/integerLiteral.hxx"
+#include "../core/trace.hxx"
+
+using namespace std::literals::string_view_literals;
+using mangrove::parser::Tokeniser;
+using mangrove::parser::TriviaMode;
+using mangrove::parser::types::Token;
+using mangrove::parser::types::TokenType;
+using mangrove::parser::types::TokenSet;
+using mangrove::parser::integerLiteral::loadWord;
+using mangrove::core::trace::ScopedTimer;
+
+namespace mangrove::build
+{
+	namespace
+	{
+		constexpr TokenSet separatorTokens{TokenType::newline, TokenType::semi};
+
+		/** Just enough of the parser's import rules to walk the header, giving up at anything unexpected */
+		struct HeaderScanner final
+		{
+		private:
+			Tokeniser _lexer;
+			const Token *_current;
+			std::vector<std::string> _imports{};
+
+			void advance() noexcept { _current = &_lexer.next(); }
+
+			void skipNewlines() noexcept
+			{
+				while (_current->type() == TokenType::newline)
+					advance();
+			}
+
+			[[nodiscard]] std::string currentValue() const
+			{
+				const auto value{_current->value()};
+				return {value.data(), value.byteLength()};
+			}
+
+			// a.b.c
+			[[nodiscard]] std::optional<std::string> dottedName()
+			{
+				if (_current->type() != TokenType::ident)
+					return std::nullopt;
+				auto name{currentValue()};
+				advance();
+				while (_current->type() == TokenType::dot)
+				{
+					advance();
+					if (_current->type() != TokenType::ident)
+						return std::nullopt;
+					name += '.';
+					name += currentValue();
+					advance();
+				}
+				return name;
+			}
+
+			// a.b [as c], d - recording each name only for plain imports, not the symbols of a from-import
+			[[nodiscard]] bool importNames(const bool record)
+			{
+				while (true)
+				{
+					auto name{dottedName()};
+					if (!name)
+						return false;
+					if (record)
+						_imports.emplace_back(std::move(*name));
+					if (_current->type() == TokenType::asStmt)
+					{
+						advance();
+						if (_current->type() != TokenType::ident)
+							return false;
+						advance();
+					}
+					if (_current->type() != TokenType::comma)
+						return true;
+					advance();
+					skipNewlines();
+				}
+			}
+
+		public:
+			HeaderScanner(SourceBuffer &&source) :
+				_lexer{std::move(source), TriviaMode::coalesce}, _current{&_lexer.next()} { }
+
+			[[nodiscard]] std::vector<std::string> scan()
+			{
+				while (true)
+				{
+					while (_current->typeIn(separatorTokens))
+						advance();
+					if (_current->type() == TokenType::importStmt)
+					{
+						advance();
+						if (!importNames(true))
+							break;
+					}
+					else if (_current->type() == TokenType::fromStmt)
+					{
+						advance();
+						auto module{dottedName()};
+						if (!module)
+							break;
+						_imports.emplace_back(std::move(*module));
+						if (_current->type() != TokenType::importStmt)
+							break;
+						advance();
+						if (!importNames(false))
+							break;
+					}
+					else
+						break;
+					// Each import statement must be ended properly for the header to carry on
+					if (!_current->typeIn(separatorTokens))
+						break;
+				}
+				return std::move(_imports);
+			}
+		};
+	} // namespace
+
+	std::vector<std::string> scanImports(SourceBuffer &&source)
+	{
+		const ScopedTimer timer{"scanImports"sv};
+		if (!source.valid())
+			return {};
+		try
+			{ return HeaderScanner{std::move(source)}.scan(); }
+		// A file too large to lex has no imports we can find, and parsing it will report why
+		catch (const std::system_error &)
+			{ return {}; }
+	}
+
+	uint64_t hashSource(const std::string_view source) noexcept
+	{
+		// Each word is folded in with a multiply and xor-shift, with the length mixed in last so
+		// files differing only in trailing NULs still hash apart
+		constexpr uint64_t multiplier{0x9e3779b97f4a7c15U};
+		uint64_t hash{0xcbf29ce484222325U};
+		size_t offset{};
+		for (; offset + 8U <= source.length(); offset += 8U)
+		{
+			hash ^= loadWord(source.data() + offset);
+			hash *= multiplier;
+			hash ^= hash >> 29U;
+		}
+		uint64_t tail{};
+		for (size_t index{}; offset + index < source.length(); ++index)
+			tail |= uint64_t{static_cast<uint8_t>(source[offset + index])} << (index * 8U);
+		hash ^= tail;
+		hash *= multiplier;
+		hash ^= source.length();
+		hash *= multiplier;
+		return hash ^ (hash >> 32U);
+	}
+} // namespace mangrove::build
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef BUILD_IMPORT_SCANNER_HXX
+#define BUILD_IMPORT_SCANNER_HXX
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../core/sourceLoader.hxx"
+
+/**
+ * @file importScanner.hxx
+ * @brief Cheap discovery of a source file's dependencies and of whether its contents changed
+ */
+
+namespace mangrove::build
+{
+	inline namespace internal
+	{
+		using mangrove::core::loader::SourceBuffer;
+	} // namespace internal
+
+	/**
+	 * Reads the import header of a source file - the `import a.b as c, d` and `from a.b import c`
+	 * statements it opens with - returning the dotted names of the modules imported, in order.
+	 * Only the header is lexed: scanning stops at the first token that can't continue it.
+	 */
+	[[nodiscard]] std::vector<std::string> scanImports(SourceBuffer &&source);
+
+	/**
+	 * Hashes a source file's contents, 8 bytes at a time. The result is stored in build caches
+	 * so must be the same on every host, hence the explicitly little-endian word loads.
+	 */
+	[[nodiscard]] uint64_t hashSource(std::string_view source) noexcept;
+} // namespace mangrove::build
+
+#endif /*BUILD_IMPORT_SCANNER_HXX*/
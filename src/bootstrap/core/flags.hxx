@@ -65,6 +65,8 @@ namespace mangrove::core
 		}
 
 		[[nodiscard]] constexpr auto toRaw() const noexcept { return value; }
+		// Reconstitutes a set of flags previously taken apart with toRaw(), such as when read back from a file
+		[[nodiscard]] constexpr static BitFlags fromRaw(const T flags) noexcept { return {flags}; }
 
 		constexpr bool operator ==(const BitFlags &flags) const noexcept { return value == flags.value; }
 		constexpr bool operator ==(const Enum flag) const noexcept { return value == flagAsBit(flag); }
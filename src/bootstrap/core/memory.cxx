@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fmt/format.h>
+#include <substrate/console>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#ifdef MANGROVE_ALLOC_TRACKING
+#include <malloc.h>
+#endif
+#include "memory.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+
+namespace mangrove::core::memory
+{
+	namespace internal
+	{
+		struct AtomicStats final
+		{
+			std::atomic<uint64_t> allocations;
+			std::atomic<uint64_t> deallocations;
+			std::atomic<uint64_t> bytes;
+			std::array<std::atomic<uint64_t>, histogramBuckets> sizeHistogram;
+		};
+
+		// These must be constant-initialised as the allocator can be called before any dynamic initialisation runs
+		static std::array<AtomicStats, phaseCount> stats{};
+		static std::atomic<uint64_t> liveBytes{};
+		static std::atomic<uint64_t> peakLiveBytes{};
+		thread_local static Phase currentPhase{Phase::other};
+
+		Phase enterPhase(const Phase phase) noexcept
+		{
+			const auto previousPhase{currentPhase};
+			currentPhase = phase;
+			return previousPhase;
+		}
+
+		/**
+		 * Every tracked block starts with one of these, just before the pointer handed out, so a free can be
+		 * credited to the phase that made the allocation rather than whichever phase the freeing thread is in.
+		 * It's padded to the alignment asked for, so also records how far the block really starts before that.
+		 */
+		struct BlockHeader final
+		{
+			size_t offset;
+			Phase phase;
+		};
+
+		constexpr inline size_t headerLength{alignof(std::max_align_t)};
+		static_assert(sizeof(BlockHeader) <= headerLength);
+
+		[[maybe_unused]] static void *claimBlock(void *const block, const size_t offset) noexcept
+		{
+			auto *const pointer{static_cast<uint8_t *>(block) + offset};
+			const BlockHeader header{offset, currentPhase};
+			std::memcpy(pointer - headerLength, &header, sizeof(BlockHeader));
+			return pointer;
+		}
+
+		[[maybe_unused]] static BlockHeader headerOf(void *const pointer) noexcept
+		{
+			BlockHeader header{};
+			std::memcpy(&header, static_cast<uint8_t *>(pointer) - headerLength, sizeof(BlockHeader));
+			return header;
+		}
+
+		[[maybe_unused]] static void recordAllocation(const size_t size, const size_t usableSize) noexcept
+		{
+			auto &phase{stats[static_cast<size_t>(currentPhase)]};
+			phase.allocations.fetch_add(1U, std::memory_order_relaxed);
+			phase.bytes.fetch_add(size, std::memory_order_relaxed);
+			phase.sizeHistogram[histogramBucket(size)].fetch_add(1U, std::memory_order_relaxed);
+
+			const auto live{liveBytes.fetch_add(usableSize, std::memory_order_relaxed) + usableSize};
+			auto peak{peakLiveBytes.load(std::memory_order_relaxed)};
+			while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+				continue;
+		}
+
+		[[maybe_unused]] static void recordDeallocation(const Phase allocatingPhase, const size_t usableSize) noexcept
+		{
+			stats[static_cast<size_t>(allocatingPhase)].deallocations.fetch_add(1U, std::memory_order_relaxed);
+			liveBytes.fetch_sub(usableSize, std::memory_order_relaxed);
+		}
+	} // namespace internal
+
+	PhaseStats phaseStats(const Phase phase) noexcept
+	{
+		const auto &stats{internal::stats[static_cast<size_t>(phase)]};
+		PhaseStats result{};
+		result.allocations = stats.allocations.load(std::memory_order_relaxed);
+		result.deallocations = stats.deallocations.load(std::memory_order_relaxed);
+		result.bytes = stats.bytes.load(std::memory_order_relaxed);
+		for (size_t bucket{}; bucket < histogramBuckets; ++bucket)
+			result.sizeHistogram[bucket] = stats.sizeHistogram[bucket].load(std::memory_order_relaxed);
+		return result;
+	}
+
+	uint64_t peakRSS() noexcept
+	{
+#ifndef _WIN32
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+		return 0U;
+	}
+
+	constexpr static std::array<std::string_view, phaseCount> phaseNames
+		{{"other"sv, "lex"sv, "parse"sv, "symbol"sv, "elf"sv}};
+
+	static std::string bucketName(const size_t bucket)
+	{
+		if (bucket == histogramBuckets - 1U)
+			return fmt::format(">{}"sv, size_t{8U} << (bucket - 1U));
+		return fmt::format("<={}"sv, size_t{8U} << bucket);
+	}
+
+	void printReport() noexcept
+	{
+		if constexpr (!trackingEnabled)
+		{
+			console.warning("Allocation tracking was not enabled in this build, "
+				"only peak RSS is available"sv);
+			console.info(fmt::format("Peak RSS: {} KiB"sv, peakRSS()));
+			return;
+		}
+
+		// Take a snapshot of everything before formatting the report, as that allocates too
+		std::array<PhaseStats, phaseCount> snapshot{};
+		for (size_t phase{}; phase < phaseCount; ++phase)
+			snapshot[phase] = phaseStats(static_cast<Phase>(phase));
+		const auto peakHeap{internal::peakLiveBytes.load(std::memory_order_relaxed)};
+
+		console.info(fmt::format("Peak RSS: {} KiB, peak live heap: {} bytes"sv, peakRSS(), peakHeap));
+		console.info(fmt::format("{:<8} {:>12} {:>12} {:>16}"sv, "phase"sv, "allocs"sv, "frees"sv, "bytes"sv));
+		for (size_t phase{}; phase < phaseCount; ++phase)
+		{
+			const auto &stats{snapshot[phase]};
+			console.info(fmt::format("{:<8} {:>12} {:>12} {:>16}"sv, phaseNames[phase], stats.allocations,
+				stats.deallocations, stats.bytes));
+		}
+
+		for (size_t phase{}; phase < phaseCount; ++phase)
+		{
+			const auto &stats{snapshot[phase]};
+			if (!stats.allocations)
+				continue;
+			console.info(fmt::format("Allocation sizes for phase {}:"sv, phaseNames[phase]));
+			for (size_t bucket{}; bucket < histogramBuckets; ++bucket)
+			{
+				if (stats.sizeHistogram[bucket])
+					console.info(fmt::format("  {:>8}: {}"sv, bucketName(bucket), stats.sizeHistogram[bucket]));
+			}
+		}
+	}
+} // namespace mangrove::core::memory
+
+#ifdef MANGROVE_ALLOC_TRACKING
+namespace mangrove::core::memory::internal
+{
+	void *allocate(const size_t size) noexcept
+	{
+		if (size > SIZE_MAX - headerLength)
+			return nullptr;
+		auto *const block{std::malloc(size + headerLength)};
+		if (!block)
+			return nullptr;
+		recordAllocation(size, malloc_usable_size(block));
+		return claimBlock(block, headerLength);
+	}
+
+	void *allocate(const size_t size, const std::align_val_t alignment) noexcept
+	{
+		// The header takes up a whole alignment's worth of space so the pointer after it stays aligned
+		const auto offset{std::max(static_cast<size_t>(alignment), headerLength)};
+		void *block{nullptr};
+		if (size > SIZE_MAX - offset || posix_memalign(&block, offset, size + offset) != 0)
+			return nullptr;
+		recordAllocation(size, malloc_usable_size(block));
+		return claimBlock(block, offset);
+	}
+
+	void deallocate(void *const pointer) noexcept
+	{
+		if (!pointer)
+			return;
+		const auto header{headerOf(pointer)};
+		auto *const block{static_cast<uint8_t *>(pointer) - header.offset};
+		recordDeallocation(header.phase, malloc_usable_size(block));
+		std::free(block);
+	}
+} // namespace mangrove::core::memory::internal
+
+using mangrove::core::memory::internal::allocate;
+using mangrove::core::memory::internal::deallocate;
+
+/**
+ * As the standard requires of the replaceable allocation functions, a failed allocation calls the current
+ * new_handler and tries again, for as long as there is one, before giving up with std::bad_alloc
+ */
+template<typename... Args> static void *allocateOrThrow(const Args ...args)
+{
+	while (true)
+	{
+		if (auto *const pointer{allocate(args...)}; pointer)
+			return pointer;
+		const auto handler{std::get_new_handler()};
+		if (!handler)
+			throw std::bad_alloc{};
+		handler();
+	}
+}
+
+// The non-throwing forms behave as if they called the throwing ones, returning nullptr rather than throwing
+template<typename... Args> static void *allocateOrNull(const Args ...args) noexcept
+{
+	try
+		{ return allocateOrThrow(args...); }
+	catch (const std::bad_alloc &)
+		{ return nullptr; }
+}
+
+// NOLINTBEGIN(cert-dcl54-cpp,misc-new-delete-overloads)
+void *operator new(const size_t size) { return allocateOrThrow(size); }
+void *operator new[](const size_t size) { return allocateOrThrow(size); }
+void *operator new(const size_t size, const std::align_val_t alignment) { return allocateOrThrow(size, alignment); }
+void *operator new[](const size_t size, const std::align_val_t alignment)
+	{ return allocateOrThrow(size, alignment); }
+
+void *operator new(const size_t size, const std::nothrow_t &) noexcept
+	{ return allocateOrNull(size); }
+void *operator new[](const size_t size, const std::nothrow_t &) noexcept
+	{ return allocateOrNull(size); }
+void *operator new(const size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept
+	{ return allocateOrNull(size, alignment); }
+void *operator new[](const size_t size, const std::align_val_t alignment, const std::nothrow_t &) noexcept
+	{ return allocateOrNull(size, alignment); }
+
+void operator delete(void *const pointer) noexcept { deallocate(pointer); }
+void operator delete[](void *const pointer) noexcept { deallocate(pointer); }
+void operator delete(void *const pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete[](void *const pointer, size_t) noexcept { deallocate(pointer); }
+void operator delete(void *const pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void *const pointer, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void *const pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete[](void *const pointer, size_t, std::align_val_t) noexcept { deallocate(pointer); }
+void operator delete(void *const pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+void operator delete[](void *const pointer, const std::nothrow_t &) noexcept { deallocate(pointer); }
+void operator delete(void *const pointer, std::align_val_t, const std::nothrow_t &) noexcept
+	{ deallocate(pointer); }
+void operator delete[](void *const pointer, std::align_val_t, const std::nothrow_t &) noexcept
+	{ deallocate(pointer); }
+// NOLINTEND(cert-dcl54-cpp,misc-new-delete-overloads)
+#endif
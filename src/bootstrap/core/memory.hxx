@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CORE_MEMORY_HXX
+#define CORE_MEMORY_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <new>
+
+/**
+ * @file memory.hxx
+ * @brief Allocation tracking with per-phase attribution and reporting
+ *
+ * When the build is configured with `-DallocationTracking=true`, the global allocator is replaced
+ * with a counting one that attributes each allocation to the compiler phase active on the calling
+ * thread, and each free to the phase that made the allocation being freed. Otherwise PhaseScope is an
+ * empty type and the tracking compiles away entirely.
+ */
+
+namespace mangrove::core::memory
+{
+#ifdef MANGROVE_ALLOC_TRACKING
+	constexpr inline bool trackingEnabled{true};
+#else
+	constexpr inline bool trackingEnabled{false};
+#endif
+
+	enum class Phase : uint8_t
+	{
+		other,
+		lex,
+		parse,
+		symbol,
+		elf,
+	};
+
+	constexpr inline size_t phaseCount{5U};
+	// Buckets are powers of two from <= 8 bytes up to <= 256KiB, with a final bucket for anything larger
+	constexpr inline size_t histogramBuckets{17U};
+
+	struct PhaseStats final
+	{
+		uint64_t allocations{};
+		uint64_t deallocations{};
+		uint64_t bytes{};
+		std::array<uint64_t, histogramBuckets> sizeHistogram{};
+	};
+
+	[[nodiscard]] constexpr inline size_t histogramBucket(const size_t size) noexcept
+	{
+		size_t bucket{};
+		for (size_t limit{8U}; bucket < histogramBuckets - 1U && size > limit; limit <<= 1U)
+			++bucket;
+		return bucket;
+	}
+
+	namespace internal
+	{
+		/** Sets the calling thread's current phase, returning the one it replaces */
+		[[nodiscard]] Phase enterPhase(Phase phase) noexcept;
+#ifdef MANGROVE_ALLOC_TRACKING
+		/** The counting allocator the replacement global operator new and delete are built on */
+		[[nodiscard]] void *allocate(size_t size) noexcept;
+		[[nodiscard]] void *allocate(size_t size, std::align_val_t alignment) noexcept;
+		void deallocate(void *pointer) noexcept;
+#endif
+	} // namespace internal
+
+#ifdef MANGROVE_ALLOC_TRACKING
+	/** Attributes all allocations made on this thread during the object's lifetime to the given phase */
+	struct PhaseScope final
+	{
+	private:
+		Phase _previousPhase;
+
+	public:
+		PhaseScope(const Phase phase) noexcept : _previousPhase{internal::enterPhase(phase)} { }
+		PhaseScope(const PhaseScope &) = delete;
+		PhaseScope(PhaseScope &&) = delete;
+		PhaseScope &operator =(const PhaseScope &) = delete;
+		PhaseScope &operator =(PhaseScope &&) = delete;
+		~PhaseScope() noexcept { static_cast<void>(internal::enterPhase(_previousPhase)); }
+	};
+#else
+	struct PhaseScope final
+	{
+		constexpr PhaseScope(const Phase) noexcept { }
+	};
+#endif
+
+	[[nodiscard]] PhaseStats phaseStats(Phase phase) noexcept;
+	/** Peak resident set size of the process in KiB, as reported by the kernel */
+	[[nodiscard]] uint64_t peakRSS() noexcept;
+	/** Prints peak RSS and the per-phase allocation counts, byte totals and size histograms */
+	void printReport() noexcept;
+} // namespace mangrove::core::memory
+
+#endif /*CORE_MEMORY_HXX*/
@@ -0,0 +1,469 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include "sourceLoader.hxx"
+#include "trace.hxx"
+
+#if __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define MANGROVE_HAVE_IO_URING
+#endif
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::nameThread;
+
+namespace mangrove::core::loader
+{
+	namespace
+	{
+		/** A bounded hand-off from the thread driving the I/O to the workers consuming what it loads */
+		struct WorkQueue final
+		{
+		private:
+			std::mutex _lock{};
+			std::condition_variable _notEmpty{};
+			std::condition_variable _notFull{};
+			std::deque<LoadedSource> _items{};
+			size_t _limit;
+			bool _closed{false};
+
+		public:
+			WorkQueue(const size_t limit) noexcept : _limit{limit} { }
+
+			void push(LoadedSource &&source)
+			{
+				std::unique_lock lock{_lock};
+				_notFull.wait(lock, [this]() noexcept { return _items.size() < _limit; });
+				_items.emplace_back(std::move(source));
+				_notEmpty.notify_one();
+			}
+
+			[[nodiscard]] std::optional<LoadedSource> pop()
+			{
+				std::unique_lock lock{_lock};
+				_notEmpty.wait(lock, [this]() noexcept { return !_items.empty() || _closed; });
+				if (_items.empty())
+					return std::nullopt;
+				auto source{std::move(_items.front())};
+				_items.pop_front();
+				_notFull.notify_one();
+				return source;
+			}
+
+			void close()
+			{
+				const std::lock_guard lock{_lock};
+				_closed = true;
+				_notEmpty.notify_all();
+			}
+		};
+
+		[[nodiscard]] std::vector<std::thread> startWorkers(const size_t count, WorkQueue &queue,
+			const SourceHandler &handler)
+		{
+			std::vector<std::thread> workers{};
+			workers.reserve(count);
+			for (size_t worker{}; worker < count; ++worker)
+			{
+				workers.emplace_back([&queue, &handler, worker]()
+				{
+					nameThread(fmt::format("loader worker {}"sv, worker));
+					while (auto source{queue.pop()})
+						handler(std::move(*source));
+				});
+			}
+			return workers;
+		}
+
+		[[nodiscard]] LoadedSource readFile(const path &fileName)
+		{
+			LoadedSource source{fileName, {}, 0};
+			const fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY | O_CLOEXEC};
+			const auto length{file.valid() ? file.length() : -1};
+			if (length < 0)
+			{
+				source.error = errno;
+				return source;
+			}
+			source.buffer = SourceBuffer{static_cast<size_t>(length)};
+			size_t offset{};
+			while (offset < source.buffer.length())
+			{
+				const auto result{::pread(file, source.buffer.data() + offset, source.buffer.length() - offset,
+					static_cast<off_t>(offset))};
+				if (result < 0 && errno == EINTR)
+					continue;
+				if (result < 0)
+				{
+					source.error = errno;
+					break;
+				}
+				if (!result)
+					break;
+				offset += static_cast<size_t>(result);
+			}
+			source.buffer.truncate(offset);
+			return source;
+		}
+
+#ifdef MANGROVE_HAVE_IO_URING
+		template<typename T> [[nodiscard]] T *ringField(void *const ring, const uint32_t offset) noexcept
+			{ return static_cast<T *>(static_cast<void *>(static_cast<char *>(ring) + offset)); }
+
+		/** A minimal io_uring instance, driven with the raw system calls so there's no liburing dependency */
+		struct Ring final
+		{
+		private:
+			int _fd{-1};
+			io_uring_params _params{};
+			void *_sqRing{MAP_FAILED};
+			size_t _sqRingSize{};
+			void *_cqRing{MAP_FAILED};
+			size_t _cqRingSize{};
+			io_uring_sqe *_sqes{nullptr};
+			size_t _sqesSize{};
+			uint32_t *_sqTail{nullptr};
+			uint32_t *_sqArray{nullptr};
+			uint32_t _sqMask{};
+			uint32_t *_cqHead{nullptr};
+			uint32_t *_cqTail{nullptr};
+			io_uring_cqe *_cqes{nullptr};
+			uint32_t _cqMask{};
+			// Our copy of the submission queue tail, and how many entries the kernel has yet to consume
+			uint32_t _tail{};
+			uint32_t _unsubmitted{};
+
+		public:
+			Ring(const uint32_t entries) noexcept
+			{
+				_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &_params));
+				// The open, statx and read operations all arrived in the same kernel as this feature
+				if (_fd < 0 || !(_params.features & IORING_FEAT_RW_CUR_POS))
+					return;
+				_sqRingSize = _params.sq_off.array + (_params.sq_entries * sizeof(uint32_t));
+				_cqRingSize = _params.cq_off.cqes + (_params.cq_entries * sizeof(io_uring_cqe));
+				if (_params.features & IORING_FEAT_SINGLE_MMAP)
+					_sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+				_sqRing = ::mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+					IORING_OFF_SQ_RING);
+				if (_sqRing == MAP_FAILED)
+					return;
+				if (_params.features & IORING_FEAT_SINGLE_MMAP)
+					_cqRing = _sqRing;
+				else
+					_cqRing = ::mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+						IORING_OFF_CQ_RING);
+				_sqesSize = _params.sq_entries * sizeof(io_uring_sqe);
+				auto *const sqes{::mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+					IORING_OFF_SQES)};
+				if (_cqRing == MAP_FAILED || sqes == MAP_FAILED)
+					return;
+				_sqes = static_cast<io_uring_sqe *>(sqes);
+				_sqTail = ringField<uint32_t>(_sqRing, _params.sq_off.tail);
+				_tail = *_sqTail;
+				_sqArray = ringField<uint32_t>(_sqRing, _params.sq_off.array);
+				_sqMask = *ringField<uint32_t>(_sqRing, _params.sq_off.ring_mask);
+				_cqHead = ringField<uint32_t>(_cqRing, _params.cq_off.head);
+				_cqTail = ringField<uint32_t>(_cqRing, _params.cq_off.tail);
+				_cqes = ringField<io_uring_cqe>(_cqRing, _params.cq_off.cqes);
+				_cqMask = *ringField<uint32_t>(_cqRing, _params.cq_off.ring_mask);
+			}
+
+			Ring(const Ring &) = delete;
+			Ring(Ring &&) = delete;
+			Ring &operator =(const Ring &) = delete;
+			Ring &operator =(Ring &&) = delete;
+
+			~Ring() noexcept
+			{
+				if (_sqes)
+					::munmap(_sqes, _sqesSize);
+				if (_cqRing != MAP_FAILED && _cqRing != _sqRing)
+					::munmap(_cqRing, _cqRingSize);
+				if (_sqRing != MAP_FAILED)
+					::munmap(_sqRing, _sqRingSize);
+				if (_fd >= 0)
+					::close(_fd);
+			}
+
+			[[nodiscard]] bool valid() const noexcept { return _sqes; }
+
+			/** Fills in the next submission queue entry, to be submitted on the next call to submitAndWait() */
+			[[nodiscard]] io_uring_sqe &prepare(const uint8_t opcode, const int fd, const uint64_t userData) noexcept
+			{
+				const auto index{_tail++ & _sqMask};
+				++_unsubmitted;
+				auto &entry{_sqes[index]};
+				std::memset(&entry, 0, sizeof(entry));
+				entry.opcode = opcode;
+				entry.fd = fd;
+				entry.user_data = userData;
+				_sqArray[index] = index;
+				return entry;
+			}
+
+			/** Submits everything prepared since the last call and waits for at least one completion */
+			[[nodiscard]] int submitAndWait() noexcept
+			{
+				__atomic_store_n(_sqTail, _tail, __ATOMIC_RELEASE);
+				while (true)
+				{
+					const auto result{::syscall(__NR_io_uring_enter, _fd, _unsubmitted, 1U, IORING_ENTER_GETEVENTS,
+						nullptr, 0U)};
+					if (result >= 0)
+					{
+						_unsubmitted -= static_cast<uint32_t>(result);
+						return 0;
+					}
+					if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+						return errno;
+				}
+			}
+
+			/** Reaps every completion currently available, passing each one's user data and result to handler */
+			template<typename Handler> void reap(Handler &&handler)
+			{
+				auto head{*_cqHead};
+				const auto tail{__atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)};
+				for (; head != tail; ++head)
+				{
+					const auto &completion{_cqes[head & _cqMask]};
+					handler(completion.user_data, completion.res);
+				}
+				__atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+			}
+		};
+
+		enum class Operation : uint8_t
+		{
+			open,
+			stat,
+			read,
+			close,
+		};
+
+		[[nodiscard]] constexpr uint64_t userData(const size_t slot, const Operation operation) noexcept
+			{ return (uint64_t{slot} << 2U) | static_cast<uint8_t>(operation); }
+
+		/** The state of one file while it works its way through open + statx, read, and close */
+		struct InFlight final
+		{
+			LoadedSource source{};
+			int fd{-1};
+			struct statx stat{};
+			size_t offset{};
+			// How many of the open and statx are still outstanding
+			uint8_t waiting{};
+		};
+#endif
+	} // namespace
+
+	bool ioUringAvailable() noexcept
+	{
+#ifdef MANGROVE_HAVE_IO_URING
+		// io_uring can be compiled in and still be unavailable, eg disabled by sysctl or a seccomp filter
+		static const bool available{Ring{2U}.valid()};
+		return available;
+#else
+		return false;
+#endif
+	}
+
+	SourceLoader::SourceLoader(const LoaderBackend backend, const size_t workers, const size_t queueDepth) noexcept :
+		_backend{backend}, _workers{workers ? workers : std::max(std::thread::hardware_concurrency(), 1U)},
+		_queueDepth{std::max<size_t>(queueDepth, 1U)}
+	{
+		if (_backend == LoaderBackend::automatic || (_backend == LoaderBackend::ioUring && !ioUringAvailable()))
+			_backend = ioUringAvailable() ? LoaderBackend::ioUring : LoaderBackend::threadPool;
+	}
+
+	void SourceLoader::load(const std::vector<path> &files, const SourceHandler &handler) const
+	{
+		const ScopedTimer timer{"SourceLoader::load"sv};
+		if (files.empty())
+			return;
+		switch (_backend)
+		{
+			case LoaderBackend::serial:
+				loadSerial(files, handler);
+				break;
+			case LoaderBackend::ioUring:
+				if (loadIoUring(files, handler))
+					break;
+				[[fallthrough]];
+			default:
+				loadThreadPool(files, handler);
+		}
+	}
+
+	void SourceLoader::loadSerial(const std::vector<path> &files, const SourceHandler &handler) const
+	{
+		for (const auto &fileName : files)
+			handler(readFile(fileName));
+	}
+
+	void SourceLoader::loadThreadPool(const std::vector<path> &files, const SourceHandler &handler) const
+	{
+		// Each worker loads and then handles the files it claims, so the handler runs on the thread that did the read
+		std::atomic<size_t> nextFile{};
+		std::vector<std::thread> workers{};
+		const auto count{std::min(_workers, files.size())};
+		workers.reserve(count);
+		for (size_t worker{}; worker < count; ++worker)
+		{
+			workers.emplace_back([&, worker]()
+			{
+				nameThread(fmt::format("loader worker {}"sv, worker));
+				for (auto index{nextFile++}; index < files.size(); index = nextFile++)
+					handler(readFile(files[index]));
+			});
+		}
+		for (auto &worker : workers)
+			worker.join();
+	}
+
+#ifdef MANGROVE_HAVE_IO_URING
+	bool SourceLoader::loadIoUring(const std::vector<path> &files, const SourceHandler &handler) const
+	{
+		// Each file has at most two operations in flight, plus the close of the file its slot last held
+		const auto slotCount{std::min(_queueDepth, files.size())};
+		Ring ring{static_cast<uint32_t>(slotCount * 4U)};
+		if (!ring.valid())
+			return false;
+
+		WorkQueue queue{slotCount};
+		auto workers{startWorkers(_workers, queue, handler)};
+		std::vector<InFlight> slots(slotCount);
+		size_t nextFile{};
+		size_t outstanding{};
+
+		const auto start{[&](const size_t slot)
+		{
+			if (nextFile == files.size())
+				return;
+			auto &file{slots[slot]};
+			file = {};
+			file.source.fileName = files[nextFile++];
+			// Open and size the file together, as neither depends on the other
+			auto &open{ring.prepare(IORING_OP_OPENAT, AT_FDCWD, userData(slot, Operation::open))};
+			open.addr = reinterpret_cast<uintptr_t>(file.source.fileName.c_str());
+			open.open_flags = O_RDONLY | O_NOCTTY | O_CLOEXEC;
+			auto &stat{ring.prepare(IORING_OP_STATX, AT_FDCWD, userData(slot, Operation::stat))};
+			stat.addr = reinterpret_cast<uintptr_t>(file.source.fileName.c_str());
+			stat.len = STATX_SIZE;
+			stat.off = reinterpret_cast<uintptr_t>(&file.stat);
+			file.waiting = 2U;
+			outstanding += 2U;
+		}};
+
+		const auto readMore{[&](const size_t slot)
+		{
+			auto &file{slots[slot]};
+			auto &read{ring.prepare(IORING_OP_READ, file.fd, userData(slot, Operation::read))};
+			read.addr = reinterpret_cast<uintptr_t>(file.source.buffer.data() + file.offset);
+			read.len = static_cast<uint32_t>(std::min<size_t>(file.source.buffer.length() - file.offset, UINT32_MAX));
+			read.off = file.offset;
+			++outstanding;
+		}};
+
+		const auto finish{[&](const size_t slot)
+		{
+			auto &file{slots[slot]};
+			if (file.fd >= 0)
+			{
+				// Nothing waits on the close, it's only reaped to keep count of what's outstanding
+				static_cast<void>(ring.prepare(IORING_OP_CLOSE, file.fd, userData(slot, Operation::close)));
+				++outstanding;
+			}
+			file.source.buffer.truncate(file.offset);
+			queue.push(std::move(file.source));
+			start(slot);
+		}};
+
+		const auto complete{[&](const uint64_t data, const int32_t result)
+		{
+			--outstanding;
+			const auto slot{static_cast<size_t>(data >> 2U)};
+			auto &file{slots[slot]};
+			switch (static_cast<Operation>(data & 3U))
+			{
+				case Operation::open:
+				case Operation::stat:
+					if (result < 0 && !file.source.error)
+						file.source.error = -result;
+					else if (static_cast<Operation>(data & 3U) == Operation::open && result >= 0)
+						file.fd = result;
+					if (--file.waiting)
+						return;
+					if (!file.source.error)
+						file.source.buffer = SourceBuffer{static_cast<size_t>(file.stat.stx_size)};
+					if (file.source.error || !file.source.buffer.length())
+						finish(slot);
+					else
+						readMore(slot);
+					return;
+				case Operation::read:
+					if (result == -EINTR || result == -EAGAIN)
+						readMore(slot);
+					else if (result < 0)
+					{
+						file.source.error = -result;
+						finish(slot);
+					}
+					else
+					{
+						file.offset += static_cast<size_t>(result);
+						// A short read at EOF means the file shrank after it was sized
+						if (result && file.offset < file.source.buffer.length())
+							readMore(slot);
+						else
+							finish(slot);
+					}
+					return;
+				case Operation::close:
+					return;
+			}
+		}};
+
+		for (size_t slot{}; slot < slotCount; ++slot)
+			start(slot);
+		while (outstanding)
+		{
+			if (const auto error{ring.submitAndWait()}; error)
+			{
+				// Requests may still be in flight into our buffers, so there's no safe way to carry on
+				console.error("io_uring submission failed: "sv, std::strerror(error));
+				std::abort();
+			}
+			ring.reap(complete);
+		}
+
+		queue.close();
+		for (auto &worker : workers)
+			worker.join();
+		return true;
+	}
+#else
+	bool SourceLoader::loadIoUring(const std::vector<path> &, const SourceHandler &) const
+		{ return false; }
+#endif
+} // namespace mangrove::core::loader
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CORE_SOURCE_LOADER_HXX
+#define CORE_SOURCE_LOADER_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * @file sourceLoader.hxx
+ * @brief Batched loading of many source files at once, handing each to a worker as it completes
+ *
+ * Reading files one at a time leaves the disk queue nearly empty, so whole-project builds spend most
+ * of their time waiting on I/O latency. The loader keeps many files in flight at once - via io_uring
+ * where the kernel provides it, submitting the open, statx and read for a batch of files in one go,
+ * or otherwise with a pool of threads each doing its own pread()s. Each buffer is handed to a worker
+ * thread as soon as its read completes, so tokenising overlaps with the I/O still outstanding.
+ */
+
+namespace mangrove::core::loader
+{
+	using std::filesystem::path;
+
+	/** An owned, in-memory copy of a source file's contents */
+	struct SourceBuffer final
+	{
+	private:
+		std::unique_ptr<char []> _data{};
+		size_t _length{};
+
+	public:
+		SourceBuffer() noexcept = default;
+		SourceBuffer(const size_t length) : _data{std::make_unique<char []>(length)}, _length{length} { }
+
+		[[nodiscard]] char *data() noexcept { return _data.get(); }
+		[[nodiscard]] const char *data() const noexcept { return _data.get(); }
+		[[nodiscard]] auto length() const noexcept { return _length; }
+		[[nodiscard]] bool valid() const noexcept { return static_cast<bool>(_data); }
+		[[nodiscard]] std::string_view view() const noexcept { return {_data.get(), _length}; }
+		// Files can shrink between being sized and read, so only what was actually read is kept
+		void truncate(const size_t length) noexcept
+		{
+			if (length < _length)
+				_length = length;
+		}
+	};
+
+	struct LoadedSource final
+	{
+		path fileName{};
+		SourceBuffer buffer{};
+		// The errno value that loading the file failed with, if any
+		int error{};
+
+		[[nodiscard]] bool valid() const noexcept { return !error && buffer.valid(); }
+	};
+
+	enum class LoaderBackend : uint8_t
+	{
+		// io_uring when the kernel supports it, otherwise the thread pool
+		automatic,
+		ioUring,
+		// A pool of threads each opening and pread()ing the files it claims
+		threadPool,
+		// One file at a time on the calling thread - the baseline the others are measured against
+		serial,
+	};
+
+	using SourceHandler = std::function<void (LoadedSource &&)>;
+
+	struct SourceLoader final
+	{
+	private:
+		LoaderBackend _backend;
+		size_t _workers;
+		size_t _queueDepth;
+
+		void loadSerial(const std::vector<path> &files, const SourceHandler &handler) const;
+		void loadThreadPool(const std::vector<path> &files, const SourceHandler &handler) const;
+		[[nodiscard]] bool loadIoUring(const std::vector<path> &files, const SourceHandler &handler) const;
+
+	public:
+		constexpr static size_t defaultQueueDepth{64U};
+
+		/** Creates a loader handing files to the given number of workers (0 picks one per hardware thread) */
+		SourceLoader(LoaderBackend backend = LoaderBackend::automatic, size_t workers = 0U,
+			size_t queueDepth = defaultQueueDepth) noexcept;
+
+		/** The backend load() will use, with LoaderBackend::automatic resolved to the one that's available */
+		[[nodiscard]] auto backend() const noexcept { return _backend; }
+		[[nodiscard]] auto workers() const noexcept { return _workers; }
+
+		/**
+		 * Loads each of the files, calling handler once for each on one of the worker threads as it completes,
+		 * in no particular order. Files that fail to load are still handed over, with their error set.
+		 * Returns once every file has been handled.
+		 */
+		void load(const std::vector<path> &files, const SourceHandler &handler) const;
+	};
+
+	/** Whether io_uring is usable for file loading on the running kernel */
+	[[nodiscard]] bool ioUringAvailable() noexcept;
+} // namespace mangrove::core::loader
+
+#endif /*CORE_SOURCE_LOADER_HXX*/
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <iterator>
+#include <fmt/format.h>
+#include <substrate/fd>
+#include <substrate/console>
+#include "trace.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::fd_t;
+using substrate::console;
+
+namespace mangrove::core::trace
+{
+	constexpr static std::array<std::string_view, counterCount> counterNames
+	{{
+		"tokensLexed"sv,
+		"bytesRead"sv,
+		"symbolsInserted"sv,
+		"symbolsLookedUp"sv,
+		"queueReads"sv,
+		"queueDepth"sv,
+		"producerStalls"sv,
+		"consumerStalls"sv,
+	}};
+
+	std::string_view counterName(const Counter counter) noexcept
+		{ return counterNames[static_cast<size_t>(counter)]; }
+
+	namespace internal
+	{
+		static std::mutex registryLock{};
+		static std::vector<std::unique_ptr<ThreadState>> threads{};
+		static const auto epoch{std::chrono::steady_clock::now()};
+
+		ThreadState &threadState() noexcept
+		{
+			thread_local ThreadState *state{nullptr};
+			if (!state)
+			{
+				const std::lock_guard lock{registryLock};
+				state = threads.emplace_back(std::make_unique<ThreadState>()).get();
+				state->id = threads.size();
+			}
+			return *state;
+		}
+
+		uint64_t now() noexcept
+		{
+			const auto elapsed{std::chrono::steady_clock::now() - epoch};
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		}
+	} // namespace internal
+
+	using internal::threadState;
+	using internal::threads;
+	using internal::registryLock;
+
+#ifdef MANGROVE_TRACING
+	ScopedTimer::~ScopedTimer() noexcept
+	{
+		const auto end{internal::now()};
+		threadState().events.push_back({_name, _begin, end - _begin});
+	}
+#endif
+
+	void nameThread(const std::string_view name) noexcept
+	{
+		if constexpr (enabled)
+			threadState().name = name;
+	}
+
+	CounterValues counterTotals() noexcept
+	{
+		CounterValues totals{};
+		const std::lock_guard lock{registryLock};
+		for (const auto &thread : threads)
+		{
+			for (size_t counter{}; counter < counterCount; ++counter)
+				totals[counter] += thread->counters[counter];
+		}
+		return totals;
+	}
+
+	// Chrome trace-event timestamps are in microseconds, so split our nanosecond values accordingly
+	static auto toMicroseconds(const uint64_t nanoseconds) noexcept
+		{ return std::pair{nanoseconds / 1000U, nanoseconds % 1000U}; }
+
+	bool writeTrace(const std::filesystem::path &fileName) noexcept
+	{
+		if constexpr (!enabled)
+		{
+			console.warning("Tracing support was not enabled in this build, no trace will be written"sv);
+			return false;
+		}
+
+		const auto totals{counterTotals()};
+		const auto [endMicros, endNanos] = toMicroseconds(internal::now());
+		fmt::memory_buffer buffer{};
+		auto output{std::back_inserter(buffer)};
+		const std::lock_guard lock{registryLock};
+
+		fmt::format_to(output, R"({{"displayTimeUnit":"ns","traceEvents":[)");
+		fmt::format_to(output, R"({{"name":"process_name","ph":"M","pid":1,"tid":0,"args":{{"name":"mangrove"}}}})");
+		for (const auto &thread : threads)
+		{
+			const auto name{thread->name.empty() ? fmt::format("thread {}"sv, thread->id) : thread->name};
+			fmt::format_to(output, R"(,{{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+				thread->id, name);
+			for (const auto &event : thread->events)
+			{
+				const auto [beginMicros, beginNanos] = toMicroseconds(event.begin);
+				const auto [durationMicros, durationNanos] = toMicroseconds(event.duration);
+				fmt::format_to(output,
+					R"(,{{"name":"{}","cat":"mangrove","ph":"X","pid":1,"tid":{},"ts":{}.{:03},"dur":{}.{:03}}})",
+					event.name, thread->id, beginMicros, beginNanos, durationMicros, durationNanos);
+			}
+		}
+		for (size_t counter{}; counter < counterCount; ++counter)
+			fmt::format_to(output, R"(,{{"name":"{}","ph":"C","pid":1,"ts":{}.{:03},"args":{{"value":{}}}}})",
+				counterNames[counter], endMicros, endNanos, totals[counter]);
+		fmt::format_to(output, "]}}\n");
+
+		const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		if (!file.valid() || !file.write(buffer.data(), buffer.size()))
+		{
+			console.error("Failed to write trace file "sv, fileName.c_str());
+			return false;
+		}
+		return true;
+	}
+} // namespace mangrove::core::trace
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef CORE_TRACE_HXX
+#define CORE_TRACE_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+/**
+ * @file trace.hxx
+ * @brief Light-weight hot-path instrumentation that exports a Chrome trace-event timeline
+ *
+ * When the build is not configured with `-Dtracing=true`, ScopedTimer is an empty type
+ * and count() a no-op, so the instrumentation compiles away entirely.
+ */
+
+namespace mangrove::core::trace
+{
+#ifdef MANGROVE_TRACING
+	constexpr inline bool enabled{true};
+#else
+	constexpr inline bool enabled{false};
+#endif
+
+	enum class Counter : uint8_t
+	{
+		tokensLexed,
+		bytesRead,
+		symbolsInserted,
+		symbolsLookedUp,
+		// Batches the parser took from a TokenPipe, and the sum of the queue depths it saw doing so
+		queueReads,
+		queueDepth,
+		// Times the lexer found a TokenPipe full, and the parser found one empty
+		producerStalls,
+		consumerStalls,
+	};
+
+	constexpr inline size_t counterCount{8U};
+	using CounterValues = std::array<uint64_t, counterCount>;
+
+	[[nodiscard]] std::string_view counterName(Counter counter) noexcept;
+
+	namespace internal
+	{
+		struct Event final
+		{
+			std::string_view name;
+			uint64_t begin;
+			uint64_t duration;
+		};
+
+		/**
+		 * Per-thread trace state. These are owned by a global registry so they outlive
+		 * the threads that produced them, which lets writeTrace() run after workers join.
+		 */
+		struct ThreadState final
+		{
+			size_t id{};
+			std::string name{};
+			std::vector<Event> events{};
+			CounterValues counters{};
+		};
+
+		[[nodiscard]] ThreadState &threadState() noexcept;
+		[[nodiscard]] uint64_t now() noexcept;
+	} // namespace internal
+
+#ifdef MANGROVE_TRACING
+	/** Records the lifetime of the object as a complete ("X") event on the current thread's lane */
+	struct ScopedTimer final
+	{
+	private:
+		std::string_view _name;
+		uint64_t _begin;
+
+	public:
+		ScopedTimer(const std::string_view name) noexcept : _name{name}, _begin{internal::now()} { }
+		ScopedTimer(const ScopedTimer &) = delete;
+		ScopedTimer(ScopedTimer &&) = delete;
+		ScopedTimer &operator =(const ScopedTimer &) = delete;
+		ScopedTimer &operator =(ScopedTimer &&) = delete;
+		~ScopedTimer() noexcept;
+	};
+#else
+	struct ScopedTimer final
+	{
+		constexpr ScopedTimer(const std::string_view) noexcept { }
+	};
+#endif
+
+	inline void count([[maybe_unused]] const Counter counter, [[maybe_unused]] const uint64_t amount = 1U) noexcept
+	{
+		if constexpr (enabled)
+			internal::threadState().counters[static_cast<size_t>(counter)] += amount;
+	}
+
+	/** Names the calling thread's lane in the exported timeline */
+	void nameThread(std::string_view name) noexcept;
+	/** Sums each counter across all threads that have recorded anything */
+	[[nodiscard]] CounterValues counterTotals() noexcept;
+	/**
+	 * Writes all recorded events and counters out in Chrome trace-event format.
+	 * This must only be called once any worker threads have been joined.
+	 */
+	[[nodiscard]] bool writeTrace(const std::filesystem::path &fileName) noexcept;
+} // namespace mangrove::core::trace
+
+#endif /*CORE_TRACE_HXX*/
@@ -67,6 +67,12 @@ namespace mangrove::core::utf8
 		String &operator =(const String &str) = default;
 		String &operator =(String &&str) noexcept = default;
 
+		void swap(String &str) noexcept
+		{
+			_data.swap(str._data);
+			std::swap(_length, str._length);
+		}
+
 		[[nodiscard]] operator StringView() const noexcept
 			{ return {_data, _length}; }
 
@@ -103,6 +109,13 @@ namespace mangrove::core::utf8
 			return *this;
 		}
 
+		String &append(const StringView &str) noexcept
+		{
+			_data.append(str.data(), str.byteLength());
+			_length += str.length();
+			return *this;
+		}
+
 		String &operator +=(const Char &chr) noexcept
 			{ return append(chr); }
 		String &operator +=(const String &str) noexcept
@@ -0,0 +1,544 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <substrate/span>
+#include "formats/elf/elf.hxx"
+#include "core/trace.hxx"
+
+/**
+ * @file elfdump.cxx
+ * @brief mangrove-elfdump - inspects many ELF files at once on a pool of worker threads, streaming a
+ * summary of each file's sections, segments and symbols as JSON lines or CSV rows, in the order given
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::elf::ELF;
+using mangrove::elf::AccessPattern;
+using namespace mangrove::elf::enums;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+namespace trace = mangrove::core::trace;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static auto formatOption{"--format="sv};
+constexpr static auto jobsOption{"--jobs="sv};
+constexpr static auto filesFromOption{"--files-from="sv};
+constexpr static auto statsOption{"--stats"sv};
+constexpr static auto traceOption{"--trace="sv};
+constexpr static auto ignoreInvalidOption{"--ignore-invalid"sv};
+
+enum class OutputFormat : uint8_t
+{
+	json,
+	csv,
+};
+
+// Running totals across every file inspected, for --stats
+struct Totals final
+{
+	std::atomic<uint64_t> files{};
+	std::atomic<uint64_t> failures{};
+	std::atomic<uint64_t> skipped{};
+	std::atomic<uint64_t> bytes{};
+	std::atomic<uint64_t> sections{};
+	std::atomic<uint64_t> segments{};
+	std::atomic<uint64_t> symbols{};
+};
+
+struct SymbolSummary final
+{
+	uint64_t total{};
+	uint64_t local{};
+	uint64_t global{};
+	uint64_t weak{};
+	uint64_t undefined{};
+	uint64_t functions{};
+	uint64_t objects{};
+};
+
+/**
+ * Collects the records produced by the workers and writes them out in input order as soon as
+ * every record before them is ready, so output streams while still being deterministic
+ */
+struct OrderedOutput final
+{
+private:
+	std::mutex _lock{};
+	std::map<size_t, std::string> _pending{};
+	size_t _next{};
+
+public:
+	void submit(const size_t index, std::string &&record)
+	{
+		const std::lock_guard<std::mutex> guard{_lock};
+		_pending.emplace(index, std::move(record));
+		for (auto entry{_pending.begin()}; entry != _pending.end() && entry->first == _next;
+			entry = _pending.erase(entry), ++_next)
+			std::fwrite(entry->second.data(), 1U, entry->second.size(), stdout);
+	}
+};
+
+[[nodiscard]] static std::string_view className(const Class elfClass) noexcept
+	{ return elfClass == Class::elf32Bit ? "ELF32"sv : "ELF64"sv; }
+[[nodiscard]] static std::string_view endianName(const Endian endian) noexcept
+	{ return endian == Endian::little ? "little"sv : "big"sv; }
+
+[[nodiscard]] static std::string typeName(const Type type)
+{
+	switch (type)
+	{
+		case Type::unknown:
+			return "none";
+		case Type::relocatable:
+			return "relocatable";
+		case Type::executable:
+			return "executable";
+		case Type::shared:
+			return "shared";
+		case Type::core:
+			return "core";
+	}
+	return fmt::format("{:#x}"sv, static_cast<uint16_t>(type));
+}
+
+[[nodiscard]] static std::string machineName(const Machine machine)
+{
+	switch (machine)
+	{
+		case Machine::nonSpecific:
+			return "none";
+		case Machine::sparc:
+			return "SPARC";
+		case Machine::x86:
+			return "x86";
+		case Machine::mips:
+			return "MIPS";
+		case Machine::powerPC:
+			return "PowerPC";
+		case Machine::s390:
+			return "S390";
+		case Machine::arm:
+			return "ARM";
+		case Machine::superH:
+			return "SuperH";
+		case Machine::ia64:
+			return "IA-64";
+		case Machine::x86_64:
+			return "x86-64";
+		case Machine::aarch64:
+			return "AArch64";
+		case Machine::pic:
+			return "PIC";
+		case Machine::riscV:
+			return "RISC-V";
+	}
+	return fmt::format("{:#x}"sv, static_cast<uint16_t>(machine));
+}
+
+[[nodiscard]] static std::string sectionTypeName(const SectionHeaderType type)
+{
+	switch (type)
+	{
+		case SectionHeaderType::empty:
+			return "NULL";
+		case SectionHeaderType::program:
+			return "PROGBITS";
+		case SectionHeaderType::symbolTable:
+			return "SYMTAB";
+		case SectionHeaderType::stringTable:
+			return "STRTAB";
+		case SectionHeaderType::relocAddend:
+			return "RELA";
+		case SectionHeaderType::symbolHash:
+			return "HASH";
+		case SectionHeaderType::dynamic:
+			return "DYNAMIC";
+		case SectionHeaderType::note:
+			return "NOTE";
+		case SectionHeaderType::bss:
+			return "NOBITS";
+		case SectionHeaderType::reloc:
+			return "REL";
+		case SectionHeaderType::reserved:
+			return "SHLIB";
+		case SectionHeaderType::dynamicSymbols:
+			return "DYNSYM";
+		case SectionHeaderType::initArray:
+			return "INIT_ARRAY";
+		case SectionHeaderType::finiArray:
+			return "FINI_ARRAY";
+		case SectionHeaderType::preInitArray:
+			return "PREINIT_ARRAY";
+		case SectionHeaderType::group:
+			return "GROUP";
+		case SectionHeaderType::symbolTableIndex:
+			return "SYMTAB_SHNDX";
+		case SectionHeaderType::numberOfTypes:
+			break;
+	}
+	return fmt::format("{:#x}"sv, static_cast<uint32_t>(type));
+}
+
+[[nodiscard]] static std::string segmentTypeName(const ProgramHeaderType type)
+{
+	switch (type)
+	{
+		case ProgramHeaderType::empty:
+			return "NULL";
+		case ProgramHeaderType::load:
+			return "LOAD";
+		case ProgramHeaderType::dynamic:
+			return "DYNAMIC";
+		case ProgramHeaderType::interp:
+			return "INTERP";
+		case ProgramHeaderType::note:
+			return "NOTE";
+		case ProgramHeaderType::shlib:
+			return "SHLIB";
+		case ProgramHeaderType::phdr:
+			return "PHDR";
+	}
+	return fmt::format("{:#x}"sv, static_cast<uint32_t>(type));
+}
+
+// Appends value to record as a quoted, escaped JSON string
+static void appendJSON(std::string &record, const std::string_view value)
+{
+	record += '"';
+	for (const auto character : value)
+	{
+		if (character == '"' || character == '\\')
+		{
+			record += '\\';
+			record += character;
+		}
+		else if (static_cast<uint8_t>(character) < 0x20U)
+			fmt::format_to(std::back_inserter(record), "\\u{:04x}"sv, static_cast<uint8_t>(character));
+		else
+			record += character;
+	}
+	record += '"';
+}
+
+// Appends value to record as a CSV field, quoting it only if it needs to be
+static void appendCSV(std::string &record, const std::string_view value)
+{
+	if (value.find_first_of(",\"\r\n"sv) == std::string_view::npos)
+	{
+		record += value;
+		return;
+	}
+	record += '"';
+	for (const auto character : value)
+	{
+		if (character == '"')
+			record += '"';
+		record += character;
+	}
+	record += '"';
+}
+
+template<typename Record> static void summariseTable(SymbolSummary &summary, const std::vector<Record> &symbols)
+{
+	// Entry 0 of every symbol table is the reserved null symbol
+	for (size_t index{1U}; index < symbols.size(); ++index)
+	{
+		const auto &symbol{symbols[index]};
+		const auto binding{static_cast<uint8_t>(symbol.info >> 4U)};
+		const auto symbolType{static_cast<uint8_t>(symbol.info & 0x0fU)};
+		++summary.total;
+		summary.local += binding == 0U ? 1U : 0U;
+		summary.global += binding == 1U ? 1U : 0U;
+		summary.weak += binding == 2U ? 1U : 0U;
+		summary.undefined += symbol.sectionIndex == 0U ? 1U : 0U;
+		summary.objects += symbolType == 1U ? 1U : 0U;
+		summary.functions += symbolType == 2U ? 1U : 0U;
+	}
+}
+
+[[nodiscard]] static SymbolSummary summariseSymbols(const ELF &elf)
+{
+	SymbolSummary summary{};
+	// Each table is decoded in bulk, rather than a field at a time, into storage shared by all the tables
+	std::vector<elf32::SymbolRecord> symbols32{};
+	std::vector<elf64::SymbolRecord> symbols64{};
+	const auto &sections{elf.sectionHeaders()};
+	for (size_t section{}; section < sections.size(); ++section)
+	{
+		const auto type{sections[section].type()};
+		if (type != SectionHeaderType::symbolTable && type != SectionHeaderType::dynamicSymbols)
+			continue;
+		if (elf.header().elfClass() == Class::elf32Bit)
+		{
+			static_cast<void>(elf.readTable(section, symbols32));
+			summariseTable(summary, symbols32);
+		}
+		else
+		{
+			static_cast<void>(elf.readTable(section, symbols64));
+			summariseTable(summary, symbols64);
+		}
+	}
+	return summary;
+}
+
+[[nodiscard]] static std::string failure(const path &fileName, const OutputFormat format,
+	const std::string_view error)
+{
+	std::string record{};
+	if (format == OutputFormat::json)
+	{
+		record += "{\"file\":"sv;
+		appendJSON(record, fileName.string());
+		record += ",\"error\":"sv;
+		appendJSON(record, error);
+		record += "}\n"sv;
+	}
+	else
+	{
+		appendCSV(record, fileName.string());
+		// Leave every column between the file name and the error empty, so the error lands under its heading
+		record += ",,,,,,,,,,,,,,,,"sv;
+		appendCSV(record, error);
+		record += '\n';
+	}
+	return record;
+}
+
+[[nodiscard]] static std::string inspect(const path &fileName, const OutputFormat format, const bool ignoreInvalid,
+	Totals &totals)
+{
+	const trace::ScopedTimer timer{"inspect"sv};
+	++totals.files;
+	fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+	if (!file.valid())
+	{
+		++totals.failures;
+		return failure(fileName, format, "could not open file"sv);
+	}
+	const auto length{static_cast<uint64_t>(std::max<off_t>(file.length(), 0))};
+	const ELF elf{std::move(file), AccessPattern::sequential};
+	if (!elf.valid())
+	{
+		// When sweeping whole directory trees, anything that isn't an ELF file is simply not of interest
+		if (ignoreInvalid)
+		{
+			--totals.files;
+			++totals.skipped;
+			return {};
+		}
+		++totals.failures;
+		return failure(fileName, format, "not a valid ELF file"sv);
+	}
+	totals.bytes += length;
+	trace::count(trace::Counter::bytesRead, length);
+
+	const auto &header{elf.header()};
+	const auto &sections{elf.sectionHeaders()};
+	const auto &segments{elf.programHeaders()};
+	const auto symbols{summariseSymbols(elf)};
+	totals.sections += sections.size();
+	totals.segments += segments.size();
+	totals.symbols += symbols.total;
+
+	std::string record{};
+	auto out{std::back_inserter(record)};
+	if (format == OutputFormat::csv)
+	{
+		uint64_t sectionBytes{};
+		for (const auto &section : sections)
+			sectionBytes += section.type() == SectionHeaderType::bss ? 0U : section.fileLength();
+		appendCSV(record, fileName.string());
+		fmt::format_to(out, ",{},{},{},{},{},{},{},{},{},{},{},{},{},{},{},\n"sv, className(header.elfClass()),
+			endianName(header.endian()), typeName(header.type()), machineName(header.machine()), sections.size(),
+			segments.size(), symbols.total, symbols.local, symbols.global, symbols.weak, symbols.undefined,
+			symbols.functions, symbols.objects, sectionBytes, header.entryPoint());
+		return record;
+	}
+
+	record += "{\"file\":"sv;
+	appendJSON(record, fileName.string());
+	fmt::format_to(out, ",\"class\":\"{}\",\"endian\":\"{}\",\"type\":\"{}\",\"machine\":\"{}\",\"entry\":{}"sv,
+		className(header.elfClass()), endianName(header.endian()), typeName(header.type()),
+		machineName(header.machine()), header.entryPoint());
+	record += ",\"sections\":["sv;
+	for (size_t index{}; index < sections.size(); ++index)
+	{
+		const auto &section{sections[index]};
+		record += index ? ",{\"name\":"sv : "{\"name\":"sv;
+		appendJSON(record, elf.sectionNames().stringFromOffset(section.nameOffset()));
+		fmt::format_to(out, ",\"type\":\"{}\",\"flags\":{},\"offset\":{},\"size\":{}}}"sv,
+			sectionTypeName(section.type()), section.flags().toRaw(), section.fileOffset(), section.fileLength());
+	}
+	record += "],\"segments\":["sv;
+	for (size_t index{}; index < segments.size(); ++index)
+	{
+		const auto &segment{segments[index]};
+		fmt::format_to(out, "{}{{\"type\":\"{}\",\"flags\":{},\"offset\":{},\"fileSize\":{},\"memorySize\":{}}}"sv,
+			index ? ","sv : ""sv, segmentTypeName(segment.type()), segment.flags(), segment.offset(),
+			segment.fileLength(), segment.memoryLength());
+	}
+	fmt::format_to(out, "],\"symbols\":{{\"total\":{},\"local\":{},\"global\":{},\"weak\":{},\"undefined\":{},"
+		"\"functions\":{},\"objects\":{}}}}}\n"sv, symbols.total, symbols.local, symbols.global, symbols.weak,
+		symbols.undefined, symbols.functions, symbols.objects);
+	return record;
+}
+
+// Expands directories into the regular files beneath them
+static void collectFiles(const path &entry, std::vector<path> &files)
+{
+	std::error_code error{};
+	if (!std::filesystem::is_directory(entry, error))
+	{
+		files.emplace_back(entry);
+		return;
+	}
+	for (const auto &file : std::filesystem::recursive_directory_iterator{entry, error})
+	{
+		if (file.is_regular_file(error))
+			files.emplace_back(file.path());
+	}
+}
+
+[[nodiscard]] static bool readFileList(const std::string_view listName, std::vector<path> &files)
+{
+	std::FILE *const list{listName == "-"sv ? stdin : std::fopen(std::string{listName}.c_str(), "r")};
+	if (!list)
+		return false;
+	std::string line{};
+	for (int character{}; (character = std::fgetc(list)) != EOF; )
+	{
+		if (character != '\n')
+			line += static_cast<char>(character);
+		else if (!line.empty())
+			collectFiles(std::exchange(line, {}), files);
+	}
+	if (!line.empty())
+		collectFiles(line, files);
+	if (list != stdin)
+		std::fclose(list);
+	return true;
+}
+
+int main(int argCount, char **argList)
+{
+	console = {stdout, stderr};
+	trace::nameThread("main"sv);
+
+	auto format{OutputFormat::json};
+	size_t jobs{std::max(std::thread::hardware_concurrency(), 1U)};
+	bool stats{false};
+	bool ignoreInvalid{false};
+	std::optional<path> traceFile{};
+	std::vector<path> files{};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	for (const std::string_view arg : args)
+	{
+		if (arg.substr(0, formatOption.length()) == formatOption)
+		{
+			const auto value{arg.substr(formatOption.length())};
+			if (value == "json"sv)
+				format = OutputFormat::json;
+			else if (value == "csv"sv)
+				format = OutputFormat::csv;
+			else
+			{
+				console.error("Unknown output format "sv, value, ", expected one of 'json' or 'csv'"sv);
+				return 1;
+			}
+		}
+		else if (arg.substr(0, jobsOption.length()) == jobsOption)
+		{
+			try
+				{ jobs = std::stoul(std::string{arg.substr(jobsOption.length())}); }
+			catch (const std::exception &)
+				{ jobs = 0U; }
+			if (!jobs)
+			{
+				console.error("Invalid job count "sv, arg.substr(jobsOption.length()));
+				return 1;
+			}
+		}
+		else if (arg.substr(0, filesFromOption.length()) == filesFromOption)
+		{
+			if (!readFileList(arg.substr(filesFromOption.length()), files))
+			{
+				console.error("Could not read file list "sv, arg.substr(filesFromOption.length()));
+				return 1;
+			}
+		}
+		else if (arg == statsOption)
+			stats = true;
+		else if (arg == ignoreInvalidOption)
+			ignoreInvalid = true;
+		else if (arg.substr(0, traceOption.length()) == traceOption)
+			traceFile = arg.substr(traceOption.length());
+		else
+			collectFiles(arg, files);
+	}
+
+	if (files.empty())
+	{
+		console.error("Usage: mangrove-elfdump [--format=json|csv] [--jobs=N] [--stats] [--trace=file] "sv,
+			"[--ignore-invalid] [--files-from=list|-] <files or directories...>"sv);
+		return 1;
+	}
+
+	if (format == OutputFormat::csv)
+		std::fputs("file,class,endian,type,machine,sections,segments,symbols,localSymbols,globalSymbols,"
+			"weakSymbols,undefinedSymbols,functions,objects,sectionBytes,entry,error\n", stdout);
+
+	Totals totals{};
+	OrderedOutput output{};
+	std::atomic<size_t> nextFile{};
+	const auto worker{[&](const size_t workerIndex)
+	{
+		trace::nameThread(fmt::format("worker {}"sv, workerIndex));
+		for (auto index{nextFile++}; index < files.size(); index = nextFile++)
+			output.submit(index, inspect(files[index], format, ignoreInvalid, totals));
+	}};
+
+	const auto begin{benchClock::now()};
+	std::vector<std::thread> workers{};
+	jobs = std::min(jobs, files.size());
+	workers.reserve(jobs);
+	for (size_t workerIndex{}; workerIndex < jobs; ++workerIndex)
+		workers.emplace_back(worker, workerIndex);
+	for (auto &thread : workers)
+		thread.join();
+	const auto elapsed{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+	std::fflush(stdout);
+
+	if (stats)
+	{
+		const auto fileCount{static_cast<double>(totals.files.load())};
+		const auto byteCount{static_cast<double>(totals.bytes.load())};
+		const auto symbolCount{static_cast<double>(totals.symbols.load())};
+		// stdout carries the records, so the summary goes to stderr to keep it out of the data
+		fmt::print(stderr, "{} files ({} failed, {} skipped) on {} threads in {:.3f}s: {:.0f} files/s, {:.2f} MiB/s, "
+			"{:.2f} M symbols/s ({} sections, {} segments, {} symbols)\n"sv, totals.files.load(),
+			totals.failures.load(), totals.skipped.load(), jobs, elapsed, fileCount / elapsed, byteCount / elapsed / 1048576.0,
+			symbolCount / elapsed / 1e6, totals.sections.load(), totals.segments.load(), totals.symbols.load());
+	}
+	if (traceFile && !trace::writeTrace(*traceFile))
+		return 1;
+	return totals.failures.load() ? 1 : 0;
+}
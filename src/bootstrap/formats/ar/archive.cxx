@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include "archive.hxx"
+#include "../elf/io.hxx"
+#include "../../core/trace.hxx"
+#include "../../core/memory.hxx"
+
+using namespace std::literals::string_view_literals;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Endian;
+
+namespace mangrove::ar
+{
+	constexpr static auto archiveMagic{"!<arch>\n"sv};
+	// Every member header is a fixed 60 characters - name, date, uid, gid, mode, size and a terminator
+	constexpr static size_t headerLength{60U};
+	constexpr static size_t nameLength{16U};
+	constexpr static size_t sizeOffset{48U};
+	constexpr static size_t sizeLength{10U};
+	constexpr static auto headerTerminator{"`\n"sv};
+	// BSD archives put names too long for the header, or containing spaces, at the start of the member's data
+	constexpr static auto bsdLongName{"#1/"sv};
+
+	[[nodiscard]] static std::string_view asString(const span<uint8_t> &data) noexcept
+		{ return {reinterpret_cast<const char *>(data.data()), data.size()}; }
+
+	// Header fields are padded out with spaces
+	[[nodiscard]] static std::string_view field(const std::string_view header, const size_t offset,
+		const size_t length) noexcept
+	{
+		const auto value{header.substr(offset, length)};
+		const auto end{value.find_last_not_of(' ')};
+		return value.substr(0U, end == std::string_view::npos ? 0U : end + 1U);
+	}
+
+	[[nodiscard]] static std::optional<size_t> parseDecimal(const std::string_view value) noexcept
+	{
+		if (value.empty())
+			return std::nullopt;
+		size_t result{};
+		for (const auto digit : value)
+		{
+			if (digit < '0' || digit > '9' || result > (SIZE_MAX - 9U) / 10U)
+				return std::nullopt;
+			result = (result * 10U) + static_cast<size_t>(digit - '0');
+		}
+		return result;
+	}
+
+	bool isArchive(const span<const uint8_t> data) noexcept
+	{
+		return data.size() >= archiveMagic.size() &&
+			std::equal(archiveMagic.begin(), archiveMagic.end(), data.begin(),
+				[](const char magic, const uint8_t value) { return static_cast<uint8_t>(magic) == value; });
+	}
+
+	Archive::Archive(fd_t &&file) : _map{file.map(PROT_READ)}
+	{
+		const ScopedTimer timer{"Archive::Archive"sv};
+		const PhaseScope phase{Phase::elf};
+		if (!_map.valid())
+			return;
+		_data = span{_map.address<uint8_t>(), _map.length()};
+		if (!isArchive({_data.data(), _data.size()}))
+			return;
+
+		// The symbol index and the long name table, when there are any, come ahead of every ordinary member
+		size_t offset{archiveMagic.size()};
+		while (offset < _data.size())
+		{
+			const auto entry{member(offset)};
+			if (!entry)
+				return;
+			if (entry->name == "/"sv || entry->name == "/SYM64/"sv)
+			{
+				if (_hasIndex || !readGNUIndex(entry->data, entry->name != "/"sv))
+					return;
+				_hasIndex = true;
+			}
+			else if (entry->name == "__.SYMDEF"sv || entry->name == "__.SYMDEF SORTED"sv)
+			{
+				if (_hasIndex || !readBSDIndex(entry->data))
+					return;
+				_hasIndex = true;
+			}
+			else if (entry->name == "//"sv)
+				_longNames = asString(entry->data);
+			else
+				break;
+			offset = entry->nextOffset;
+		}
+		_firstMember = offset;
+		_valid = true;
+	}
+
+	// GNU/SysV indices are a big endian count, that many member offsets, then the symbols' names in the same
+	// order, each NUL terminated. The "/SYM64/" form, for archives over 4GiB, has 64-bit counts and offsets.
+	bool Archive::readGNUIndex(const span<uint8_t> index, const bool wide)
+	{
+		const Memory table{index};
+		const size_t width{wide ? 8U : 4U};
+		if (index.size() < width)
+			return false;
+		const uint64_t symbols{wide ? table.read<uint64_t>(0U, Endian::big) : table.read<uint32_t>(0U, Endian::big)};
+		if (symbols > (index.size() - width) / width)
+			return false;
+		const auto namesOffset{static_cast<size_t>(symbols + 1U) * width};
+		auto names{asString(index.subspan(namesOffset))};
+		_symbols.reserve(static_cast<size_t>(symbols));
+		for (size_t symbol{}; symbol < symbols; ++symbol)
+		{
+			const auto position{(symbol + 1U) * width};
+			const uint64_t member{wide ? table.read<uint64_t>(position, Endian::big) :
+				table.read<uint32_t>(position, Endian::big)};
+			const auto end{names.find('\0')};
+			if (end == std::string_view::npos)
+				return false;
+			// As with ld, the first member to define a symbol is the one it comes from
+			_symbols.try_emplace(names.substr(0U, end), static_cast<size_t>(member));
+			names.remove_prefix(end + 1U);
+		}
+		return true;
+	}
+
+	// BSD indices are the byte length of an array of (name offset, member offset) pairs, the array, then the
+	// byte length of the names followed by the names. They're written in the byte order of the machine the
+	// archive was made on, which for any archive we'd link is little endian.
+	bool Archive::readBSDIndex(const span<uint8_t> index)
+	{
+		const Memory table{index};
+		if (index.size() < 8U)
+			return false;
+		const size_t rangesLength{table.read<uint32_t>(0U, Endian::little)};
+		if (rangesLength % 8U || rangesLength > index.size() - 8U)
+			return false;
+		const size_t namesLength{table.read<uint32_t>(4U + rangesLength, Endian::little)};
+		if (namesLength > index.size() - 8U - rangesLength)
+			return false;
+		const auto names{asString(index.subspan(8U + rangesLength, namesLength))};
+		_symbols.reserve(rangesLength / 8U);
+		for (size_t position{4U}; position < 4U + rangesLength; position += 8U)
+		{
+			const size_t nameOffset{table.read<uint32_t>(position, Endian::little)};
+			const size_t member{table.read<uint32_t>(position + 4U, Endian::little)};
+			if (nameOffset >= names.size())
+				return false;
+			const auto name{names.substr(nameOffset)};
+			_symbols.try_emplace(name.substr(0U, name.find('\0')), member);
+		}
+		return true;
+	}
+
+	std::optional<size_t> Archive::lookup(const std::string_view symbol) const noexcept
+	{
+		count(Counter::symbolsLookedUp);
+		const auto entry{_symbols.find(symbol)};
+		if (entry == _symbols.end())
+			return std::nullopt;
+		return entry->second;
+	}
+
+	std::optional<Member> Archive::member(const size_t headerOffset) const noexcept
+	{
+		// Offsets come from the symbol index as well as from walking the archive, so may be anything at all
+		if (headerOffset < archiveMagic.size() || headerOffset > _data.size() ||
+			_data.size() - headerOffset < headerLength)
+			return std::nullopt;
+		const auto header{asString(_data.subspan(headerOffset, headerLength))};
+		const auto dataOffset{headerOffset + headerLength};
+		const auto length{parseDecimal(field(header, sizeOffset, sizeLength))};
+		if (header.substr(headerLength - headerTerminator.size()) != headerTerminator || !length ||
+			*length > _data.size() - dataOffset)
+			return std::nullopt;
+
+		Member result{field(header, 0U, nameLength), headerOffset, _data.subspan(dataOffset, *length),
+			// Members start on even offsets, so one of odd length is followed by a byte of padding
+			dataOffset + *length + (*length & 1U)};
+		auto &name{result.name};
+		if (name.substr(0U, bsdLongName.size()) == bsdLongName)
+		{
+			const auto storedLength{parseDecimal(name.substr(bsdLongName.size()))};
+			if (!storedLength || *storedLength > result.data.size())
+				return std::nullopt;
+			name = asString(result.data.subspan(0U, *storedLength));
+			// The name is padded out with NULs to keep the contents after it aligned
+			name = name.substr(0U, name.find('\0'));
+			result.data = result.data.subspan(*storedLength);
+		}
+		else if (name.size() > 1U && name[0] == '/' && name[1] >= '0' && name[1] <= '9')
+		{
+			// GNU long names are an offset into the "//" member, ending at a '/' (or for SysV, a newline)
+			const auto nameOffset{parseDecimal(name.substr(1U))};
+			if (!nameOffset || *nameOffset >= _longNames.size())
+				return std::nullopt;
+			name = _longNames.substr(*nameOffset);
+			name = name.substr(0U, name.find_first_of("/\n"sv));
+		}
+		// Otherwise GNU ends names with a '/', so they can contain spaces, except for the special members
+		else if (name.size() > 1U && name[0] != '/' && name.back() == '/')
+			name.remove_suffix(1U);
+		return result;
+	}
+
+	std::vector<Member> Archive::members() const
+	{
+		std::vector<Member> result{};
+		if (!_valid)
+			return result;
+		for (auto offset{_firstMember}; offset < _data.size();)
+		{
+			const auto entry{member(offset)};
+			if (!entry)
+				break;
+			result.push_back(*entry);
+			offset = entry->nextOffset;
+		}
+		return result;
+	}
+
+	const ELF *Archive::object(const size_t headerOffset)
+	{
+		if (!_valid)
+			return nullptr;
+		if (const auto existing{_objects.find(headerOffset)}; existing != _objects.end())
+			return &existing->second;
+		const auto entry{member(headerOffset)};
+		if (!entry)
+			return nullptr;
+		return &_objects.try_emplace(headerOffset, entry->data).first->second;
+	}
+
+	const ELF *Archive::resolve(const std::string_view symbol)
+	{
+		const auto headerOffset{lookup(symbol)};
+		return headerOffset ? object(*headerOffset) : nullptr;
+	}
+} // namespace mangrove::ar
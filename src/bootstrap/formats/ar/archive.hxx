@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef FORMATS_AR_ARCHIVE_HXX
+#define FORMATS_AR_ARCHIVE_HXX
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <substrate/fd>
+#include <substrate/mmap>
+#include <substrate/span>
+#include "../elf/elf.hxx"
+
+/**
+ * @file archive.hxx
+ * @brief Reading of static (ar) archives in place, through their symbol index
+ */
+
+namespace mangrove::ar
+{
+	inline namespace internal
+	{
+		using substrate::fd_t;
+		using substrate::mmap_t;
+		using substrate::span;
+		using mangrove::elf::ELF;
+	} // namespace internal
+
+	/** A member of an archive, its contents left in place in the archive's mapping */
+	struct Member final
+	{
+		std::string_view name;
+		// Where the member's header is in the archive, which is how the symbol index refers to members
+		size_t headerOffset;
+		span<uint8_t> data;
+		// Where the next member's header is, if there is one
+		size_t nextOffset;
+	};
+
+	/**
+	 * A static archive, as made by ar(1), mapped in for reading. GNU/SysV archives (with "/" or "/SYM64/"
+	 * symbol indices and a "//" long name table) and BSD archives (with "__.SYMDEF" indices and "#1/"
+	 * names) are both understood, but thin archives, whose members live in files of their own, aren't.
+	 *
+	 * The symbol index is read once, as the archive is opened, into a hash table from each symbol to the
+	 * member defining it, so finding a member is a single probe rather than a search of every member.
+	 * Members are only looked at when asked for, and are read in place - the ELF views object() hands out
+	 * are over the archive's own mapping, built on first use and kept for the archive's lifetime.
+	 * As object() builds views, an Archive must not be used from more than one thread at once.
+	 */
+	struct Archive final
+	{
+	private:
+		mmap_t _map;
+		span<uint8_t> _data{};
+		bool _valid{false};
+		bool _hasIndex{false};
+		// The "//" member holding the names too long for a member header
+		std::string_view _longNames{};
+		// Where the first member after the symbol index and long name table is
+		size_t _firstMember{};
+		std::unordered_map<std::string_view, size_t> _symbols{};
+		std::unordered_map<size_t, ELF> _objects{};
+
+		[[nodiscard]] bool readGNUIndex(span<uint8_t> index, bool wide);
+		[[nodiscard]] bool readBSDIndex(span<uint8_t> index);
+
+	public:
+		Archive(fd_t &&file);
+		Archive(const Archive &) = delete;
+		Archive(Archive &&) = default;
+		Archive &operator =(const Archive &) = delete;
+		Archive &operator =(Archive &&) = default;
+		~Archive() noexcept = default;
+
+		/** Whether the file is an archive we can read, with a well-formed symbol index if it has one */
+		[[nodiscard]] auto valid() const noexcept { return _valid; }
+		/** Whether the archive has a symbol index - without one, lookup() never finds anything */
+		[[nodiscard]] auto hasIndex() const noexcept { return _hasIndex; }
+		[[nodiscard]] auto symbolCount() const noexcept { return _symbols.size(); }
+
+		/** Returns the header offset of the member defining symbol according to the index, if any does */
+		[[nodiscard]] std::optional<size_t> lookup(std::string_view symbol) const noexcept;
+		/** Reads the header of the member at headerOffset, or nothing if there isn't a well-formed one there */
+		[[nodiscard]] std::optional<Member> member(size_t headerOffset) const noexcept;
+		/** Walks the headers of every ordinary member, in archive order */
+		[[nodiscard]] std::vector<Member> members() const;
+		/**
+		 * Returns an ELF view of the member at headerOffset, or nullptr if there's no member there. The view
+		 * may still not be valid() if the member isn't an ELF object.
+		 */
+		[[nodiscard]] const ELF *object(size_t headerOffset);
+		/** Finds the member defining symbol through the index and returns an ELF view of it */
+		[[nodiscard]] const ELF *resolve(std::string_view symbol);
+	};
+
+	/** Checks whether data starts with the magic of an archive we can read */
+	[[nodiscard]] bool isArchive(span<const uint8_t> data) noexcept;
+} // namespace mangrove::ar
+
+#endif /*FORMATS_AR_ARCHIVE_HXX*/
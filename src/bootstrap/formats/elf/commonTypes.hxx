@@ -15,6 +15,10 @@ namespace mangrove::elf::types
 
 	// This represents the magic number \x7f ELF
 	constexpr static inline std::array<uint8_t, 4> elfMagic{{0x7fU, 0x45U, 0x4cU, 0x46U}};
+	// SHN_LORESERVE, the first of the section indices reserved for special meanings
+	constexpr static inline uint16_t reservedSectionIndices{0xff00U};
+	// SHN_XINDEX, marking the section names index as too large for the header and kept in section 0
+	constexpr static inline uint16_t extendedSectionIndex{0xffffU};
 
 	struct ELFIdent
 	{
@@ -34,6 +38,16 @@ namespace mangrove::elf::types
 		[[nodiscard]] auto abi() const noexcept { return _storage.read<ABI>(7); }
 		[[nodiscard]] auto padding() const noexcept { return _storage.read<std::array<uint8_t, 8>>(8); }
 
+		void magic(const std::array<uint8_t, 4> &value) const noexcept { _storage.write(0, value); }
+		void elfClass(const Class value) const noexcept { _storage.write(4, value); }
+		void endian(const Endian value) noexcept
+		{
+			_storage.write(5, value);
+			_endian = value;
+		}
+		void version(const IdentVersion value) const noexcept { _storage.write(6, value); }
+		void abi(const ABI value) const noexcept { _storage.write(7, value); }
+
 		[[nodiscard]] constexpr static size_t size() noexcept { return 16U; }
 	};
 } // namespace mangrove::elf::types
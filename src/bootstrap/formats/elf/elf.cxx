@@ -1,24 +1,95 @@
 // SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include <substrate/index_sequence>
 #include "elf.hxx"
+#include "../../core/trace.hxx"
+#include "../../core/memory.hxx"
+
+using namespace std::literals::string_view_literals;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
+using mangrove::elf::io::inBounds;
 
 namespace mangrove::elf
 {
-	ELF::ELF(fd_t &&file) : _backingStorage{file.map(PROT_READ)}, _header
+	// Checks that an ELF identity is one we know how to go on to read the rest of the header for
+	[[nodiscard]] static bool validIdent(const span<uint8_t> &data) noexcept
+	{
+		if (data.size() < ELFIdent::size())
+			return false;
+		const ELFIdent ident{data};
+		const auto elfClass{ident.elfClass()};
+		const auto endian{ident.endian()};
+		return ident.magic() == elfMagic && ident.version() == IdentVersion::current &&
+			(endian == Endian::little || endian == Endian::big) &&
+			((elfClass == Class::elf32Bit && data.size() >= elf32::ELFHeader::size()) ||
+			(elfClass == Class::elf64Bit && data.size() >= elf64::ELFHeader::size()));
+	}
+
+	// Picks the header view for an image, or one reading as all zeros if it has no header we can read
+	// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+	[[nodiscard]] static ELFHeader headerFor(const span<uint8_t> &data, std::unique_ptr<uint8_t []> &nullHeader)
 	{
-		[this]() -> ELFHeader
+		// A file too short or too mangled to have a header gets one of zeros, its own so nothing written
+		// through it can show up in any other file's
+		if (!validIdent(data))
 		{
-			auto &map{std::get<mmap_t>(_backingStorage)};
-			const auto data{toSpan(map)};
-			const ELFIdent ident{data};
-			// TODO: Check the validity of ident
-			if (ident.elfClass() == Class::elf32Bit)
-				return elf32::ELFHeader{data};
-			return elf64::ELFHeader{data};
-		}()
-	} // This initially allows the vectors for the headers to be default constructed.
+			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+			nullHeader = std::make_unique<uint8_t []>(elf64::ELFHeader::size());
+			return elf64::ELFHeader{span{nullHeader.get(), elf64::ELFHeader::size()}};
+		}
+		if (ELFIdent{data}.elfClass() == Class::elf32Bit)
+			return elf32::ELFHeader{data};
+		return elf64::ELFHeader{data};
+	}
+
+	// Returns the image in a mapping, asking for the readahead before the first header read faults anything in
+	[[nodiscard]] static span<uint8_t> imageFor(mmap_t &map, [[maybe_unused]] const AccessPattern access) noexcept
+	{
+		if (!map.valid())
+			return {};
+#ifndef _WIN32
+		if (access == AccessPattern::sequential)
+		{
+			static_cast<void>(madvise(map.address(), map.length(), MADV_SEQUENTIAL));
+			static_cast<void>(madvise(map.address(), map.length(), MADV_WILLNEED));
+		}
+#endif
+		return toSpan(map);
+	}
+
+	ELF::ELF(fd_t &&file, const AccessPattern access) : _backingStorage{file.map(PROT_READ)},
+		_header{headerFor(imageFor(std::get<mmap_t>(_backingStorage), access), _nullHeader)}
+		{ load(image()); }
+
+	ELF::ELF(const span<uint8_t> data) : _backingStorage{data}, _header{headerFor(data, _nullHeader)}
+		{ load(data); }
+
+	span<uint8_t> ELF::image() const noexcept
+	{
+		if (const auto *const data{std::get_if<span<uint8_t>>(&_backingStorage)})
+			return *data;
+		const auto &map{std::get<mmap_t>(_backingStorage)};
+		if (!map.valid())
+			return {};
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+		return {const_cast<uint8_t *>(map.address<uint8_t>()), map.length()};
+	}
+
+	// Reads the header tables of a mapped or borrowed image in place, then validates all they describe
+	void ELF::load(const span<uint8_t> data)
 	{
-		const auto data{toSpan(std::get<mmap_t>(_backingStorage))};
+		const ScopedTimer timer{"ELF::ELF"sv};
+		const PhaseScope phase{Phase::elf};
+		if (!validIdent(data))
+			return;
+		const auto sectionHeaderCount{sectionCounts(data)};
+		if (!sectionHeaderCount || !validTables(data, *sectionHeaderCount))
+			return;
 		const auto elfClass{_header.elfClass()};
 		const auto endian{_header.endian()};
 		const auto programHeaderSize{_header.programHeaderSize()};
@@ -51,7 +122,7 @@ namespace mangrove::elf
 		const auto sectionHeaderSize{_header.sectionHeaderSize()};
 		offset = _header.shdrOffset();
 		// Now loop through and pull out all the section headers.
-		for ([[maybe_unused]] const auto index : substrate::indexSequence_t{_header.sectionHeaderCount()})
+		for ([[maybe_unused]] const auto index : substrate::indexSequence_t{*sectionHeaderCount})
 		{
 			if (elfClass == Class::elf32Bit)
 				_sectionHeaders.emplace_back
@@ -74,18 +145,308 @@ namespace mangrove::elf
 			offset += sectionHeaderSize;
 		}
 
+		// Now the headers are known to be readable, check everything they describe is too
+		if (!validContents(data))
+		{
+			_programHeaders.clear();
+			_sectionHeaders.clear();
+			return;
+		}
+
 		// Extract the section names
-		const auto &sectionNamesHeader{_sectionHeaders[_header.sectionNamesIndex()]};
-		_sectionNames = data.subspan(sectionNamesHeader.fileOffset(), sectionNamesHeader.fileLength());
+		if (!_sectionHeaders.empty())
+		{
+			const auto &sectionNamesHeader{_sectionHeaders[_sectionNamesIndex]};
+			_sectionNames = data.subspan(sectionNamesHeader.fileOffset(), sectionNamesHeader.fileLength());
+		}
+		_valid = true;
+	}
+
+	/**
+	 * Reads how many section headers there are and which holds the section names. A file with too many
+	 * sections for the header's 16-bit fields (extended section numbering) zeros e_shnum and sets e_shstrndx
+	 * to SHN_XINDEX, keeping the real values in the null section's sh_size and sh_link instead. Gives back
+	 * nothing if that null section has to be read and can't be.
+	 */
+	std::optional<uint64_t> ELF::sectionCounts(const span<uint8_t> data) noexcept
+	{
+		const auto elfClass{_header.elfClass()};
+		const auto sectionHeaderSize{elfClass == Class::elf32Bit ?
+			elf32::SectionHeader::size() : elf64::SectionHeader::size()};
+		uint64_t count{_header.sectionHeaderCount()};
+		_sectionNamesIndex = _header.sectionNamesIndex();
+		const auto shdrOffset{_header.shdrOffset()};
+		if ((count || !shdrOffset) && _sectionNamesIndex != extendedSectionIndex)
+			return count;
+
+		if (_header.sectionHeaderSize() != sectionHeaderSize || !inBounds(shdrOffset, 1U, sectionHeaderSize, data.size()))
+			return std::nullopt;
+		const auto nullSection{data.subspan(shdrOffset, sectionHeaderSize)};
+		const SectionHeader header{elfClass == Class::elf32Bit ?
+			SectionHeader{elf32::SectionHeader{nullSection, _header.endian()}} :
+			SectionHeader{elf64::SectionHeader{nullSection, _header.endian()}}};
+		if (!count)
+			count = header.fileLength();
+		if (_sectionNamesIndex == extendedSectionIndex)
+			_sectionNamesIndex = header.link();
+		return count;
+	}
+
+	// Checks the ELF header proper, and that the header tables it points to lie within the file
+	bool ELF::validTables(const span<uint8_t> data, const uint64_t sectionHeaderCount) const noexcept
+	{
+		const auto elfClass{_header.elfClass()};
+		const auto programHeaderSize{elfClass == Class::elf32Bit ?
+			elf32::ProgramHeader::size() : elf64::ProgramHeader::size()};
+		const auto sectionHeaderSize{elfClass == Class::elf32Bit ?
+			elf32::SectionHeader::size() : elf64::SectionHeader::size()};
+		const auto headerSize{elfClass == Class::elf32Bit ? elf32::ELFHeader::size() : elf64::ELFHeader::size()};
+		const auto programHeaderCount{_header.programHeaderCount()};
+		return _header.version() == Version::current && _header.headerSize() == headerSize &&
+			(!programHeaderCount || (_header.programHeaderSize() == programHeaderSize &&
+				inBounds(_header.phdrOffset(), programHeaderCount, programHeaderSize, data.size()))) &&
+			(!sectionHeaderCount || (_header.sectionHeaderSize() == sectionHeaderSize &&
+				inBounds(_header.shdrOffset(), sectionHeaderCount, sectionHeaderSize, data.size()))) &&
+			(sectionHeaderCount ? _sectionNamesIndex < sectionHeaderCount : !_sectionNamesIndex);
+	}
+
+	/**
+	 * Checks every segment, section and section name lies within the file, and that sections only
+	 * link to other sections that exist. The fields are gathered up front so the checks themselves
+	 * are a single branch-free sweep the compiler can vectorise, rather than a branch per field.
+	 */
+	bool ELF::validContents(const span<uint8_t> data) const noexcept
+	{
+		const ScopedTimer timer{"ELF::validate"sv};
+		const auto sectionCount{_sectionHeaders.size()};
+		const auto elf32Bit{_header.elfClass() == Class::elf32Bit};
+		const auto symbolSize{elf32Bit ? elf32::ELFSymbol::size() : elf64::ELFSymbol::size()};
+		const auto relSize{elf32Bit ? elf32::ELFRelocation::size(false) : elf64::ELFRelocation::size(false)};
+		const auto relaSize{elf32Bit ? elf32::ELFRelocation::size(true) : elf64::ELFRelocation::size(true)};
+		std::vector<uint64_t> offsets{};
+		std::vector<uint64_t> lengths{};
+		offsets.reserve(_programHeaders.size() + sectionCount);
+		lengths.reserve(_programHeaders.size() + sectionCount);
+
+		for (const auto &header : _programHeaders)
+		{
+			offsets.push_back(header.offset());
+			lengths.push_back(header.fileLength());
+		}
+		uint64_t invalid{};
+		for (const auto &header : _sectionHeaders)
+		{
+			const auto type{header.type()};
+			// A section that takes no space in the file can claim whatever extent it likes
+			const auto occupiesFile{type != SectionHeaderType::bss && type != SectionHeaderType::empty};
+			offsets.push_back(occupiesFile ? header.fileOffset() : 0U);
+			lengths.push_back(occupiesFile ? header.fileLength() : 0U);
+			const auto symbols{type == SectionHeaderType::symbolTable || type == SectionHeaderType::dynamicSymbols};
+			invalid |= uint64_t{header.link() >= sectionCount} |
+				uint64_t{symbols && header.fileLength() % symbolSize != 0U} |
+				uint64_t{type == SectionHeaderType::reloc && header.fileLength() % relSize != 0U} |
+				uint64_t{type == SectionHeaderType::relocAddend && header.fileLength() % relaSize != 0U};
+		}
+
+		const auto length{data.size()};
+		for (size_t index{}; index < offsets.size(); ++index)
+			invalid |= uint64_t{offsets[index] > length} | uint64_t{lengths[index] > length - offsets[index]};
+		if (invalid || !sectionCount)
+			return !invalid;
+
+		// With the name table known to be in the file, every section's name has to start inside it
+		const auto namesLength{_sectionHeaders[_sectionNamesIndex].fileLength()};
+		for (const auto &header : _sectionHeaders)
+			invalid |= uint64_t{header.nameOffset() >= namesLength};
+		return !invalid;
+	}
+
+	// Fills in the identifying fields of a freshly allocated (and so zeroed) header for a relocatable object
+	template<typename SectionHeaderT, typename T> static T initialise(T header, const Class elfClass,
+		const Endian endian, const Machine machine) noexcept
+	{
+		header.magic(elfMagic);
+		header.elfClass(elfClass);
+		header.endian(endian);
+		header.ELFIdent::version(IdentVersion::current);
+		header.abi(ABI::systemV);
+		header.type(Type::relocatable);
+		header.machine(machine);
+		header.version(Version::current);
+		header.headerSize(static_cast<uint16_t>(T::size()));
+		header.sectionHeaderSize(static_cast<uint16_t>(SectionHeaderT::size()));
+		return header;
+	}
+
+	ELF::ELF(const Class elfClass, const Endian endian, const Machine machine) :
+		_backingStorage{FragmentStorage{}}, _header
+	{
+		[&]() -> ELFHeader
+		{
+			if (elfClass == Class::elf32Bit)
+				return initialise<elf32::SectionHeader>(allocate<elf32::ELFHeader>(), elfClass, endian, machine);
+			return initialise<elf64::SectionHeader>(allocate<elf64::ELFHeader>(), elfClass, endian, machine);
+		}()
+	}
+	{
+		_headerStorage = span{std::get<FragmentStorage>(_backingStorage).front().get(), _header.headerSize()};
+		// The null section's header is left all zeros, and it has no contents
+		static_cast<void>(allocateSection({}, SectionHeaderType::empty, {}, 0U));
+		static_cast<void>(allocateSection(".shstrtab"sv, SectionHeaderType::stringTable, {}, 1U));
+		_header.sectionNamesIndex(1U);
+		_sectionNamesIndex = 1U;
+		_valid = true;
+	}
+
+	SectionHeader ELF::allocateSection(const std::string_view name, const SectionHeaderType type,
+		const Flags<SectionFlag> flags, const uint64_t alignment)
+	{
+		const auto headerData{allocate(_header.elfClass() == Class::elf32Bit ?
+			elf32::SectionHeader::size() : elf64::SectionHeader::size())};
+		const auto endian{_header.endian()};
+		const auto &header
+		{
+			_header.elfClass() == Class::elf32Bit ?
+				_sectionHeaders.emplace_back(elf32::SectionHeader{headerData, endian}) :
+				_sectionHeaders.emplace_back(elf64::SectionHeader{headerData, endian})
+		};
+		_sectionHeaderStorage.emplace_back(headerData);
+		// Sections sharing a name share its entry in the table, and the null section gets the empty string
+		header.nameOffset(_sectionNameData.add(name));
+		header.type(type);
+		header.flags(flags);
+		header.alignment(alignment);
+		_sectionContents.emplace_back(Memory{{}});
+		// Adding a name may have moved the name table, so point everything that refers to it at its new home
+		const auto names{_sectionNameData.storage()};
+		_sectionNames = names;
+		if (_sectionHeaders.size() > 1U)
+		{
+			_sectionContents[1] = names;
+			_sectionHeaders[1].fileLength(names.length());
+		}
+		return header;
+	}
+
+	size_t ELF::symbolCount(const size_t sectionIndex) const noexcept
+	{
+		const auto symbolSize{_header.elfClass() == Class::elf32Bit ?
+			elf32::ELFSymbol::size() : elf64::ELFSymbol::size()};
+		return sectionData(sectionIndex).length() / symbolSize;
+	}
+
+	ELFSymbol ELF::symbol(const size_t sectionIndex, const size_t index) const noexcept
+	{
+		const auto data{sectionData(sectionIndex).dataSpan()};
+		const auto endian{_header.endian()};
+		if (_header.elfClass() == Class::elf32Bit)
+			return elf32::ELFSymbol{data.subspan(index * elf32::ELFSymbol::size(), elf32::ELFSymbol::size()), endian};
+		return elf64::ELFSymbol{data.subspan(index * elf64::ELFSymbol::size(), elf64::ELFSymbol::size()), endian};
+	}
+
+	size_t ELF::relocationCount(const size_t sectionIndex) const noexcept
+	{
+		if (sectionIndex >= _sectionHeaders.size())
+			return 0U;
+		const auto withAddend{_sectionHeaders[sectionIndex].type() == SectionHeaderType::relocAddend};
+		const auto relocationSize{_header.elfClass() == Class::elf32Bit ?
+			elf32::ELFRelocation::size(withAddend) : elf64::ELFRelocation::size(withAddend)};
+		return sectionData(sectionIndex).length() / relocationSize;
+	}
+
+	ELFRelocation ELF::relocation(const size_t sectionIndex, const size_t index) const noexcept
+	{
+		const auto data{sectionData(sectionIndex).dataSpan()};
+		const auto endian{_header.endian()};
+		const auto withAddend{_sectionHeaders[sectionIndex].type() == SectionHeaderType::relocAddend};
+		if (_header.elfClass() == Class::elf32Bit)
+		{
+			const auto size{elf32::ELFRelocation::size(withAddend)};
+			return elf32::ELFRelocation{data.subspan(index * size, size), endian, withAddend};
+		}
+		const auto size{elf64::ELFRelocation::size(withAddend)};
+		return elf64::ELFRelocation{data.subspan(index * size, size), endian, withAddend};
+	}
+
+	size_t ELF::addSection(const std::string_view name, const SectionHeaderType type, const Flags<SectionFlag> flags,
+		const span<const uint8_t> data, const uint64_t alignment)
+	{
+		const PhaseScope phase{Phase::elf};
+		const auto header{allocateSection(name, type, flags, alignment)};
+		const auto index{_sectionHeaders.size() - 1U};
+		header.fileLength(data.size());
+		if (type != SectionHeaderType::bss)
+		{
+			const auto contents{allocate(data.size())};
+			std::copy(data.begin(), data.end(), contents.begin());
+			_sectionContents[index] = contents;
+		}
+		return index;
+	}
+
+	std::optional<size_t> ELF::sectionIndex(const std::string_view name) const noexcept
+	{
+		for (size_t index{}; index < _sectionHeaders.size(); ++index)
+		{
+			if (_sectionNames.matches(_sectionHeaders[index].nameOffset(), name))
+				return index;
+		}
+		return std::nullopt;
+	}
+
+	Memory ELF::sectionData(const size_t index) const noexcept
+	{
+		if (index >= _sectionHeaders.size())
+			return {{}};
+		if (std::holds_alternative<FragmentStorage>(_backingStorage))
+			return _sectionContents[index];
+		const auto &header{_sectionHeaders[index]};
+		if (header.type() == SectionHeaderType::bss || header.type() == SectionHeaderType::empty)
+			return {{}};
+		// Validation on load guarantees the section lies within the image
+		return image().subspan(header.fileOffset(), header.fileLength());
 	}
 
-	ELF::ELF(const Class elfClass) : _backingStorage{FragmentStorage{}}, _header
+	bool ELF::write(const fd_t &file)
 	{
-		[this](const Class fileClass) -> ELFHeader
+		if (!std::holds_alternative<FragmentStorage>(_backingStorage))
+			return false;
+		const ScopedTimer timer{"ELF::write"sv};
+		const PhaseScope phase{Phase::elf};
+		const auto alignTo{[](const uint64_t offset, const uint64_t alignment)
+			{ return alignment > 1U ? (offset + alignment - 1U) & ~(alignment - 1U) : offset; }};
+
+		// Lay the section contents out after the ELF header, honouring their alignments
+		uint64_t offset{_headerStorage.length()};
+		for (size_t index{1U}; index < _sectionHeaders.size(); ++index)
 		{
-			if (fileClass == Class::elf32Bit)
-				return allocate<elf32::ELFHeader>();
-			return allocate<elf64::ELFHeader>();
-		}(elfClass)
-	} { }
+			const auto &header{_sectionHeaders[index]};
+			offset = alignTo(offset, header.alignment());
+			header.fileOffset(offset);
+			if (header.type() != SectionHeaderType::bss)
+				offset += _sectionContents[index].length();
+		}
+		// Followed by the section header table
+		const auto shdrOffset{alignTo(offset, 8U)};
+		const auto sectionHeaderSize{_header.sectionHeaderSize()};
+		_header.shdrOffset(shdrOffset);
+		// Past the reserved indices, the count only fits in the null section's size (extended section numbering)
+		const auto sectionCount{_sectionHeaders.size()};
+		const auto extendedCount{sectionCount >= reservedSectionIndices};
+		_header.sectionHeaderCount(extendedCount ? 0U : static_cast<uint16_t>(sectionCount));
+		_sectionHeaders[0].fileLength(extendedCount ? sectionCount : 0U);
+
+		std::vector<uint8_t> image(shdrOffset + (_sectionHeaders.size() * sectionHeaderSize));
+		const auto place{[&](const Memory &block, const uint64_t position)
+			{ std::copy_n(block.data(), block.length(), image.begin() + static_cast<ptrdiff_t>(position)); }};
+		place(_headerStorage, 0U);
+		for (size_t index{1U}; index < _sectionHeaders.size(); ++index)
+		{
+			if (_sectionHeaders[index].type() != SectionHeaderType::bss)
+				place(_sectionContents[index], _sectionHeaders[index].fileOffset());
+		}
+		for (size_t index{}; index < _sectionHeaderStorage.size(); ++index)
+			place(_sectionHeaderStorage[index], shdrOffset + (index * sectionHeaderSize));
+		return file.write(image.data(), image.size());
+	}
 } // namespace mangrove::elf
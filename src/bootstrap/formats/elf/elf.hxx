@@ -2,6 +2,8 @@
 #ifndef FORMATS_ELF_HXX
 #define FORMATS_ELF_HXX
 
+#include <optional>
+#include <string_view>
 #include <variant>
 #include <vector>
 #include <memory>
@@ -26,28 +28,72 @@ namespace mangrove::elf
 			{ return {map.address<uint8_t>(), map.length()}; }
 	} // namespace internal
 
+	/** How a mapped ELF file is going to be read, so the kernel can tune its paging for it */
+	enum class AccessPattern : uint8_t
+	{
+		normal,
+		// The whole file is about to be walked through, so read it all in ahead of time
+		sequential,
+	};
+
+	/**
+	 * An ELF file, either mapped in from disk (or viewed in place in memory, as with an archive member)
+	 * for reading, or being built up in memory for writing. When building, section 0 is the null section
+	 * and section 1 holds the section names, which grows as sections are added.
+	 *
+	 * A mapped file is validated once as it is loaded - every header table, section and name is
+	 * checked against the size of the mapping - so the accessors never have to range check what
+	 * they read. A file that fails validation is left with no program or section headers.
+	 */
 	struct ELF final
 	{
 	private:
-		std::variant<mmap_t, FragmentStorage> _backingStorage;
+		// A file mapped in, one being built, or an image borrowed from elsewhere, such as an archive member
+		std::variant<mmap_t, FragmentStorage, span<uint8_t>> _backingStorage;
+		// The zeros standing in for the header of an invalid file, on the heap so moving the ELF doesn't leave
+		// _header pointing into the object moved from
+		// NOLINTNEXTLINE(modernize-avoid-c-arrays)
+		std::unique_ptr<uint8_t []> _nullHeader{};
 		ELFHeader _header;
 		std::vector<ProgramHeader> _programHeaders{};
 		std::vector<SectionHeader> _sectionHeaders{};
 		StringTable _sectionNames{};
+		// The header's e_shstrndx, or the null section's link when that is SHN_XINDEX
+		uint32_t _sectionNamesIndex{};
+		bool _valid{false};
+		// Only used when building - the storage behind the headers, the section contents, and the section names
+		Memory _headerStorage{{}};
+		std::vector<Memory> _sectionHeaderStorage{};
+		std::vector<Memory> _sectionContents{};
+		StringTableBuilder _sectionNameData{};
 
-		template<typename T> T allocate()
+		span<uint8_t> allocate(const size_t size)
 		{
 			auto &storage{std::get<FragmentStorage>(_backingStorage)};
-			const auto size{T::size()};
 			// NOLINTNEXTLINE(modernize-avoid-c-arrays)
 			const auto &allocation{storage.emplace_back(std::make_unique<uint8_t []>(size))};
-			return {span{allocation.get(), size}};
+			return {allocation.get(), size};
 		}
 
+		template<typename T, typename... Args> T allocate(Args &&...args)
+			{ return {allocate(T::size()), std::forward<Args>(args)...}; }
+
+		SectionHeader allocateSection(std::string_view name, SectionHeaderType type, Flags<SectionFlag> flags,
+			uint64_t alignment);
+		void load(span<uint8_t> data);
+		[[nodiscard]] span<uint8_t> image() const noexcept;
+		[[nodiscard]] std::optional<uint64_t> sectionCounts(span<uint8_t> data) noexcept;
+		[[nodiscard]] bool validTables(span<uint8_t> data, uint64_t sectionHeaderCount) const noexcept;
+		[[nodiscard]] bool validContents(span<uint8_t> data) const noexcept;
+
 	public:
-		ELF(fd_t &&file);
-		ELF(Class elfClass);
+		ELF(fd_t &&file, AccessPattern access = AccessPattern::normal);
+		/** Reads an ELF image in place from memory owned elsewhere, which must outlive this and all taken from it */
+		explicit ELF(span<uint8_t> data);
+		ELF(Class elfClass, Endian endian = Endian::little, Machine machine = Machine::nonSpecific);
 
+		/** Whether the file passed validation when it was loaded - always true for one being built */
+		[[nodiscard]] auto valid() const noexcept { return _valid; }
 		[[nodiscard]] auto &header() noexcept { return _header; }
 		[[nodiscard]] const auto &header() const noexcept { return _header; }
 		[[nodiscard]] auto &programHeaders() noexcept { return _programHeaders; }
@@ -56,6 +102,41 @@ namespace mangrove::elf
 		[[nodiscard]] const auto &sectionHeaders() const noexcept { return _sectionHeaders; }
 		[[nodiscard]] auto &sectionNames() noexcept { return _sectionNames; }
 		[[nodiscard]] const auto &sectionNames() const noexcept { return _sectionNames; }
+
+		/** Looks a section up by name through the section name table, returning its index */
+		[[nodiscard]] std::optional<size_t> sectionIndex(std::string_view name) const noexcept;
+		/** Returns the contents of a section in place, or an empty block if it has none in the file */
+		[[nodiscard]] Memory sectionData(size_t index) const noexcept;
+
+		/** Returns a view of a string table section, such as the one a symbol table links to */
+		[[nodiscard]] StringTable stringTable(size_t index) const noexcept { return sectionData(index); }
+		/** Returns the number of entries in a symbol table section */
+		[[nodiscard]] size_t symbolCount(size_t sectionIndex) const noexcept;
+		/** Returns a view of an entry in a symbol table section, which must be less than symbolCount() */
+		[[nodiscard]] ELFSymbol symbol(size_t sectionIndex, size_t index) const noexcept;
+		/** Returns the number of entries in a relocation (SHT_REL or SHT_RELA) section */
+		[[nodiscard]] size_t relocationCount(size_t sectionIndex) const noexcept;
+		/** Returns a view of an entry in a relocation section, which must be less than relocationCount() */
+		[[nodiscard]] ELFRelocation relocation(size_t sectionIndex, size_t index) const noexcept;
+
+		/**
+		 * Decodes every entry of a table section - symbols or relocations - into records in one pass,
+		 * reusing records' storage, and returns how many there were. Record must be the type for the
+		 * file's class, such as elf64::SymbolRecord for a 64-bit file's symbol table.
+		 */
+		template<typename Record> size_t readTable(const size_t sectionIndex, std::vector<Record> &records) const
+		{
+			const auto data{sectionData(sectionIndex)};
+			records.resize(data.length() / sizeof(Record));
+			io::readRecords(data.dataSpan(), records.data(), records.size(), _header.endian());
+			return records.size();
+		}
+
+		/** Adds a section holding a copy of data to an ELF being built, returning its index */
+		size_t addSection(std::string_view name, SectionHeaderType type, Flags<SectionFlag> flags,
+			span<const uint8_t> data, uint64_t alignment = 1U);
+		/** Lays out and writes an ELF being built to file */
+		[[nodiscard]] bool write(const fd_t &file);
 	};
 } // namespace mangrove::elf
 
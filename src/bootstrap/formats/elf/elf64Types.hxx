@@ -2,6 +2,7 @@
 #ifndef FORMATS_ELF64_TYPES_HXX
 #define FORMATS_ELF64_TYPES_HXX
 
+#include <cstddef>
 #include "io.hxx"
 #include "enums.hxx"
 #include "commonTypes.hxx"
@@ -30,6 +31,20 @@ namespace mangrove::elf::types::elf64
 		[[nodiscard]] auto sectionHeaderCount() const noexcept { return _storage.read<uint16_t>(60, _endian); }
 		[[nodiscard]] auto sectionNamesIndex() const noexcept { return _storage.read<uint16_t>(62, _endian); }
 
+		void type(const Type value) const noexcept { _storage.write(16, value, _endian); }
+		void machine(const Machine value) const noexcept { _storage.write(18, value, _endian); }
+		void version(const Version value) const noexcept { _storage.write(20, value, _endian); }
+		void entryPoint(const uint64_t value) const noexcept { _storage.write(24, value, _endian); }
+		void phdrOffset(const uint64_t value) const noexcept { _storage.write(32, value, _endian); }
+		void shdrOffset(const uint64_t value) const noexcept { _storage.write(40, value, _endian); }
+		void flags(const uint32_t value) const noexcept { _storage.write(48, value, _endian); }
+		void headerSize(const uint16_t value) const noexcept { _storage.write(52, value, _endian); }
+		void programHeaderSize(const uint16_t value) const noexcept { _storage.write(54, value, _endian); }
+		void programHeaderCount(const uint16_t value) const noexcept { _storage.write(56, value, _endian); }
+		void sectionHeaderSize(const uint16_t value) const noexcept { _storage.write(58, value, _endian); }
+		void sectionHeaderCount(const uint16_t value) const noexcept { _storage.write(60, value, _endian); }
+		void sectionNamesIndex(const uint16_t value) const noexcept { _storage.write(62, value, _endian); }
+
 		[[nodiscard]] bool valid() const noexcept
 		{
 			return
@@ -60,6 +75,15 @@ namespace mangrove::elf::types::elf64
 		[[nodiscard]] auto memoryLength() const noexcept { return _storage.read<uint64_t>(40, _endian); }
 		[[nodiscard]] auto alignment() const noexcept { return _storage.read<uint64_t>(48, _endian); }
 
+		void type(const ProgramHeaderType value) const noexcept { _storage.write(0, value, _endian); }
+		void flags(const uint32_t value) const noexcept { _storage.write(4, value, _endian); }
+		void offset(const uint64_t value) const noexcept { _storage.write(8, value, _endian); }
+		void virtualAddress(const uint64_t value) const noexcept { _storage.write(16, value, _endian); }
+		void physicalAddress(const uint64_t value) const noexcept { _storage.write(24, value, _endian); }
+		void fileLength(const uint64_t value) const noexcept { _storage.write(32, value, _endian); }
+		void memoryLength(const uint64_t value) const noexcept { _storage.write(40, value, _endian); }
+		void alignment(const uint64_t value) const noexcept { _storage.write(48, value, _endian); }
+
 		[[nodiscard]] constexpr static size_t size() noexcept { return 56U; }
 	};
 
@@ -83,6 +107,18 @@ namespace mangrove::elf::types::elf64
 		[[nodiscard]] auto alignment() const noexcept { return _storage.read<uint64_t>(48, _endian); }
 		[[nodiscard]] auto entityLength() const noexcept { return _storage.read<uint64_t>(56, _endian); }
 
+		void nameOffset(const uint32_t value) const noexcept { _storage.write(0, value, _endian); }
+		void type(const SectionHeaderType value) const noexcept { _storage.write(4, value, _endian); }
+		void flags(const Flags<SectionFlag> value) const noexcept
+			{ _storage.write(8, static_cast<uint64_t>(value.toRaw()), _endian); }
+		void address(const uint64_t value) const noexcept { _storage.write(16, value, _endian); }
+		void fileOffset(const uint64_t value) const noexcept { _storage.write(24, value, _endian); }
+		void fileLength(const uint64_t value) const noexcept { _storage.write(32, value, _endian); }
+		void link(const uint32_t value) const noexcept { _storage.write(40, value, _endian); }
+		void info(const uint32_t value) const noexcept { _storage.write(44, value, _endian); }
+		void alignment(const uint64_t value) const noexcept { _storage.write(48, value, _endian); }
+		void entityLength(const uint64_t value) const noexcept { _storage.write(56, value, _endian); }
+
 		[[nodiscard]] constexpr static size_t size() noexcept { return 64U; }
 	};
 
@@ -104,6 +140,77 @@ namespace mangrove::elf::types::elf64
 
 		[[nodiscard]] constexpr static size_t size() noexcept { return 24U; }
 	};
+
+	/**
+	 * A relocation table entry, read in place. SHT_REL and SHT_RELA entries share a layout bar the
+	 * trailing addend, so one view serves both - an entry without one reads as having an addend of 0
+	 */
+	struct ELFRelocation final
+	{
+	private:
+		Memory _storage;
+		Endian _endian;
+		bool _withAddend;
+
+	public:
+		ELFRelocation(const Memory &storage, const Endian &endian, const bool withAddend) :
+			_storage{storage}, _endian{endian}, _withAddend{withAddend} { }
+
+		[[nodiscard]] auto offset() const noexcept { return _storage.read<uint64_t>(0, _endian); }
+		[[nodiscard]] auto info() const noexcept { return _storage.read<uint64_t>(8, _endian); }
+		[[nodiscard]] int64_t addend() const noexcept
+			{ return _withAddend ? static_cast<int64_t>(_storage.read<uint64_t>(16, _endian)) : 0; }
+		[[nodiscard]] auto symbol() const noexcept { return static_cast<uint32_t>(info() >> 32U); }
+		[[nodiscard]] auto type() const noexcept { return static_cast<uint32_t>(info()); }
+		[[nodiscard]] auto withAddend() const noexcept { return _withAddend; }
+
+		[[nodiscard]] constexpr static size_t size(const bool withAddend) noexcept
+			{ return withAddend ? 24U : 16U; }
+	};
+
+	/**
+	 * A symbol table entry decoded to native byte order. This mirrors the on-disk layout
+	 * exactly so that whole tables can be decoded at once with io::readRecords()
+	 */
+	struct SymbolRecord final
+	{
+		uint32_t nameOffset;
+		uint8_t info;
+		uint8_t other;
+		uint16_t sectionIndex;
+		uint64_t value;
+		uint64_t symbolLength;
+
+		constexpr static std::array<uint8_t, 6> fieldSizes{{4U, 1U, 1U, 2U, 8U, 8U}};
+	};
+
+	/** A relocation table entry without an addend, decoded to native byte order */
+	struct RelRecord final
+	{
+		uint64_t offset;
+		uint64_t info;
+
+		[[nodiscard]] constexpr uint32_t symbol() const noexcept { return static_cast<uint32_t>(info >> 32U); }
+		[[nodiscard]] constexpr uint32_t type() const noexcept { return static_cast<uint32_t>(info); }
+
+		constexpr static std::array<uint8_t, 2> fieldSizes{{8U, 8U}};
+	};
+
+	/** A relocation table entry with an addend, decoded to native byte order */
+	struct RelaRecord final
+	{
+		uint64_t offset;
+		uint64_t info;
+		int64_t addend;
+
+		[[nodiscard]] constexpr uint32_t symbol() const noexcept { return static_cast<uint32_t>(info >> 32U); }
+		[[nodiscard]] constexpr uint32_t type() const noexcept { return static_cast<uint32_t>(info); }
+
+		constexpr static std::array<uint8_t, 3> fieldSizes{{8U, 8U, 8U}};
+	};
+
+	static_assert(sizeof(SymbolRecord) == ELFSymbol::size() && offsetof(SymbolRecord, value) == 8U);
+	static_assert(sizeof(RelRecord) == 16U && sizeof(RelaRecord) == 24U);
 } // namespace mangrove::elf::types::elf64
 
 #endif /*FORMATS_ELF64_TYPES_HXX*/
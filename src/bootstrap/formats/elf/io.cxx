@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstring>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <numeric>
+#include <immintrin.h>
+#define MANGROVE_SHUFFLE_SSSE3
+#endif
+#include "io.hxx"
+
+namespace mangrove::elf::io
+{
+	namespace
+	{
+#ifdef MANGROVE_SHUFFLE_SSSE3
+		constexpr size_t blockSize{16U};
+		// The shuffle kernel works on runs of records that exactly fill a whole number of 16 byte blocks -
+		// 48 bytes for 2 64-bit symbols or 4 32-bit relocations with addends, 16 for most everything else
+		constexpr size_t maxBlocks{4U};
+
+		/**
+		 * A byte-swapping shuffle for a run of records, as a shuffle mask per 16 byte block. Only usable
+		 * if no field straddles a block boundary in the run - a shuffle can't pull bytes in from another block.
+		 */
+		struct ShuffleKernel final
+		{
+			std::array<std::array<uint8_t, blockSize>, maxBlocks> masks{};
+			size_t blocks{};
+			size_t period{};
+			bool usable{false};
+		};
+
+		[[nodiscard]] ShuffleKernel buildKernel(const size_t recordSize, const span<const uint8_t> &fieldSizes) noexcept
+		{
+			ShuffleKernel kernel{};
+			kernel.period = std::lcm(recordSize, blockSize);
+			kernel.blocks = kernel.period / blockSize;
+			if (kernel.blocks > maxBlocks)
+				return kernel;
+			for (size_t record{}; record < kernel.period; record += recordSize)
+			{
+				size_t fieldOffset{record};
+				for (const auto fieldSize : fieldSizes)
+				{
+					const auto block{fieldOffset / blockSize};
+					if ((fieldOffset + fieldSize - 1U) / blockSize != block)
+						return kernel;
+					// Each byte of the field comes from the mirror image position in the source
+					for (size_t byte{}; byte < fieldSize; ++byte)
+						kernel.masks[block][(fieldOffset + byte) % blockSize] =
+							static_cast<uint8_t>((fieldOffset + fieldSize - 1U - byte) % blockSize);
+					fieldOffset += fieldSize;
+				}
+			}
+			kernel.usable = true;
+			return kernel;
+		}
+
+		// The build only assumes SSE2, so the shuffle is compiled for SSSE3 separately and picked at runtime
+		__attribute__((target("ssse3"))) size_t shuffleSSSE3(const uint8_t *const source,
+			uint8_t *const destination, const size_t length, const ShuffleKernel &kernel) noexcept
+		{
+			size_t offset{};
+			for (; offset + kernel.period <= length; offset += kernel.period)
+			{
+				for (size_t block{}; block < kernel.blocks; ++block)
+				{
+					const auto blockOffset{offset + (block * blockSize)};
+					const auto mask{_mm_loadu_si128(static_cast<const __m128i *>(
+						static_cast<const void *>(kernel.masks[block].data())))};
+					const auto data{_mm_loadu_si128(static_cast<const __m128i *>(
+						static_cast<const void *>(source + blockOffset)))};
+					_mm_storeu_si128(static_cast<__m128i *>(static_cast<void *>(destination + blockOffset)),
+						_mm_shuffle_epi8(data, mask));
+				}
+			}
+			return offset;
+		}
+
+		const bool haveSSSE3{__builtin_cpu_supports("ssse3") != 0};
+#endif
+
+		void swapRecord(const uint8_t *source, uint8_t *destination, const span<const uint8_t> &fieldSizes) noexcept
+		{
+			for (const auto fieldSize : fieldSizes)
+			{
+				switch (fieldSize)
+				{
+					case 2U:
+					{
+						uint16_t value{};
+						std::memcpy(&value, source, sizeof(value));
+						value = __builtin_bswap16(value);
+						std::memcpy(destination, &value, sizeof(value));
+						break;
+					}
+					case 4U:
+					{
+						uint32_t value{};
+						std::memcpy(&value, source, sizeof(value));
+						value = __builtin_bswap32(value);
+						std::memcpy(destination, &value, sizeof(value));
+						break;
+					}
+					case 8U:
+					{
+						uint64_t value{};
+						std::memcpy(&value, source, sizeof(value));
+						value = __builtin_bswap64(value);
+						std::memcpy(destination, &value, sizeof(value));
+						break;
+					}
+					default:
+						for (size_t byte{}; byte < fieldSize; ++byte)
+							destination[byte] = source[fieldSize - 1U - byte];
+				}
+				source += fieldSize;
+				destination += fieldSize;
+			}
+		}
+	} // namespace
+
+	void decodeSwapped(const uint8_t *const source, uint8_t *const destination, const size_t count,
+		const size_t recordSize, const span<const uint8_t> fieldSizes) noexcept
+	{
+		const auto length{count * recordSize};
+		size_t offset{};
+#ifdef MANGROVE_SHUFFLE_SSSE3
+		if (haveSSSE3)
+		{
+			if (const auto kernel{buildKernel(recordSize, fieldSizes)}; kernel.usable)
+				offset = shuffleSSSE3(source, destination, length, kernel);
+		}
+#endif
+		// Whatever's left over (or everything, without a shuffle) is done a field at a time
+		for (; offset < length; offset += recordSize)
+			swapRecord(source + offset, destination + offset, fieldSizes);
+	}
+} // namespace mangrove::elf::io
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <array>
 #include <cstring>
+#include <string_view>
 #include <type_traits>
 #include <substrate/span>
 #include "enums.hxx"
@@ -124,6 +125,83 @@ namespace mangrove::elf::io
 				fromBytesBE(data);
 				value = static_cast<T>(data);
 			}
+
+			void toBytes(const void *const value) const noexcept
+				{ std::memcpy(_data.data(), value, _data.size()); }
+
+			void toBytesLE(const uint16_t value) const noexcept
+			{
+				const std::array<uint8_t, 2> data{{uint8_t(value), uint8_t(value >> 8U)}};
+				toBytes(data.data());
+			}
+
+			void toBytesLE(const uint32_t value) const noexcept
+			{
+				const std::array<uint8_t, 4> data
+				{{
+					uint8_t(value), uint8_t(value >> 8U),
+					uint8_t(value >> 16U), uint8_t(value >> 24U)
+				}};
+				toBytes(data.data());
+			}
+
+			void toBytesLE(const uint64_t value) const noexcept
+			{
+				const std::array<uint8_t, 8> data
+				{{
+					uint8_t(value), uint8_t(value >> 8U),
+					uint8_t(value >> 16U), uint8_t(value >> 24U),
+					uint8_t(value >> 32U), uint8_t(value >> 40U),
+					uint8_t(value >> 48U), uint8_t(value >> 56U)
+				}};
+				toBytes(data.data());
+			}
+
+			template<typename T> std::enable_if_t<
+				std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+				std::is_signed_v<T> && sizeof(T) >= 2
+			> toBytesLE(const T value) const noexcept
+				{ toBytesLE(static_cast<std::make_unsigned_t<T>>(value)); }
+
+			template<typename T> std::enable_if_t<std::is_enum_v<T>> toBytesLE(const T value) const noexcept
+				{ toBytesLE(static_cast<std::underlying_type_t<T>>(value)); }
+
+			void toBytesBE(const uint16_t value) const noexcept
+			{
+				const std::array<uint8_t, 2> data{{uint8_t(value >> 8U), uint8_t(value)}};
+				toBytes(data.data());
+			}
+
+			void toBytesBE(const uint32_t value) const noexcept
+			{
+				const std::array<uint8_t, 4> data
+				{{
+					uint8_t(value >> 24U), uint8_t(value >> 16U),
+					uint8_t(value >> 8U), uint8_t(value)
+				}};
+				toBytes(data.data());
+			}
+
+			void toBytesBE(const uint64_t value) const noexcept
+			{
+				const std::array<uint8_t, 8> data
+				{{
+					uint8_t(value >> 56U), uint8_t(value >> 48U),
+					uint8_t(value >> 40U), uint8_t(value >> 32U),
+					uint8_t(value >> 24U), uint8_t(value >> 16U),
+					uint8_t(value >> 8U), uint8_t(value)
+				}};
+				toBytes(data.data());
+			}
+
+			template<typename T> std::enable_if_t<
+				std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+				std::is_signed_v<T> && sizeof(T) >= 2
+			> toBytesBE(const T value) const noexcept
+				{ toBytesBE(static_cast<std::make_unsigned_t<T>>(value)); }
+
+			template<typename T> std::enable_if_t<std::is_enum_v<T>> toBytesBE(const T value) const noexcept
+				{ toBytesBE(static_cast<std::underlying_type_t<T>>(value)); }
 		};
 
 		/**
@@ -170,6 +248,33 @@ namespace mangrove::elf::io
 			}
 		};
 
+		/**
+		 * ELF writing orchestration type - the mirror of Reader, this creates a
+		 * suitably sized subspan of the output span and provides functions to
+		 * store typed data into it, doing endian dispatch as required.
+		 */
+		template<typename T> struct Writer
+		{
+		private:
+			Container _data;
+
+		public:
+			Writer(const span<uint8_t> &data) noexcept : _data{data.subspan(0, sizeof(T))} { }
+
+			void write(const T &value) const noexcept { _data.toBytes(&value); }
+
+			void write(const T &value, const Endian endian) const noexcept
+			{
+				if (endian == Endian::little)
+					writeLE(value);
+				else
+					writeBE(value);
+			}
+
+			void writeLE(const T &value) const noexcept { _data.toBytesLE(value); }
+			void writeBE(const T &value) const noexcept { _data.toBytesBE(value); }
+		};
+
 		/** This works similarly to the base reader type, but on std::array<>'s */
 		template<typename T, size_t N> struct Reader<std::array<T, N>>
 		{
@@ -209,8 +314,76 @@ namespace mangrove::elf::io
 
 		template<typename T> [[nodiscard]] auto read(const size_t offset, const Endian endian) const noexcept
 			{ return Reader<T>{_data.subspan(offset)}.read(endian); }
+
+		template<typename T> void write(const size_t offset, const T &value) const noexcept
+			{ Writer<T>{_data.subspan(offset)}.write(value); }
+
+		template<typename T> void write(const size_t offset, const T &value, const Endian endian) const noexcept
+			{ Writer<T>{_data.subspan(offset)}.write(value, endian); }
 	};
 
+	/** Checks that count entries of size bytes starting at offset all lie within a block of length bytes */
+	[[nodiscard]] constexpr inline bool inBounds(const uint64_t offset, const uint64_t entries, const uint64_t size,
+		const uint64_t length) noexcept
+		{ return offset <= length && entries <= (length - offset) / size; }
+
+	/**
+	 * Hashes a string with FNV-1a, which is cheap for the short strings that make up symbol and section
+	 * names. Module interfaces store these hashes, so this must give the same result in every process
+	 */
+	[[nodiscard]] constexpr inline uint32_t hashString(const std::string_view string) noexcept
+	{
+		uint32_t hash{0x811c9dc5U};
+		for (const auto value : string)
+		{
+			hash ^= static_cast<uint8_t>(value);
+			hash *= 0x01000193U;
+		}
+		return hash;
+	}
+
+	/** The byte order of the machine we're running on */
+	constexpr inline Endian hostEndian{__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? Endian::big : Endian::little};
+
+	/**
+	 * Decodes count records of recordSize bytes from source into destination, byte-swapping each of
+	 * the fields described by fieldSizes, which are given in order and must add up to recordSize.
+	 * This is the half of readRecords() for data written in the opposite endian to the host.
+	 */
+	void decodeSwapped(const uint8_t *source, uint8_t *destination, size_t count, size_t recordSize,
+		span<const uint8_t> fieldSizes) noexcept;
+
+	/**
+	 * Decodes a table of fixed-layout records, such as a symbol or relocation table, into native structs in
+	 * one pass. Record must mirror the on-disk layout exactly and describe it with a fieldSizes array, and
+	 * data must hold at least count of them. When the data is in the host's endian this is a single memcpy(),
+	 * otherwise the fields are byte-swapped as they're copied, 16 bytes at a time where the CPU can shuffle.
+	 */
+	template<typename Record> void readRecords(const span<uint8_t> &data, Record *const records,
+		const size_t count, const Endian endian) noexcept
+	{
+		static_assert(std::is_trivially_copyable_v<Record>, "Records must be decodable with memcpy()");
+		auto *const destination{static_cast<uint8_t *>(static_cast<void *>(records))};
+		if (endian == hostEndian)
+			std::memcpy(destination, data.data(), count * sizeof(Record));
+		else
+			decodeSwapped(data.data(), destination, count, sizeof(Record),
+				{Record::fieldSizes.data(), Record::fieldSizes.size()});
+	}
+
+	/** Decodes an array of count integers from data, in the given endian, into values */
+	template<typename T> void readArray(const span<uint8_t> &data, T *const values, const size_t count,
+		const Endian endian) noexcept
+	{
+		static_assert(std::is_integral_v<T>, "readArray() decodes arrays of integers, use readRecords() for structs");
+		constexpr std::array<uint8_t, 1> fieldSizes{{sizeof(T)}};
+		auto *const destination{static_cast<uint8_t *>(static_cast<void *>(values))};
+		if (endian == hostEndian || sizeof(T) == 1U)
+			std::memcpy(destination, data.data(), count * sizeof(T));
+		else
+			decodeSwapped(data.data(), destination, count, sizeof(T), {fieldSizes.data(), fieldSizes.size()});
+	}
+
 	/** Helper type for std::visit(), allowing match block semantics for interaction with std::variant<>s */
 	template<typename... Ts> struct Match : Ts... { using Ts::operator()...; };
 	template<typename... Ts> Match(Ts...) -> Match<Ts...>;
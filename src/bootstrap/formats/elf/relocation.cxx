@@ -0,0 +1,398 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "relocation.hxx"
+#include "../../core/trace.hxx"
+
+using namespace std::literals::string_view_literals;
+using mangrove::core::trace::ScopedTimer;
+
+namespace mangrove::elf::relocation
+{
+	namespace
+	{
+		// Both targets' relocation types of interest are all well below this, anything above is unsupported
+		constexpr size_t typeTableSize{64U};
+		using TypeTable = std::array<Operation, typeTableSize>;
+
+		constexpr TypeTable x86_64Operations{[]() noexcept
+		{
+			TypeTable operations{};
+			for (auto &operation : operations)
+				operation = Operation::unsupported;
+			operations[0U] = Operation::none; // R_X86_64_NONE
+			operations[1U] = Operation::absolute64; // R_X86_64_64
+			operations[2U] = Operation::relative32Signed; // R_X86_64_PC32
+			// With no PLT in a static link, calls through the PLT go straight to the function
+			operations[4U] = Operation::relative32Signed; // R_X86_64_PLT32
+			operations[10U] = Operation::absolute32Unsigned; // R_X86_64_32
+			operations[11U] = Operation::absolute32Signed; // R_X86_64_32S
+			operations[24U] = Operation::relative64; // R_X86_64_PC64
+			return operations;
+		}()};
+
+		constexpr TypeTable armOperations{[]() noexcept
+		{
+			TypeTable operations{};
+			for (auto &operation : operations)
+				operation = Operation::unsupported;
+			operations[0U] = Operation::none; // R_ARM_NONE
+			operations[1U] = Operation::armBranch24; // R_ARM_PC24
+			operations[2U] = Operation::absolute32; // R_ARM_ABS32
+			operations[3U] = Operation::relative32; // R_ARM_REL32
+			operations[10U] = Operation::thumbCall; // R_ARM_THM_CALL
+			operations[28U] = Operation::armCall; // R_ARM_CALL
+			operations[29U] = Operation::armBranch24; // R_ARM_JUMP24
+			operations[30U] = Operation::thumbJump24; // R_ARM_THM_JUMP24
+			// Only marks a BX for linkers rewriting them for ARMv4, which we don't
+			operations[40U] = Operation::none; // R_ARM_V4BX
+			operations[47U] = Operation::thumbMovw; // R_ARM_THM_MOVW_ABS_NC
+			operations[48U] = Operation::thumbMovt; // R_ARM_THM_MOVT_ABS
+			return operations;
+		}()};
+
+		// How many bytes each operation's field takes, indexed by Operation
+		constexpr std::array<uint64_t, operationCount + 1U> fieldWidths{{0U, 4U, 4U, 4U, 8U, 4U, 4U, 8U, 4U, 4U, 4U, 4U, 4U, 4U, 0U}};
+		constexpr auto noFailure{std::numeric_limits<size_t>::max()};
+
+		[[nodiscard]] const TypeTable *operationsFor(const Machine machine) noexcept
+		{
+			switch (machine)
+			{
+				case Machine::x86_64:
+					return &x86_64Operations;
+				case Machine::arm:
+					return &armOperations;
+				default:
+					return nullptr;
+			}
+		}
+
+		[[nodiscard]] inline size_t operationIndex(const TypeTable &operations, const uint32_t type) noexcept
+			{ return static_cast<size_t>(type < operations.size() ? operations[type] : Operation::unsupported); }
+
+		template<typename Record, typename = void> struct hasAddend : std::false_type { };
+		template<typename Record> struct hasAddend<Record, std::void_t<decltype(Record::addend)>> :
+			std::true_type { };
+
+		[[nodiscard]] inline uint16_t byteSwap(const uint16_t value) noexcept { return __builtin_bswap16(value); }
+		[[nodiscard]] inline uint32_t byteSwap(const uint32_t value) noexcept { return __builtin_bswap32(value); }
+		[[nodiscard]] inline uint64_t byteSwap(const uint64_t value) noexcept { return __builtin_bswap64(value); }
+
+		template<typename T, bool swap> [[nodiscard]] inline T load(const uint8_t *const field) noexcept
+		{
+			T value{};
+			std::memcpy(&value, field, sizeof(T));
+			if constexpr (swap)
+				return byteSwap(value);
+			else
+				return value;
+		}
+
+		template<typename T, bool swap> inline void store(uint8_t *const field, T value) noexcept
+		{
+			if constexpr (swap)
+				value = byteSwap(value);
+			std::memcpy(field, &value, sizeof(T));
+		}
+
+		// Thumb-2 instructions are a pair of halfwords, which we keep with the first in the top 16 bits
+		template<bool swap> [[nodiscard]] inline uint32_t loadThumb(const uint8_t *const field) noexcept
+			{ return (uint32_t{load<uint16_t, swap>(field)} << 16U) | load<uint16_t, swap>(field + 2U); }
+
+		template<bool swap> inline void storeThumb(uint8_t *const field, const uint32_t instruction) noexcept
+		{
+			store<uint16_t, swap>(field, static_cast<uint16_t>(instruction >> 16U));
+			store<uint16_t, swap>(field + 2U, static_cast<uint16_t>(instruction));
+		}
+
+		// A Thumb-2 BL, BLX or B.W's offset is S:I1:I2:imm10:imm11:0, where I1 = !(J1 ^ S) and I2 = !(J2 ^ S)
+		[[nodiscard]] constexpr inline int64_t thumbBranchOffset(const uint32_t instruction) noexcept
+		{
+			const auto sign{(instruction >> 26U) & 1U};
+			const auto i1{~((instruction >> 13U) ^ sign) & 1U};
+			const auto i2{~((instruction >> 11U) ^ sign) & 1U};
+			const auto offset{(sign << 24U) | (i1 << 23U) | (i2 << 22U) | (((instruction >> 16U) & 0x3ffU) << 12U) |
+				((instruction & 0x7ffU) << 1U)};
+			return int64_t{static_cast<int32_t>(offset << 7U) >> 7U};
+		}
+
+		[[nodiscard]] constexpr inline uint32_t thumbBranch(const uint32_t instruction, const uint64_t offset) noexcept
+		{
+			const auto sign{static_cast<uint32_t>(offset >> 24U) & 1U};
+			const auto j1{(~static_cast<uint32_t>(offset >> 23U) ^ sign) & 1U};
+			const auto j2{(~static_cast<uint32_t>(offset >> 22U) ^ sign) & 1U};
+			return (instruction & 0xf800d000U) | (sign << 26U) | ((static_cast<uint32_t>(offset >> 12U) & 0x3ffU) << 16U) |
+				(j1 << 13U) | (j2 << 11U) | (static_cast<uint32_t>(offset >> 1U) & 0x7ffU);
+		}
+
+		// MOVW and MOVT split their 16-bit immediate up as imm4:i:imm3:imm8
+		[[nodiscard]] constexpr inline uint32_t thumbMovImmediate(const uint32_t instruction) noexcept
+		{
+			return ((instruction >> 4U) & 0xf000U) | ((instruction >> 15U) & 0x0800U) | ((instruction >> 4U) & 0x0700U) |
+				(instruction & 0x00ffU);
+		}
+
+		[[nodiscard]] constexpr inline uint32_t thumbMov(const uint32_t instruction, const uint64_t value) noexcept
+		{
+			const auto immediate{static_cast<uint32_t>(value) & 0xffffU};
+			return (instruction & ~0x040f70ffU) | ((immediate & 0xf000U) << 4U) | ((immediate & 0x0800U) << 15U) |
+				((immediate & 0x0700U) << 4U) | (immediate & 0x00ffU);
+		}
+
+		/**
+		 * Applies one batch of relocations that all share an operation, returning the position of the first
+		 * entry that overflowed, if any. Everything that varies between operations, endians and implicit or
+		 * explicit addends is resolved at compile time, and the overflow tracking is a conditional select,
+		 * so the loop body has no branches of its own.
+		 */
+		template<Operation operation, bool swap, bool implicitAddend> size_t applyBatch(uint8_t *const data,
+			const uint64_t address, const std::vector<Relocator::Pending> &batch) noexcept
+		{
+			constexpr auto wide{operation == Operation::absolute64 || operation == Operation::relative64};
+			constexpr auto thumb{operation == Operation::thumbCall || operation == Operation::thumbJump24 ||
+				operation == Operation::thumbMovw || operation == Operation::thumbMovt};
+			constexpr auto relative{operation == Operation::relative32 || operation == Operation::relative32Signed ||
+				operation == Operation::relative64 || operation == Operation::armBranch24 ||
+				operation == Operation::armCall || operation == Operation::thumbCall || operation == Operation::thumbJump24};
+			using Field = std::conditional_t<wide, uint64_t, uint32_t>;
+
+			size_t failed{noFailure};
+			for (size_t position{}; position < batch.size(); ++position)
+			{
+				const auto &entry{batch[position]};
+				auto *const field{data + entry.offset};
+				const auto original{[&]() noexcept
+				{
+					if constexpr (thumb)
+						return loadThumb<swap>(field);
+					else
+						return load<Field, swap>(field);
+				}()};
+				uint64_t value{entry.value};
+				if constexpr (implicitAddend)
+				{
+					if constexpr (operation == Operation::armBranch24)
+						// The word offset in the low 24 bits, sign extended and turned back into bytes
+						value += static_cast<uint64_t>(int64_t{static_cast<int32_t>(original << 8U) >> 6U});
+					else if constexpr (operation == Operation::armCall)
+						// As for B, but a BLX (condition 0xf) also has a halfword offset in its H bit
+						value += static_cast<uint64_t>(int64_t{static_cast<int32_t>(original << 8U) >> 6U}) +
+							((original >> 28U) == 0xfU ? (original >> 23U) & 2U : 0U);
+					else if constexpr (operation == Operation::thumbCall || operation == Operation::thumbJump24)
+						value += static_cast<uint64_t>(thumbBranchOffset(original));
+					else if constexpr (operation == Operation::thumbMovw || operation == Operation::thumbMovt)
+						value += static_cast<uint64_t>(int64_t{static_cast<int16_t>(thumbMovImmediate(original))});
+					else if constexpr (wide)
+						value += original;
+					else
+						value += static_cast<uint64_t>(int64_t{static_cast<int32_t>(original)});
+				}
+				if constexpr (relative)
+					value -= address + entry.offset;
+
+				bool overflows{false};
+				if constexpr (operation == Operation::absolute32Unsigned)
+					overflows = (value >> 32U) != 0U;
+				else if constexpr (operation == Operation::absolute32Signed || operation == Operation::relative32Signed)
+					overflows = ((value + 0x80000000U) >> 32U) != 0U;
+				// Any ARM to ARM or Thumb to Thumb branch is even, so bit 0 being set means a change of instruction set
+				else if constexpr (operation == Operation::armBranch24)
+					overflows = (((value + 0x02000000U) >> 26U) != 0U) || (value & 1U);
+				else if constexpr (operation == Operation::armCall)
+					overflows = ((value + 0x02000000U) >> 26U) != 0U;
+				else if constexpr (operation == Operation::thumbCall)
+					overflows = ((value + 0x01000000U) >> 25U) != 0U;
+				else if constexpr (operation == Operation::thumbJump24)
+					overflows = (((value + 0x01000000U) >> 25U) != 0U) || !(value & 1U);
+
+				if constexpr (operation == Operation::armBranch24)
+					store<Field, swap>(field, (original & 0xff000000U) | static_cast<uint32_t>((value >> 2U) & 0x00ffffffU));
+				else if constexpr (operation == Operation::armCall)
+				{
+					// A call into Thumb code becomes a BLX, with the H bit for a target that's not word aligned,
+					// while one into ARM code becomes (or stays) a BL
+					const auto opcode{(value & 1U) ? 0xfa000000U | static_cast<uint32_t>((value & 2U) << 23U) :
+						(original >> 28U) == 0xfU ? 0xeb000000U : original & 0xff000000U};
+					store<Field, swap>(field, opcode | static_cast<uint32_t>((value >> 2U) & 0x00ffffffU));
+				}
+				else if constexpr (operation == Operation::thumbCall)
+				{
+					// Bit 12 of the second halfword picks BL (staying in Thumb) or BLX, which branches from P
+					// rounded down to a word
+					const auto toThumb{static_cast<uint32_t>(value & 1U)};
+					const auto offset{toThumb ? value - 1U : value + ((address + entry.offset) & 2U)};
+					storeThumb<swap>(field, (thumbBranch(original, offset) & ~0x1000U) | (toThumb << 12U));
+				}
+				else if constexpr (operation == Operation::thumbJump24)
+					storeThumb<swap>(field, thumbBranch(original, value & ~uint64_t{1U}));
+				else if constexpr (operation == Operation::thumbMovw)
+					storeThumb<swap>(field, thumbMov(original, value));
+				else if constexpr (operation == Operation::thumbMovt)
+					storeThumb<swap>(field, thumbMov(original, value >> 16U));
+				else
+					store<Field, swap>(field, static_cast<Field>(value));
+				failed = std::min(failed, overflows ? position : noFailure);
+			}
+			return failed;
+		}
+
+		template<Operation operation> size_t applyBatch(uint8_t *const data, const uint64_t address,
+			const std::vector<Relocator::Pending> &batch, const bool swap, const bool implicitAddends) noexcept
+		{
+			if (swap)
+				return implicitAddends ? applyBatch<operation, true, true>(data, address, batch) :
+					applyBatch<operation, true, false>(data, address, batch);
+			return implicitAddends ? applyBatch<operation, false, true>(data, address, batch) :
+				applyBatch<operation, false, false>(data, address, batch);
+		}
+
+		template<typename Record> [[nodiscard]] span<const Record> decodeTable(const ELF &elf,
+			const size_t sectionIndex, std::vector<Record> &records)
+		{
+			static_cast<void>(elf.readTable(sectionIndex, records));
+			return {records.data(), records.size()};
+		}
+	} // namespace
+
+	Operation operationFor(const Machine machine, const uint32_t type) noexcept
+	{
+		const auto *const operations{operationsFor(machine)};
+		if (!operations || type >= operations->size())
+			return Operation::unsupported;
+		return (*operations)[type];
+	}
+
+	bool Relocator::supported() const noexcept { return operationsFor(_machine) != nullptr; }
+
+	// Validates a table and sorts it into the buckets, only touching section once all of it is known good
+	template<typename Record> RelocationResult Relocator::applyTable(const span<uint8_t> section,
+		const uint64_t address, const span<const Record> relocations, const span<const uint64_t> symbolValues)
+	{
+		const ScopedTimer timer{"Relocator::apply"sv};
+		const auto *const operations{operationsFor(_machine)};
+		if (!operations)
+			return {0U, RelocationError::unsupportedMachine, 0U};
+		for (auto &bucket : _buckets)
+			bucket.clear();
+
+		const auto length{section.size()};
+		for (size_t index{}; index < relocations.size(); ++index)
+		{
+			const auto &relocation{relocations[index]};
+			const auto kind{operationIndex(*operations, relocation.type())};
+			const auto symbol{relocation.symbol()};
+			const uint64_t offset{relocation.offset};
+			// Everything that can be wrong with an entry is checked with the one (never taken) branch
+			if ((kind == operationCount) | (symbol >= symbolValues.size()) | (offset > length) |
+				(fieldWidths[kind] > length - offset))
+			{
+				if (kind == operationCount)
+					return {0U, RelocationError::unsupportedType, index};
+				if (symbol >= symbolValues.size())
+					return {0U, RelocationError::badSymbol, index};
+				return {0U, RelocationError::outOfBounds, index};
+			}
+			uint64_t value{symbolValues[symbol]};
+			if constexpr (hasAddend<Record>::value)
+				value += static_cast<uint64_t>(int64_t{relocation.addend});
+			_buckets[kind].push_back({offset, value});
+		}
+
+		const auto failures{applyBuckets(section, address, !hasAddend<Record>::value)};
+		if (std::all_of(failures.begin(), failures.end(), [](const size_t failure) { return failure == noFailure; }))
+			return {relocations.size(), RelocationError::none, 0U};
+		// Batches keep their entries in table order, so a position in one maps back to the table by counting
+		std::array<size_t, operationCount> positions{};
+		for (size_t index{}; index < relocations.size(); ++index)
+		{
+			const auto kind{operationIndex(*operations, relocations[index].type())};
+			if (positions[kind]++ == failures[kind])
+				return {relocations.size(), RelocationError::overflow, index};
+		}
+		return {relocations.size(), RelocationError::overflow, 0U};
+	}
+
+	Relocator::BatchFailures Relocator::applyBuckets(const span<uint8_t> section, const uint64_t address,
+		const bool implicitAddends) noexcept
+	{
+		auto *const data{section.data()};
+		const auto swap{_endian != io::hostEndian};
+		BatchFailures failures{};
+		for (size_t kind{}; kind < operationCount; ++kind)
+		{
+			const auto &batch{_buckets[kind]};
+			failures[kind] = [&]() noexcept
+			{
+				switch (static_cast<Operation>(kind))
+				{
+					case Operation::absolute32:
+						return applyBatch<Operation::absolute32>(data, address, batch, swap, implicitAddends);
+					case Operation::absolute32Unsigned:
+						return applyBatch<Operation::absolute32Unsigned>(data, address, batch, swap, implicitAddends);
+					case Operation::absolute32Signed:
+						return applyBatch<Operation::absolute32Signed>(data, address, batch, swap, implicitAddends);
+					case Operation::absolute64:
+						return applyBatch<Operation::absolute64>(data, address, batch, swap, implicitAddends);
+					case Operation::relative32:
+						return applyBatch<Operation::relative32>(data, address, batch, swap, implicitAddends);
+					case Operation::relative32Signed:
+						return applyBatch<Operation::relative32Signed>(data, address, batch, swap, implicitAddends);
+					case Operation::relative64:
+						return applyBatch<Operation::relative64>(data, address, batch, swap, implicitAddends);
+					case Operation::armBranch24:
+						return applyBatch<Operation::armBranch24>(data, address, batch, swap, implicitAddends);
+					case Operation::armCall:
+						return applyBatch<Operation::armCall>(data, address, batch, swap, implicitAddends);
+					case Operation::thumbCall:
+						return applyBatch<Operation::thumbCall>(data, address, batch, swap, implicitAddends);
+					case Operation::thumbJump24:
+						return applyBatch<Operation::thumbJump24>(data, address, batch, swap, implicitAddends);
+					case Operation::thumbMovw:
+						return applyBatch<Operation::thumbMovw>(data, address, batch, swap, implicitAddends);
+					case Operation::thumbMovt:
+						return applyBatch<Operation::thumbMovt>(data, address, batch, swap, implicitAddends);
+					default:
+						// Operation::none, which has nothing to apply
+						return noFailure;
+				}
+			}();
+		}
+		return failures;
+	}
+
+	RelocationResult Relocator::apply(const span<uint8_t> section, const uint64_t address,
+		const span<const elf32::RelRecord> relocations, const span<const uint64_t> symbolValues)
+		{ return applyTable(section, address, relocations, symbolValues); }
+
+	RelocationResult Relocator::apply(const span<uint8_t> section, const uint64_t address,
+		const span<const elf32::RelaRecord> relocations, const span<const uint64_t> symbolValues)
+		{ return applyTable(section, address, relocations, symbolValues); }
+
+	RelocationResult Relocator::apply(const span<uint8_t> section, const uint64_t address,
+		const span<const elf64::RelRecord> relocations, const span<const uint64_t> symbolValues)
+		{ return applyTable(section, address, relocations, symbolValues); }
+
+	RelocationResult Relocator::apply(const span<uint8_t> section, const uint64_t address,
+		const span<const elf64::RelaRecord> relocations, const span<const uint64_t> symbolValues)
+		{ return applyTable(section, address, relocations, symbolValues); }
+
+	RelocationResult Relocator::applySection(const ELF &elf, const size_t relocationSection,
+		const span<uint8_t> section, const uint64_t address, const span<const uint64_t> symbolValues)
+	{
+		const auto &headers{elf.sectionHeaders()};
+		const auto withAddend{relocationSection < headers.size() &&
+			headers[relocationSection].type() == SectionHeaderType::relocAddend};
+		if (elf.header().elfClass() == Class::elf32Bit)
+		{
+			if (withAddend)
+				return apply(section, address, decodeTable(elf, relocationSection, _rela32), symbolValues);
+			return apply(section, address, decodeTable(elf, relocationSection, _rel32), symbolValues);
+		}
+		if (withAddend)
+			return apply(section, address, decodeTable(elf, relocationSection, _rela64), symbolValues);
+		return apply(section, address, decodeTable(elf, relocationSection, _rel64), symbolValues);
+	}
+} // namespace mangrove::elf::relocation
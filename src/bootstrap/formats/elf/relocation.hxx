@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef FORMATS_ELF_RELOCATION_HXX
+#define FORMATS_ELF_RELOCATION_HXX
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <substrate/span>
+#include "elf.hxx"
+
+/**
+ * @file relocation.hxx
+ * @brief Batched application of ELF relocations to section contents
+ */
+
+namespace mangrove::elf::relocation
+{
+	inline namespace internal
+	{
+		using substrate::span;
+		using mangrove::elf::enums::Endian;
+		using mangrove::elf::enums::Machine;
+	} // namespace internal
+
+	/**
+	 * What a relocation computes and how it stores the result, independent of the target it comes
+	 * from. S is the symbol's value, A the addend and P the address of the field being relocated.
+	 */
+	enum class Operation : uint8_t
+	{
+		// Does nothing, such as R_X86_64_NONE
+		none,
+		// S + A, truncated to 32 bits
+		absolute32,
+		// S + A, which must zero-extend from 32 bits
+		absolute32Unsigned,
+		// S + A, which must sign-extend from 32 bits
+		absolute32Signed,
+		// S + A
+		absolute64,
+		// S + A - P, truncated to 32 bits
+		relative32,
+		// S + A - P, which must sign-extend from 32 bits
+		relative32Signed,
+		// S + A - P
+		relative64,
+		// (S + A - P) >> 2 in the low 24 bits of an ARM B or BL, which must lie within +/-32MiB and not
+		// change instruction set
+		armBranch24,
+		// ((S + A) | T) - P as an ARM BL, or a BLX when the target is Thumb code, within +/-32MiB
+		armCall,
+		// ((S + A) | T) - P as a Thumb-2 BL, or a BLX when the target is ARM code, within +/-16MiB
+		thumbCall,
+		// ((S + A) | T) - P as a Thumb-2 B.W, which must lie within +/-16MiB and stay in Thumb code
+		thumbJump24,
+		// (S + A) | T, truncated to 16 bits, in the immediate of a Thumb-2 MOVW
+		thumbMovw,
+		// (S + A) >> 16 in the immediate of a Thumb-2 MOVT
+		thumbMovt,
+		// A relocation type that the target doesn't have, or we can't apply
+		unsupported,
+	};
+
+	constexpr inline size_t operationCount{static_cast<size_t>(Operation::unsupported)};
+
+	/** Maps a target's relocation type (the low bits of r_info) to the operation that applies it */
+	[[nodiscard]] Operation operationFor(Machine machine, uint32_t type) noexcept;
+
+	enum class RelocationError : uint8_t
+	{
+		none,
+		unsupportedMachine,
+		unsupportedType,
+		badSymbol,
+		outOfBounds,
+		overflow,
+	};
+
+	struct RelocationResult final
+	{
+		size_t applied{};
+		RelocationError error{RelocationError::none};
+		// The index in the relocation table of the entry that failed
+		size_t index{};
+
+		[[nodiscard]] bool success() const noexcept { return error == RelocationError::none; }
+	};
+
+	/**
+	 * Applies relocation tables for one target - x86-64 or 32-bit ARM - to section contents in batches.
+	 * Each table is first validated and sorted by operation in a single pass, with nothing written if any
+	 * entry has an unknown type, a symbol outside of the symbol values given, or a field outside of the
+	 * section. Each operation's batch is then applied by its own loop, free of any per-entry dispatch.
+	 *
+	 * Fields that overflow are still written (truncated), with the lowest such entry reported as an error.
+	 * SHT_REL tables take their addends from the fields being relocated, as the ELF ABIs specify.
+	 * For ARM, T is bit 0 of the symbol value, set for Thumb functions. Calls switch between BL and BLX to
+	 * suit the target, but plain branches have no such form and we make no veneers, so a B or B.W to
+	 * code of the other instruction set is reported as an overflow.
+	 * The buckets are kept between calls, so one Relocator should be reused across a link.
+	 */
+	struct Relocator final
+	{
+	public:
+		/** A relocation that has been validated, with S + A already worked out where A is explicit */
+		struct Pending final
+		{
+			uint64_t offset;
+			uint64_t value;
+		};
+		// For each operation, the position in its batch of the first entry that overflowed
+		using BatchFailures = std::array<size_t, operationCount>;
+
+	private:
+		Machine _machine;
+		Endian _endian;
+		std::array<std::vector<Pending>, operationCount> _buckets{};
+		// Storage for tables decoded by applySection()
+		std::vector<elf32::RelRecord> _rel32{};
+		std::vector<elf32::RelaRecord> _rela32{};
+		std::vector<elf64::RelRecord> _rel64{};
+		std::vector<elf64::RelaRecord> _rela64{};
+
+		template<typename Record> RelocationResult applyTable(span<uint8_t> section, uint64_t address,
+			span<const Record> relocations, span<const uint64_t> symbolValues);
+		[[nodiscard]] BatchFailures applyBuckets(span<uint8_t> section, uint64_t address, bool implicitAddends) noexcept;
+
+	public:
+		Relocator(Machine machine, Endian endian) noexcept : _machine{machine}, _endian{endian} { }
+
+		/** Whether relocations for the machine this Relocator was made for can be applied */
+		[[nodiscard]] bool supported() const noexcept;
+
+		/**
+		 * Applies relocations to section, which is loaded at address. symbolValues gives the resolved
+		 * value of each symbol in the symbol table the relocations refer to, by index.
+		 */
+		RelocationResult apply(span<uint8_t> section, uint64_t address, span<const elf32::RelRecord> relocations,
+			span<const uint64_t> symbolValues);
+		RelocationResult apply(span<uint8_t> section, uint64_t address, span<const elf32::RelaRecord> relocations,
+			span<const uint64_t> symbolValues);
+		RelocationResult apply(span<uint8_t> section, uint64_t address, span<const elf64::RelRecord> relocations,
+			span<const uint64_t> symbolValues);
+		RelocationResult apply(span<uint8_t> section, uint64_t address, span<const elf64::RelaRecord> relocations,
+			span<const uint64_t> symbolValues);
+
+		/**
+		 * Decodes the SHT_REL or SHT_RELA section relocationSection of elf and applies it to section,
+		 * which would usually be a copy of the contents of the section it links to via sh_info
+		 */
+		RelocationResult applySection(const ELF &elf, size_t relocationSection, span<uint8_t> section,
+			uint64_t address, span<const uint64_t> symbolValues);
+	};
+} // namespace mangrove::elf::relocation
+
+#endif /*FORMATS_ELF_RELOCATION_HXX*/
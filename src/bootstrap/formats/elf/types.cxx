@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <cstring>
 #include "types.hxx"
 
 using namespace mangrove::elf::types;
 using mangrove::elf::io::Match;
+using mangrove::elf::io::hashString;
 
 // NOLINTBEGIN(bugprone-exception-escape)
 
@@ -41,6 +44,17 @@ uint16_t ELFHeader::sectionHeaderCount() const noexcept
 uint16_t ELFHeader::sectionNamesIndex() const noexcept
 	{ return std::visit([](const auto &header) { return header.sectionNamesIndex(); }, _header); }
 
+// Setters narrow their values to the field width of the header's class
+void ELFHeader::shdrOffset(const uint64_t offset) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.shdrOffset(static_cast<decltype(header.shdrOffset())>(offset)); }, _header);
+}
+void ELFHeader::sectionHeaderCount(const uint16_t count) const noexcept
+	{ std::visit([&](const auto &header) { header.sectionHeaderCount(count); }, _header); }
+void ELFHeader::sectionNamesIndex(const uint16_t index) const noexcept
+	{ std::visit([&](const auto &header) { header.sectionNamesIndex(index); }, _header); }
+
 ProgramHeaderType ProgramHeader::type() const noexcept
 	{ return std::visit([](const auto &header) { return header.type(); }, _header); }
 uint32_t ProgramHeader::flags() const noexcept
@@ -79,6 +93,42 @@ uint64_t SectionHeader::alignment() const noexcept
 uint64_t SectionHeader::entityLength() const noexcept
 	{ return std::visit([](const auto &header) -> uint64_t { return header.entityLength(); }, _header); }
 
+void SectionHeader::nameOffset(const uint32_t offset) const noexcept
+	{ std::visit([&](const auto &header) { header.nameOffset(offset); }, _header); }
+void SectionHeader::type(const SectionHeaderType type) const noexcept
+	{ std::visit([&](const auto &header) { header.type(type); }, _header); }
+void SectionHeader::flags(const Flags<SectionFlag> flags) const noexcept
+	{ std::visit([&](const auto &header) { header.flags(flags); }, _header); }
+void SectionHeader::address(const uint64_t address) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.address(static_cast<decltype(header.address())>(address)); }, _header);
+}
+void SectionHeader::fileOffset(const uint64_t offset) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.fileOffset(static_cast<decltype(header.fileOffset())>(offset)); }, _header);
+}
+void SectionHeader::fileLength(const uint64_t length) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.fileLength(static_cast<decltype(header.fileLength())>(length)); }, _header);
+}
+void SectionHeader::link(const uint32_t link) const noexcept
+	{ std::visit([&](const auto &header) { header.link(link); }, _header); }
+void SectionHeader::info(const uint32_t info) const noexcept
+	{ std::visit([&](const auto &header) { header.info(info); }, _header); }
+void SectionHeader::alignment(const uint64_t alignment) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.alignment(static_cast<decltype(header.alignment())>(alignment)); }, _header);
+}
+void SectionHeader::entityLength(const uint64_t length) const noexcept
+{
+	std::visit([&](const auto &header)
+		{ header.entityLength(static_cast<decltype(header.entityLength())>(length)); }, _header);
+}
+
 uint32_t ELFSymbol::nameOffset() const noexcept
 	{ return std::visit([](const auto &header) { return header.nameOffset(); }, _header); }
 uint64_t ELFSymbol::value() const noexcept
@@ -92,23 +142,122 @@ uint8_t ELFSymbol::other() const noexcept
 uint16_t ELFSymbol::sectionIndex() const noexcept
 	{ return std::visit([](const auto &header) { return header.sectionIndex(); }, _header); }
 
-std::string_view StringTable::stringFromOffset(const size_t offset) const noexcept
+uint64_t ELFRelocation::offset() const noexcept
+	{ return std::visit([](const auto &header) -> uint64_t { return header.offset(); }, _header); }
+uint32_t ELFRelocation::symbol() const noexcept
+	{ return std::visit([](const auto &header) { return header.symbol(); }, _header); }
+uint32_t ELFRelocation::type() const noexcept
+	{ return std::visit([](const auto &header) { return header.type(); }, _header); }
+int64_t ELFRelocation::addend() const noexcept
+	{ return std::visit([](const auto &header) -> int64_t { return header.addend(); }, _header); }
+bool ELFRelocation::withAddend() const noexcept
+	{ return std::visit([](const auto &header) { return header.withAddend(); }, _header); }
+
+void StringTable::buildIndex()
 {
-	// Start by getting a subspan at the correct offset
-	const auto data{_storage.dataSpan().subspan(offset)};
-	// Now, we need to figure out how long the string is.. we could use strlen(),
-	// but that would introduce a risk of memory unsafety here, so we instead iterate
-	// till we find '\0' or fall off the end of the span, which should mean we
-	// can't accidentally do a memory safety bad here.
-	size_t length{};
-	for (const auto &value : data)
+	const auto *const begin{_storage.data()};
+	const auto *const end{begin + _storage.length()};
+	_terminators.clear();
+	// memchr() skips through each string many bytes at a time to find where it ends
+	for (const auto *string{begin}; string < end; )
 	{
-		++length;
-		if (value == 0x00U)
+		const auto *const terminator
+			{static_cast<const uint8_t *>(std::memchr(string, 0, static_cast<size_t>(end - string)))};
+		if (!terminator)
 			break;
+		_terminators.push_back(static_cast<uint32_t>(terminator - begin));
+		string = terminator + 1U;
+	}
+	_terminators.push_back(static_cast<uint32_t>(end - begin));
+}
+
+std::string_view StringTable::stringFromOffset(const size_t offset) const noexcept
+{
+	// Offsets come straight out of the file, so may well point outside the table
+	if (offset >= _storage.length())
+		return {};
+	const auto *const string{_storage.data() + offset};
+	if (!_terminators.empty())
+	{
+		// The table's length is always last, so an offset inside the table always finds an end
+		const auto end{*std::lower_bound(_terminators.begin(), _terminators.end(), offset)};
+		return {reinterpret_cast<const char *>(string), end - offset};
+	}
+	// memchr() is bounded by the end of the table, so a final unterminated string can't take us off
+	// the end of it, and will search many bytes at a time rather than one by one
+	const auto remaining{_storage.length() - offset};
+	const auto *const terminator{static_cast<const uint8_t *>(std::memchr(string, 0, remaining))};
+	return {reinterpret_cast<const char *>(string),
+		terminator ? static_cast<size_t>(terminator - string) : remaining};
+}
+
+bool StringTable::matches(const size_t offset, const std::string_view string) const noexcept
+{
+	const auto length{_storage.length()};
+	if (offset >= length || string.size() > length - offset)
+		return false;
+	// Compare first, so a mismatch costs only as much as the common prefix, then check the string ends here
+	const auto end{offset + string.size()};
+	return std::memcmp(_storage.data() + offset, string.data(), string.size()) == 0 &&
+		(end == length || _storage.data()[end] == 0U);
+}
+
+StringTableBuilder::StringTableBuilder() : _slots(64U) { }
+
+std::optional<uint32_t> StringTableBuilder::find(const std::string_view string, const uint32_t hash,
+	size_t &slot) const noexcept
+{
+	const auto mask{_slots.size() - 1U};
+	// The table is never more than half full, so there's always a free slot to end the probe
+	for (slot = hash & mask; ; slot = (slot + 1U) & mask)
+	{
+		const auto entry{_slots[slot]};
+		if (!entry)
+			return std::nullopt;
+		const auto offset{static_cast<uint32_t>(entry)};
+		// Offsets in the hash always have a string and its terminator after them in the table
+		if (static_cast<uint32_t>(entry >> 32U) == hash && string.size() < _data.size() - offset &&
+			std::memcmp(_data.data() + offset, string.data(), string.size()) == 0 &&
+			_data[offset + string.size()] == 0U)
+			return offset;
+	}
+}
+
+void StringTableBuilder::grow()
+{
+	std::vector<uint64_t> slots(_slots.size() * 2U);
+	std::swap(_slots, slots);
+	const auto mask{_slots.size() - 1U};
+	for (const auto entry : slots)
+	{
+		if (!entry)
+			continue;
+		auto slot{static_cast<size_t>(entry >> 32U) & mask};
+		while (_slots[slot])
+			slot = (slot + 1U) & mask;
+		_slots[slot] = entry;
+	}
+}
+
+uint32_t StringTableBuilder::add(const std::string_view string)
+{
+	if (string.empty())
+		return 0U;
+	const auto hash{hashString(string)};
+	size_t slot{};
+	if (const auto offset{find(string, hash, slot)}; offset)
+		return *offset;
+	if ((_stringCount + 1U) * 2U > _slots.size())
+	{
+		grow();
+		static_cast<void>(find(string, hash, slot));
 	}
-	// Finally, put the whole thing together as a string view
-	return {reinterpret_cast<const char *>(data.data()), length};
+	const auto offset{static_cast<uint32_t>(_data.size())};
+	_data.insert(_data.end(), string.begin(), string.end());
+	_data.push_back(0U);
+	_slots[slot] = (uint64_t{hash} << 32U) | offset;
+	++_stringCount;
+	return offset;
 }
 
 // NOLINTEND(bugprone-exception-escape)
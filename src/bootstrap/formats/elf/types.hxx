@@ -2,7 +2,11 @@
 #ifndef FORMATS_ELF_TYPES_HXX
 #define FORMATS_ELF_TYPES_HXX
 
+#include <cstdint>
+#include <optional>
+#include <string_view>
 #include <variant>
+#include <vector>
 #include "io.hxx"
 #include "enums.hxx"
 #include "commonTypes.hxx"
@@ -43,6 +47,10 @@ namespace mangrove::elf::types
 		[[nodiscard]] uint16_t sectionHeaderSize() const noexcept;
 		[[nodiscard]] uint16_t sectionHeaderCount() const noexcept;
 		[[nodiscard]] uint16_t sectionNamesIndex() const noexcept;
+
+		void shdrOffset(uint64_t offset) const noexcept;
+		void sectionHeaderCount(uint16_t count) const noexcept;
+		void sectionNamesIndex(uint16_t index) const noexcept;
 	};
 
 	struct ProgramHeader final
@@ -81,6 +89,17 @@ namespace mangrove::elf::types
 		[[nodiscard]] uint32_t info() const noexcept;
 		[[nodiscard]] uint64_t alignment() const noexcept;
 		[[nodiscard]] uint64_t entityLength() const noexcept;
+
+		void nameOffset(uint32_t offset) const noexcept;
+		void type(SectionHeaderType type) const noexcept;
+		void flags(Flags<SectionFlag> flags) const noexcept;
+		void address(uint64_t address) const noexcept;
+		void fileOffset(uint64_t offset) const noexcept;
+		void fileLength(uint64_t length) const noexcept;
+		void link(uint32_t link) const noexcept;
+		void info(uint32_t info) const noexcept;
+		void alignment(uint64_t alignment) const noexcept;
+		void entityLength(uint64_t length) const noexcept;
 	};
 
 	struct ELFSymbol final
@@ -99,22 +118,85 @@ namespace mangrove::elf::types
 		[[nodiscard]] uint16_t sectionIndex() const noexcept;
 	};
 
+	struct ELFRelocation final
+	{
+	private:
+		std::variant<elf32::ELFRelocation, elf64::ELFRelocation> _header;
+
+	public:
+		template<typename T> ELFRelocation(T header) noexcept : _header{header} { }
+
+		[[nodiscard]] uint64_t offset() const noexcept;
+		[[nodiscard]] uint32_t symbol() const noexcept;
+		[[nodiscard]] uint32_t type() const noexcept;
+		[[nodiscard]] int64_t addend() const noexcept;
+		[[nodiscard]] bool withAddend() const noexcept;
+	};
+
+	/**
+	 * A view onto a table of NUL-terminated strings, such as .strtab or .shstrtab. Strings are found by
+	 * searching for their terminator, or for tables that will see many lookups, the table can first be
+	 * indexed by where each string ends in a single sweep, making each lookup a binary search.
+	 */
 	struct StringTable final
 	{
 	private:
 		Memory _storage{{}};
+		// When indexed, the offset of every terminator in the table in ascending order, followed by the
+		// table's length to end any final unterminated string. Offsets part way into a string (as when
+		// names share a suffix) end at the next terminator along, so this serves every offset
+		std::vector<uint32_t> _terminators{};
 
 	public:
-		constexpr StringTable() noexcept = default;
-		constexpr StringTable(const Memory &storage) noexcept : _storage{storage} { }
+		StringTable() noexcept = default;
+		StringTable(const Memory &storage) noexcept : _storage{storage} { }
 
-		constexpr StringTable &operator =(const Memory &storage) noexcept
+		StringTable &operator =(const Memory &storage) noexcept
 		{
 			_storage = storage;
+			_terminators.clear();
 			return *this;
 		}
 
+		[[nodiscard]] auto length() const noexcept { return _storage.length(); }
+		[[nodiscard]] auto indexed() const noexcept { return !_terminators.empty(); }
+		/** Builds the index of string ends, costing 4 bytes per string in the table */
+		void buildIndex();
+
+		/** Returns the string at offset without its terminator, or an empty string if offset is outside the table */
 		[[nodiscard]] std::string_view stringFromOffset(size_t offset) const noexcept;
+		/** Checks whether the string at offset is string, without first having to find where it ends */
+		[[nodiscard]] bool matches(size_t offset, std::string_view string) const noexcept;
+	};
+
+	/**
+	 * Builds up a string table to be written out, handing back the offset of each string as it's
+	 * added. Adding a string that is already in the table hands back the offset of the existing copy,
+	 * so names shared between sections or symbols are only stored once.
+	 */
+	struct StringTableBuilder final
+	{
+	private:
+		// The table always starts with the empty string, which is what offset 0 refers to
+		std::vector<uint8_t> _data{0U};
+		// Open-addressed hash of the strings in the table, each slot the hash << 32 | the string's offset.
+		// As offset 0 is the empty string, which never goes in the hash, an empty slot is simply 0
+		std::vector<uint64_t> _slots{};
+		size_t _stringCount{};
+
+		void grow();
+		[[nodiscard]] std::optional<uint32_t> find(std::string_view string, uint32_t hash, size_t &slot) const noexcept;
+
+	public:
+		StringTableBuilder();
+
+		/** Adds string, which must not contain a NUL, returning its offset in the table */
+		[[nodiscard]] uint32_t add(std::string_view string);
+		[[nodiscard]] auto length() const noexcept { return _data.size(); }
+		[[nodiscard]] auto stringCount() const noexcept { return _stringCount; }
+		/** The table as it currently stands - this moves whenever a new string is added */
+		[[nodiscard]] Memory storage() noexcept { return io::span{_data.data(), _data.size()}; }
+		[[nodiscard]] io::span<const uint8_t> storage() const noexcept { return {_data.data(), _data.size()}; }
 	};
 } // namespace mangrove::elf::types
 
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include "moduleInterface.hxx"
+#include "../../core/trace.hxx"
+#include "../../core/memory.hxx"
+
+using namespace std::literals::string_view_literals;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
+using mangrove::elf::io::inBounds;
+using mangrove::elf::io::hashString;
+
+namespace mangrove::moduleInterface
+{
+	ModuleInterface::ModuleInterface(fd_t &&file) : _map{file.map(PROT_READ)}
+	{
+		if (_map->valid())
+			_storage = span{_map->address<uint8_t>(), _map->length()};
+		validate();
+	}
+
+	ModuleInterface::ModuleInterface(const Memory &storage) noexcept : _storage{storage} { validate(); }
+
+	ModuleInterface::ModuleInterface(const ELF &elf) noexcept
+	{
+		if (const auto section{elf.sectionIndex(interfaceSectionName)}; section)
+			_storage = elf.sectionData(*section);
+		validate();
+	}
+
+	void ModuleInterface::validate() noexcept
+	{
+		const ScopedTimer timer{"ModuleInterface::validate"sv};
+		const auto length{_storage.length()};
+		if (length < InterfaceHeader::size())
+			return;
+		const InterfaceHeader header{_storage};
+		_endian = header.endian();
+		if (header.magic() != interfaceMagic || header.version() != InterfaceVersion::current ||
+			(_endian != Endian::little && _endian != Endian::big))
+			return;
+		_symbolCount = header.symbolCount();
+		_bucketCount = header.bucketCount();
+		_symbolsOffset = header.symbolsOffset();
+		_bucketsOffset = header.bucketsOffset();
+		const auto stringsOffset{header.stringsOffset()};
+		const auto stringsLength{header.stringsLength()};
+		// The hash index must have a power of 2 number of buckets for the hash to be masked onto it
+		if (!_bucketCount || (_bucketCount & (_bucketCount - 1U)) ||
+			!inBounds(_symbolsOffset, _symbolCount, ExportedSymbol::size(), length) ||
+			!inBounds(_bucketsOffset, _bucketCount, sizeof(uint32_t), length) ||
+			!inBounds(stringsOffset, stringsLength, 1U, length))
+			return;
+		_strings = _storage.dataSpan().subspan(stringsOffset, stringsLength);
+		_valid = true;
+	}
+
+	ExportedSymbol ModuleInterface::symbol(const size_t index) const noexcept
+		{ return {_storage.dataSpan().subspan(_symbolsOffset + (index * ExportedSymbol::size())), _endian}; }
+
+	std::string_view ModuleInterface::name(const ExportedSymbol &symbol) const noexcept
+	{
+		const uint64_t offset{symbol.nameOffset()};
+		const uint64_t length{symbol.nameLength()};
+		if (!inBounds(offset, length, 1U, _strings.length()))
+			return {};
+		return {reinterpret_cast<const char *>(_strings.data() + offset), length};
+	}
+
+	std::optional<ExportedSymbol> ModuleInterface::find(const StringView &ident) const noexcept
+	{
+		if (!_valid)
+			return std::nullopt;
+		count(Counter::symbolsLookedUp);
+		const std::string_view name{ident.data(), ident.byteLength()};
+		const auto hash{hashString(name)};
+		auto index{_storage.read<uint32_t>(_bucketsOffset + ((hash & (_bucketCount - 1U)) * sizeof(uint32_t)),
+			_endian)};
+		// Chains can't legitimately be longer than the symbol table, which also stops a corrupt file
+		// with a cycle in a chain from making us spin forever
+		for (uint32_t steps{}; index && steps < _symbolCount; ++steps)
+		{
+			if (index > _symbolCount)
+				return std::nullopt;
+			const auto candidate{symbol(index - 1U)};
+			if (candidate.hash() == hash && this->name(candidate) == name)
+				return candidate;
+			index = candidate.next();
+		}
+		return std::nullopt;
+	}
+
+	bool InterfaceBuilder::add(const StringView &ident, const SymbolType &type)
+	{
+		const PhaseScope phase{Phase::symbol};
+		count(Counter::symbolsInserted);
+		return _exports.try_emplace(std::string{ident.data(), ident.byteLength()}, type.flags()).second;
+	}
+
+	std::vector<uint8_t> InterfaceBuilder::build(const Endian endian) const
+	{
+		const ScopedTimer timer{"InterfaceBuilder::build"sv};
+		const auto symbolCount{static_cast<uint32_t>(_exports.size())};
+		uint32_t bucketCount{1U};
+		while (bucketCount < symbolCount)
+			bucketCount <<= 1U;
+		size_t stringsLength{};
+		for (const auto &[name, type] : _exports)
+			stringsLength += name.size() + 1U;
+
+		const auto symbolsOffset{InterfaceHeader::size()};
+		const auto bucketsOffset{symbolsOffset + (symbolCount * ExportedSymbol::size())};
+		const auto stringsOffset{bucketsOffset + (bucketCount * sizeof(uint32_t))};
+		std::vector<uint8_t> result(stringsOffset + stringsLength);
+		const Memory storage{span{result.data(), result.size()}};
+
+		const InterfaceHeader header{storage, endian};
+		header.symbolCount(symbolCount);
+		header.bucketCount(bucketCount);
+		header.symbolsOffset(symbolsOffset);
+		header.bucketsOffset(bucketsOffset);
+		header.stringsOffset(stringsOffset);
+		header.stringsLength(stringsLength);
+
+		// The buckets start zeroed (empty), and each symbol is pushed onto the head of its bucket's chain
+		std::vector<uint32_t> buckets(bucketCount);
+		uint32_t index{};
+		uint32_t nameOffset{};
+		for (const auto &[name, type] : _exports)
+		{
+			const ExportedSymbol symbol{storage.dataSpan().subspan(symbolsOffset + (index * ExportedSymbol::size())),
+				endian};
+			const auto hash{hashString(name)};
+			auto &bucket{buckets[hash & (bucketCount - 1U)]};
+			symbol.nameOffset(nameOffset);
+			symbol.nameLength(static_cast<uint32_t>(name.size()));
+			symbol.typeFlags(type.toRaw());
+			symbol.hash(hash);
+			symbol.next(bucket);
+			bucket = ++index;
+			// Names are NUL terminated too so the table can be inspected with the usual string tools
+			std::copy(name.begin(), name.end(), result.begin() + static_cast<ptrdiff_t>(stringsOffset + nameOffset));
+			nameOffset += static_cast<uint32_t>(name.size() + 1U);
+		}
+		for (size_t bucket{}; bucket < bucketCount; ++bucket)
+			storage.write(bucketsOffset + (bucket * sizeof(uint32_t)), buckets[bucket], endian);
+		return result;
+	}
+
+	bool InterfaceBuilder::write(const fd_t &file, const Endian endian) const
+	{
+		const auto data{build(endian)};
+		return file.write(data.data(), data.size());
+	}
+
+	size_t InterfaceBuilder::embedInto(ELF &elf) const
+	{
+		// The interface is metadata rather than part of the program image, so isn't allocated at runtime
+		const auto data{build(elf.header().endian())};
+		return elf.addSection(interfaceSectionName, mangrove::elf::enums::SectionHeaderType::program, {},
+			span{data.data(), data.size()}, 8U);
+	}
+} // namespace mangrove::moduleInterface
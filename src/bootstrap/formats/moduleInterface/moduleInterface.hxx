@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef FORMATS_MODULE_INTERFACE_HXX
+#define FORMATS_MODULE_INTERFACE_HXX
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <substrate/fd>
+#include <substrate/mmap>
+#include "types.hxx"
+#include "../elf/elf.hxx"
+#include "../../ast/symbolTable.hxx"
+
+/**
+ * @file moduleInterface.hxx
+ * @brief Reading and writing precompiled module interfaces
+ */
+
+namespace mangrove::moduleInterface
+{
+	inline namespace internal
+	{
+		using substrate::fd_t;
+		using substrate::mmap_t;
+		using substrate::span;
+		using mangrove::ast::symbolTable::StringView;
+		using mangrove::ast::symbolTable::SymbolType;
+		using mangrove::ast::symbolTable::TypeFlags;
+		using mangrove::elf::ELF;
+		using namespace types;
+	} // namespace internal
+
+	/** The object file section module interfaces are embedded in, so one artefact serves linker and importer */
+	constexpr static inline std::string_view interfaceSectionName{".mangrove.interface"};
+
+	/**
+	 * A module interface loaded for use by an importer. Loading validates the header and the
+	 * extents of the tables once, after which everything is read directly from the file's mapping -
+	 * there is no parsing step, and resolving an imported name is a single probe of the hash index.
+	 */
+	struct ModuleInterface final
+	{
+	private:
+		std::optional<mmap_t> _map{};
+		Memory _storage{{}};
+		Endian _endian{Endian::little};
+		uint32_t _symbolCount{};
+		uint32_t _bucketCount{};
+		uint64_t _symbolsOffset{};
+		uint64_t _bucketsOffset{};
+		Memory _strings{{}};
+		bool _valid{false};
+
+		void validate() noexcept;
+
+	public:
+		/** Maps and loads the interface in file */
+		ModuleInterface(fd_t &&file);
+		/** Loads the interface held in storage, which must outlive this object */
+		ModuleInterface(const Memory &storage) noexcept;
+		/** Loads the interface embedded in an object file in place, which must outlive this object */
+		ModuleInterface(const ELF &elf) noexcept;
+
+		[[nodiscard]] auto valid() const noexcept { return _valid; }
+		[[nodiscard]] auto symbolCount() const noexcept { return _symbolCount; }
+		[[nodiscard]] auto bucketCount() const noexcept { return _bucketCount; }
+
+		[[nodiscard]] ExportedSymbol symbol(size_t index) const noexcept;
+		/** Returns the name of symbol, or an empty string if the name lies outside the string table */
+		[[nodiscard]] std::string_view name(const ExportedSymbol &symbol) const noexcept;
+		[[nodiscard]] static SymbolType type(const ExportedSymbol &symbol) noexcept
+			{ return {TypeFlags::fromRaw(symbol.typeFlags())}; }
+
+		/** Looks up an exported symbol by name */
+		[[nodiscard]] std::optional<ExportedSymbol> find(const StringView &ident) const noexcept;
+	};
+
+	/** Collects a module's exported symbols and lays them out as a module interface */
+	struct InterfaceBuilder final
+	{
+	private:
+		// Keeping the exports sorted makes the output independent of the order they were added in
+		std::map<std::string, TypeFlags, std::less<>> _exports{};
+
+	public:
+		/** Adds an exported symbol, returning false if the name has already been exported */
+		[[nodiscard]] bool add(const StringView &ident, const SymbolType &type);
+		[[nodiscard]] auto exportCount() const noexcept { return _exports.size(); }
+
+		[[nodiscard]] std::vector<uint8_t> build(Endian endian = Endian::little) const;
+		[[nodiscard]] bool write(const fd_t &file, Endian endian = Endian::little) const;
+		/** Embeds the interface into an object file being built, returning the index of its section */
+		size_t embedInto(ELF &elf) const;
+	};
+} // namespace mangrove::moduleInterface
+
+#endif /*FORMATS_MODULE_INTERFACE_HXX*/
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef FORMATS_MODULE_INTERFACE_TYPES_HXX
+#define FORMATS_MODULE_INTERFACE_TYPES_HXX
+
+#include <cstdint>
+#include <array>
+#include "../elf/io.hxx"
+#include "../elf/enums.hxx"
+
+/**
+ * @file types.hxx
+ * @brief Endian-aware views onto the structures that make up a module interface file
+ *
+ * A module interface file is laid out as:
+ *  - the header, giving the counts, offsets and lengths of everything after it
+ *  - the exported symbol table, a fixed-size entry per symbol
+ *  - the hash index, an array of 32-bit bucket heads, each the index + 1 of the first symbol in
+ *    that bucket's chain or 0 for an empty bucket
+ *  - the string table holding the symbols' names
+ * All multi-byte values are stored in the endian given in the header.
+ */
+
+namespace mangrove::moduleInterface::types
+{
+	inline namespace internal
+	{
+		using mangrove::elf::io::Memory;
+		using mangrove::elf::enums::Endian;
+	} // namespace internal
+
+	// This represents the magic number \x7f MMI (Mangrove Module Interface)
+	constexpr static inline std::array<uint8_t, 4> interfaceMagic{{0x7fU, 0x4dU, 0x4dU, 0x49U}};
+
+	enum class InterfaceVersion : uint8_t
+	{
+		current = 1U,
+	};
+
+	struct InterfaceHeader final
+	{
+	private:
+		Memory _storage;
+		Endian _endian;
+
+	public:
+		InterfaceHeader(const Memory &storage) : _storage{storage}, _endian{_storage.read<Endian>(5)} { }
+		InterfaceHeader(const Memory &storage, const Endian endian) : _storage{storage}, _endian{endian}
+		{
+			_storage.write(0, interfaceMagic);
+			_storage.write(4, InterfaceVersion::current);
+			_storage.write(5, endian);
+			_storage.write<uint16_t>(6, 0U, _endian);
+		}
+
+		[[nodiscard]] auto magic() const noexcept { return _storage.read<std::array<uint8_t, 4>>(0); }
+		[[nodiscard]] auto version() const noexcept { return _storage.read<InterfaceVersion>(4); }
+		[[nodiscard]] auto endian() const noexcept { return _endian; }
+		[[nodiscard]] auto symbolCount() const noexcept { return _storage.read<uint32_t>(8, _endian); }
+		[[nodiscard]] auto bucketCount() const noexcept { return _storage.read<uint32_t>(12, _endian); }
+		[[nodiscard]] auto symbolsOffset() const noexcept { return _storage.read<uint64_t>(16, _endian); }
+		[[nodiscard]] auto bucketsOffset() const noexcept { return _storage.read<uint64_t>(24, _endian); }
+		[[nodiscard]] auto stringsOffset() const noexcept { return _storage.read<uint64_t>(32, _endian); }
+		[[nodiscard]] auto stringsLength() const noexcept { return _storage.read<uint64_t>(40, _endian); }
+
+		void symbolCount(const uint32_t count) const noexcept { _storage.write(8, count, _endian); }
+		void bucketCount(const uint32_t count) const noexcept { _storage.write(12, count, _endian); }
+		void symbolsOffset(const uint64_t offset) const noexcept { _storage.write(16, offset, _endian); }
+		void bucketsOffset(const uint64_t offset) const noexcept { _storage.write(24, offset, _endian); }
+		void stringsOffset(const uint64_t offset) const noexcept { _storage.write(32, offset, _endian); }
+		void stringsLength(const uint64_t length) const noexcept { _storage.write(40, length, _endian); }
+
+		[[nodiscard]] constexpr static size_t size() noexcept { return 48U; }
+	};
+
+	struct ExportedSymbol final
+	{
+	private:
+		Memory _storage;
+		Endian _endian;
+
+	public:
+		ExportedSymbol(const Memory &storage, const Endian &endian) : _storage{storage}, _endian{endian} { }
+
+		[[nodiscard]] auto nameOffset() const noexcept { return _storage.read<uint32_t>(0, _endian); }
+		[[nodiscard]] auto nameLength() const noexcept { return _storage.read<uint32_t>(4, _endian); }
+		// The raw form of the symbol's TypeFlags - type IDs are only meaningful within a single process
+		[[nodiscard]] auto typeFlags() const noexcept { return _storage.read<uint32_t>(8, _endian); }
+		[[nodiscard]] auto hash() const noexcept { return _storage.read<uint32_t>(12, _endian); }
+		// The index + 1 of the next symbol in this symbol's hash chain, or 0 at the end of the chain
+		[[nodiscard]] auto next() const noexcept { return _storage.read<uint32_t>(16, _endian); }
+
+		void nameOffset(const uint32_t offset) const noexcept { _storage.write(0, offset, _endian); }
+		void nameLength(const uint32_t length) const noexcept { _storage.write(4, length, _endian); }
+		void typeFlags(const uint32_t flags) const noexcept { _storage.write(8, flags, _endian); }
+		void hash(const uint32_t hash) const noexcept { _storage.write(12, hash, _endian); }
+		void next(const uint32_t index) const noexcept { _storage.write(16, index, _endian); }
+
+		[[nodiscard]] constexpr static size_t size() noexcept { return 24U; }
+	};
+} // namespace mangrove::moduleInterface::types
+
+#endif /*FORMATS_MODULE_INTERFACE_TYPES_HXX*/
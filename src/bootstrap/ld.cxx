@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdio>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/span>
+#include "link/linker.hxx"
+#include "core/trace.hxx"
+
+/**
+ * @file ld.cxx
+ * @brief mangrove-ld - statically links relocatable ELF objects and archives into an executable across a
+ * pool of worker threads
+ */
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::span;
+using mangrove::link::LinkOptions;
+namespace trace = mangrove::core::trace;
+using benchClock = std::chrono::steady_clock;
+
+constexpr static auto outputOption{"--output="sv};
+constexpr static auto entryOption{"--entry="sv};
+constexpr static auto jobsOption{"--jobs="sv};
+constexpr static auto exportOption{"--export="sv};
+constexpr static auto gcSectionsOption{"--gc-sections"sv};
+constexpr static auto icfOption{"--icf"sv};
+constexpr static auto statsOption{"--stats"sv};
+constexpr static auto traceOption{"--trace="sv};
+
+int main(int argCount, char **argList)
+{
+	console = {stdout, stderr};
+	trace::nameThread("main"sv);
+
+	LinkOptions options{};
+	options.workers = std::max(std::thread::hardware_concurrency(), 1U);
+	bool stats{false};
+	std::optional<path> traceFile{};
+	std::vector<path> files{};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	for (size_t index{}; index < args.size(); ++index)
+	{
+		const std::string_view arg{args[index]};
+		if (arg == "-o"sv)
+		{
+			if (++index == args.size())
+			{
+				console.error("-o requires an output file"sv);
+				return 1;
+			}
+			options.output = args[index];
+		}
+		else if (arg.substr(0, outputOption.length()) == outputOption)
+			options.output = arg.substr(outputOption.length());
+		else if (arg.substr(0, entryOption.length()) == entryOption)
+			options.entry = arg.substr(entryOption.length());
+		else if (arg.substr(0, jobsOption.length()) == jobsOption)
+		{
+			try
+				{ options.workers = std::stoul(std::string{arg.substr(jobsOption.length())}); }
+			catch (const std::exception &)
+				{ options.workers = 0U; }
+			if (!options.workers)
+			{
+				console.error("Invalid job count "sv, arg.substr(jobsOption.length()));
+				return 1;
+			}
+		}
+		else if (arg.substr(0, exportOption.length()) == exportOption)
+			options.exports.emplace_back(arg.substr(exportOption.length()));
+		else if (arg == gcSectionsOption)
+			options.collectGarbage = true;
+		else if (arg == icfOption)
+			options.foldIdentical = true;
+		else if (arg == statsOption)
+			stats = true;
+		else if (arg.substr(0, traceOption.length()) == traceOption)
+			traceFile = arg.substr(traceOption.length());
+		else
+			files.emplace_back(arg);
+	}
+
+	if (files.empty())
+	{
+		console.error("Usage: mangrove-ld [-o file|--output=file] [--entry=symbol] [--jobs=N] [--gc-sections] "sv,
+			"[--icf] [--export=symbol] [--stats] [--trace=file] <objects and archives...>"sv);
+		return 1;
+	}
+
+	const auto begin{benchClock::now()};
+	const auto result{mangrove::link::link(files, options)};
+	const auto elapsed{std::chrono::duration<double>{benchClock::now() - begin}.count()};
+	for (const auto &error : result.errors)
+		console.error(error);
+
+	if (stats)
+	{
+		fmt::print(stderr, "{} objects on {} threads in {:.3f}s: {} sections, {} symbols, {} relocations, "
+			"{} bytes written\n"sv, result.objects, options.workers, elapsed, result.sections, result.symbols,
+			result.relocations, result.outputLength);
+		for (const auto &saving : result.savings)
+			fmt::print(stderr, "{}: {} bytes collected, {} bytes folded\n"sv, saving.name, saving.collected,
+				saving.folded);
+	}
+	if (traceFile && !trace::writeTrace(*traceFile))
+		return 1;
+	return result.success() ? 0 : 1;
+}
@@ -0,0 +1,1222 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <fmt/format.h>
+#include <substrate/fd>
+#include <substrate/mmap>
+#include <substrate/span>
+#include "linker.hxx"
+#include "../formats/ar/archive.hxx"
+#include "../formats/elf/elf.hxx"
+#include "../formats/elf/relocation.hxx"
+#include "../core/trace.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::fd_t;
+using substrate::mmap_t;
+using substrate::span;
+using mangrove::core::Flags;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::ar::Archive;
+using mangrove::ar::isArchive;
+using mangrove::elf::ELF;
+using mangrove::elf::AccessPattern;
+using mangrove::elf::io::Memory;
+using mangrove::elf::relocation::Relocator;
+using mangrove::elf::relocation::RelocationError;
+using mangrove::elf::types::SectionHeader;
+using mangrove::elf::types::StringTable;
+using mangrove::elf::types::StringTableBuilder;
+using mangrove::elf::types::elfMagic;
+using namespace mangrove::elf::enums;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+
+namespace mangrove::link
+{
+	namespace
+	{
+		constexpr uint64_t pageSize{0x1000U};
+		constexpr size_t shardCount{64U};
+		constexpr auto noSection{std::numeric_limits<size_t>::max()};
+		// Special section indices (SHN_*) and symbol bindings (STB_*)
+		constexpr uint16_t undefinedIndex{0U};
+		constexpr uint16_t reservedIndices{0xff00U};
+		constexpr uint16_t absoluteIndex{0xfff1U};
+		constexpr uint16_t commonIndex{0xfff2U};
+		// SHF_GNU_RETAIN, which the section flag enum doesn't cover
+		constexpr uint64_t retainFlag{0x200000U};
+		constexpr uint8_t localBinding{0U};
+		constexpr uint8_t weakBinding{2U};
+		// Segment permissions (PF_*)
+		constexpr uint32_t executable{1U};
+		constexpr uint32_t writable{2U};
+		constexpr uint32_t readable{4U};
+
+		struct Symbol final
+		{
+			std::string_view name;
+			uint64_t value;
+			uint16_t section;
+			uint8_t binding;
+		};
+
+		// The symbol a name resolves to, by the object defining it and its index in that object's symbol table
+		struct Definition final
+		{
+			size_t object;
+			size_t symbol;
+			bool weak;
+		};
+
+		using Shard = std::unordered_map<std::string_view, Definition>;
+
+		// How garbage collection treats a section
+		enum class SectionKind : uint8_t
+		{
+			// Not part of the image, so never live
+			unallocated,
+			// Live only if something live refers to it
+			ordinary,
+			// Always live, as with constructor tables, and keeps what it refers to live
+			retained,
+			// Always live but keeps nothing else live, as with .eh_frame, whose entries for dead code go unused
+			opaque,
+		};
+
+		struct RelocationEntry final
+		{
+			uint64_t offset;
+			uint32_t symbol;
+			uint32_t type;
+			int64_t addend;
+		};
+
+		// What a symbol refers to - a section of some object, numbered as a node of the section graph, and
+		// an offset into it, or for absolute symbols, just a value
+		struct Target final
+		{
+			size_t node;
+			uint64_t value;
+
+			[[nodiscard]] bool operator ==(const Target &other) const noexcept
+				{ return node == other.node && value == other.value; }
+		};
+
+		struct SectionRef final
+		{
+			size_t object;
+			size_t section;
+		};
+
+		struct InputObject final
+		{
+			path file{};
+			std::optional<ELF> elf{};
+			std::optional<size_t> symbolTable{};
+			std::vector<Symbol> symbols{};
+			// The indices of the object's global definitions, grouped by shard, and where each shard's group starts
+			std::vector<size_t> definitions{};
+			std::array<size_t, shardCount + 1U> shardStarts{};
+			// For each of the object's sections, its index in the linker's input sections, or noSection if not linked
+			std::vector<size_t> sections{};
+			// The final value of each symbol in the object's symbol table, as relocations see them
+			std::vector<uint64_t> symbolValues{};
+			std::vector<std::string> errors{};
+
+			// The rest is only filled in when sections are being collected or folded - for each section, what
+			// collection makes of it, the section it's ordered after (SHF_LINK_ORDER), and the relocations
+			// against it. Then which sections were discarded, and which were folded into an identical one.
+			std::vector<SectionKind> kinds{};
+			std::vector<size_t> linkedTo{};
+			std::vector<std::vector<RelocationEntry>> relocations{};
+			std::vector<uint8_t> discarded{};
+			std::vector<SectionRef> foldedInto{};
+		};
+
+		struct InputSection final
+		{
+			size_t object;
+			size_t index;
+			size_t output;
+			uint64_t length;
+			uint64_t alignment;
+			// Where in its output section this section goes
+			uint64_t offset{};
+		};
+
+		struct OutputSection final
+		{
+			std::string_view name;
+			SectionHeaderType type;
+			Flags<SectionFlag> flags;
+			uint64_t alignment{1U};
+			uint64_t length{};
+			uint64_t address{};
+			uint64_t fileOffset{};
+			std::vector<size_t> inputs{};
+		};
+
+		struct Segment final
+		{
+			uint64_t offset;
+			uint64_t address;
+			uint64_t fileLength;
+			uint64_t memoryLength;
+			uint32_t flags;
+		};
+
+		struct Layout final
+		{
+			// The output sections in the order they're laid out, which is also the order of their headers
+			std::vector<size_t> order{};
+			std::vector<Segment> segments{};
+			StringTableBuilder names{};
+			std::vector<uint32_t> nameOffsets{};
+			uint32_t namesName{};
+			uint64_t namesOffset{};
+			uint64_t shdrOffset{};
+			uint64_t length{};
+		};
+
+		struct RelocationTask final
+		{
+			size_t object;
+			size_t section;
+			size_t target;
+			std::string error{};
+		};
+
+		// Runs function over [0, count) on up to workers threads, the calling thread included
+		template<typename F> void parallelFor(const size_t count, const size_t workers, const F &function)
+		{
+			std::atomic<size_t> next{};
+			const auto worker{[&](const size_t workerIndex)
+			{
+				for (auto index{next++}; index < count; index = next++)
+					function(index, workerIndex);
+			}};
+			const auto threadCount{std::max<size_t>(1U, std::min(workers, count))};
+			std::vector<std::thread> threads{};
+			threads.reserve(threadCount - 1U);
+			for (size_t workerIndex{1U}; workerIndex < threadCount; ++workerIndex)
+				threads.emplace_back(worker, workerIndex);
+			worker(0U);
+			for (auto &thread : threads)
+				thread.join();
+		}
+
+		[[nodiscard]] constexpr uint64_t alignTo(const uint64_t offset, const uint64_t alignment) noexcept
+			{ return alignment > 1U ? (offset + alignment - 1U) & ~(alignment - 1U) : offset; }
+
+		[[nodiscard]] size_t shardFor(const std::string_view name) noexcept
+			{ return std::hash<std::string_view>{}(name) % shardCount; }
+
+		// Sections named for a function or object, as with -ffunction-sections, go in with the rest of their kind
+		[[nodiscard]] std::string_view outputNameFor(const std::string_view name) noexcept
+		{
+			for (const auto prefix : {".text"sv, ".rodata"sv, ".data"sv, ".bss"sv, ".init_array"sv, ".fini_array"sv,
+				".ARM.exidx"sv})
+			{
+				if (name.substr(0U, prefix.length()) == prefix &&
+					(name.length() == prefix.length() || name[prefix.length()] == '.'))
+					return prefix;
+			}
+			return name;
+		}
+
+		// Code first, then read-only data, which share the first segment, then data followed by .bss in the second
+		[[nodiscard]] size_t rankOf(const OutputSection &section) noexcept
+		{
+			if (section.type == SectionHeaderType::bss)
+				return 3U;
+			if (section.flags.includes(SectionFlag::writeable))
+				return 2U;
+			return section.flags.includes(SectionFlag::execuable) ? 0U : 1U;
+		}
+
+		[[nodiscard]] std::string_view describe(const RelocationError error) noexcept
+		{
+			switch (error)
+			{
+				case RelocationError::unsupportedMachine:
+					return "relocations for this machine are not supported"sv;
+				case RelocationError::unsupportedType:
+					return "unsupported relocation type"sv;
+				case RelocationError::badSymbol:
+					return "symbol index outside of the symbol table"sv;
+				case RelocationError::outOfBounds:
+					return "relocated field lies outside of the section"sv;
+				case RelocationError::overflow:
+					return "relocated value does not fit its field"sv;
+				default:
+					return "no error"sv;
+			}
+		}
+
+		template<typename Record> void decodeSymbols(const ELF &elf, const size_t symbolTable,
+			const StringTable &names, std::vector<Symbol> &symbols)
+		{
+			std::vector<Record> records{};
+			static_cast<void>(elf.readTable(symbolTable, records));
+			symbols.reserve(records.size());
+			for (const auto &record : records)
+				symbols.push_back({names.stringFromOffset(record.nameOffset), record.value, record.sectionIndex,
+					static_cast<uint8_t>(record.info >> 4U)});
+		}
+
+		// Decodes a loaded object's symbol table, and sorts its global definitions into shards
+		void readObject(InputObject &object)
+		{
+			const auto fileName{object.file.string()};
+			const auto &elf{*object.elf};
+			if (!elf.valid() || elf.header().type() != Type::relocatable)
+			{
+				object.errors.emplace_back(fmt::format("{}: not a relocatable ELF object"sv, fileName));
+				return;
+			}
+			// Section names are looked up again and again - by collection, folding and layout - so find where
+			// each one ends just the once
+			object.elf->sectionNames().buildIndex();
+			const auto &headers{elf.sectionHeaders()};
+			for (size_t index{}; index < headers.size(); ++index)
+			{
+				if (headers[index].type() != SectionHeaderType::symbolTable)
+					continue;
+				if (object.symbolTable)
+				{
+					object.errors.emplace_back(fmt::format("{}: more than one symbol table"sv, fileName));
+					return;
+				}
+				object.symbolTable = index;
+			}
+			if (!object.symbolTable)
+				return;
+
+			const auto names{elf.stringTable(headers[*object.symbolTable].link())};
+			if (elf.header().elfClass() == Class::elf32Bit)
+				decodeSymbols<elf32::SymbolRecord>(elf, *object.symbolTable, names, object.symbols);
+			else
+				decodeSymbols<elf64::SymbolRecord>(elf, *object.symbolTable, names, object.symbols);
+
+			// Counting sort the definitions by shard, so each shard's worker can walk straight to its own
+			std::vector<size_t> shards(object.symbols.size(), shardCount);
+			std::array<size_t, shardCount> counts{};
+			for (size_t index{1U}; index < object.symbols.size(); ++index)
+			{
+				const auto &symbol{object.symbols[index]};
+				if (symbol.binding == localBinding || symbol.section == undefinedIndex)
+					continue;
+				if (symbol.section == commonIndex)
+				{
+					object.errors.emplace_back(fmt::format("{}: '{}' is a common symbol, which is not supported "
+						"(build with -fno-common)"sv, fileName, symbol.name));
+					continue;
+				}
+				if (symbol.section >= reservedIndices && symbol.section != absoluteIndex)
+					continue;
+				shards[index] = shardFor(symbol.name);
+				++counts[shards[index]];
+			}
+			for (size_t shard{}; shard < shardCount; ++shard)
+				object.shardStarts[shard + 1U] = object.shardStarts[shard] + counts[shard];
+			object.definitions.resize(object.shardStarts[shardCount]);
+			auto cursors{object.shardStarts};
+			for (size_t index{}; index < shards.size(); ++index)
+			{
+				if (shards[index] != shardCount)
+					object.definitions[cursors[shards[index]]++] = index;
+			}
+		}
+
+		// Maps an input in, reading it as an object, or if it's an archive, just mapping it to search later
+		void loadInput(InputObject &object, std::optional<Archive> &archive)
+		{
+			fd_t file{object.file.c_str(), O_RDONLY | O_NOCTTY};
+			if (!file.valid())
+			{
+				object.errors.emplace_back(fmt::format("{}: could not open file"sv, object.file.string()));
+				return;
+			}
+			std::array<uint8_t, 8U> magic{};
+			if (file.read(magic) && isArchive({magic.data(), magic.size()}))
+			{
+				if (!archive.emplace(std::move(file)).valid())
+					object.errors.emplace_back(fmt::format("{}: malformed archive"sv, object.file.string()));
+				return;
+			}
+			object.elf.emplace(std::move(file), AccessPattern::sequential);
+			readObject(object);
+		}
+
+		/**
+		 * Pulls in the archive members defining symbols the objects leave undefined, a round at a time - each
+		 * round finds the members the last round's objects need through the archives' indices, and they're
+		 * then read in parallel. Every archive is searched whatever its place on the command line, as if they
+		 * were all in one --start-group, and where several define a symbol, the first given wins.
+		 */
+		void pullMembers(std::vector<InputObject> &objects, const std::vector<path> &files,
+			std::vector<std::optional<Archive>> &archives, const size_t workers)
+		{
+			std::unordered_set<std::string_view> defined{};
+			std::vector<std::unordered_set<size_t>> pulled(archives.size());
+			for (size_t scanned{}; scanned < objects.size();)
+			{
+				const auto first{objects.size()};
+				for (auto index{scanned}; index < first; ++index)
+				{
+					const auto &object{objects[index]};
+					for (const auto symbol : object.definitions)
+						defined.insert(object.symbols[symbol].name);
+				}
+				std::vector<std::pair<size_t, size_t>> round{};
+				for (; scanned < first; ++scanned)
+				{
+					for (const auto &symbol : objects[scanned].symbols)
+					{
+						// Weak references don't pull members in, they're left at zero if nothing else does
+						if (symbol.section != undefinedIndex || symbol.binding == localBinding ||
+							symbol.binding == weakBinding || defined.count(symbol.name))
+							continue;
+						for (size_t archive{}; archive < archives.size(); ++archive)
+						{
+							if (!archives[archive])
+								continue;
+							if (const auto member{archives[archive]->lookup(symbol.name)})
+							{
+								if (pulled[archive].insert(*member).second)
+									round.emplace_back(archive, *member);
+								break;
+							}
+						}
+					}
+				}
+
+				for (const auto &[archive, headerOffset] : round)
+				{
+					auto &object{objects.emplace_back()};
+					const auto member{archives[archive]->member(headerOffset)};
+					if (!member)
+					{
+						object.file = files[archive];
+						object.errors.emplace_back(fmt::format("{}: symbol index refers to a member at {} that "
+							"does not exist"sv, object.file.string(), headerOffset));
+						continue;
+					}
+					object.file = fmt::format("{}({})"sv, files[archive].string(), member->name);
+					object.elf.emplace(member->data);
+				}
+				parallelFor(objects.size() - first, workers, [&](const size_t index, const size_t)
+				{
+					if (objects[first + index].elf)
+						readObject(objects[first + index]);
+				});
+			}
+		}
+
+		// Builds one shard of the global symbol table from every object in input order
+		void resolveShard(const std::vector<InputObject> &objects, const size_t shard, Shard &table,
+			std::vector<std::string> &errors)
+		{
+			for (size_t objectIndex{}; objectIndex < objects.size(); ++objectIndex)
+			{
+				const auto &object{objects[objectIndex]};
+				for (auto position{object.shardStarts[shard]}; position < object.shardStarts[shard + 1U]; ++position)
+				{
+					const auto symbolIndex{object.definitions[position]};
+					const auto &symbol{object.symbols[symbolIndex]};
+					const auto weak{symbol.binding == weakBinding};
+					const auto [entry, inserted]{table.try_emplace(symbol.name, Definition{objectIndex, symbolIndex, weak})};
+					if (inserted || weak)
+						continue;
+					// A strong definition replaces a weak one, but two strong ones is an error
+					auto &existing{entry->second};
+					if (existing.weak)
+						existing = {objectIndex, symbolIndex, false};
+					else
+						errors.emplace_back(fmt::format("duplicate definition of '{}' in {} and {}"sv, symbol.name,
+							objects[existing.object].file.string(), object.file.string()));
+				}
+			}
+		}
+
+		[[nodiscard]] std::optional<Definition> lookup(const std::vector<Shard> &shards, const std::string_view name)
+		{
+			const auto &shard{shards[shardFor(name)]};
+			if (const auto definition{shard.find(name)}; definition != shard.end())
+				return definition->second;
+			return std::nullopt;
+		}
+
+		template<typename Record> void decodeRelocations(const ELF &elf, const size_t section,
+			std::vector<RelocationEntry> &entries)
+		{
+			std::vector<Record> records{};
+			static_cast<void>(elf.readTable(section, records));
+			entries.reserve(entries.size() + records.size());
+			for (const auto &record : records)
+			{
+				if constexpr (std::is_same_v<Record, elf32::RelaRecord> || std::is_same_v<Record, elf64::RelaRecord>)
+					entries.push_back({record.offset, record.symbol(), record.type(), record.addend});
+				else
+					entries.push_back({record.offset, record.symbol(), record.type(), 0});
+			}
+		}
+
+		[[nodiscard]] SectionKind kindOf(const SectionHeader &header, const std::string_view name) noexcept
+		{
+			const auto flags{header.flags()};
+			if (!flags.includes(SectionFlag::allocate))
+				return SectionKind::unallocated;
+			if (name == ".eh_frame"sv)
+				return SectionKind::opaque;
+			const auto type{header.type()};
+			const auto outputName{outputNameFor(name)};
+			// Sections the runtime walks rather than anything referring to them, and those marked SHF_GNU_RETAIN
+			if (type == SectionHeaderType::initArray || type == SectionHeaderType::finiArray ||
+				type == SectionHeaderType::preInitArray || type == SectionHeaderType::note ||
+				outputName == ".init_array"sv || outputName == ".fini_array"sv || name == ".init"sv ||
+				name == ".fini"sv || name.substr(0U, 6U) == ".ctors"sv || name.substr(0U, 6U) == ".dtors"sv ||
+				(flags.toRaw() & retainFlag))
+				return SectionKind::retained;
+			return SectionKind::ordinary;
+		}
+
+		// Works out what collection and folding need to know about each of an object's sections
+		void prepareObject(InputObject &object)
+		{
+			const auto &elf{*object.elf};
+			const auto &headers{elf.sectionHeaders()};
+			const auto elf32Bit{elf.header().elfClass() == Class::elf32Bit};
+			object.kinds.assign(headers.size(), SectionKind::unallocated);
+			object.linkedTo.assign(headers.size(), noSection);
+			object.relocations.resize(headers.size());
+			object.discarded.assign(headers.size(), 0U);
+			object.foldedInto.assign(headers.size(), {noSection, noSection});
+			for (size_t index{1U}; index < headers.size(); ++index)
+			{
+				const auto &header{headers[index]};
+				object.kinds[index] = kindOf(header, elf.sectionNames().stringFromOffset(header.nameOffset()));
+				if (header.flags().includes(SectionFlag::linkOrder) && header.link() < headers.size())
+					object.linkedTo[index] = header.link();
+				const auto type{header.type()};
+				const auto target{header.info()};
+				if ((type != SectionHeaderType::reloc && type != SectionHeaderType::relocAddend) ||
+					target >= headers.size() || !headers[target].flags().includes(SectionFlag::allocate))
+					continue;
+				auto &entries{object.relocations[target]};
+				if (type == SectionHeaderType::relocAddend)
+				{
+					if (elf32Bit)
+						decodeRelocations<elf32::RelaRecord>(elf, index, entries);
+					else
+						decodeRelocations<elf64::RelaRecord>(elf, index, entries);
+				}
+				else if (elf32Bit)
+					decodeRelocations<elf32::RelRecord>(elf, index, entries);
+				else
+					decodeRelocations<elf64::RelRecord>(elf, index, entries);
+			}
+		}
+
+		/**
+		 * Discards the allocated sections that nothing reachable from the entry point, the exported symbols
+		 * or a retained section refers to, then folds read-only sections with identical contents and
+		 * relocations into one another. Both are linear in the number of sections and relocations:
+		 * collection is a single walk of the section graph, and folding hashes each candidate once,
+		 * comparing candidates in full only when their hashes match. Folding takes a single pass, so
+		 * sections that only differ in referring to each other, like mutually recursive functions, stay.
+		 */
+		void reduceSections(std::vector<InputObject> &objects, const std::vector<Shard> &shards,
+			const LinkOptions &options, const size_t workers, LinkResult &result)
+		{
+			parallelFor(objects.size(), workers, [&](const size_t index, const size_t)
+				{ prepareObject(objects[index]); });
+
+			// Number every section of every object, so the graph can be kept in flat arrays indexed by node
+			std::vector<size_t> nodeBase(objects.size() + 1U);
+			for (size_t index{}; index < objects.size(); ++index)
+				nodeBase[index + 1U] = nodeBase[index] + objects[index].kinds.size();
+			const auto nodeCount{nodeBase.back()};
+			std::vector<size_t> nodeObject(nodeCount);
+			for (size_t index{}; index < objects.size(); ++index)
+			{
+				for (auto node{nodeBase[index]}; node < nodeBase[index + 1U]; ++node)
+					nodeObject[node] = index;
+			}
+			const auto sectionOf{[&](const size_t node) noexcept { return node - nodeBase[nodeObject[node]]; }};
+			const auto kindOfNode{[&](const size_t node) noexcept
+				{ return objects[nodeObject[node]].kinds[sectionOf(node)]; }};
+
+			// Resolve what every symbol refers to up front, once, rather than per relocation
+			std::vector<std::vector<Target>> targets(objects.size());
+			parallelFor(objects.size(), workers, [&](const size_t objectIndex, const size_t)
+			{
+				const auto &symbols{objects[objectIndex].symbols};
+				auto &objectTargets{targets[objectIndex]};
+				objectTargets.reserve(symbols.size());
+				for (const auto &symbol : symbols)
+				{
+					auto owner{objectIndex};
+					const auto *definition{&symbol};
+					if (symbol.binding != localBinding)
+					{
+						if (const auto global{lookup(shards, symbol.name)})
+						{
+							owner = global->object;
+							definition = &objects[owner].symbols[global->symbol];
+						}
+					}
+					if (definition->section == absoluteIndex)
+						objectTargets.push_back({nodeCount, definition->value});
+					else if (definition->section == undefinedIndex || definition->section >= objects[owner].kinds.size())
+						objectTargets.push_back({noSection, 0U});
+					else
+						objectTargets.push_back({nodeBase[owner] + definition->section, definition->value});
+				}
+			});
+
+			// Sections ordered after another (SHF_LINK_ORDER), such as ARM unwind tables, live and die with it
+			std::vector<size_t> firstDependent(nodeCount, noSection);
+			std::vector<size_t> nextDependent(nodeCount, noSection);
+			for (size_t node{}; node < nodeCount; ++node)
+			{
+				const auto objectIndex{nodeObject[node]};
+				const auto parent{objects[objectIndex].linkedTo[sectionOf(node)]};
+				if (parent == noSection)
+					continue;
+				nextDependent[node] = firstDependent[nodeBase[objectIndex] + parent];
+				firstDependent[nodeBase[objectIndex] + parent] = node;
+			}
+
+			std::vector<uint8_t> live(nodeCount);
+			if (options.collectGarbage)
+			{
+				std::vector<size_t> worklist{};
+				const auto mark{[&](const size_t node)
+				{
+					if (node >= nodeCount || live[node] || kindOfNode(node) == SectionKind::unallocated)
+						return;
+					live[node] = 1U;
+					worklist.push_back(node);
+				}};
+				for (size_t node{}; node < nodeCount; ++node)
+				{
+					const auto kind{kindOfNode(node)};
+					if (kind == SectionKind::retained || kind == SectionKind::opaque)
+						mark(node);
+				}
+				// A missing entry point is reported once the link gets that far
+				if (const auto entry{lookup(shards, options.entry)})
+					mark(targets[entry->object][entry->symbol].node);
+				for (const auto &name : options.exports)
+				{
+					if (const auto definition{lookup(shards, name)})
+						mark(targets[definition->object][definition->symbol].node);
+					else
+						result.errors.emplace_back(fmt::format("exported symbol '{}' is not defined"sv, name));
+				}
+				while (!worklist.empty())
+				{
+					const auto node{worklist.back()};
+					worklist.pop_back();
+					for (auto dependent{firstDependent[node]}; dependent != noSection; dependent = nextDependent[dependent])
+						mark(dependent);
+					if (kindOfNode(node) == SectionKind::opaque)
+						continue;
+					const auto objectIndex{nodeObject[node]};
+					const auto &objectTargets{targets[objectIndex]};
+					for (const auto &relocation : objects[objectIndex].relocations[sectionOf(node)])
+					{
+						if (relocation.symbol < objectTargets.size())
+							mark(objectTargets[relocation.symbol].node);
+					}
+				}
+			}
+			else
+			{
+				for (size_t node{}; node < nodeCount; ++node)
+					live[node] = kindOfNode(node) != SectionKind::unallocated;
+			}
+
+			std::vector<size_t> foldedInto(nodeCount, noSection);
+			if (options.foldIdentical)
+			{
+				const auto headerOf{[&](const size_t node) -> const SectionHeader &
+					{ return objects[nodeObject[node]].elf->sectionHeaders()[sectionOf(node)]; }};
+				const auto nameOf{[&](const size_t node)
+				{
+					const auto &elf{*objects[nodeObject[node]].elf};
+					return outputNameFor(elf.sectionNames().stringFromOffset(headerOf(node).nameOffset()));
+				}};
+				const auto contentsOf{[&](const size_t node)
+				{
+					const auto data{objects[nodeObject[node]].elf->sectionData(sectionOf(node))};
+					return std::string_view{reinterpret_cast<const char *>(data.data()), data.length()};
+				}};
+
+				// Only read-only data and code that nothing else is ordered after can be folded
+				std::vector<size_t> candidates{};
+				for (size_t node{}; node < nodeCount; ++node)
+				{
+					if (!live[node] || kindOfNode(node) != SectionKind::ordinary || firstDependent[node] != noSection ||
+						objects[nodeObject[node]].linkedTo[sectionOf(node)] != noSection)
+						continue;
+					const auto &header{headerOf(node)};
+					if (header.type() == SectionHeaderType::program && header.fileLength() &&
+						!header.flags().includes(SectionFlag::writeable))
+						candidates.push_back(node);
+				}
+
+				std::vector<uint64_t> hashes(candidates.size());
+				parallelFor(candidates.size(), workers, [&](const size_t index, const size_t)
+				{
+					const auto node{candidates[index]};
+					const auto &header{headerOf(node)};
+					uint64_t hash{std::hash<std::string_view>{}(contentsOf(node))};
+					const auto mix{[&](const uint64_t value) noexcept { hash = (hash ^ value) * 0x100000001b3U; }};
+					mix(std::hash<std::string_view>{}(nameOf(node)));
+					mix(header.flags().toRaw());
+					mix(header.alignment());
+					// Symbol indices are local to each object, so only what they resolve to can be hashed, or
+					// twins from different objects would never share a bucket
+					const auto &objectTargets{targets[nodeObject[node]]};
+					for (const auto &relocation : objects[nodeObject[node]].relocations[sectionOf(node)])
+					{
+						mix(relocation.offset);
+						mix(relocation.type);
+						mix(static_cast<uint64_t>(relocation.addend));
+						if (relocation.symbol < objectTargets.size())
+						{
+							mix(objectTargets[relocation.symbol].node);
+							mix(objectTargets[relocation.symbol].value);
+						}
+					}
+					hashes[index] = hash;
+				});
+
+				const auto identical{[&](const size_t a, const size_t b)
+				{
+					const auto &headerA{headerOf(a)};
+					const auto &headerB{headerOf(b)};
+					const auto &relocationsA{objects[nodeObject[a]].relocations[sectionOf(a)]};
+					const auto &relocationsB{objects[nodeObject[b]].relocations[sectionOf(b)]};
+					if (headerA.flags() != headerB.flags() || headerA.alignment() != headerB.alignment() ||
+						relocationsA.size() != relocationsB.size() || nameOf(a) != nameOf(b) ||
+						contentsOf(a) != contentsOf(b))
+						return false;
+					const auto &targetsA{targets[nodeObject[a]]};
+					const auto &targetsB{targets[nodeObject[b]]};
+					for (size_t index{}; index < relocationsA.size(); ++index)
+					{
+						const auto &relocationA{relocationsA[index]};
+						const auto &relocationB{relocationsB[index]};
+						if (relocationA.offset != relocationB.offset || relocationA.type != relocationB.type ||
+							relocationA.addend != relocationB.addend || relocationA.symbol >= targetsA.size() ||
+							relocationB.symbol >= targetsB.size() ||
+							!(targetsA[relocationA.symbol] == targetsB[relocationB.symbol]))
+							return false;
+					}
+					return true;
+				}};
+
+				// The first of each set of identical sections, in input order, is the one kept
+				std::unordered_map<uint64_t, std::vector<size_t>> representatives{};
+				for (size_t index{}; index < candidates.size(); ++index)
+				{
+					auto &bucket{representatives[hashes[index]]};
+					const auto node{candidates[index]};
+					const auto match{std::find_if(bucket.begin(), bucket.end(),
+						[&](const size_t representative) { return identical(representative, node); })};
+					if (match == bucket.end())
+						bucket.push_back(node);
+					else
+						foldedInto[node] = *match;
+				}
+			}
+
+			// Record the outcome against each object, and the space saved against each output section
+			std::unordered_map<std::string_view, size_t> savings{};
+			for (size_t node{}; node < nodeCount; ++node)
+			{
+				if (kindOfNode(node) == SectionKind::unallocated || (live[node] && foldedInto[node] == noSection))
+					continue;
+				auto &object{objects[nodeObject[node]]};
+				const auto section{sectionOf(node)};
+				const auto &header{object.elf->sectionHeaders()[section]};
+				if (!live[node])
+					object.discarded[section] = 1U;
+				else
+					object.foldedInto[section] = {nodeObject[foldedInto[node]], sectionOf(foldedInto[node])};
+				// The empty sections compilers emit by default aren't worth reporting
+				const auto length{header.fileLength()};
+				if (!length)
+					continue;
+				const auto name{outputNameFor(object.elf->sectionNames().stringFromOffset(header.nameOffset()))};
+				const auto [entry, inserted]{savings.try_emplace(name, result.savings.size())};
+				if (inserted)
+					result.savings.push_back({std::string{name}});
+				auto &saving{result.savings[entry->second]};
+				(live[node] ? saving.folded : saving.collected) += length;
+			}
+		}
+
+		// Gathers every allocated section of every object into output sections by name
+		void collectSections(std::vector<InputObject> &objects, std::vector<InputSection> &inputs,
+			std::vector<OutputSection> &outputs)
+		{
+			std::unordered_map<std::string_view, size_t> outputIndices{};
+			for (size_t objectIndex{}; objectIndex < objects.size(); ++objectIndex)
+			{
+				auto &object{objects[objectIndex]};
+				const auto &elf{*object.elf};
+				const auto &headers{elf.sectionHeaders()};
+				object.sections.assign(headers.size(), noSection);
+				for (size_t index{1U}; index < headers.size(); ++index)
+				{
+					const auto &header{headers[index]};
+					const auto flags{header.flags()};
+					if (!flags.includes(SectionFlag::allocate) || (!object.discarded.empty() &&
+						(object.discarded[index] || object.foldedInto[index].object != noSection)))
+						continue;
+					const auto name{elf.sectionNames().stringFromOffset(header.nameOffset())};
+					if (flags.includes(SectionFlag::tls))
+					{
+						object.errors.emplace_back(fmt::format("{}: section {} is thread-local, which is not supported"sv,
+							object.file.string(), name));
+						continue;
+					}
+					const auto [entry, inserted]{outputIndices.try_emplace(outputNameFor(name), outputs.size())};
+					if (inserted)
+						outputs.push_back({entry->first, header.type(), flags});
+					auto &output{outputs[entry->second]};
+					// An output only takes no space in the file if none of what went into it does
+					if (header.type() != SectionHeaderType::bss)
+						output.type = header.type() == output.type || output.type == SectionHeaderType::bss ?
+							header.type() : SectionHeaderType::program;
+					output.flags = Flags<SectionFlag>{static_cast<uint64_t>(output.flags.toRaw() | flags.toRaw())};
+					const auto alignment{std::max<uint64_t>(header.alignment(), 1U)};
+					output.alignment = std::max(output.alignment, alignment);
+					object.sections[index] = inputs.size();
+					output.inputs.push_back(inputs.size());
+					inputs.push_back({objectIndex, index, entry->second, header.fileLength(), alignment});
+				}
+				// A folded section takes the place of the one it was folded into, which always comes before it
+				for (size_t index{}; index < object.foldedInto.size(); ++index)
+				{
+					const auto &folded{object.foldedInto[index]};
+					if (folded.object != noSection)
+						object.sections[index] = objects[folded.object].sections[folded.section];
+				}
+			}
+			for (auto &output : outputs)
+			{
+				for (const auto input : output.inputs)
+				{
+					auto &section{inputs[input]};
+					output.length = alignTo(output.length, section.alignment);
+					section.offset = output.length;
+					output.length += section.length;
+				}
+			}
+		}
+
+		/**
+		 * Places the output sections, giving them their addresses and file offsets. The first segment holds
+		 * the headers, code and read-only data, the second data and .bss, starting on a fresh page in both
+		 * the file and memory so the two can be mapped with different permissions.
+		 */
+		[[nodiscard]] Layout layOut(std::vector<OutputSection> &outputs, const uint64_t baseAddress,
+			const uint64_t headerSize, const uint64_t programHeaderSize, const uint64_t sectionHeaderSize)
+		{
+			Layout layout{};
+			layout.order.resize(outputs.size());
+			for (size_t index{}; index < outputs.size(); ++index)
+				layout.order[index] = index;
+			std::stable_sort(layout.order.begin(), layout.order.end(),
+				[&](const size_t a, const size_t b) noexcept { return rankOf(outputs[a]) < rankOf(outputs[b]); });
+			const auto hasData{std::any_of(outputs.begin(), outputs.end(),
+				[](const OutputSection &section) noexcept { return rankOf(section) >= 2U; })};
+			const auto segmentCount{hasData ? 2U : 1U};
+
+			uint64_t offset{headerSize + (segmentCount * programHeaderSize)};
+			auto position{layout.order.begin()};
+			for (; position != layout.order.end() && rankOf(outputs[*position]) < 2U; ++position)
+			{
+				auto &section{outputs[*position]};
+				offset = alignTo(offset, section.alignment);
+				section.fileOffset = offset;
+				section.address = baseAddress + offset;
+				offset += section.length;
+			}
+			layout.segments.push_back({0U, baseAddress, offset, offset, readable | executable});
+
+			if (hasData)
+			{
+				offset = alignTo(offset, pageSize);
+				const auto dataOffset{offset};
+				for (; position != layout.order.end() && rankOf(outputs[*position]) == 2U; ++position)
+				{
+					auto &section{outputs[*position]};
+					offset = alignTo(offset, section.alignment);
+					section.fileOffset = offset;
+					section.address = baseAddress + offset;
+					offset += section.length;
+				}
+				auto address{baseAddress + offset};
+				for (; position != layout.order.end(); ++position)
+				{
+					auto &section{outputs[*position]};
+					address = alignTo(address, section.alignment);
+					section.fileOffset = offset;
+					section.address = address;
+					address += section.length;
+				}
+				layout.segments.push_back({dataOffset, baseAddress + dataOffset, offset - dataOffset,
+					address - (baseAddress + dataOffset), readable | writable});
+			}
+
+			for (const auto index : layout.order)
+				layout.nameOffsets.push_back(layout.names.add(outputs[index].name));
+			layout.namesName = layout.names.add(".shstrtab"sv);
+			layout.namesOffset = offset;
+			layout.shdrOffset = alignTo(offset + layout.names.length(), 8U);
+			layout.length = layout.shdrOffset + ((outputs.size() + 2U) * sectionHeaderSize);
+			return layout;
+		}
+
+		// Gives every symbol its final value: pass 1 does the ones each object defines, pass 2 resolves the rest
+		void assignValues(InputObject &object, const std::vector<InputSection> &inputs,
+			const std::vector<OutputSection> &outputs)
+		{
+			object.symbolValues.assign(object.symbols.size(), 0U);
+			for (size_t index{}; index < object.symbols.size(); ++index)
+			{
+				const auto &symbol{object.symbols[index]};
+				if (symbol.section == absoluteIndex)
+					object.symbolValues[index] = symbol.value;
+				else if (symbol.section != undefinedIndex && symbol.section < reservedIndices &&
+					symbol.section < object.sections.size() && object.sections[symbol.section] != noSection)
+				{
+					const auto &input{inputs[object.sections[symbol.section]]};
+					object.symbolValues[index] = outputs[input.output].address + input.offset + symbol.value;
+				}
+			}
+		}
+
+		void resolveValues(const size_t objectIndex, std::vector<InputObject> &objects, const std::vector<Shard> &shards)
+		{
+			auto &object{objects[objectIndex]};
+			for (size_t index{1U}; index < object.symbols.size(); ++index)
+			{
+				const auto &symbol{object.symbols[index]};
+				if (symbol.binding == localBinding)
+					continue;
+				const auto definition{lookup(shards, symbol.name)};
+				if (definition)
+				{
+					// The definition chosen is never itself rewritten here, so may safely be read from any thread
+					if (definition->object != objectIndex || definition->symbol != index)
+						object.symbolValues[index] = objects[definition->object].symbolValues[definition->symbol];
+				}
+				else if (symbol.section == undefinedIndex && symbol.binding != weakBinding)
+					object.errors.emplace_back(fmt::format("{}: undefined reference to '{}'"sv,
+						object.file.string(), symbol.name));
+			}
+		}
+
+		template<typename ELFHeaderT, typename ProgramHeaderT, typename SectionHeaderT> void writeHeaders(
+			const span<uint8_t> &image, const Layout &layout, const std::vector<OutputSection> &outputs,
+			const ELF &first, const uint64_t entry)
+		{
+			const Memory storage{image};
+			const auto endian{first.header().endian()};
+			ELFHeaderT header{storage};
+			using Word = decltype(header.entryPoint());
+			header.magic(elfMagic);
+			header.elfClass(first.header().elfClass());
+			header.endian(endian);
+			header.ELFIdent::version(IdentVersion::current);
+			header.abi(ABI::systemV);
+			header.type(Type::executable);
+			header.machine(first.header().machine());
+			header.version(Version::current);
+			header.entryPoint(static_cast<Word>(entry));
+			header.phdrOffset(static_cast<Word>(ELFHeaderT::size()));
+			header.shdrOffset(static_cast<Word>(layout.shdrOffset));
+			// Processor flags, such as ARM's EABI version, carry over from the objects
+			header.flags(first.header().flags());
+			header.headerSize(static_cast<uint16_t>(ELFHeaderT::size()));
+			header.programHeaderSize(static_cast<uint16_t>(ProgramHeaderT::size()));
+			header.programHeaderCount(static_cast<uint16_t>(layout.segments.size()));
+			header.sectionHeaderSize(static_cast<uint16_t>(SectionHeaderT::size()));
+			header.sectionHeaderCount(static_cast<uint16_t>(layout.order.size() + 2U));
+			header.sectionNamesIndex(static_cast<uint16_t>(layout.order.size() + 1U));
+
+			for (size_t index{}; index < layout.segments.size(); ++index)
+			{
+				const auto &segment{layout.segments[index]};
+				const ProgramHeaderT programHeader{image.subspan(ELFHeaderT::size() + (index * ProgramHeaderT::size()),
+					ProgramHeaderT::size()), endian};
+				programHeader.type(ProgramHeaderType::load);
+				programHeader.flags(segment.flags);
+				programHeader.offset(static_cast<Word>(segment.offset));
+				programHeader.virtualAddress(static_cast<Word>(segment.address));
+				programHeader.physicalAddress(static_cast<Word>(segment.address));
+				programHeader.fileLength(static_cast<Word>(segment.fileLength));
+				programHeader.memoryLength(static_cast<Word>(segment.memoryLength));
+				programHeader.alignment(static_cast<Word>(pageSize));
+			}
+
+			// Section 0 is the null section, left as zeros
+			const auto sectionHeader{[&](const size_t index)
+			{
+				return SectionHeaderT{image.subspan(layout.shdrOffset + (index * SectionHeaderT::size()),
+					SectionHeaderT::size()), endian};
+			}};
+			for (size_t index{}; index < layout.order.size(); ++index)
+			{
+				const auto &section{outputs[layout.order[index]]};
+				const auto shdr{sectionHeader(index + 1U)};
+				shdr.nameOffset(layout.nameOffsets[index]);
+				shdr.type(section.type);
+				shdr.flags(section.flags);
+				shdr.address(static_cast<Word>(section.address));
+				shdr.fileOffset(static_cast<Word>(section.fileOffset));
+				shdr.fileLength(static_cast<Word>(section.length));
+				shdr.alignment(static_cast<Word>(section.alignment));
+			}
+			const auto names{sectionHeader(layout.order.size() + 1U)};
+			names.nameOffset(layout.namesName);
+			names.type(SectionHeaderType::stringTable);
+			names.fileOffset(static_cast<Word>(layout.namesOffset));
+			names.fileLength(static_cast<Word>(layout.names.length()));
+			names.alignment(1U);
+		}
+
+		void collectErrors(std::vector<InputObject> &objects, LinkResult &result)
+		{
+			for (auto &object : objects)
+			{
+				for (auto &error : object.errors)
+					result.errors.emplace_back(std::move(error));
+				object.errors.clear();
+			}
+		}
+	} // namespace
+
+	LinkResult link(const std::vector<path> &files, const LinkOptions &options)
+	{
+		const ScopedTimer linkTimer{"link"sv};
+		const auto workers{options.workers ? options.workers : std::max(std::thread::hardware_concurrency(), 1U)};
+		LinkResult result{};
+		result.objects = files.size();
+		if (files.empty())
+		{
+			result.errors.emplace_back("no input files"sv);
+			return result;
+		}
+
+		// Archive members are read in place, so the archives must outlive the objects taken from them
+		std::vector<std::optional<Archive>> archives(files.size());
+		std::vector<InputObject> objects(files.size());
+		{
+			const ScopedTimer timer{"link::load"sv};
+			parallelFor(files.size(), workers, [&](const size_t index, const size_t)
+			{
+				objects[index].file = files[index];
+				loadInput(objects[index], archives[index]);
+			});
+		}
+		collectErrors(objects, result);
+		if (!result.success())
+			return result;
+		// An archive isn't linked itself, only searched for members to link
+		objects.erase(std::remove_if(objects.begin(), objects.end(),
+			[](const InputObject &object) { return !object.elf; }), objects.end());
+		if (std::any_of(archives.begin(), archives.end(), [](const auto &archive) { return archive.has_value(); }))
+		{
+			const ScopedTimer timer{"link::archives"sv};
+			pullMembers(objects, files, archives, workers);
+			collectErrors(objects, result);
+			if (!result.success())
+				return result;
+		}
+		result.objects = objects.size();
+		if (objects.empty())
+		{
+			result.errors.emplace_back("no objects to link"sv);
+			return result;
+		}
+
+		const auto &first{*objects.front().elf};
+		const auto elfClass{first.header().elfClass()};
+		const auto endian{first.header().endian()};
+		const auto machine{first.header().machine()};
+		for (const auto &object : objects)
+		{
+			const auto &header{object.elf->header()};
+			if (header.elfClass() != elfClass || header.endian() != endian || header.machine() != machine)
+				result.errors.emplace_back(fmt::format("{}: class, endian or machine differs from {}"sv,
+					object.file.string(), objects.front().file.string()));
+		}
+		if (!Relocator{machine, endian}.supported())
+			result.errors.emplace_back(fmt::format("{}: linking for this machine is not supported"sv,
+				objects.front().file.string()));
+		if (!result.success())
+			return result;
+
+		std::vector<Shard> shards(shardCount);
+		{
+			const ScopedTimer timer{"link::resolve"sv};
+			std::vector<std::vector<std::string>> shardErrors(shardCount);
+			parallelFor(shardCount, workers, [&](const size_t shard, const size_t)
+				{ resolveShard(objects, shard, shards[shard], shardErrors[shard]); });
+			for (auto &errors : shardErrors)
+				std::move(errors.begin(), errors.end(), std::back_inserter(result.errors));
+			for (const auto &shard : shards)
+				result.symbols += shard.size();
+		}
+
+		if (options.collectGarbage || options.foldIdentical)
+		{
+			const ScopedTimer timer{"link::reduce"sv};
+			reduceSections(objects, shards, options, workers, result);
+		}
+
+		std::vector<InputSection> inputs{};
+		std::vector<OutputSection> outputs{};
+		collectSections(objects, inputs, outputs);
+		result.sections = outputs.size();
+		const auto elf32Bit{elfClass == Class::elf32Bit};
+		const auto layout{layOut(outputs, options.baseAddress,
+			elf32Bit ? elf32::ELFHeader::size() : elf64::ELFHeader::size(),
+			elf32Bit ? elf32::ProgramHeader::size() : elf64::ProgramHeader::size(),
+			elf32Bit ? elf32::SectionHeader::size() : elf64::SectionHeader::size())};
+		result.outputLength = layout.length;
+		const auto &lastSegment{layout.segments.back()};
+		if (elf32Bit && lastSegment.address + lastSegment.memoryLength > std::numeric_limits<uint32_t>::max())
+			result.errors.emplace_back("output does not fit in a 32-bit address space"sv);
+
+		{
+			const ScopedTimer timer{"link::symbols"sv};
+			parallelFor(objects.size(), workers, [&](const size_t index, const size_t)
+				{ assignValues(objects[index], inputs, outputs); });
+			parallelFor(objects.size(), workers, [&](const size_t index, const size_t)
+				{ resolveValues(index, objects, shards); });
+		}
+		collectErrors(objects, result);
+		const auto entry{lookup(shards, options.entry)};
+		if (!entry)
+			result.errors.emplace_back(fmt::format("entry symbol '{}' is not defined"sv, options.entry));
+		if (!result.success())
+			return result;
+
+		std::vector<RelocationTask> tasks{};
+		for (size_t objectIndex{}; objectIndex < objects.size(); ++objectIndex)
+		{
+			const auto &object{objects[objectIndex]};
+			const auto &headers{object.elf->sectionHeaders()};
+			for (size_t index{}; index < headers.size(); ++index)
+			{
+				const auto type{headers[index].type()};
+				const auto target{headers[index].info()};
+				// Relocations against sections we aren't linking, such as debug info, go with them, as do
+				// those against a section folded into another, which gets that section's relocations instead
+				if ((type != SectionHeaderType::reloc && type != SectionHeaderType::relocAddend) ||
+					target >= object.sections.size() || object.sections[target] == noSection ||
+					inputs[object.sections[target]].object != objectIndex || inputs[object.sections[target]].index != target)
+					continue;
+				if (!object.symbolTable || headers[index].link() != *object.symbolTable)
+				{
+					result.errors.emplace_back(fmt::format("{}: relocation section {} does not use the symbol table"sv,
+						object.file.string(), index));
+					continue;
+				}
+				tasks.push_back({objectIndex, index, object.sections[target]});
+				result.relocations += object.elf->relocationCount(index);
+			}
+		}
+		if (!result.success())
+			return result;
+
+		fd_t file{options.output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_NOCTTY, 0755};
+		if (!file.valid() || !file.resize(static_cast<off_t>(layout.length)))
+		{
+			result.errors.emplace_back(fmt::format("{}: could not create output file"sv, options.output.string()));
+			return result;
+		}
+		{
+			auto map{file.map(PROT_READ | PROT_WRITE)};
+			if (!map.valid())
+			{
+				result.errors.emplace_back(fmt::format("{}: could not map output file"sv, options.output.string()));
+				return result;
+			}
+			const span<uint8_t> image{map.address<uint8_t>(), map.length()};
+
+			{
+				const ScopedTimer timer{"link::copy"sv};
+				parallelFor(inputs.size(), workers, [&](const size_t index, const size_t)
+				{
+					const auto &input{inputs[index]};
+					const auto &output{outputs[input.output]};
+					if (output.type == SectionHeaderType::bss)
+						return;
+					const auto data{objects[input.object].elf->sectionData(input.index)};
+					std::memcpy(image.data() + output.fileOffset + input.offset, data.data(), data.length());
+				});
+			}
+
+			{
+				const ScopedTimer timer{"link::relocate"sv};
+				std::vector<Relocator> relocators(std::min(workers, std::max<size_t>(tasks.size(), 1U)),
+					Relocator{machine, endian});
+				parallelFor(tasks.size(), workers, [&](const size_t index, const size_t workerIndex)
+				{
+					auto &task{tasks[index]};
+					const auto &object{objects[task.object]};
+					const auto &input{inputs[task.target]};
+					const auto &output{outputs[input.output]};
+					if (output.type == SectionHeaderType::bss)
+						return;
+					const auto relocation{relocators[workerIndex].applySection(*object.elf, task.section,
+						image.subspan(output.fileOffset + input.offset, input.length), output.address + input.offset,
+						{object.symbolValues.data(), object.symbolValues.size()})};
+					if (!relocation.success())
+						task.error = fmt::format("{}: relocation {} of section {}: {}"sv, object.file.string(),
+							relocation.index, task.section, describe(relocation.error));
+				});
+				for (auto &task : tasks)
+				{
+					if (!task.error.empty())
+						result.errors.emplace_back(std::move(task.error));
+				}
+			}
+
+			const auto entryAddress{objects[entry->object].symbolValues[entry->symbol]};
+			if (elf32Bit)
+				writeHeaders<elf32::ELFHeader, elf32::ProgramHeader, elf32::SectionHeader>(image, layout, outputs,
+					first, entryAddress);
+			else
+				writeHeaders<elf64::ELFHeader, elf64::ProgramHeader, elf64::SectionHeader>(image, layout, outputs,
+					first, entryAddress);
+			const auto names{layout.names.storage()};
+			std::memcpy(image.data() + layout.namesOffset, names.data(), names.size());
+		}
+		if (!result.success())
+			std::filesystem::remove(options.output);
+		return result;
+	}
+} // namespace mangrove::link
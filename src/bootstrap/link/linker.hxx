@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef LINK_LINKER_HXX
+#define LINK_LINKER_HXX
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @file linker.hxx
+ * @brief A static linker combining relocatable ELF objects into a single executable
+ */
+
+namespace mangrove::link
+{
+	inline namespace internal
+	{
+		using std::filesystem::path;
+	} // namespace internal
+
+	struct LinkOptions final
+	{
+		path output{"a.out"};
+		// The symbol execution starts at
+		std::string entry{"_start"};
+		// Where the first segment - the ELF headers, code and read-only data - is loaded
+		uint64_t baseAddress{0x400000U};
+		// How many threads to link with, 0 picks one per hardware thread
+		size_t workers{0U};
+		// Drop allocated sections that nothing reachable from the entry point or exports refers to
+		bool collectGarbage{false};
+		// Fold read-only sections with identical contents and relocations into one
+		bool foldIdentical{false};
+		// Symbols kept, along with everything they refer to, even if the entry point doesn't reach them
+		std::vector<std::string> exports{};
+	};
+
+	// The space garbage collection and folding saved in one output section, in bytes
+	struct SectionSavings final
+	{
+		std::string name;
+		uint64_t collected{};
+		uint64_t folded{};
+	};
+
+	struct LinkResult final
+	{
+		// Every problem found, in input order - any at all and no output is written
+		std::vector<std::string> errors{};
+		// The objects linked, counting those pulled out of archives but not the archives themselves
+		size_t objects{};
+		size_t sections{};
+		size_t symbols{};
+		size_t relocations{};
+		uint64_t outputLength{};
+		// Filled in when collecting or folding sections, in order of each output section's first input
+		std::vector<SectionSavings> savings{};
+
+		[[nodiscard]] bool success() const noexcept { return errors.empty(); }
+	};
+
+	/**
+	 * Links relocatable ELF objects, along with the members they need of any static archives given, which
+	 * must all share a class, endian and machine the relocation engine supports, into a statically linked
+	 * executable at options.output. Each stage runs across the workers:
+	 *
+	 * - Objects are mapped and their symbol tables decoded in parallel, each object sorting its global
+	 *   definitions into shards by name hash. Archives are mapped and their symbol indices read, then the
+	 *   members defining anything left undefined are pulled in, by index lookup rather than a scan of the
+	 *   archive, and read in place.
+	 * - Each shard of the global symbol table is then built by its own worker from every object in input
+	 *   order, so resolution needs no locks and always picks the same definition whatever the thread count.
+	 * - When asked to, unreachable sections are discarded and identical read-only ones folded together,
+	 *   in time linear in the number of sections and relocations.
+	 * - Allocated sections are merged by name (.text.* into .text and so on) and laid out into a read/execute
+	 *   segment and a read/write one. The output file is sized up front and mapped, and every input section
+	 *   copied into place with its own memcpy().
+	 * - Finally, each input section's relocations are applied in place in the mapping in parallel.
+	 */
+	[[nodiscard]] LinkResult link(const std::vector<path> &objects, const LinkOptions &options);
+} // namespace mangrove::link
+
+#endif /*LINK_LINKER_HXX*/
@@ -1,10 +1,167 @@
 // SPDX-License-Identifier: BSD-3-Clause
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
 #include <substrate/console>
+#include <substrate/span>
+#include "parser/parser.hxx"
+#include "core/trace.hxx"
+#include "core/memory.hxx"
+#include "core/sourceLoader.hxx"
+#include "build/buildGraph.hxx"
 
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
 using substrate::console;
+using substrate::span;
+using mangrove::parser::Parser;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::Pipelining;
+using mangrove::core::loader::SourceLoader;
+using mangrove::core::loader::LoadedSource;
+using mangrove::build::BuildGraph;
+using mangrove::build::Module;
+namespace trace = mangrove::core::trace;
+namespace memory = mangrove::core::memory;
 
-int main(int, char **)
+constexpr static auto traceOption{"--trace="sv};
+constexpr static auto memReportOption{"--mem-report"sv};
+constexpr static auto lexerOption{"--lexer="sv};
+constexpr static auto pipelineOption{"--pipeline"sv};
+constexpr static auto jobsOption{"--jobs="sv};
+constexpr static auto incrementalOption{"--incremental="sv};
+
+int main(int argCount, char **argList)
 {
 	console = {stdout, stderr};
+	trace::nameThread("main"sv);
+
+	std::optional<path> traceFile{};
+	std::optional<path> buildCache{};
+	bool memReport{false};
+	// Unless a lexer is asked for, files are loaded in bulk and lexed from memory, which needs the table engine
+	std::optional<LexerEngine> lexerEngine{};
+	size_t jobs{0U};
+	auto pipelining{Pipelining::none};
+	std::vector<path> sourceFiles{};
+	const auto args{span{argList, static_cast<size_t>(argCount)}.subspan(1)};
+	for (const std::string_view arg : args)
+	{
+		if (arg.substr(0, traceOption.length()) == traceOption)
+			traceFile = arg.substr(traceOption.length());
+		else if (arg == memReportOption)
+			memReport = true;
+		else if (arg.substr(0, incrementalOption.length()) == incrementalOption)
+			buildCache = arg.substr(incrementalOption.length());
+		else if (arg == pipelineOption)
+			pipelining = Pipelining::threaded;
+		else if (arg.substr(0, jobsOption.length()) == jobsOption)
+		{
+			try
+				{ jobs = std::stoul(std::string{arg.substr(jobsOption.length())}); }
+			catch (const std::exception &)
+				{ jobs = 0U; }
+			if (!jobs)
+			{
+				console.error("Invalid job count "sv, arg.substr(jobsOption.length()));
+				return 1;
+			}
+		}
+		else if (arg.substr(0, lexerOption.length()) == lexerOption)
+		{
+			const auto engine{arg.substr(lexerOption.length())};
+			if (engine == "table"sv)
+				lexerEngine = LexerEngine::table;
+			else if (engine == "scalar"sv)
+				lexerEngine = LexerEngine::scalar;
+			else
+			{
+				console.error("Unknown lexer engine "sv, engine, ", expected one of 'scalar' or 'table'"sv);
+				return 1;
+			}
+		}
+		else
+			sourceFiles.emplace_back(arg);
+	}
+
+	if (buildCache)
+	{
+		// Only rebuild what changed since the last run with this cache, and whatever imports that
+		const SourceLoader loader{mangrove::core::loader::LoaderBackend::automatic, jobs};
+		BuildGraph graph{*buildCache, std::filesystem::current_path()};
+		graph.scan(sourceFiles, loader);
+		const auto result{graph.build([&](const Module &module)
+		{
+			try
+			{
+				Parser parser{module.fileName, lexerEngine.value_or(LexerEngine::table), pipelining};
+				return parser.parse();
+			}
+			catch (const std::exception &)
+			{
+				console.error("Failed to set up a parser for "sv, module.fileName.c_str());
+				return false;
+			}
+		}, loader.workers())};
+		if (!graph.save())
+			console.warning("Failed to write build cache "sv, buildCache->c_str());
+		if (!result.success())
+			return 1;
+	}
+	else if (lexerEngine && *lexerEngine == LexerEngine::scalar)
+	{
+		for (const auto &sourceFile : sourceFiles)
+		{
+			try
+			{
+				Parser parser{sourceFile, *lexerEngine, pipelining};
+				if (!parser.parse())
+					return 1;
+			}
+			catch (const std::exception &)
+			{
+				console.error("Failed to set up a parser for "sv, sourceFile.c_str());
+				return 1;
+			}
+		}
+	}
+	else
+	{
+		// Keep the disk busy loading files while the ones already loaded are parsed on the loader's workers
+		std::atomic<bool> failed{false};
+		const SourceLoader loader{mangrove::core::loader::LoaderBackend::automatic, jobs};
+		loader.load(sourceFiles, [&](LoadedSource &&source)
+		{
+			if (!source.valid())
+			{
+				console.error("Failed to read "sv, source.fileName.c_str(), ": "sv, std::strerror(source.error));
+				failed = true;
+				return;
+			}
+			try
+			{
+				Parser parser{source.fileName, std::move(source.buffer), pipelining};
+				if (!parser.parse())
+					failed = true;
+			}
+			catch (const std::exception &)
+			{
+				console.error("Failed to set up a parser for "sv, source.fileName.c_str());
+				failed = true;
+			}
+		});
+		if (failed)
+			return 1;
+	}
+
+	if (memReport)
+		memory::printReport();
+	if (traceFile && !trace::writeTrace(*traceFile))
+		return 1;
 	return 0;
 }
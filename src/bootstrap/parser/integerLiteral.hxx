@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_INTEGER_LITERAL_HXX
+#define PARSER_INTEGER_LITERAL_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <optional>
+#include <string_view>
+
+/**
+ * @file integerLiteral.hxx
+ * @brief SWAR (SIMD within a register) scanning and decoding of integer literal digits
+ *
+ * Digits are handled 8 at a time, loaded into a uint64_t with the first digit in the least significant
+ * byte regardless of host byte order. Classification works on the bytes in parallel using 7-bit
+ * arithmetic so no carry can cross from one byte into the next, and conversion folds adjacent lanes
+ * together (digit pairs, then pairs of pairs, and so on) in three multiply-add-mask steps.
+ */
+
+namespace mangrove::parser::integerLiteral
+{
+	constexpr inline uint64_t ones{UINT64_C(0x0101010101010101)};
+	constexpr inline uint64_t highBits{ones * 0x80U};
+	constexpr inline uint64_t zeroDigits{ones * '0'};
+
+	/** Loads 8 bytes of data, first byte least significant */
+	[[nodiscard]] inline uint64_t loadWord(const char *const data) noexcept
+	{
+		uint64_t word{};
+		std::memcpy(&word, data, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		word = __builtin_bswap64(word);
+#endif
+		return word;
+	}
+
+	/** Loads up to the first 8 bytes of text, first byte least significant, padding with 0 bytes (never a digit) */
+	[[nodiscard]] inline uint64_t load(const std::string_view text) noexcept
+	{
+		if (text.length() >= 8U)
+			return loadWord(text.data());
+		uint64_t word{};
+		for (size_t index{}; index < text.length(); ++index)
+			word |= uint64_t{static_cast<uint8_t>(text[index])} << (index * 8U);
+		return word;
+	}
+
+	/** Moves the first length digits of word to its top so they decode as the last digits of an 8 digit chunk */
+	[[nodiscard]] constexpr uint64_t alignDigits(const uint64_t word, const size_t length) noexcept
+	{
+		if (length >= 8U)
+			return word;
+		if (!length)
+			return zeroDigits;
+		const auto padding{(8U - length) * 8U};
+		return (word << padding) | (zeroDigits >> (64U - padding));
+	}
+
+	/** Sets the high bit of each byte of word that is an ASCII character in [lower, upper] */
+	[[nodiscard]] constexpr uint64_t inRange(const uint64_t word, const uint8_t lower, const uint8_t upper) noexcept
+	{
+		const auto low{word & ~highBits};
+		const auto atLeastLower{low + ones * (0x80U - lower)};
+		const auto aboveUpper{low + ones * (0x7fU - upper)};
+		return atLeastLower & ~aboveUpper & ~word & highBits;
+	}
+
+	template<uint64_t base> [[nodiscard]] constexpr uint64_t digitMask(const uint64_t word) noexcept
+	{
+		static_assert(base >= 2U && base <= 16U);
+		if constexpr (base > 10U)
+			return inRange(word, '0', '9') | inRange(word | ones * 0x20U, 'a', 'a' + base - 11U);
+		else
+			return inRange(word, '0', '0' + base - 1U);
+	}
+
+	/** Counts the digits of the given base at the start of text */
+	template<uint64_t base> [[nodiscard]] inline size_t countDigits(const std::string_view text) noexcept
+	{
+		size_t count{};
+		// A short final load is padded with non-digits, so this always terminates on a set bit
+		while (count < text.length())
+		{
+			const auto nonDigits{~digitMask<base>(load(text.substr(count))) & highBits};
+			if (nonDigits)
+				return count + static_cast<size_t>(__builtin_ctzll(nonDigits)) / 8U;
+			count += 8U;
+		}
+		return count;
+	}
+
+	/** Converts each ASCII digit byte of word to its value */
+	template<uint64_t base> [[nodiscard]] constexpr uint64_t digitValues(const uint64_t word) noexcept
+	{
+		// Letters have bit 6 set and a low nibble of 1 through 6, digits have it clear
+		if constexpr (base > 10U)
+			return (word & ones * 0x0fU) + ((word & ones * 0x40U) >> 6U) * 9U;
+		else
+			return word - zeroDigits;
+	}
+
+	/** Combines 8 digit values (most significant first) into the value they represent */
+	template<uint64_t base> [[nodiscard]] constexpr uint64_t combine(uint64_t digits) noexcept
+	{
+		digits = (digits * base + (digits >> 8U)) & UINT64_C(0x00ff00ff00ff00ff);
+		digits = (digits * (base * base) + (digits >> 16U)) & UINT64_C(0x0000ffff0000ffff);
+		return (digits * (base * base * base * base) + (digits >> 32U)) & UINT64_C(0x00000000ffffffff);
+	}
+
+	template<uint64_t base> constexpr inline auto powers
+	{
+		[]() noexcept
+		{
+			std::array<uint64_t, 9> result{};
+			result[0] = 1U;
+			for (size_t index{1U}; index < result.size(); ++index)
+				result[index] = result[index - 1U] * base;
+			return result;
+		}()
+	};
+
+	/**
+	 * Decodes a run of digits in the given base, which must all be valid, returning std::nullopt if
+	 * the value does not fit in 64 bits. The leading partial chunk is decoded first, padded out with
+	 * leading zero digits, so every chunk goes through the same 8 digit conversion.
+	 */
+	template<uint64_t base> [[nodiscard]] inline std::optional<uint64_t> decode(std::string_view digits) noexcept
+	{
+		uint64_t value{};
+		bool overflowed{false};
+		auto chunkLength{digits.length() % 8U ? digits.length() % 8U : 8U};
+		while (!digits.empty())
+		{
+			const auto chunk{combine<base>(digitValues<base>(alignDigits(load(digits.substr(0, chunkLength)), chunkLength)))};
+			uint64_t scaled{};
+			overflowed |= __builtin_mul_overflow(value, powers<base>[chunkLength], &scaled);
+			overflowed |= __builtin_add_overflow(scaled, chunk, &value);
+			digits.remove_prefix(chunkLength);
+			chunkLength = 8U;
+		}
+		if (overflowed)
+			return std::nullopt;
+		return value;
+	}
+
+	/** Digit-at-a-time counterpart to decode() for when the digits are not available as a contiguous run */
+	template<uint64_t base> struct Accumulator final
+	{
+	private:
+		uint64_t _value{};
+		size_t _digits{};
+		bool _overflowed{false};
+
+	public:
+		void push(const char digit) noexcept
+		{
+			const auto byte{static_cast<uint8_t>(digit)};
+			const auto digitValue{static_cast<uint64_t>(base > 10U ? (byte & 0x0fU) + (byte >> 6U) * 9U : byte - 0x30U)};
+			_overflowed |= __builtin_mul_overflow(_value, base, &_value);
+			_overflowed |= __builtin_add_overflow(_value, digitValue, &_value);
+			++_digits;
+		}
+
+		[[nodiscard]] bool empty() const noexcept { return !_digits; }
+
+		[[nodiscard]] std::optional<uint64_t> value() const noexcept
+		{
+			if (_overflowed)
+				return std::nullopt;
+			return _value;
+		}
+	};
+} // namespace mangrove::parser::integerLiteral
+
+#endif /*PARSER_INTEGER_LITERAL_HXX*/
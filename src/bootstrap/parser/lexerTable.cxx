@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <optional>
+#include <string_view>
+#include <utility>
+#include "tokeniser.hxx"
+#include "lexerTable.hxx"
+#include "integerLiteral.hxx"
+#include "stringLiteral.hxx"
+#include "../core/trace.hxx"
+
+using namespace mangrove::parser;
+using namespace mangrove::parser::types;
+using namespace mangrove::parser::recognisers;
+using namespace mangrove::parser::lexerTable;
+using namespace mangrove::parser::integerLiteral;
+using mangrove::parser::stringLiteral::plainRun;
+using mangrove::core::utf8::StringView;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+
+// Classifies the character at the start of text as an input symbol, returning it along with its length in bytes
+static inline std::pair<Symbol, size_t> classify(const std::string_view text) noexcept
+{
+	const auto byte{static_cast<uint8_t>(text[0])};
+	if (byte < 0x80U)
+		return {byte, 1U};
+	const Char chr{text};
+	// Invalid and overlong sequences are stepped over a byte at a time
+	if (!chr.valid() || chr.value() < 0x80U)
+		return {unicodeOther, 1U};
+	if (isAlpha(chr))
+		return {unicodeLetter, chr.length()};
+	if (isNormalAlpha(chr))
+		return {unicodeText, chr.length()};
+	return {unicodeOther, chr.length()};
+}
+
+static std::optional<Char> escapeFor(const char escape, const char quote) noexcept
+{
+	switch (escape)
+	{
+		case '\\':
+			return Char{'\\'};
+		case 'b':
+			return Char{8U};
+		case 'r':
+			return Char{13U};
+		case 'n':
+			return Char{10U};
+		case 't':
+			return Char{9U};
+		case 'v':
+			return Char{11U};
+		case 'f':
+			return Char{12U};
+		case 'a':
+			return Char{7U};
+		default:
+			if (escape == quote)
+				return Char{quote};
+			return std::nullopt;
+	}
+}
+
+namespace
+{
+	struct LiteralValue final
+	{
+		String value{};
+		// If a \u escape produced an invalid character, the offset just past its digits
+		std::optional<size_t> invalidAt{};
+	};
+} // namespace
+
+/*!
+ * Decodes the body of a string or character literal (text starting just after the opening quote).
+ * The automaton has already validated the structure of the literal, save for the code points
+ * \u escapes produce, so this only needs to stop at the first thing that could end the literal.
+ */
+static LiteralValue decodeLiteral(const std::string_view text, const char quote) noexcept
+{
+	LiteralValue result{};
+	size_t offset{};
+	while (offset < text.length() && text[offset] != quote)
+	{
+		if (text[offset] != '\\')
+		{
+			// Copy plain text through in bulk, leaving only what stops the run to be looked at character by character
+			if (const auto run{plainRun(text.substr(offset), quote)}; run.bytes)
+			{
+				result.value.append(StringView{text.substr(offset, run.bytes), run.chars});
+				offset += run.bytes;
+				continue;
+			}
+			const auto [symbol, length]{classify(text.substr(offset))};
+			// Anything but a normal character here means the literal was already invalid
+			if (symbol < ' ' || symbol == 0x7fU || symbol == unicodeOther)
+				break;
+			result.value += Char{text.substr(offset, length)};
+			offset += length;
+			continue;
+		}
+
+		if (++offset == text.length())
+			break;
+		const auto escape{text[offset++]};
+		if (escape == 'u' || escape == 'U')
+		{
+			// An escape with no digits decodes to NUL, and one too large to be a code point is invalid
+			const auto digits{text.substr(offset, countDigits<16U>(text.substr(offset)))};
+			const auto codePoint{decode<16U>(digits)};
+			offset += digits.length();
+			const Char chr{codePoint && *codePoint < Char::invalidCodePoint ?
+				static_cast<uint32_t>(*codePoint) : Char::invalidCodePoint};
+			if (!chr.valid())
+			{
+				result.invalidAt = offset;
+				break;
+			}
+			result.value += chr;
+		}
+		else if (const auto chr{escapeFor(escape, quote)}; chr)
+			result.value += *chr;
+		else
+			break;
+	}
+	return result;
+}
+
+// The value the scalar engine gives operator and punctuation tokens
+static std::string_view operatorValue(const TokenType type, const std::string_view text) noexcept
+{
+	switch (type)
+	{
+		case TokenType::mulOp:
+		case TokenType::addOp:
+		case TokenType::bitOp:
+		case TokenType::relOp:
+		case TokenType::shiftOp:
+		case TokenType::equOp:
+		case TokenType::assignOp:
+		case TokenType::invert:
+			return text;
+		// "++", "&&" and friends carry just the one character
+		case TokenType::incOp:
+		case TokenType::logicOp:
+			return text.substr(0, 1);
+		default:
+			return {};
+	}
+}
+
+template<uint64_t base> static size_t lexDigits(const std::string_view text, const size_t prefixLength,
+	const TokenType type, Token &token) noexcept
+{
+	const auto digits{text.substr(prefixLength, countDigits<base>(text.substr(prefixLength)))};
+	// A prefix with no digits after it is an invalid token, which the automaton already knows how to produce
+	if (digits.empty())
+		return 0U;
+	token.set(type);
+	token.integer(decode<base>(digits));
+	return prefixLength + digits.length();
+}
+
+/*!
+ * Fast path for integer literals (text starting with a digit): scans and decodes the digits a word at a
+ * time and never builds the literal's text. Returns the length of the literal, or 0 if it was not handled.
+ */
+static size_t lexInteger(const std::string_view text, Token &token) noexcept
+{
+	if (text[0] == '0' && text.length() > 1U)
+	{
+		switch (text[1] | 0x20)
+		{
+			case 'b':
+				return lexDigits<2U>(text, 2U, TokenType::binLit, token);
+			case 'c':
+				return lexDigits<8U>(text, 2U, TokenType::octLit, token);
+			case 'x':
+				return lexDigits<16U>(text, 2U, TokenType::hexLit, token);
+		}
+	}
+	return lexDigits<10U>(text, 0U, TokenType::intLit, token);
+}
+
+Token &Tokeniser::nextFromTable() noexcept
+{
+	const auto source{_text};
+	const auto begin{currentOffset};
+	if (begin >= source.length())
+	{
+		_target->set(TokenType::eof);
+		_target->spans(begin, begin);
+		return *_target;
+	}
+
+	if (source[begin] >= '0' && source[begin] <= '9')
+	{
+		if (const auto length{lexInteger(source.substr(begin), *_target)}; length)
+		{
+			_target->spans(begin, begin + length);
+			count(Counter::bytesRead, length);
+			currentOffset = begin + length;
+			return *_target;
+		}
+	}
+
+	// Run the automaton for as long as it has transitions, remembering the last accepting state (maximal munch)
+	const auto &table{automaton};
+	State state{startState};
+	State acceptState{deadState};
+	auto acceptEnd{begin};
+	auto offset{begin};
+	size_t firstLength{};
+	while (offset < source.length())
+	{
+		const auto [symbol, length]{classify(source.substr(offset))};
+		if (offset == begin)
+			firstLength = length;
+		state = table.next[state][symbol];
+		if (state == deadState)
+			break;
+		offset += length;
+		// The plain text of a string keeps the automaton where it is, so step over it without classifying it
+		if (state == stringState)
+			offset += plainRun(source.substr(offset), '"').bytes;
+		if (table.accepting[state])
+		{
+			acceptState = state;
+			acceptEnd = offset;
+		}
+	}
+
+	// If nothing matched, the token is a single invalid character
+	if (acceptState == deadState)
+	{
+		_target->set(TokenType::invalid);
+		acceptEnd = begin + firstLength;
+	}
+	else
+	{
+		const auto type{table.accept[acceptState]};
+		const auto text{source.substr(begin, acceptEnd - begin)};
+		switch (type)
+		{
+			case TokenType::ident:
+				classifyIdent(String{StringView{text}});
+				break;
+			case TokenType::comment:
+			{
+				// Strip the comment's introducer, and terminator if it's a terminated block comment
+				auto body{text.substr(text[0] == '#' ? 1U : 2U)};
+				if (acceptState == static_cast<State>(Named::blockEnd))
+					body.remove_suffix(2U);
+				_target->set(type, String{StringView{body}});
+				break;
+			}
+			case TokenType::invalid:
+			case TokenType::stringLit:
+			case TokenType::charLit:
+			{
+				_target->set(type);
+				if (text[0] != '"' && text[0] != '\'')
+					break;
+				auto literal{decodeLiteral(text.substr(1), text[0])};
+				if (literal.invalidAt)
+				{
+					// A \u escape that produces no valid character ends the literal one character past its digits
+					const auto digitsEnd{begin + 1U + *literal.invalidAt};
+					acceptEnd = digitsEnd < source.length() ? digitsEnd + classify(source.substr(digitsEnd)).second : digitsEnd;
+					_target->set(TokenType::invalid);
+				}
+				else if (type != TokenType::invalid)
+					_target->value(std::move(literal.value));
+				break;
+			}
+			default:
+				if (const auto value{operatorValue(type, text)}; value.empty())
+					_target->set(type);
+				else
+					_target->set(type, String{StringView{value}});
+		}
+	}
+
+	_target->spans(begin, acceptEnd);
+	count(Counter::bytesRead, acceptEnd - begin);
+	currentOffset = acceptEnd;
+	return *_target;
+}
@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_LEXER_TABLE_HXX
+#define PARSER_LEXER_TABLE_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string_view>
+#include "types.hxx"
+
+/**
+ * @file lexerTable.hxx
+ * @brief Compile-time generated DFA for the table-driven lexer engine
+ *
+ * The automaton is described declaratively below as three parts:
+ * - the fixed spellings of the operators and punctuation, which are built into a trie,
+ * - the spellings that lead into one of the literal or comment sub-automata, and
+ * - transition rules over ranges of input symbols for those sub-automata.
+ * These are compiled into a dense [state][symbol] transition table at compile time.
+ *
+ * Input symbols are ASCII bytes, which map to themselves, plus three classes for non-ASCII
+ * characters which the driver decodes and classifies before stepping the automaton.
+ */
+
+namespace mangrove::parser::lexerTable
+{
+	using namespace std::literals::string_view_literals;
+	using mangrove::parser::types::TokenType;
+
+	using State = uint8_t;
+	using Symbol = uint8_t;
+
+	// A non-ASCII character for which recognisers::isAlpha() holds
+	constexpr inline Symbol unicodeLetter{128U};
+	// Any other non-ASCII character that may appear in string and character literals
+	constexpr inline Symbol unicodeText{129U};
+	// An invalid or otherwise unacceptable character
+	constexpr inline Symbol unicodeOther{130U};
+	constexpr inline size_t symbolCount{131U};
+
+	// The states of the literal and comment sub-automata. The trie states follow on from these.
+	enum class Named : State
+	{
+		dead,
+		start,
+		ident,
+		zero,
+		decimal,
+		binPrefix,
+		binDigits,
+		octPrefix,
+		octDigits,
+		hexPrefix,
+		hexDigits,
+		lineComment,
+		blockComment,
+		blockStar,
+		blockEnd,
+		// Strings - the states after a bad character still need to consume one more character
+		string,
+		stringEscape,
+		stringHex,
+		stringEnd,
+		stringBad,
+		stringBadEnd,
+		// Character literals
+		charOpen,
+		charBody,
+		charEscape,
+		charHex,
+		charEnd,
+		charBad,
+		charBadEnd,
+		count,
+	};
+
+	struct Spelling final
+	{
+		std::string_view text;
+		TokenType type;
+	};
+
+	struct Entry final
+	{
+		std::string_view text;
+		Named state;
+	};
+
+	struct Accept final
+	{
+		Named state;
+		TokenType type;
+	};
+
+	struct Rule final
+	{
+		Named from;
+		Symbol first;
+		Symbol last;
+		Named to;
+		// When set, the row for `from` is overwritten with a copy of the row for `to`
+		bool copy;
+	};
+
+	[[nodiscard]] constexpr inline Spelling spell(const std::string_view text, const TokenType type) noexcept
+		{ return {text, type}; }
+	[[nodiscard]] constexpr inline Entry enter(const std::string_view text, const Named state) noexcept
+		{ return {text, state}; }
+	[[nodiscard]] constexpr inline Accept accept(const Named state, const TokenType type) noexcept
+		{ return {state, type}; }
+	[[nodiscard]] constexpr inline Rule on(const Named from, const Symbol first, const Symbol last, const Named to) noexcept
+		{ return {from, first, last, to, false}; }
+	[[nodiscard]] constexpr inline Rule on(const Named from, const char symbol, const Named to) noexcept
+		{ return {from, Symbol(symbol), Symbol(symbol), to, false}; }
+	[[nodiscard]] constexpr inline Rule on(const Named from, const char first, const char last, const Named to) noexcept
+		{ return {from, Symbol(first), Symbol(last), to, false}; }
+	[[nodiscard]] constexpr inline Rule onAny(const Named from, const Named to) noexcept
+		{ return {from, 0U, Symbol(symbolCount - 1U), to, false}; }
+	[[nodiscard]] constexpr inline Rule like(const Named state, const Named base) noexcept
+		{ return {state, 0U, 0U, base, true}; }
+
+	constexpr inline std::array spellings
+	{
+		spell(" "sv, TokenType::whitespace),
+		spell("\t"sv, TokenType::whitespace),
+		spell("\r"sv, TokenType::newline),
+		spell("\n"sv, TokenType::newline),
+		spell("."sv, TokenType::dot),
+		spell("..."sv, TokenType::ellipsis),
+		spell(";"sv, TokenType::semi),
+		spell("{"sv, TokenType::leftBrace),
+		spell("}"sv, TokenType::rightBrace),
+		spell("("sv, TokenType::leftParen),
+		spell(")"sv, TokenType::rightParen),
+		spell("["sv, TokenType::leftSquare),
+		spell("]"sv, TokenType::rightSquare),
+		spell(","sv, TokenType::comma),
+		spell(":"sv, TokenType::colon),
+		spell("~"sv, TokenType::invert),
+		spell("!"sv, TokenType::invert),
+		spell("/"sv, TokenType::mulOp),
+		spell("/="sv, TokenType::assignOp),
+		spell("*"sv, TokenType::mulOp),
+		spell("*="sv, TokenType::assignOp),
+		spell("%"sv, TokenType::mulOp),
+		spell("%="sv, TokenType::assignOp),
+		spell("+"sv, TokenType::addOp),
+		spell("+="sv, TokenType::assignOp),
+		spell("++"sv, TokenType::incOp),
+		spell("-"sv, TokenType::addOp),
+		spell("-="sv, TokenType::assignOp),
+		spell("--"sv, TokenType::incOp),
+		spell("->"sv, TokenType::arrow),
+		spell("&"sv, TokenType::bitOp),
+		spell("&="sv, TokenType::assignOp),
+		spell("&&"sv, TokenType::logicOp),
+		spell("|"sv, TokenType::bitOp),
+		spell("|="sv, TokenType::assignOp),
+		spell("||"sv, TokenType::logicOp),
+		spell("^"sv, TokenType::bitOp),
+		spell("^="sv, TokenType::assignOp),
+		spell("<"sv, TokenType::relOp),
+		spell("<="sv, TokenType::relOp),
+		spell("<<"sv, TokenType::shiftOp),
+		spell("<<="sv, TokenType::assignOp),
+		spell(">"sv, TokenType::relOp),
+		spell(">="sv, TokenType::relOp),
+		spell(">>"sv, TokenType::shiftOp),
+		spell(">>="sv, TokenType::assignOp),
+		spell("="sv, TokenType::assignOp),
+		spell("=="sv, TokenType::equOp),
+		spell("!="sv, TokenType::equOp),
+	};
+
+	constexpr inline std::array entries
+	{
+		enter("#"sv, Named::lineComment),
+		enter("//"sv, Named::lineComment),
+		enter("/*"sv, Named::blockComment),
+		enter("\""sv, Named::string),
+		enter("'"sv, Named::charOpen),
+		enter("0"sv, Named::zero),
+	};
+
+	// Literals that stop short of their closing quote are invalid, as are integer prefixes with no digits
+	constexpr inline std::array accepts
+	{
+		accept(Named::ident, TokenType::ident),
+		accept(Named::zero, TokenType::intLit),
+		accept(Named::decimal, TokenType::intLit),
+		accept(Named::binPrefix, TokenType::invalid),
+		accept(Named::binDigits, TokenType::binLit),
+		accept(Named::octPrefix, TokenType::invalid),
+		accept(Named::octDigits, TokenType::octLit),
+		accept(Named::hexPrefix, TokenType::invalid),
+		accept(Named::hexDigits, TokenType::hexLit),
+		accept(Named::lineComment, TokenType::comment),
+		accept(Named::blockComment, TokenType::comment),
+		accept(Named::blockStar, TokenType::comment),
+		accept(Named::blockEnd, TokenType::comment),
+		accept(Named::string, TokenType::invalid),
+		accept(Named::stringEscape, TokenType::invalid),
+		accept(Named::stringHex, TokenType::invalid),
+		accept(Named::stringEnd, TokenType::stringLit),
+		accept(Named::stringBad, TokenType::invalid),
+		accept(Named::stringBadEnd, TokenType::invalid),
+		accept(Named::charOpen, TokenType::invalid),
+		accept(Named::charBody, TokenType::invalid),
+		accept(Named::charEscape, TokenType::invalid),
+		accept(Named::charHex, TokenType::invalid),
+		accept(Named::charEnd, TokenType::charLit),
+		accept(Named::charBad, TokenType::invalid),
+		accept(Named::charBadEnd, TokenType::invalid),
+	};
+
+	// Rules are applied in order, so later rules override earlier ones for the same symbols
+	constexpr inline std::array rules
+	{
+		// Identifiers and integers
+		on(Named::start, 'a', 'z', Named::ident),
+		on(Named::start, 'A', 'Z', Named::ident),
+		on(Named::start, '_', Named::ident),
+		on(Named::start, unicodeLetter, unicodeLetter, Named::ident),
+		on(Named::start, '1', '9', Named::decimal),
+		on(Named::ident, 'a', 'z', Named::ident),
+		on(Named::ident, 'A', 'Z', Named::ident),
+		on(Named::ident, '0', '9', Named::ident),
+		on(Named::ident, '_', Named::ident),
+		on(Named::ident, unicodeLetter, unicodeLetter, Named::ident),
+		on(Named::zero, '0', '9', Named::decimal),
+		on(Named::zero, 'b', Named::binPrefix),
+		on(Named::zero, 'B', Named::binPrefix),
+		on(Named::zero, 'c', Named::octPrefix),
+		on(Named::zero, 'C', Named::octPrefix),
+		on(Named::zero, 'x', Named::hexPrefix),
+		on(Named::zero, 'X', Named::hexPrefix),
+		on(Named::decimal, '0', '9', Named::decimal),
+		on(Named::binPrefix, '0', '1', Named::binDigits),
+		like(Named::binDigits, Named::binPrefix),
+		on(Named::octPrefix, '0', '7', Named::octDigits),
+		like(Named::octDigits, Named::octPrefix),
+		on(Named::hexPrefix, '0', '9', Named::hexDigits),
+		on(Named::hexPrefix, 'a', 'f', Named::hexDigits),
+		on(Named::hexPrefix, 'A', 'F', Named::hexDigits),
+		like(Named::hexDigits, Named::hexPrefix),
+		// Comments - line comments stop short of the newline, block comments run to their terminator or EOF
+		onAny(Named::lineComment, Named::lineComment),
+		on(Named::lineComment, '\r', Named::dead),
+		on(Named::lineComment, '\n', Named::dead),
+		onAny(Named::blockComment, Named::blockComment),
+		on(Named::blockComment, '*', Named::blockStar),
+		like(Named::blockStar, Named::blockComment),
+		on(Named::blockStar, '/', Named::blockEnd),
+		// Strings - a bad character invalidates the literal, which then swallows one more character
+		onAny(Named::string, Named::stringBad),
+		on(Named::string, ' ', '~', Named::string),
+		on(Named::string, unicodeLetter, unicodeText, Named::string),
+		on(Named::string, '"', Named::stringEnd),
+		on(Named::string, '\\', Named::stringEscape),
+		onAny(Named::stringEscape, Named::stringBad),
+		on(Named::stringEscape, '\\', Named::string),
+		on(Named::stringEscape, '"', Named::string),
+		on(Named::stringEscape, 'a', 'b', Named::string),
+		on(Named::stringEscape, 'f', Named::string),
+		on(Named::stringEscape, 'n', Named::string),
+		on(Named::stringEscape, 'r', Named::string),
+		on(Named::stringEscape, 't', Named::string),
+		on(Named::stringEscape, 'v', Named::string),
+		on(Named::stringEscape, 'u', Named::stringHex),
+		on(Named::stringEscape, 'U', Named::stringHex),
+		// After a \u escape's hex digits, the string continues as normal
+		like(Named::stringHex, Named::string),
+		on(Named::stringHex, '0', '9', Named::stringHex),
+		on(Named::stringHex, 'a', 'f', Named::stringHex),
+		on(Named::stringHex, 'A', 'F', Named::stringHex),
+		onAny(Named::stringBad, Named::stringBadEnd),
+		// Character literals - as strings, but with the roles of the two quote characters swapped
+		onAny(Named::charOpen, Named::charBad),
+		on(Named::charOpen, ' ', '~', Named::charBody),
+		on(Named::charOpen, unicodeLetter, unicodeText, Named::charBody),
+		on(Named::charOpen, '\'', Named::charBadEnd),
+		on(Named::charOpen, '\\', Named::charEscape),
+		onAny(Named::charEscape, Named::charBad),
+		on(Named::charEscape, '\\', Named::charBody),
+		on(Named::charEscape, '\'', Named::charBody),
+		on(Named::charEscape, 'a', 'b', Named::charBody),
+		on(Named::charEscape, 'f', Named::charBody),
+		on(Named::charEscape, 'n', Named::charBody),
+		on(Named::charEscape, 'r', Named::charBody),
+		on(Named::charEscape, 't', Named::charBody),
+		on(Named::charEscape, 'v', Named::charBody),
+		on(Named::charEscape, 'u', Named::charHex),
+		on(Named::charEscape, 'U', Named::charHex),
+		onAny(Named::charBody, Named::charBadEnd),
+		on(Named::charBody, '\'', Named::charEnd),
+		like(Named::charHex, Named::charBody),
+		on(Named::charHex, '0', '9', Named::charHex),
+		on(Named::charHex, 'a', 'f', Named::charHex),
+		on(Named::charHex, 'A', 'F', Named::charHex),
+		onAny(Named::charBad, Named::charBadEnd),
+	};
+
+	struct Automaton final
+	{
+		constexpr static size_t maxStates{96U};
+
+		std::array<std::array<State, symbolCount>, maxStates> next{};
+		std::array<TokenType, maxStates> accept{};
+		std::array<bool, maxStates> accepting{};
+		size_t stateCount{static_cast<size_t>(Named::count)};
+
+		constexpr void apply(const Rule &rule) noexcept
+		{
+			auto &row{next[static_cast<size_t>(rule.from)]};
+			if (rule.copy)
+				row = next[static_cast<size_t>(rule.to)];
+			else
+			{
+				for (size_t symbol{rule.first}; symbol <= rule.last; ++symbol)
+					row[symbol] = static_cast<State>(rule.to);
+			}
+		}
+
+		// Walks the trie for text, allocating states as needed, and returns the final state
+		constexpr State insert(const std::string_view text, const State last) noexcept
+		{
+			State state{static_cast<State>(Named::start)};
+			for (size_t index{}; index < text.length(); ++index)
+			{
+				auto &target{next[state][static_cast<uint8_t>(text[index])]};
+				if (index + 1U == text.length() && last != static_cast<State>(Named::dead))
+					target = last;
+				else if (target == static_cast<State>(Named::dead))
+					target = static_cast<State>(stateCount++);
+				state = target;
+			}
+			return state;
+		}
+
+		constexpr void add(const Spelling &spelling) noexcept
+		{
+			const auto state{insert(spelling.text, static_cast<State>(Named::dead))};
+			accept[state] = spelling.type;
+			accepting[state] = true;
+		}
+	};
+
+	constexpr inline Automaton automaton
+	{
+		[]() noexcept
+		{
+			Automaton result{};
+			for (const auto &rule : rules)
+				result.apply(rule);
+			for (const auto &state : accepts)
+			{
+				result.accept[static_cast<size_t>(state.state)] = state.type;
+				result.accepting[static_cast<size_t>(state.state)] = true;
+			}
+			for (const auto &entry : entries)
+				result.insert(entry.text, static_cast<State>(entry.state));
+			for (const auto &spelling : spellings)
+				result.add(spelling);
+			return result;
+		}()
+	};
+
+	static_assert(automaton.stateCount <= Automaton::maxStates, "Lexer automaton has outgrown its state table");
+
+	[[nodiscard]] constexpr inline State step(const State state, const char chr) noexcept
+		{ return automaton.next[state][static_cast<uint8_t>(chr)]; }
+	constexpr inline State startState{static_cast<State>(Named::start)};
+	constexpr inline State deadState{static_cast<State>(Named::dead)};
+	constexpr inline State stringState{static_cast<State>(Named::string)};
+
+	// Sanity check the trie, entries and rules compose as intended
+	static_assert(automaton.accept[step(step(step(startState, '<'), '<'), '=')] == TokenType::assignOp);
+	static_assert(step(step(startState, '/'), '/') == static_cast<State>(Named::lineComment));
+	static_assert(!automaton.accepting[step(step(startState, '.'), '.')]);
+	// The string fast path relies on plain text leaving a string's body state unchanged
+	static_assert(step(step(step(startState, '"'), 'a'), '\'') == stringState);
+	static_assert(step(step(startState, '"'), '~') == stringState);
+} // namespace mangrove::parser::lexerTable
+
+#endif /*PARSER_LEXER_TABLE_HXX*/
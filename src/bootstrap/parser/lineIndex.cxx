@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "lineIndex.hxx"
+#include "../core/utf8/helpers.hxx"
+
+using namespace mangrove::parser;
+using namespace mangrove::parser::types;
+using mangrove::core::utf8::helpers::countUnits;
+
+// A CR only ends a line on its own if it's not the first half of a CR-LF pair
+static inline bool endsLine(const std::string_view &source, const size_t offset) noexcept
+{
+	const auto chr{source[offset]};
+	return chr == '\n' || (chr == '\r' && (offset + 1U == source.length() || source[offset + 1U] != '\n'));
+}
+
+#if !defined(__SSE2__)
+// SWAR test for whether any byte in the block is a CR or LF - this never gives a false negative
+static inline bool mayContainNewline(const uint64_t block) noexcept
+{
+	constexpr uint64_t lowBits{UINT64_C(0x0101010101010101)};
+	constexpr uint64_t highBits{UINT64_C(0x8080808080808080)};
+	const auto hasZero{[](const uint64_t value) noexcept { return (value - lowBits) & ~value & highBits; }};
+	return hasZero(block ^ (lowBits * uint8_t('\n'))) | hasZero(block ^ (lowBits * uint8_t('\r')));
+}
+#endif
+
+LineIndex::LineIndex(const std::string_view source) : _source{source}
+{
+	const auto length{source.length()};
+	// Assume something like typical line lengths to avoid most of the reallocations
+	_lineStarts.reserve(length / 32U + 1U);
+	size_t offset{};
+	const auto recordNewline
+	{
+		[&](const size_t index)
+		{
+			if (endsLine(source, index))
+				_lineStarts.push_back(static_cast<uint32_t>(index + 1U));
+		}
+	};
+
+#if defined(__SSE2__)
+	// Compare 16 bytes at a time, then walk just the set bits of the resulting match mask
+	const auto lineFeeds{_mm_set1_epi8('\n')};
+	const auto carriageReturns{_mm_set1_epi8('\r')};
+	for (; offset + 16U <= length; offset += 16U)
+	{
+		const auto block{_mm_loadu_si128(static_cast<const __m128i *>(static_cast<const void *>(source.data() + offset)))};
+		const auto matches{_mm_or_si128(_mm_cmpeq_epi8(block, lineFeeds), _mm_cmpeq_epi8(block, carriageReturns))};
+		for (auto mask{static_cast<uint32_t>(_mm_movemask_epi8(matches))}; mask; mask &= mask - 1U)
+			recordNewline(offset + static_cast<size_t>(__builtin_ctz(mask)));
+	}
+#else
+	// Otherwise skip over 8-byte blocks that cannot contain a newline
+	for (; offset + 8U <= length; offset += 8U)
+	{
+		uint64_t block{};
+		std::memcpy(&block, source.data() + offset, sizeof(block));
+		if (!mayContainNewline(block))
+			continue;
+		for (size_t index{}; index < sizeof(block); ++index)
+			recordNewline(offset + index);
+	}
+#endif
+
+	for (; offset < length; ++offset)
+		recordNewline(offset);
+}
+
+size_t LineIndex::lineFor(const uint32_t offset) const noexcept
+{
+	// Find the first line starting after the offset, the line we want is then the one before it
+	const auto line{std::upper_bound(_lineStarts.begin(), _lineStarts.end(), offset)};
+	return static_cast<size_t>(line - _lineStarts.begin()) - 1U;
+}
+
+Position LineIndex::position(const uint32_t offset) const noexcept
+{
+	const auto line{lineFor(offset)};
+	const auto lineBegin{_lineStarts[line]};
+	const auto prefix{_source.substr(lineBegin, offset - lineBegin)};
+	// Columns are counted in code points, falling back to bytes should the line not be valid UTF-8
+	const auto column{countUnits(prefix)};
+	return {line, column || prefix.empty() ? column : prefix.length()};
+}
+
+FileSegment LineIndex::location(const SourceRange source) const noexcept
+	{ return {position(source.offset), position(source.end())}; }
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_LINE_INDEX_HXX
+#define PARSER_LINE_INDEX_HXX
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "types.hxx"
+
+namespace mangrove::parser
+{
+	/**
+	 * Table of the byte offsets at which each line of a source file starts, allowing a
+	 * byte offset to be turned into a line and column by binary search only when needed.
+	 * A line ends after '\n', '\r\n' or a lone '\r'.
+	 */
+	struct LineIndex final
+	{
+	private:
+		std::string_view _source{};
+		std::vector<uint32_t> _lineStarts{0U};
+
+	public:
+		LineIndex() noexcept = default;
+		LineIndex(std::string_view source);
+
+		[[nodiscard]] auto lineCount() const noexcept { return _lineStarts.size(); }
+		[[nodiscard]] uint32_t lineStart(const size_t line) const noexcept { return _lineStarts[line]; }
+		[[nodiscard]] size_t lineFor(uint32_t offset) const noexcept;
+		[[nodiscard]] types::Position position(uint32_t offset) const noexcept;
+		[[nodiscard]] types::FileSegment location(types::SourceRange source) const noexcept;
+	};
+} // namespace mangrove::parser
+
+#endif /*PARSER_LINE_INDEX_HXX*/
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_OPERATORS_HXX
+#define PARSER_OPERATORS_HXX
+
+#include <cstdint>
+#include <array>
+#include "types.hxx"
+#include "../ast/tree.hxx"
+
+/**
+ * @file operators.hxx
+ * @brief Compile-time operator precedence table used to drive expression parsing
+ */
+
+namespace mangrove::parser::operators
+{
+	using mangrove::parser::types::TokenType;
+	using mangrove::parser::types::TokenSet;
+	using mangrove::ast::Operator;
+
+	enum class Associativity : uint8_t
+	{
+		left,
+		right,
+	};
+
+	struct BinaryOperator final
+	{
+		// A precedence of 0 means the operator is not a binary operator
+		uint8_t precedence{};
+		Associativity associativity{Associativity::left};
+
+		[[nodiscard]] constexpr bool valid() const noexcept { return precedence != 0U; }
+		// The minimum precedence the right hand side of this operator must bind at
+		[[nodiscard]] constexpr uint8_t rhsPrecedence() const noexcept
+			{ return associativity == Associativity::right ? precedence : uint8_t(precedence + 1U); }
+	};
+
+	struct OperatorPrecedence final
+	{
+		Operator op;
+		BinaryOperator binary;
+	};
+
+	// Plain and compound assignment alike bind loosest of all
+	constexpr inline BinaryOperator assignment{1U, Associativity::right};
+
+	/**
+	 * The other binary operators, from loosest to tightest binding. Token classes lump together operators
+	 * that bind differently ('&', '|' and '^' are all bitOp), so precedence goes by the operator itself.
+	 * As in C, the bitwise operators bind looser than the comparisons.
+	 */
+	constexpr inline std::array<OperatorPrecedence, 18> operatorPrecedences
+	{{
+		{Operator::logicOr, {2U, Associativity::left}},
+		{Operator::logicAnd, {3U, Associativity::left}},
+		{Operator::bitOr, {4U, Associativity::left}},
+		{Operator::bitXor, {5U, Associativity::left}},
+		{Operator::bitAnd, {6U, Associativity::left}},
+		{Operator::equal, {7U, Associativity::left}},
+		{Operator::notEqual, {7U, Associativity::left}},
+		{Operator::less, {8U, Associativity::left}},
+		{Operator::lessEqual, {8U, Associativity::left}},
+		{Operator::greater, {8U, Associativity::left}},
+		{Operator::greaterEqual, {8U, Associativity::left}},
+		{Operator::shiftLeft, {9U, Associativity::left}},
+		{Operator::shiftRight, {9U, Associativity::left}},
+		{Operator::add, {10U, Associativity::left}},
+		{Operator::subtract, {10U, Associativity::left}},
+		{Operator::multiply, {11U, Associativity::left}},
+		{Operator::divide, {11U, Associativity::left}},
+		{Operator::modulo, {11U, Associativity::left}},
+	}};
+
+	constexpr inline size_t operatorCount{static_cast<size_t>(Operator::decrement) + 1U};
+
+	// Flattened form of operatorPrecedences, indexed directly by Operator
+	constexpr inline auto binaryOperators
+	{
+		[]() noexcept
+		{
+			std::array<BinaryOperator, operatorCount> table{};
+			for (const auto &precedence : operatorPrecedences)
+				table[static_cast<size_t>(precedence.op)] = precedence.binary;
+			return table;
+		}()
+	};
+
+	/**
+	 * Looks up how the operator op, read from a token of the given type, binds. The type is needed
+	 * to tell compound assignments apart, as '+=' is Operator::add just as '+' is.
+	 */
+	[[nodiscard]] constexpr inline BinaryOperator binaryOperator(const TokenType type, const Operator op) noexcept
+		{ return type == TokenType::assignOp ? assignment : binaryOperators[static_cast<size_t>(op)]; }
+
+	constexpr inline TokenSet prefixOperators{TokenType::invert, TokenType::addOp, TokenType::incOp};
+
+	static_assert(binaryOperator(TokenType::mulOp, Operator::multiply).precedence >
+		binaryOperator(TokenType::addOp, Operator::add).precedence);
+	static_assert(binaryOperator(TokenType::bitOp, Operator::bitAnd).precedence >
+		binaryOperator(TokenType::bitOp, Operator::bitXor).precedence);
+	static_assert(binaryOperator(TokenType::bitOp, Operator::bitXor).precedence >
+		binaryOperator(TokenType::bitOp, Operator::bitOr).precedence);
+	static_assert(binaryOperator(TokenType::logicOp, Operator::logicAnd).precedence >
+		binaryOperator(TokenType::logicOp, Operator::logicOr).precedence);
+	static_assert(!binaryOperator(TokenType::ident, Operator::none).valid());
+} // namespace mangrove::parser::operators
+
+#endif /*PARSER_OPERATORS_HXX*/
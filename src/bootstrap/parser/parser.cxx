@@ -1,10 +1,777 @@
 // SPDX-License-Identifier: BSD-3-Clause
+#include <string>
+#include <fmt/format.h>
+#include <substrate/console>
 #include "parser.hxx"
+#include "operators.hxx"
+#include "../core/trace.hxx"
+#include "../core/memory.hxx"
 
 using namespace mangrove::parser;
+using namespace mangrove::parser::types;
+using mangrove::ast::noNode;
+using mangrove::parser::operators::binaryOperator;
+using mangrove::parser::operators::prefixOperators;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
+using substrate::console;
 
-Parser::Parser(const path &fileName) : lexer{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}}
+constexpr static TokenSet terminatorTokens{TokenType::newline, TokenType::semi, TokenType::eof};
+constexpr static TokenSet recoveryTokens{TokenType::newline, TokenType::semi, TokenType::rightBrace, TokenType::eof};
+constexpr static TokenSet specifierTokens{TokenType::storageSpec, TokenType::locationSpec};
+constexpr static TokenSet integerTokens{TokenType::intLit, TokenType::binLit, TokenType::octLit, TokenType::hexLit};
+
+static std::string_view bytesOf(const StringView &value) noexcept
+	{ return {value.data(), value.byteLength()}; }
+
+static Operator arithmeticOperatorFor(const char value) noexcept
+{
+	switch (value)
+	{
+		case '+':
+			return Operator::add;
+		case '-':
+			return Operator::subtract;
+		case '*':
+			return Operator::multiply;
+		case '/':
+			return Operator::divide;
+		case '%':
+			return Operator::modulo;
+		case '&':
+			return Operator::bitAnd;
+		case '|':
+			return Operator::bitOr;
+		case '^':
+			return Operator::bitXor;
+		case '<':
+			return Operator::shiftLeft;
+		case '>':
+			return Operator::shiftRight;
+		default:
+			return Operator::none;
+	}
+}
+
+// Maps a binary operator token onto the operation it represents
+static Operator binaryOperatorFor(const Token &token) noexcept
+{
+	const auto value{bytesOf(token.value())};
+	if (value.empty())
+		return Operator::none;
+	switch (token.type())
+	{
+		case TokenType::addOp:
+		case TokenType::mulOp:
+		case TokenType::shiftOp:
+		case TokenType::bitOp:
+			return arithmeticOperatorFor(value[0]);
+		case TokenType::logicOp:
+			return value[0] == '&' ? Operator::logicAnd : Operator::logicOr;
+		case TokenType::relOp:
+			if (value[0] == '<')
+				return value.length() == 1U ? Operator::less : Operator::lessEqual;
+			return value.length() == 1U ? Operator::greater : Operator::greaterEqual;
+		case TokenType::equOp:
+			return value[0] == '=' ? Operator::equal : Operator::notEqual;
+		case TokenType::assignOp:
+			return value.length() == 1U ? Operator::assign : arithmeticOperatorFor(value[0]);
+		default:
+			return Operator::none;
+	}
+}
+
+// Maps a prefix operator token onto the operation it represents
+static Operator unaryOperatorFor(const Token &token) noexcept
+{
+	const auto value{bytesOf(token.value())};
+	if (value.empty())
+		return Operator::none;
+	switch (token.type())
+	{
+		case TokenType::addOp:
+			return value[0] == '+' ? Operator::plus : Operator::negate;
+		case TokenType::invert:
+			return value[0] == '!' ? Operator::logicNot : Operator::invert;
+		case TokenType::incOp:
+			return value[0] == '+' ? Operator::increment : Operator::decrement;
+		default:
+			return Operator::none;
+	}
+}
+
+static NodeType literalNodeFor(const TokenType type) noexcept
+{
+	switch (type)
+	{
+		case TokenType::intLit:
+			return NodeType::intLit;
+		case TokenType::binLit:
+			return NodeType::binLit;
+		case TokenType::octLit:
+			return NodeType::octLit;
+		case TokenType::hexLit:
+			return NodeType::hexLit;
+		case TokenType::stringLit:
+			return NodeType::stringLit;
+		case TokenType::charLit:
+			return NodeType::charLit;
+		case TokenType::boolLit:
+			return NodeType::boolLit;
+		case TokenType::nullptrLit:
+			return NodeType::nullptrLit;
+		default:
+			return NodeType::invalid;
+	}
+}
+
+Parser::Parser(const path &fileName, const LexerEngine engine, const Pipelining pipelining) :
+	_fileName{fileName}, lexer{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, TriviaMode::coalesce}
+	{ setup(pipelining); }
+
+Parser::Parser(const path &fileName, SourceBuffer &&source, const Pipelining pipelining) :
+	_fileName{fileName}, lexer{std::move(source), TriviaMode::coalesce}
+	{ setup(pipelining); }
+
+void Parser::setup(const Pipelining pipelining)
 {
+	const ScopedTimer timer{"Parser::Parser"sv};
+	const PhaseScope phase{Phase::parse};
+	// The global scope has no parent, so must only be created once _symbolTable is itself initialised
+	_symbolTable = std::make_shared<SymbolTable>(*this);
 	if (!addBuiltinTypesTo(*_symbolTable))
 		throw std::exception{};
+	// Start lexing as soon as we're set up so the lexer gets a head start on the parser
+	if (pipelining == Pipelining::threaded)
+		_pipe.emplace(lexer);
+}
+
+void Parser::nextSignificant(Token &token) noexcept
+{
+	// Whitespace and comments never affect the parse - the lexer coalesces them away when it can see the
+	// whole file, and anything it can't is dropped here
+	do
+	{
+		if (_nextToken == _tokenCount)
+		{
+			_tokenCount = _pipe ? _pipe->next(_tokens) : lexer.next(_tokens);
+			_nextToken = 0U;
+		}
+		token.swap(_tokens[_nextToken++]);
+	}
+	while (token.typeIn({TokenType::whitespace, TokenType::comment}));
+}
+
+void Parser::advance() noexcept
+{
+	if (_haveLookahead)
+	{
+		_current.swap(_lookahead);
+		_haveLookahead = false;
+	}
+	else
+		nextSignificant(_current);
+}
+
+const Token &Parser::peek() noexcept
+{
+	if (!_haveLookahead)
+	{
+		nextSignificant(_lookahead);
+		_haveLookahead = true;
+	}
+	return _lookahead;
+}
+
+bool Parser::atTerminator() const noexcept
+	{ return _current.typeIn(terminatorTokens) || _current.type() == TokenType::rightBrace; }
+
+void Parser::skipNewlines() noexcept
+{
+	while (_current.type() == TokenType::newline)
+		advance();
+}
+
+void Parser::skipTerminators() noexcept
+{
+	while (_current.typeIn({TokenType::newline, TokenType::semi}))
+		advance();
+}
+
+bool Parser::expect(const TokenType type, const std::string_view what) noexcept
+{
+	if (_current.type() != type)
+	{
+		error(fmt::format("expected {}"sv, what));
+		return false;
+	}
+	advance();
+	return true;
+}
+
+void Parser::error(const std::string_view message) noexcept
+{
+	const auto location{lexer.location(_current)};
+	console.error(fmt::format("{}:{}:{}: {}"sv, _fileName.string(), location.begin.line + 1U,
+		location.begin.character + 1U, message));
+	++_errors;
+}
+
+void Parser::recover() noexcept
+{
+	// Skip to the end of the broken statement so parsing can resume at the next one
+	while (!_current.typeIn(recoveryTokens))
+		advance();
+}
+
+void Parser::endStatement() noexcept
+{
+	if (_current.typeIn({TokenType::newline, TokenType::semi}))
+		advance();
+	else if (!_current.typeIn({TokenType::rightBrace, TokenType::eof}))
+	{
+		error("expected end of statement"sv);
+		recover();
+	}
+}
+
+NodeIndex Parser::makeNode(const NodeType type, const Operator op)
+	{ return _ast.make(type, _current.source(), op); }
+
+NodeIndex Parser::makeValueNode(const NodeType type)
+{
+	const auto node{makeNode(type)};
+	_ast[node].value = _ast.intern(bytesOf(_current.value()));
+	return node;
+}
+
+NodeIndex Parser::makeIntegerNode(const NodeType type)
+{
+	const auto node{makeNode(type)};
+	if (const auto value{_current.integer()}; value)
+		_ast.integer(node, *value);
+	else
+		error("integer literal is too large to be represented in 64 bits"sv);
+	return node;
+}
+
+// Widens node's source range to run through to the end of last's
+void Parser::extend(const NodeIndex node, const NodeIndex last) noexcept
+{
+	if (last != noNode)
+		extendTo(node, _ast[last].source.end());
+}
+
+void Parser::extendTo(const NodeIndex node, const uint32_t end) noexcept
+{
+	auto &source{_ast[node].source};
+	if (end > source.end())
+		source.length = end - source.offset;
+}
+
+bool Parser::parse()
+{
+	const ScopedTimer timer{"Parser::parse"sv};
+	const PhaseScope phase{Phase::parse};
+	advance();
+	_root = makeNode(NodeType::block);
+	auto tail{noNode};
+	while (true)
+	{
+		skipTerminators();
+		if (_current.type() == TokenType::eof)
+			break;
+		if (_current.type() == TokenType::rightBrace)
+		{
+			error("unexpected '}'"sv);
+			advance();
+			continue;
+		}
+		tail = _ast.appendChild(_root, tail, parseStatement());
+	}
+	extend(_root, tail);
+	return _errors == 0U;
+}
+
+NodeIndex Parser::parseStatement()
+{
+	switch (_current.type())
+	{
+		case TokenType::leftBrace:
+			return parseBlock();
+		case TokenType::ifStmt:
+			return parseIf();
+		case TokenType::whileStmt:
+			return parseWhile();
+		case TokenType::doStmt:
+			return parseDo();
+		case TokenType::forStmt:
+			return parseFor();
+		default:
+			break;
+	}
+
+	NodeIndex node{noNode};
+	if (_current.type() == TokenType::returnStmt)
+		node = parseReturn();
+	else if (_current.type() == TokenType::importStmt)
+		node = parseImport();
+	else if (_current.type() == TokenType::fromStmt)
+		node = parseFromImport();
+	else if (atDeclaration())
+		node = parseDeclaration();
+	else
+		node = parseExpression();
+	endStatement();
+	return node;
+}
+
+NodeIndex Parser::parseBlock()
+{
+	if (!enterNesting())
+		return blockTooDeep();
+	const auto node{makeNode(NodeType::block)};
+	if (!expect(TokenType::leftBrace, "'{'"sv))
+	{
+		--_depth;
+		return node;
+	}
+	// Each block introduces a new scope - hold the enclosing table here as the new one only weakly refers to it
+	const auto enclosingScope{_symbolTable};
+	symbolTable(std::make_shared<SymbolTable>(*this));
+
+	auto tail{noNode};
+	while (true)
+	{
+		skipTerminators();
+		if (_current.typeIn({TokenType::rightBrace, TokenType::eof}))
+			break;
+		tail = _ast.appendChild(node, tail, parseStatement());
+	}
+
+	_symbolTable->pop(*this);
+	const auto end{_current.source().end()};
+	if (expect(TokenType::rightBrace, "'}' to close block"sv))
+		extendTo(node, end);
+	--_depth;
+	return node;
+}
+
+NodeIndex Parser::parseIf()
+{
+	// An elif is an if in the else-branch of the one before it. Chains of them are parsed in a loop, hanging
+	// each if off the last, so however long a chain is it can't take the parser's stack with it
+	const auto first{makeNode(NodeType::ifStmt)};
+	auto node{first};
+	auto tail{noNode};
+	while (true)
+	{
+		advance();
+		tail = _ast.appendChild(node, noNode, parseExpression());
+		tail = _ast.appendChild(node, tail, parseBlock());
+		// An elif or else may begin on the line following the closing brace
+		if (_current.type() == TokenType::newline && peek().typeIn({TokenType::elifStmt, TokenType::elseStmt}))
+			advance();
+		if (_current.type() != TokenType::elifStmt)
+			break;
+		node = _ast.appendChild(node, tail, makeNode(NodeType::ifStmt));
+	}
+	if (_current.type() == TokenType::elseStmt)
+	{
+		advance();
+		tail = _ast.appendChild(node, tail, parseBlock());
+	}
+	// Every if in the chain ends where the last one does
+	for (auto link{first}; link != node; link = _ast.child(link, 2U))
+		extend(link, tail);
+	extend(node, tail);
+	return first;
+}
+
+NodeIndex Parser::parseWhile()
+{
+	const auto node{makeNode(NodeType::whileStmt)};
+	advance();
+	const auto tail{_ast.appendChild(node, noNode, parseExpression())};
+	extend(node, _ast.appendChild(node, tail, parseBlock()));
+	return node;
+}
+
+NodeIndex Parser::parseDo()
+{
+	const auto node{makeNode(NodeType::doStmt)};
+	advance();
+	const auto tail{_ast.appendChild(node, noNode, parseBlock())};
+	skipNewlines();
+	if (!expect(TokenType::whileStmt, "'while' to end do-block"sv))
+		return node;
+	extend(node, _ast.appendChild(node, tail, parseExpression()));
+	endStatement();
+	return node;
+}
+
+NodeIndex Parser::parseFor()
+{
+	// for (init; condition; step) { ... } - any of the three clauses may be empty
+	const auto node{makeNode(NodeType::forStmt)};
+	advance();
+	if (!expect(TokenType::leftParen, "'(' after 'for'"sv))
+		return node;
+	auto tail{noNode};
+	const auto clause
+	{
+		[&](const TokenType end, const std::string_view what, const bool allowDeclaration)
+		{
+			skipNewlines();
+			NodeIndex result{noNode};
+			if (_current.type() == end)
+				result = makeNode(NodeType::empty);
+			else if (allowDeclaration && atDeclaration())
+				result = parseDeclaration();
+			else
+				result = parseExpression();
+			tail = _ast.appendChild(node, tail, result);
+			skipNewlines();
+			return expect(end, what);
+		}
+	};
+	if (clause(TokenType::semi, "';' after for-loop initialiser"sv, true) &&
+		clause(TokenType::semi, "';' after for-loop condition"sv, false) &&
+		clause(TokenType::rightParen, "')' to close for-loop header"sv, false))
+		tail = _ast.appendChild(node, tail, parseBlock());
+	extend(node, tail);
+	return node;
+}
+
+NodeIndex Parser::parseReturn()
+{
+	const auto node{makeNode(NodeType::returnStmt)};
+	advance();
+	if (!atTerminator())
+		extend(node, _ast.appendChild(node, noNode, parseExpression()));
+	return node;
+}
+
+NodeIndex Parser::parseDottedName()
+{
+	// Dotted module paths (a.b.c) are held as a single identifier node
+	if (_current.type() != TokenType::ident)
+	{
+		error("expected a module name"sv);
+		return makeNode(NodeType::invalid);
+	}
+	const auto node{makeNode(NodeType::ident)};
+	std::string name{bytesOf(_current.value())};
+	advance();
+	while (_current.type() == TokenType::dot && peek().type() == TokenType::ident)
+	{
+		advance();
+		name += '.';
+		name += bytesOf(_current.value());
+		extendTo(node, _current.source().end());
+		advance();
+	}
+	_ast[node].value = _ast.intern(name);
+	return node;
+}
+
+NodeIndex Parser::parseImportName()
+{
+	const auto node{makeNode(NodeType::importName)};
+	auto tail{_ast.appendChild(node, noNode, parseDottedName())};
+	if (_current.type() == TokenType::asStmt)
+	{
+		advance();
+		if (_current.type() != TokenType::ident)
+			error("expected an identifier after 'as'"sv);
+		else
+		{
+			tail = _ast.appendChild(node, tail, makeValueNode(NodeType::ident));
+			advance();
+		}
+	}
+	extend(node, tail);
+	return node;
+}
+
+NodeIndex Parser::parseImport()
+{
+	// import a.b [as c], d
+	const auto node{makeNode(NodeType::importStmt)};
+	advance();
+	auto tail{_ast.appendChild(node, noNode, parseImportName())};
+	while (_current.type() == TokenType::comma)
+	{
+		advance();
+		skipNewlines();
+		tail = _ast.appendChild(node, tail, parseImportName());
+	}
+	extend(node, tail);
+	return node;
+}
+
+NodeIndex Parser::parseFromImport()
+{
+	// from a.b import c [as d], e
+	const auto node{makeNode(NodeType::fromImportStmt)};
+	advance();
+	auto tail{_ast.appendChild(node, noNode, parseDottedName())};
+	if (!expect(TokenType::importStmt, "'import' after module name"sv))
+		return node;
+	tail = _ast.appendChild(node, tail, parseImportName());
+	while (_current.type() == TokenType::comma)
+	{
+		advance();
+		skipNewlines();
+		tail = _ast.appendChild(node, tail, parseImportName());
+	}
+	extend(node, tail);
+	return node;
+}
+
+bool Parser::atDeclaration() noexcept
+{
+	if (_current.typeIn(specifierTokens))
+		return true;
+	return _current.type() == TokenType::ident && peek().type() == TokenType::ident;
+}
+
+NodeIndex Parser::parseDeclaration()
+{
+	// [specifier...] Type name [= value]
+	const auto node{makeNode(NodeType::declaration)};
+	auto tail{noNode};
+	while (_current.typeIn(specifierTokens))
+	{
+		tail = _ast.appendChild(node, tail, makeValueNode(NodeType::specifier));
+		advance();
+	}
+
+	if (_current.type() != TokenType::ident)
+	{
+		error("expected a type name"sv);
+		return node;
+	}
+	const auto *const typeSymbol{_symbolTable->find(_current.value())};
+	if (!typeSymbol || !typeSymbol->type().isType())
+		error(fmt::format("'{}' does not name a type"sv, bytesOf(_current.value())));
+	tail = _ast.appendChild(node, tail, makeValueNode(NodeType::ident));
+	advance();
+
+	if (_current.type() != TokenType::ident)
+	{
+		error("expected a name for the declaration"sv);
+		return node;
+	}
+	if (_symbolTable->findLocal(_current.value()))
+		error(fmt::format("'{}' is already defined in this scope"sv, bytesOf(_current.value())));
+	else if (auto *const symbol{_symbolTable->add(String{_current.value()})}; symbol && typeSymbol)
+		symbol->type(typeSymbol->type().forValue());
+	tail = _ast.appendChild(node, tail, makeValueNode(NodeType::ident));
+	advance();
+
+	if (_current.type() == TokenType::assignOp && binaryOperatorFor(_current) == Operator::assign)
+	{
+		advance();
+		skipNewlines();
+		tail = _ast.appendChild(node, tail, parseExpression());
+	}
+	extend(node, tail);
+	return node;
+}
+
+NodeIndex Parser::parseExpression(const uint8_t minPrecedence)
+{
+	// Precedence climbing over the operator table - each loop iteration folds one binary
+	// operator whose precedence is at least minPrecedence into the left-hand side
+	if (!enterNesting())
+		return tooDeep();
+	auto lhs{parseUnary()};
+	while (true)
+	{
+		const auto op{binaryOperatorFor(_current)};
+		const auto binary{binaryOperator(_current.type(), op)};
+		if (!binary.valid() || binary.precedence < minPrecedence)
+			break;
+		const auto isAssignment{_current.type() == TokenType::assignOp};
+		const auto node{_ast.make(isAssignment ? NodeType::assignment : NodeType::binaryOp, _ast[lhs].source, op)};
+		advance();
+		skipNewlines();
+		const auto rhs{parseExpression(binary.rhsPrecedence())};
+		_ast.appendChild(node, _ast.appendChild(node, noNode, lhs), rhs);
+		extend(node, rhs);
+		lhs = node;
+	}
+	--_depth;
+	return lhs;
+}
+
+NodeIndex Parser::parseUnary()
+{
+	if (!_current.typeIn(prefixOperators))
+		return parsePostfix(parsePrimary());
+	if (!enterNesting())
+		return tooDeep();
+	const auto node{makeNode(NodeType::unaryOp, unaryOperatorFor(_current))};
+	advance();
+	extend(node, _ast.appendChild(node, noNode, parseUnary()));
+	--_depth;
+	return node;
+}
+
+bool Parser::enterNesting() noexcept
+{
+	if (_depth == maxDepth)
+		return false;
+	++_depth;
+	return true;
+}
+
+NodeIndex Parser::tooDeep()
+{
+	error("expression is nested too deeply"sv);
+	const auto node{makeNode(NodeType::invalid)};
+	// Skip the rest of the expression, up to whatever closes the bracket it's in, so the levels
+	// of expression around it can pick up from there rather than each reporting errors of their own
+	size_t brackets{};
+	while (_current.type() != TokenType::eof && (brackets || !_current.typeIn(recoveryTokens)))
+	{
+		if (_current.typeIn({TokenType::leftParen, TokenType::leftSquare}))
+			++brackets;
+		else if (_current.typeIn({TokenType::rightParen, TokenType::rightSquare, TokenType::comma}))
+		{
+			if (!brackets)
+				break;
+			if (_current.type() != TokenType::comma)
+				--brackets;
+		}
+		extendTo(node, _current.source().end());
+		advance();
+	}
+	return node;
+}
+
+NodeIndex Parser::blockTooDeep()
+{
+	error("block is nested too deeply"sv);
+	const auto node{makeNode(NodeType::invalid)};
+	if (_current.type() != TokenType::leftBrace)
+		return node;
+	// Skip the whole block, and every block in it, so the blocks around it carry on from its closing brace
+	size_t braces{};
+	do
+	{
+		if (_current.type() == TokenType::leftBrace)
+			++braces;
+		else if (_current.type() == TokenType::rightBrace)
+			--braces;
+		extendTo(node, _current.source().end());
+		advance();
+	}
+	while (braces && _current.type() != TokenType::eof);
+	return node;
+}
+
+NodeIndex Parser::parsePostfix(NodeIndex node)
+{
+	while (true)
+	{
+		const auto type{_current.type()};
+		if (type == TokenType::leftParen)
+		{
+			// Call - the callee is the first child, followed by the arguments
+			const auto call{_ast.make(NodeType::call, _ast[node].source)};
+			auto tail{_ast.appendChild(call, noNode, node)};
+			advance();
+			skipNewlines();
+			while (!_current.typeIn({TokenType::rightParen, TokenType::eof}))
+			{
+				tail = _ast.appendChild(call, tail, parseExpression());
+				skipNewlines();
+				if (_current.type() != TokenType::comma)
+					break;
+				advance();
+				skipNewlines();
+			}
+			const auto end{_current.source().end()};
+			if (expect(TokenType::rightParen, "')' to close call"sv))
+				extendTo(call, end);
+			node = call;
+		}
+		else if (type == TokenType::leftSquare)
+		{
+			const auto index{_ast.make(NodeType::index, _ast[node].source)};
+			const auto tail{_ast.appendChild(index, noNode, node)};
+			advance();
+			skipNewlines();
+			_ast.appendChild(index, tail, parseExpression());
+			skipNewlines();
+			const auto end{_current.source().end()};
+			if (expect(TokenType::rightSquare, "']' to close index"sv))
+				extendTo(index, end);
+			node = index;
+		}
+		else if (type == TokenType::dot)
+		{
+			const auto member{_ast.make(NodeType::member, _ast[node].source)};
+			const auto tail{_ast.appendChild(member, noNode, node)};
+			advance();
+			if (_current.type() != TokenType::ident)
+			{
+				error("expected a member name after '.'"sv);
+				return member;
+			}
+			extend(member, _ast.appendChild(member, tail, makeValueNode(NodeType::ident)));
+			advance();
+			node = member;
+		}
+		else if (type == TokenType::incOp)
+		{
+			const auto postfix{_ast.make(NodeType::postfixOp, _ast[node].source, unaryOperatorFor(_current))};
+			_ast.appendChild(postfix, noNode, node);
+			extendTo(postfix, _current.source().end());
+			advance();
+			node = postfix;
+		}
+		else
+			return node;
+	}
+}
+
+NodeIndex Parser::parsePrimary()
+{
+	const auto type{_current.type()};
+	if (type == TokenType::ident)
+	{
+		const auto node{makeValueNode(NodeType::ident)};
+		advance();
+		return node;
+	}
+	if (const auto literal{literalNodeFor(type)}; literal != NodeType::invalid)
+	{
+		const auto node{_current.typeIn(integerTokens) ? makeIntegerNode(literal) : makeValueNode(literal)};
+		advance();
+		return node;
+	}
+	if (type == TokenType::leftParen)
+	{
+		const auto begin{_current.source().offset};
+		advance();
+		skipNewlines();
+		const auto node{parseExpression()};
+		skipNewlines();
+		const auto end{_current.source().end()};
+		// Parenthesised expressions take on the extent of their parentheses
+		if (expect(TokenType::rightParen, "')' to close expression"sv))
+			_ast[node].source = {begin, end - begin};
+		return node;
+	}
+
+	error("expected an expression"sv);
+	const auto node{makeNode(NodeType::invalid)};
+	// Consume the offending token unless it's one statement recovery needs to see
+	if (!_current.typeIn(recoveryTokens))
+		advance();
+	return node;
 }
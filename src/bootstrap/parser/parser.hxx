@@ -2,9 +2,14 @@
 #ifndef PARSER_PARSER_HXX
 #define PARSER_PARSER_HXX
 
+#include <array>
 #include <filesystem>
+#include <optional>
+#include <string_view>
 #include "tokeniser.hxx"
+#include "tokenPipe.hxx"
 #include "../ast/symbolTable.hxx"
+#include "../ast/tree.hxx"
 
 namespace mangrove::parser
 {
@@ -12,16 +17,88 @@ namespace mangrove::parser
 	{
 		using std::filesystem::path;
 		using mangrove::ast::symbolTable::SymbolTable;
+		using mangrove::ast::Tree;
+		using mangrove::ast::NodeIndex;
+		using mangrove::ast::NodeType;
+		using mangrove::ast::Operator;
 	}
 
 	struct Parser
 	{
 	private:
+		path _fileName;
 		Tokeniser lexer;
-		std::shared_ptr<SymbolTable> _symbolTable{std::make_shared<SymbolTable>(*this)};
+		// When pipelined, the thread lexing ahead of the parser - this must be destroyed before the lexer is
+		std::optional<TokenPipe> _pipe{};
+		std::shared_ptr<SymbolTable> _symbolTable{};
+		Tree _ast{};
+		NodeIndex _root{mangrove::ast::noNode};
+		// Tokens are lexed a batch at a time into this buffer and consumed from it in order
+		std::array<types::Token, 64U> _tokens{};
+		size_t _nextToken{};
+		size_t _tokenCount{};
+		// The current significant (non-whitespace, non-comment) token, and one token of lookahead
+		types::Token _current{};
+		types::Token _lookahead{};
+		bool _haveLookahead{false};
+		size_t _errors{};
+		// How deeply the blocks and expression being parsed are nested - bounded so deep nesting can't
+		// overflow the stack
+		size_t _depth{};
+
+		constexpr static size_t maxDepth{256U};
+
+		void setup(Pipelining pipelining);
+		void nextSignificant(types::Token &token) noexcept;
+		void advance() noexcept;
+		[[nodiscard]] const types::Token &peek() noexcept;
+		[[nodiscard]] bool atTerminator() const noexcept;
+		void skipNewlines() noexcept;
+		void skipTerminators() noexcept;
+		bool expect(types::TokenType type, std::string_view what) noexcept;
+		void error(std::string_view message) noexcept;
+		void recover() noexcept;
+		void endStatement() noexcept;
+
+		[[nodiscard]] NodeIndex makeNode(NodeType type, Operator op = Operator::none);
+		[[nodiscard]] NodeIndex makeValueNode(NodeType type);
+		[[nodiscard]] NodeIndex makeIntegerNode(NodeType type);
+		void extend(NodeIndex node, NodeIndex last) noexcept;
+		void extendTo(NodeIndex node, uint32_t end) noexcept;
+
+		[[nodiscard]] NodeIndex parseStatement();
+		[[nodiscard]] NodeIndex parseBlock();
+		[[nodiscard]] NodeIndex parseIf();
+		[[nodiscard]] NodeIndex parseWhile();
+		[[nodiscard]] NodeIndex parseDo();
+		[[nodiscard]] NodeIndex parseFor();
+		[[nodiscard]] NodeIndex parseReturn();
+		[[nodiscard]] NodeIndex parseImport();
+		[[nodiscard]] NodeIndex parseFromImport();
+		[[nodiscard]] NodeIndex parseImportName();
+		[[nodiscard]] NodeIndex parseDottedName();
+		[[nodiscard]] bool atDeclaration() noexcept;
+		[[nodiscard]] NodeIndex parseDeclaration();
+		[[nodiscard]] NodeIndex parseExpression(uint8_t minPrecedence = 1U);
+		[[nodiscard]] NodeIndex parseUnary();
+		[[nodiscard]] NodeIndex parsePostfix(NodeIndex node);
+		[[nodiscard]] NodeIndex parsePrimary();
+		[[nodiscard]] bool enterNesting() noexcept;
+		[[nodiscard]] NodeIndex tooDeep();
+		[[nodiscard]] NodeIndex blockTooDeep();
 
 	public:
-		Parser(const path &fileName);
+		Parser(const path &fileName, LexerEngine engine = LexerEngine::scalar,
+			Pipelining pipelining = Pipelining::none);
+		/** Parses a file that's already been loaded (see core/sourceLoader.hxx) with the table engine */
+		Parser(const path &fileName, SourceBuffer &&source, Pipelining pipelining = Pipelining::none);
+
+		/** Parses the whole file into the AST, returning false if any syntax errors were found */
+		[[nodiscard]] bool parse();
+
+		[[nodiscard]] const auto &ast() const noexcept { return _ast; }
+		[[nodiscard]] auto root() const noexcept { return _root; }
+		[[nodiscard]] auto errorCount() const noexcept { return _errors; }
 
 		[[nodiscard]] std::weak_ptr<SymbolTable> symbolTable() const noexcept { return _symbolTable; }
 		void symbolTable(std::shared_ptr<SymbolTable> &&table) noexcept { _symbolTable = std::move(table); }
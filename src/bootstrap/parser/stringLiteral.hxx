@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_STRING_LITERAL_HXX
+#define PARSER_STRING_LITERAL_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "integerLiteral.hxx"
+#include "recogniser.hxx"
+
+/**
+ * @file stringLiteral.hxx
+ * @brief Bulk scanning of the plain text runs in string and character literals
+ *
+ * Most of a literal's body is text that decodes to itself, so rather than decoding it a character at a
+ * time the lexers measure the run up to the next quote, escape or otherwise special character 8 bytes
+ * at a time with the same SWAR classification integerLiteral.hxx uses, then append it in one copy.
+ * Only what stops a run goes through the per-character escape decoder.
+ */
+
+namespace mangrove::parser::stringLiteral
+{
+	using integerLiteral::highBits;
+	using integerLiteral::inRange;
+	using integerLiteral::load;
+
+	/** A run of plain text, in both bytes and characters */
+	struct Run final
+	{
+		size_t bytes{};
+		size_t chars{};
+	};
+
+	/** Sets the high bit of each byte of word that is printable ASCII other than quote or a backslash */
+	[[nodiscard]] constexpr uint64_t plainMask(const uint64_t word, const uint8_t quote) noexcept
+		{ return inRange(word, ' ', '~') & ~inRange(word, quote, quote) & ~inRange(word, '\\', '\\'); }
+
+	/**
+	 * Measures the run of characters at the start of text that a literal closed by quote takes verbatim.
+	 * ASCII is taken 8 bytes at a time; non-ASCII characters are checked one by one, and anything that is
+	 * not well-formed, normal text ends the run so the per-character path can decide what to do with it.
+	 */
+	[[nodiscard]] inline Run plainRun(const std::string_view text, const char quote) noexcept
+	{
+		Run run{};
+		while (run.bytes < text.length())
+		{
+			// A short final load is padded with 0 bytes, which are never plain, so this only skips whole words
+			const auto stops{~plainMask(load(text.substr(run.bytes)), static_cast<uint8_t>(quote)) & highBits};
+			if (!stops)
+			{
+				run.bytes += 8U;
+				run.chars += 8U;
+				continue;
+			}
+			const auto plain{static_cast<size_t>(__builtin_ctzll(stops)) / 8U};
+			run.bytes += plain;
+			run.chars += plain;
+			if (run.bytes == text.length() || static_cast<uint8_t>(text[run.bytes]) < 0x80U)
+				break;
+			const Char chr{text.substr(run.bytes)};
+			// Overlong encodings must not be copied through as they would not round-trip
+			if (!chr.valid() || chr.value() < 0x80U || !recognisers::isNormalAlpha(chr))
+				break;
+			run.bytes += chr.length();
+			++run.chars;
+		}
+		return run;
+	}
+} // namespace mangrove::parser::stringLiteral
+
+#endif /*PARSER_STRING_LITERAL_HXX*/
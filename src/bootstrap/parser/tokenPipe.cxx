@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include "tokenPipe.hxx"
+#include "../core/trace.hxx"
+
+using namespace mangrove::parser;
+using namespace mangrove::parser::types;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::trace::nameThread;
+using namespace std::literals::string_view_literals;
+
+static size_t roundCapacity(const size_t capacity) noexcept
+{
+	size_t result{TokenPipe::batchSize};
+	while (result < capacity)
+		result <<= 1U;
+	return result;
+}
+
+TokenPipe::TokenPipe(Tokeniser &lexer, const size_t capacity) :
+	_slots(roundCapacity(capacity)), _mask{_slots.size() - 1U}
+	{ _producer = std::thread{[this, &lexer]() noexcept { produce(lexer); }}; }
+
+TokenPipe::~TokenPipe() noexcept
+{
+	_stop.store(true, std::memory_order_relaxed);
+	if (_producer.joinable())
+		_producer.join();
+}
+
+void TokenPipe::produce(Tokeniser &lexer) noexcept
+{
+	nameThread("lexer"sv);
+	const ScopedTimer timer{"TokenPipe::produce"sv};
+	const auto capacity{_slots.size()};
+	auto tail{_tail.load(std::memory_order_relaxed)};
+	size_t head{};
+	while (!_stop.load(std::memory_order_relaxed))
+	{
+		if (tail - head == capacity)
+		{
+			head = _head.load(std::memory_order_acquire);
+			if (tail - head == capacity)
+			{
+				// The parser has fallen behind, so wait for it to free some slots up
+				count(Counter::producerStalls);
+				while (tail - (head = _head.load(std::memory_order_acquire)) == capacity)
+				{
+					if (_stop.load(std::memory_order_relaxed))
+						return;
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		// Lex straight into the free slots, stopping at the end of the ring
+		const auto index{tail & _mask};
+		const auto length{std::min({capacity - (tail - head), capacity - index, batchSize})};
+		const auto written{lexer.next(span{&_slots[index], length})};
+		const auto finished{_slots[index + written - 1U].type() == TokenType::eof};
+		tail += written;
+		_tail.store(tail, std::memory_order_release);
+		if (finished)
+			return;
+	}
+}
+
+size_t TokenPipe::next(const span<Token> tokens) noexcept
+{
+	if (tokens.empty())
+		return 0U;
+	if (_drained)
+	{
+		Token eof{_eof};
+		tokens[0].swap(eof);
+		return 1U;
+	}
+
+	const auto head{_head.load(std::memory_order_relaxed)};
+	if (_knownTail == head)
+	{
+		_knownTail = _tail.load(std::memory_order_acquire);
+		if (_knownTail == head)
+		{
+			// The lexer has fallen behind, so wait for it to publish some more tokens
+			count(Counter::consumerStalls);
+			while ((_knownTail = _tail.load(std::memory_order_acquire)) == head)
+				std::this_thread::yield();
+		}
+	}
+
+	const auto available{_knownTail - head};
+	count(Counter::queueReads);
+	count(Counter::queueDepth, available);
+	const auto length{std::min(available, tokens.size())};
+	for (size_t index{}; index < length; ++index)
+		tokens[index].swap(_slots[(head + index) & _mask]);
+	// The producer stops after the EOF token, so it can only ever be the last one published
+	if (tokens[length - 1U].type() == TokenType::eof)
+	{
+		_drained = true;
+		_eof = Token{tokens[length - 1U]};
+	}
+	_head.store(head + length, std::memory_order_release);
+	return length;
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_TOKEN_PIPE_HXX
+#define PARSER_TOKEN_PIPE_HXX
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <substrate/span>
+#include "types.hxx"
+#include "tokeniser.hxx"
+
+/**
+ * @file tokenPipe.hxx
+ * @brief Runs a tokeniser ahead of its consumer on a producer thread
+ *
+ * Tokens are handed over through a bounded single-producer, single-consumer ring. The producer lexes
+ * straight into free slots a batch at a time and publishes them by moving the ring's tail on; the
+ * consumer swaps them out into its own storage and hands the slots back by moving the head on. Each
+ * side keeps a copy of the other's position and only goes back to the shared one when it runs out,
+ * so in the steady state neither touches the other's cache line more than once per batch.
+ */
+
+namespace mangrove::parser
+{
+	inline namespace internal
+	{
+		using substrate::span;
+	} // namespace internal
+
+	enum class Pipelining : uint8_t
+	{
+		// The parser lexes a batch of tokens itself each time it runs out
+		none,
+		// A producer thread lexes ahead of the parser through a TokenPipe
+		threaded,
+	};
+
+	struct TokenPipe final
+	{
+	private:
+		std::vector<types::Token> _slots;
+		size_t _mask;
+		alignas(64) std::atomic<size_t> _head{};
+		// Consumer side state
+		size_t _knownTail{};
+		bool _drained{false};
+		types::Token _eof{};
+		alignas(64) std::atomic<size_t> _tail{};
+		std::atomic<bool> _stop{false};
+		std::thread _producer{};
+
+		void produce(Tokeniser &lexer) noexcept;
+
+	public:
+		constexpr static size_t defaultCapacity{1024U};
+		// The most tokens the producer lexes before publishing them
+		constexpr static size_t batchSize{64U};
+
+		/** Starts lexing from lexer on a new thread. The capacity is rounded up to a power of two. */
+		TokenPipe(Tokeniser &lexer, size_t capacity = defaultCapacity);
+		TokenPipe(const TokenPipe &) = delete;
+		TokenPipe(TokenPipe &&) = delete;
+		TokenPipe &operator =(const TokenPipe &) = delete;
+		TokenPipe &operator =(TokenPipe &&) = delete;
+		~TokenPipe() noexcept;
+
+		[[nodiscard]] auto capacity() const noexcept { return _slots.size(); }
+		/**
+		 * Moves up to tokens.size() tokens into the caller's storage, waiting for the producer if none
+		 * are ready, and returns how many were moved. This follows the same contract as Tokeniser::next(),
+		 * so once the EOF token has been handed over, each call yields another copy of it.
+		 */
+		[[nodiscard]] size_t next(span<types::Token> tokens) noexcept;
+	};
+} // namespace mangrove::parser
+
+#endif /*PARSER_TOKEN_PIPE_HXX*/
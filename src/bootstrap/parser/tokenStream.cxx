@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cerrno>
+#include <system_error>
+#include <substrate/fd>
+#include "tokenStream.hxx"
+
+using namespace mangrove::parser;
+using namespace mangrove::parser::types;
+using substrate::fd_t;
+
+TokenStream::TokenStream(const path &fileName, const LexerEngine engine)
+{
+	fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+	if (!file.valid())
+		throw std::system_error{errno, std::system_category()};
+	const auto length{file.length()};
+	// PackedToken holds 32-bit offsets, so that bounds the size of file we can represent
+	if (length < 0 || static_cast<uint64_t>(length) > UINT32_MAX)
+		throw std::system_error{std::make_error_code(std::errc::file_too_large)};
+	if (length)
+	{
+		_source = file.map(PROT_READ);
+		if (!_source->valid())
+			throw std::system_error{errno, std::system_category()};
+	}
+	_lines = LineIndex{source()};
+
+	// Lex straight out of our mapping, so the tokeniser neither maps the file again nor indexes it again
+	Tokeniser lexer{source(), _lines, engine};
+	while (true)
+	{
+		const auto &token{lexer.next()};
+		_tokens.emplace_back(token);
+		if (token.type() == TokenType::eof)
+			break;
+	}
+	_tokens.shrink_to_fit();
+}
+
+std::string_view TokenStream::source() const noexcept
+{
+	if (!_source)
+		return {};
+	return {_source->address<const char>(), _source->length()};
+}
+
+std::string_view TokenStream::text(const PackedToken &token) const noexcept
+{
+	const auto range{token.source()};
+	return source().substr(range.offset, range.length);
+}
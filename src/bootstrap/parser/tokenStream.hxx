@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#ifndef PARSER_TOKEN_STREAM_HXX
+#define PARSER_TOKEN_STREAM_HXX
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <substrate/mmap>
+#include "types.hxx"
+#include "lineIndex.hxx"
+#include "tokeniser.hxx"
+
+namespace mangrove::parser
+{
+	inline namespace internal
+	{
+		using std::filesystem::path;
+		using substrate::mmap_t;
+	} // namespace internal
+
+	/**
+	 * A whole file's worth of tokens, stored packed. The source file stays mapped for the
+	 * life of the stream so token text and positions can be recovered from it on demand.
+	 */
+	struct TokenStream final
+	{
+	private:
+		std::optional<mmap_t> _source{};
+		std::vector<types::PackedToken> _tokens{};
+		LineIndex _lines{};
+
+	public:
+		TokenStream(const path &fileName, LexerEngine engine = LexerEngine::scalar);
+
+		[[nodiscard]] std::string_view source() const noexcept;
+		[[nodiscard]] auto size() const noexcept { return _tokens.size(); }
+		[[nodiscard]] auto begin() const noexcept { return _tokens.begin(); }
+		[[nodiscard]] auto end() const noexcept { return _tokens.end(); }
+		[[nodiscard]] const auto &operator [](const size_t index) const noexcept { return _tokens[index]; }
+		[[nodiscard]] const auto &lines() const noexcept { return _lines; }
+
+		[[nodiscard]] std::string_view text(const types::PackedToken &token) const noexcept;
+		[[nodiscard]] types::FileSegment location(const types::PackedToken &token) const noexcept
+			{ return _lines.location(token.source()); }
+	};
+} // namespace mangrove::parser
+
+#endif /*PARSER_TOKEN_STREAM_HXX*/
@@ -1,59 +1,265 @@
 // SPDX-License-Identifier: BSD-3-Clause
-#include <substrate/conversions>
-#include <substrate/console>
+#include <cstring>
+#include <array>
+#include <string>
+#include <system_error>
 #include "tokeniser.hxx"
+#include "lexerTable.hxx"
+#include "integerLiteral.hxx"
+#include "stringLiteral.hxx"
+#include "../core/trace.hxx"
+#include "../core/memory.hxx"
 
 using namespace mangrove::parser;
 using namespace mangrove::parser::types;
 using namespace mangrove::parser::recognisers;
-using substrate::toInt_t;
-using substrate::console;
+using mangrove::parser::integerLiteral::Accumulator;
+using mangrove::parser::stringLiteral::plainRun;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::count;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::Phase;
 using namespace std::literals::string_view_literals;
 
-Tokeniser::Tokeniser(fd_t &&file) noexcept : _file{std::move(file)}
+// The tokens TriviaMode::coalesce folds into the significant tokens around them
+constexpr static TokenSet coalescedTokens{TokenType::whitespace, TokenType::comment};
+
+// Tokens hold 32-bit offsets and trivia lengths, so that bounds the size of file we can represent
+static void checkLength(const int64_t length)
+{
+	if (length > int64_t{UINT32_MAX})
+		throw std::system_error{std::make_error_code(std::errc::file_too_large)};
+}
+
+static std::string_view checkedText(const std::string_view text)
+{
+	checkLength(static_cast<int64_t>(text.length()));
+	return text;
+}
+
+// Reads all that's left of a file that can't be mapped, such as a pipe
+static SourceBuffer readRemaining(const fd_t &file)
+{
+	std::string contents{};
+	std::array<char, 4096U> block{};
+	size_t length{};
+	do
+	{
+		static_cast<void>(file.read(block.data(), block.size(), &length));
+		contents.append(block.data(), length);
+		checkLength(static_cast<int64_t>(contents.length()));
+	}
+	while (length);
+	SourceBuffer buffer{contents.length()};
+	std::memcpy(buffer.data(), contents.data(), contents.length());
+	return buffer;
+}
+
+Tokeniser::Tokeniser(fd_t &&file, const LexerEngine engine, const TriviaMode trivia) :
+	_engine{engine}, _trivia{trivia}, _valid{file.valid()}
 {
-	_token.endsAt(position);
+	if (_valid)
+	{
+		checkLength(file.length());
+		if (file.length() > 0)
+		{
+			_source = file.map(PROT_READ);
+			if (_source->valid())
+				_text = {_source->address<const char>(), _source->length()};
+		}
+		if (!_text.data())
+		{
+			_buffer = readRemaining(file);
+			_text = _buffer.view();
+		}
+		// Build the line index up front so the per-character path needn't track positions
+		_ownLines = LineIndex{_text};
+	}
 	nextChar();
 }
 
+Tokeniser::Tokeniser(SourceBuffer &&source, const TriviaMode trivia) :
+	_engine{LexerEngine::table}, _trivia{trivia}, _buffer{std::move(source)}, _text{checkedText(_buffer.view())},
+	_ownLines{_text} { }
+
+Tokeniser::Tokeniser(const std::string_view source, const LineIndex &lines, const LexerEngine engine,
+	const TriviaMode trivia) : _engine{engine}, _trivia{trivia}, _text{checkedText(source)}, _lines{&lines}
+	{ nextChar(); }
+
+Token::Token(const Token &token) noexcept :
+	_type{token._type}, _value{token._value}, _integer{token._integer}, _source{token._source},
+	_leadingTrivia{token._leadingTrivia}, _trailingTrivia{token._trailingTrivia} { }
+
+void Token::swap(Token &token) noexcept
+{
+	std::swap(_type, token._type);
+	_value.swap(token._value);
+	std::swap(_integer, token._integer);
+	std::swap(_source, token._source);
+	std::swap(_leadingTrivia, token._leadingTrivia);
+	std::swap(_trailingTrivia, token._trailingTrivia);
+}
+
 Token &Tokeniser::next() noexcept
 {
-	if (_file.isEOF())
+	// Timing each token would swamp the trace and the lexer both, so single tokens are only counted - the
+	// time spent lexing a file shows up under the Parser::parse or TokenPipe::produce event that drives it
+	const PhaseScope phase{Phase::lex};
+	count(Counter::tokensLexed);
+	return lexToken();
+}
+
+size_t Tokeniser::next(const span<Token> tokens) noexcept
+{
+	// Pay for the instrumentation once per batch rather than once per token
+	const ScopedTimer timer{"Tokeniser::next(batch)"sv};
+	const PhaseScope phase{Phase::lex};
+	size_t written{};
+	// Lex each token directly into the caller's storage
+	while (written < tokens.size())
 	{
-		_token.set(TokenType::eof);
-		return _token;
+		_target = &tokens[written++];
+		lexToken();
+		if (_target->type() == TokenType::eof)
+			break;
 	}
-	_token.reset();
+	_target = &_token;
+	count(Counter::tokensLexed, written);
+	if (written)
+		_token = Token{tokens[written - 1U]};
+	return written;
+}
+
+Token &Tokeniser::lexToken() noexcept
+{
+	if (_trivia == TriviaMode::preserve)
+		return lexOne();
+	const auto leadingBegin{currentOffset};
+	// Mid-line, the last token's trailing trivia has already taken us up to this one
+	if (_lineStart)
+		skipTrivia();
+	// Any trivia the fast scan in skipTrivia() doesn't recognise is lexed the long way and dropped here instead
+	while (lexOne().typeIn(coalescedTokens))
+		continue;
+	auto &token{*_target};
+	const auto source{token.source()};
+	// A newline ends the line, so whatever follows it belongs to the next token instead
+	_lineStart = token.typeIn({TokenType::newline, TokenType::eof});
+	if (!_lineStart)
+		skipTrivia();
+	token.trivia({uint32_t(leadingBegin), uint32_t(source.offset - leadingBegin)},
+		{source.end(), uint32_t(currentOffset - source.end())});
+	return token;
+}
+
+[[nodiscard]] static inline bool isTriviaLead(const char value) noexcept
+	{ return value == ' ' || value == '\t' || value == '#' || value == '/'; }
+
+// Finds the end of the run of whitespace and comments starting at offset, stopping short of any newline
+[[nodiscard]] static size_t triviaEnd(const std::string_view source, size_t offset) noexcept
+{
+	while (offset < source.length())
+	{
+		const auto value{source[offset]};
+		const auto next{offset + 1U < source.length() ? source[offset + 1U] : '\0'};
+		if (value == ' ' || value == '\t')
+		{
+			while (++offset < source.length() && (source[offset] == ' ' || source[offset] == '\t'))
+				continue;
+			continue;
+		}
+		if (value == '#' || (value == '/' && next == '/'))
+		{
+			// Line comments stop short of the newline - look for \n first, and then only for a \r before it
+			const auto *const begin{source.data() + offset};
+			auto length{source.length() - offset};
+			if (const auto *const newline{static_cast<const char *>(std::memchr(begin, '\n', length))}; newline)
+				length = static_cast<size_t>(newline - begin);
+			if (const auto *const carriage{static_cast<const char *>(std::memchr(begin, '\r', length))}; carriage)
+				length = static_cast<size_t>(carriage - begin);
+			offset += length;
+			continue;
+		}
+		if (value == '/' && next == '*')
+		{
+			// Block comments run to their terminator, or the end of the file if they have none
+			const auto end{source.find("*/"sv, offset + 2U)};
+			offset = end == std::string_view::npos ? source.length() : end + 2U;
+			continue;
+		}
+		break;
+	}
+	return offset;
+}
+
+void Tokeniser::skipTrivia() noexcept
+{
+	const auto source{_text};
+	// Most tokens are directly followed by another, so make that case as cheap as possible
+	if (currentOffset >= source.length() || !isTriviaLead(source[currentOffset]))
+		return;
+	const auto end{triviaEnd(source, currentOffset)};
+	if (end == currentOffset)
+		return;
+	if (_engine == LexerEngine::table)
+	{
+		count(Counter::bytesRead, end - currentOffset);
+		currentOffset = end;
+		return;
+	}
+	skipTo(end);
+}
+
+void Tokeniser::skipTo(const size_t offset) noexcept
+{
+	// The scalar engine decodes a character ahead, so decode afresh from the new offset
+	count(Counter::bytesRead, offset - nextOffset);
+	nextOffset = offset;
+	nextChar();
+}
+
+Token &Tokeniser::lexOne() noexcept
+{
+	if (!_valid)
+	{
+		_target->reset();
+		_target->spans(currentOffset, currentOffset);
+		return *_target;
+	}
+	if (_engine == LexerEngine::table)
+		return nextFromTable();
+	if (atEnd())
+	{
+		_target->set(TokenType::eof);
+		_target->spans(currentOffset, currentOffset);
+		return *_target;
+	}
+	_target->reset();
+	const auto beginOffset{currentOffset};
 	readToken();
-	return _token;
+	_target->spans(beginOffset, currentOffset);
+	return *_target;
 }
 
 Char Tokeniser::nextChar() noexcept
 {
 	// Copy the current character
 	auto value{currentChar};
+	currentOffset = nextOffset;
 	// Handle end-of-file
-	if (_file.isEOF())
+	if (nextOffset >= _text.length())
 	{
 		currentChar = {};
 		return value;
 	}
 
-	// Read the next character
-	currentChar = {_file};
-	// Special-case newline characters
-	if (isNewLine(currentChar))
-	{
-		// If the CR or LF character is on its own of the first part of the windows sequence, update position
-		// If this is the LF of a CR-LF sequence, ignore it so windows line endings don't screw up compiler messages.
-		if ((value != '\r'_u8c && currentChar == '\n'_u8c) || currentChar == '\r'_u8c)
-		{
-			++position.line;
-			position.character = 0;
-		}
-	}
-	else
-		++position.character;
+	// Decode the next character (line and column are recovered from the line index on demand)
+	currentChar = Char{_text.substr(nextOffset)};
+	// As with the table engine, invalid sequences are stepped over a byte at a time
+	const auto length{currentChar.valid() ? currentChar.length() : 1U};
+	nextOffset += length;
+	count(Counter::bytesRead, length);
 	// return the old character
 	return value;
 }
@@ -61,8 +267,7 @@ Char Tokeniser::nextChar() noexcept
 void Tokeniser::finaliseToken(const std::optional<TokenType> type, String &&value) noexcept
 {
 	if (type)
-		_token.set(*type, std::move(value));
-	_token.endsAt(position);
+		_target->set(*type, std::move(value));
 }
 
 void Tokeniser::readToken() noexcept
@@ -71,7 +276,7 @@ void Tokeniser::readToken() noexcept
 	{
 		case ' ':
 		case '\t':
-			_token.set(TokenType::whitespace);
+			_target->set(TokenType::whitespace);
 			break;
 		case '#':
 			nextChar();
@@ -79,37 +284,37 @@ void Tokeniser::readToken() noexcept
 			return;
 		case '\r':
 		case '\n':
-			_token.set(TokenType::newline);
+			_target->set(TokenType::newline);
 			break;
 		case '.':
 			readEllipsisToken();
 			break;
 		case ';':
-			_token.set(TokenType::semi);
+			_target->set(TokenType::semi);
 			break;
 		case '{':
-			_token.set(TokenType::leftBrace);
+			_target->set(TokenType::leftBrace);
 			break;
 		case '}':
-			_token.set(TokenType::rightBrace);
+			_target->set(TokenType::rightBrace);
 			break;
 		case '(':
-			_token.set(TokenType::leftParen);
+			_target->set(TokenType::leftParen);
 			break;
 		case ')':
-			_token.set(TokenType::rightParen);
+			_target->set(TokenType::rightParen);
 			break;
 		case '[':
-			_token.set(TokenType::leftSquare);
+			_target->set(TokenType::leftSquare);
 			break;
 		case ']':
-			_token.set(TokenType::rightSquare);
+			_target->set(TokenType::rightSquare);
 			break;
 		case ',':
-			_token.set(TokenType::comma);
+			_target->set(TokenType::comma);
 			break;
 		case ':':
-			_token.set(TokenType::colon);
+			_target->set(TokenType::colon);
 			break;
 		case '"':
 			readStringToken();
@@ -118,7 +323,7 @@ void Tokeniser::readToken() noexcept
 			readCharToken();
 			break;
 		case '~':
-			_token.set(TokenType::invert, '~'_u8c);
+			_target->set(TokenType::invert, '~'_u8c);
 			break;
 		case '/':
 			readDivToken();
@@ -150,91 +355,92 @@ void Tokeniser::readToken() noexcept
 			readExtendedToken();
 			return;
 	}
-	finaliseToken();
 	nextChar();
 }
 
 void Tokeniser::readExtendedToken() noexcept
 {
-	_token.set(TokenType::ident);
 	if (isAlpha(currentChar) || isUnderscore(currentChar))
-	{
-		auto token{readAlphaNumToken()};
-		if (token.isEmpty() || _file.isEOF())
-			return;
-		if (isTrue(token) || isFalse(token))
-			_token.set(TokenType::boolLit);
-		else if (isNull(token))
-			_token.set(TokenType::nullptrLit);
-		else if (token == u8"and"_sv)
-			_token.set(TokenType::logicOp, '&'_u8c);
-		else if (token == u8"or"_sv)
-			_token.set(TokenType::logicOp, '|'_u8c);
-		else if (token == u8"not"_sv)
-			_token.set(TokenType::invert, '!'_u8c);
-		else if (isLocationSpec(token))
-			_token.set(TokenType::locationSpec);
-		else if (isStorageSpec(token))
-			_token.set(TokenType::storageSpec);
-		else if (isNew(token))
-			_token.set(TokenType::newStmt);
-		else if (isDelete(token))
-			_token.set(TokenType::deleteStmt);
-		else if (isFrom(token))
-			_token.set(TokenType::fromStmt);
-		else if (isImport(token))
-			_token.set(TokenType::importStmt);
-		else if (isAs(token))
-			_token.set(TokenType::asStmt);
-		else if (isReturn(token))
-			_token.set(TokenType::returnStmt);
-		else if (isIfStmt(token))
-			_token.set(TokenType::ifStmt);
-		else if (isElifStmt(token))
-			_token.set(TokenType::elifStmt);
-		else if (isElseStmt(token))
-			_token.set(TokenType::elseStmt);
-		else if (isForStmt(token))
-			_token.set(TokenType::forStmt);
-		else if (isWhileStmt(token))
-			_token.set(TokenType::whileStmt);
-		else if (isDoStmt(token))
-			_token.set(TokenType::doStmt);
-
-		else if (isNone(token))
-			_token.set(TokenType::noneType);
-		else if (isClass(token))
-			_token.set(TokenType::classDef);
-		else if (isEnum(token))
-			_token.set(TokenType::enumDef);
-		else if (isFunctionDef(token))
-			_token.set(TokenType::functionDef);
-		else if (isOperatorDef(token))
-			_token.set(TokenType::operatorDef);
-		else if (isVisibility(token))
-			_token.set(TokenType::visibility);
-		else if (isUnsafe(token))
-			_token.set(TokenType::unsafe);
-
-		// Make sure the token's value is set to the identifier string now we've classified the type
-		if (_token.value().isEmpty())
-			_token.value(std::move(token));
-	}
+		classifyIdent(readAlphaNumToken());
 	else if (isDigit(currentChar))
 		readIntToken();
 	else
 	{
-		_token.set(TokenType::invalid);
+		_target->set(TokenType::invalid);
 		nextChar();
 	}
 }
 
+void Tokeniser::classifyIdent(String &&token) noexcept
+{
+	_target->set(TokenType::ident);
+	if (token.isEmpty())
+		return;
+	if (isTrue(token) || isFalse(token))
+		_target->set(TokenType::boolLit);
+	else if (isNull(token))
+		_target->set(TokenType::nullptrLit);
+	else if (token == u8"and"_sv)
+		_target->set(TokenType::logicOp, '&'_u8c);
+	else if (token == u8"or"_sv)
+		_target->set(TokenType::logicOp, '|'_u8c);
+	else if (token == u8"not"_sv)
+		_target->set(TokenType::invert, '!'_u8c);
+	else if (isLocationSpec(token))
+		_target->set(TokenType::locationSpec);
+	else if (isStorageSpec(token))
+		_target->set(TokenType::storageSpec);
+	else if (isNew(token))
+		_target->set(TokenType::newStmt);
+	else if (isDelete(token))
+		_target->set(TokenType::deleteStmt);
+	else if (isFrom(token))
+		_target->set(TokenType::fromStmt);
+	else if (isImport(token))
+		_target->set(TokenType::importStmt);
+	else if (isAs(token))
+		_target->set(TokenType::asStmt);
+	else if (isReturn(token))
+		_target->set(TokenType::returnStmt);
+	else if (isIfStmt(token))
+		_target->set(TokenType::ifStmt);
+	else if (isElifStmt(token))
+		_target->set(TokenType::elifStmt);
+	else if (isElseStmt(token))
+		_target->set(TokenType::elseStmt);
+	else if (isForStmt(token))
+		_target->set(TokenType::forStmt);
+	else if (isWhileStmt(token))
+		_target->set(TokenType::whileStmt);
+	else if (isDoStmt(token))
+		_target->set(TokenType::doStmt);
+
+	else if (isNone(token))
+		_target->set(TokenType::noneType);
+	else if (isClass(token))
+		_target->set(TokenType::classDef);
+	else if (isEnum(token))
+		_target->set(TokenType::enumDef);
+	else if (isFunctionDef(token))
+		_target->set(TokenType::functionDef);
+	else if (isOperatorDef(token))
+		_target->set(TokenType::operatorDef);
+	else if (isVisibility(token))
+		_target->set(TokenType::visibility);
+	else if (isUnsafe(token))
+		_target->set(TokenType::unsafe);
+
+	// Make sure the token's value is set to the identifier string now we've classified the type
+	if (_target->value().isEmpty())
+		_target->value(std::move(token));
+}
+
 void Tokeniser::readPartComment() noexcept
 {
-	_token.set(TokenType::comment);
+	_target->set(TokenType::comment);
 	auto foundEnd{false};
 	String comment{};
-	while (!foundEnd && !_file.isEOF())
+	while (!foundEnd && !atEnd())
 	{
 		if (currentChar == '*'_u8c)
 		{
@@ -255,76 +461,69 @@ void Tokeniser::readPartComment() noexcept
 
 void Tokeniser::readLineComment() noexcept
 {
-	_token.set(TokenType::comment);
+	_target->set(TokenType::comment);
 	String comment{};
-	while (!_file.isEOF() && !isNewLine(currentChar))
+	while (!atEnd() && !isNewLine(currentChar))
 		comment += nextChar();
 	finaliseToken(TokenType::comment, std::move(comment));
 }
 
 void Tokeniser::readEllipsisToken() noexcept
 {
-	_token.set(TokenType::dot);
-	const auto currentPosition{position};
-	const auto offset{_file.tell()};
-	nextChar();
-	if (nextChar() == '.'_u8c && currentChar == '.'_u8c)
-		_token.set(TokenType::ellipsis);
-	else
+	_target->set(TokenType::dot);
+	// Look ahead for the rest of an ellipsis rather than consuming characters we'd have to give back
+	if (_text.substr(nextOffset, 2U) == ".."sv)
 	{
-		// Seek back to where we were, taking into account conditions like EOF occuring
-		if (_file.seek(offset, SEEK_SET) != offset)
-			// We should handle this better, but thought needs to be put into /how/.
-			console.error("File seek failed, tokenisation will now be unreliable"sv);
-		position = currentPosition;
+		nextChar();
+		nextChar();
+		_target->set(TokenType::ellipsis);
 	}
 }
 
 void Tokeniser::readBinToken() noexcept
 {
-	String literal{};
-	_token.set(TokenType::binLit);
+	Accumulator<2U> literal{};
+	_target->set(TokenType::binLit);
 	nextChar();
 	while (isBin(currentChar))
-		literal += nextChar();
-	if (literal.isEmpty())
-		_token.set(TokenType::invalid);
+		literal.push(static_cast<char>(nextChar().toCodePoint()));
+	if (literal.empty())
+		_target->set(TokenType::invalid);
 	else
-		_token.value(std::move(literal));
+		_target->integer(literal.value());
 }
 
 void Tokeniser::readOctToken() noexcept
 {
-	String literal{};
-	_token.set(TokenType::octLit);
+	Accumulator<8U> literal{};
+	_target->set(TokenType::octLit);
 	nextChar();
 	while (isOct(currentChar))
-		literal += nextChar();
-	if (literal.isEmpty())
-		_token.set(TokenType::invalid);
+		literal.push(static_cast<char>(nextChar().toCodePoint()));
+	if (literal.empty())
+		_target->set(TokenType::invalid);
 	else
-		_token.value(std::move(literal));
+		_target->integer(literal.value());
 }
 
 void Tokeniser::readHexToken() noexcept
 {
-	String literal{};
-	_token.set(TokenType::hexLit);
+	Accumulator<16U> literal{};
+	_target->set(TokenType::hexLit);
 	nextChar();
 	while (isHex(currentChar))
-		literal += nextChar();
-	if (literal.isEmpty())
-		_token.set(TokenType::invalid);
+		literal.push(static_cast<char>(nextChar().toCodePoint()));
+	if (literal.empty())
+		_target->set(TokenType::invalid);
 	else
-		_token.value(std::move(literal));
+		_target->integer(literal.value());
 }
 
 void Tokeniser::readIntToken() noexcept
 {
-	String literal{};
-	Char firstDigit{currentChar};
-	_token.set(TokenType::intLit);
-	if (firstDigit == '0'_u8c)
+	Accumulator<10U> literal{};
+	_target->set(TokenType::intLit);
+	if (currentChar == '0'_u8c)
 	{
 		nextChar();
 		if (isBeginBin(currentChar))
@@ -333,11 +532,11 @@ void Tokeniser::readIntToken() noexcept
 			return readOctToken();
 		if (isBeginHex(currentChar))
 			return readHexToken();
-		literal += firstDigit;
+		literal.push('0');
 	}
 	while (isDigit(currentChar))
-		literal += nextChar();
-	_token.set(TokenType::intLit, std::move(literal));
+		literal.push(static_cast<char>(nextChar().toCodePoint()));
+	_target->integer(literal.value());
 }
 
 Char Tokeniser::readUnicode(const Char &normalQuote, const Char &escapedQuote) noexcept
@@ -376,12 +575,15 @@ Char Tokeniser::readUnicode(const Char &normalQuote, const Char &escapedQuote) n
 				break;
 			case 'u':
 			case 'U': {
-				const auto type{_token.type()};
+				const auto type{_target->type()};
 				readHexToken();
-				// We get to abuse the StringView abstraction here as we're guaranteed ASCII-only
-				// values being present in _token.value() by readHexToken(), so this is safe.
-				result = {toInt_t<uint32_t>{_token.value().data(), _token.value().byteLength()}.fromHex()};
-				_token.set(type);
+				// An escape with no digits decodes to NUL, and one too large to be a code point is invalid
+				const auto codePoint{_target->valid() ? _target->integer() : std::optional<uint64_t>{0U}};
+				if (codePoint && *codePoint < Char::invalidCodePoint)
+					result = {static_cast<uint32_t>(*codePoint)};
+				else
+					result = {Char::invalidCodePoint};
+				_target->set(type);
 				return result;
 			}
 		}
@@ -394,38 +596,48 @@ Char Tokeniser::readUnicode(const Char &normalQuote, const Char &escapedQuote) n
 
 void Tokeniser::readStringToken() noexcept
 {
-	_token.set(TokenType::stringLit);
+	_target->set(TokenType::stringLit);
 	nextChar();
 	String literal{};
 	while (!isDoubleQuote(currentChar))
 	{
+		// Copy plain text through in bulk and skip on past it, leaving escapes to be decoded one by one
+		if (currentOffset < nextOffset)
+		{
+			if (const auto run{plainRun(_text.substr(currentOffset), '"')}; run.bytes)
+			{
+				literal.append(StringView{_text.substr(currentOffset, run.bytes), run.chars});
+				skipTo(currentOffset + run.bytes);
+				continue;
+			}
+		}
 		const auto value{readUnicode('\''_u8c, '"'_u8c)};
 		if (!value.valid())
 		{
-			_token.set(TokenType::invalid);
+			_target->set(TokenType::invalid);
 			return;
 		}
 		literal += value;
 	}
-	_token.value(std::move(literal));
+	_target->value(std::move(literal));
 }
 
 void Tokeniser::readCharToken() noexcept
 {
-	_token.set(TokenType::charLit);
+	_target->set(TokenType::charLit);
 	nextChar();
 	if (isSingleQuote(currentChar))
 	{
-		_token.set(TokenType::invalid);
+		_target->set(TokenType::invalid);
 		return;
 	}
 	const auto literal{readUnicode('"'_u8c, '\''_u8c)};
 	if (!literal.valid() || !isSingleQuote(currentChar))
 	{
-		_token.set(TokenType::invalid);
+		_target->set(TokenType::invalid);
 		return;
 	}
-	_token.value(literal);
+	_target->value(literal);
 }
 
 void Tokeniser::readDivToken() noexcept
@@ -523,7 +735,6 @@ void Tokeniser::readRelationToken() noexcept
 
 void Tokeniser::readEqualityToken() noexcept
 {
-	finaliseToken();
 	const auto token{nextChar()};
 	if (isEquals(currentChar))
 	{
@@ -533,9 +744,9 @@ void Tokeniser::readEqualityToken() noexcept
 	else
 	{
 		if (isEquals(token))
-			_token.set(TokenType::assignOp, token);
+			_target->set(TokenType::assignOp, token);
 		else
-			_token.set(TokenType::invert, token);
+			_target->set(TokenType::invert, token);
 	}
 }
 
@@ -543,9 +754,6 @@ String Tokeniser::readAlphaNumToken() noexcept
 {
 	String token{};
 	while (isAlphaNum(currentChar) || isUnderscore(currentChar))
-	{
-		finaliseToken();
 		token += nextChar();
-	}
 	return token;
 }
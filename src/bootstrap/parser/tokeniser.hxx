@@ -2,29 +2,84 @@
 #ifndef PARSER_TOKENISER_HXX
 #define PARSER_TOKENISER_HXX
 
+#include <cstdint>
 #include <optional>
 #include <utility>
 #include <substrate/fd>
+#include <substrate/mmap>
+#include <substrate/span>
 #include "recogniser.hxx"
 #include "types.hxx"
+#include "lineIndex.hxx"
+#include "../core/sourceLoader.hxx"
 
 namespace mangrove::parser
 {
 	inline namespace internal
 	{
 		using substrate::fd_t;
+		using substrate::mmap_t;
+		using substrate::span;
+		using mangrove::core::loader::SourceBuffer;
 	} // namespace internal
 
+	enum class LexerEngine : uint8_t
+	{
+		// The hand-written character-at-a-time lexer
+		scalar,
+		// The compile-time generated DFA (see lexerTable.hxx)
+		table,
+	};
+
+	enum class TriviaMode : uint8_t
+	{
+		// Every space, tab and comment is its own token, for tools that need to reproduce the source exactly
+		preserve,
+		/**
+		 * Runs of whitespace and comments are skipped in bulk and only recorded as byte ranges on the
+		 * tokens either side of them. A token's trailing trivia runs up to the end of its line, and
+		 * anything else before it is its leading trivia. Newlines are significant so remain tokens.
+		 */
+		coalesce,
+	};
+
+	/**
+	 * Both engines run over the whole input in memory - a mapping of the file where it can be mapped,
+	 * otherwise a buffer it's read into - which is also what the line index is built over.
+	 */
 	struct Tokeniser final
 	{
 	private:
-		fd_t _file;
+		LexerEngine _engine;
+		TriviaMode _trivia;
+		// Whether there's any input at all - a file that couldn't be opened lexes as a run of invalid tokens
+		bool _valid{true};
+		// Whether the next token starts a line, so has leading trivia to skip
+		bool _lineStart{true};
+		std::optional<mmap_t> _source{};
+		SourceBuffer _buffer{};
+		// The whole input, from the mapping, the buffer or the caller
+		std::string_view _text{};
+		LineIndex _ownLines{};
+		// The line index over _text - _ownLines, or the caller's when they already had one
+		const LineIndex *_lines{&_ownLines};
 		Char currentChar{};
-		types::Position position{};
+		// Byte offsets of currentChar and of the character following it in the input
+		size_t currentOffset{};
+		size_t nextOffset{};
 		types::Token _token{};
+		// The token being lexed into - _token, or a slot in the caller's storage during a batched next()
+		types::Token *_target{&_token};
 
+		[[nodiscard]] bool atEnd() const noexcept { return currentOffset >= _text.length(); }
 		Char nextChar() noexcept;
+		types::Token &lexToken() noexcept;
+		types::Token &lexOne() noexcept;
+		void skipTrivia() noexcept;
+		void skipTo(size_t offset) noexcept;
 		void finaliseToken(std::optional<types::TokenType> type = {}, String &&value = {}) noexcept;
+		void classifyIdent(String &&token) noexcept;
+		types::Token &nextFromTable() noexcept;
 		void readToken() noexcept;
 		void readExtendedToken() noexcept;
 
@@ -48,10 +103,37 @@ namespace mangrove::parser
 		[[nodiscard]] String readAlphaNumToken() noexcept;
 
 	public:
-		Tokeniser(fd_t &&file) noexcept;
+		/** Throws std::system_error (file_too_large) for files too big for a token's 32-bit offsets */
+		Tokeniser(fd_t &&file, LexerEngine engine = LexerEngine::scalar,
+			TriviaMode trivia = TriviaMode::preserve);
+		/** Lexes an already loaded file, always using the table engine */
+		Tokeniser(SourceBuffer &&source, TriviaMode trivia = TriviaMode::preserve);
+		/**
+		 * Lexes source as held by the caller, along with the line index they built over it. Both are
+		 * borrowed, so must outlive the tokeniser. Throws std::system_error (file_too_large) as above.
+		 */
+		Tokeniser(std::string_view source, const LineIndex &lines, LexerEngine engine = LexerEngine::scalar,
+			TriviaMode trivia = TriviaMode::preserve);
+		// _target and _lines point into the tokeniser itself, so it has to stay where it was constructed
+		Tokeniser(const Tokeniser &) = delete;
+		Tokeniser(Tokeniser &&) = delete;
+		Tokeniser &operator =(const Tokeniser &) = delete;
+		Tokeniser &operator =(Tokeniser &&) = delete;
+		~Tokeniser() noexcept = default;
 
 		[[nodiscard]] auto &token() const noexcept { return _token; }
+		[[nodiscard]] auto engine() const noexcept { return _engine; }
+		[[nodiscard]] auto trivia() const noexcept { return _trivia; }
+		[[nodiscard]] const auto &lines() const noexcept { return *_lines; }
+		[[nodiscard]] types::FileSegment location(const types::Token &token) const noexcept
+			{ return _lines->location(token.source()); }
 		types::Token &next() noexcept;
+		/**
+		 * Lexes up to tokens.size() tokens into the caller's storage, stopping after the EOF token,
+		 * and returns how many were written. Once the input is exhausted, each call yields one EOF token.
+		 * Afterwards token() holds a copy of the last token written.
+		 */
+		[[nodiscard]] size_t next(span<types::Token> tokens) noexcept;
 	};
 } // namespace mangrove::parser
 
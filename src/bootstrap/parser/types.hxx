@@ -4,7 +4,9 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <optional>
 #include <utility>
+#include "../core/flags.hxx"
 #include "../core/utf8/string.hxx"
 
 namespace mangrove::parser
@@ -83,6 +85,17 @@ namespace mangrove::parser::types
 		unsafe
 	};
 
+	static_assert(static_cast<uint16_t>(TokenType::unsafe) < 64U, "TokenType has outgrown TokenSet");
+	// Constant sets of token types for the parser, allowing membership tests in a single bit test
+	using TokenSet = mangrove::core::BitFlags<uint64_t, TokenType>;
+
+	constexpr inline TokenSet triviaTokens{TokenType::whitespace, TokenType::comment, TokenType::newline};
+	constexpr inline TokenSet literalTokens
+	{
+		TokenType::binLit, TokenType::octLit, TokenType::hexLit, TokenType::intLit, TokenType::stringLit,
+		TokenType::charLit, TokenType::boolLit, TokenType::float32Lit, TokenType::float64Lit, TokenType::nullptrLit
+	};
+
 	struct Position final
 	{
 		size_t line{};
@@ -95,45 +108,103 @@ namespace mangrove::parser::types
 		Position end{SIZE_MAX, SIZE_MAX};
 	};
 
+	// Byte range of a token within its source file
+	struct SourceRange final
+	{
+		uint32_t offset{};
+		uint32_t length{};
+
+		[[nodiscard]] constexpr uint32_t end() const noexcept { return offset + length; }
+	};
+
 	struct Token final
 	{
 	private:
 		TokenType _type{TokenType::invalid};
 		String _value{};
-		FileSegment _location{};
+		// Integer literals are decoded as they're lexed and carry no text; nullopt if the value overflowed
+		std::optional<uint64_t> _integer{};
+		SourceRange _source{};
+		// When lexing with trivia coalesced, the whitespace and comments either side of the token
+		SourceRange _leadingTrivia{};
+		SourceRange _trailingTrivia{};
 
 	public:
 		Token() noexcept = default;
 		Token(const Token &token) noexcept;
 		Token(Token &&token) noexcept : Token{} { swap(token); }
 
+		Token &operator =(Token &&token) noexcept
+		{
+			swap(token);
+			return *this;
+		}
+
 		[[nodiscard]] auto type() const noexcept { return _type; }
 		[[nodiscard]] StringView value() const noexcept { return _value; }
 		void value(String &&value) noexcept { _value = std::move(value); }
 		void value(const StringView &value) noexcept { _value = value; }
-		[[nodiscard]] auto location() const noexcept { return _location; }
+		[[nodiscard]] auto integer() const noexcept { return _integer; }
+		void integer(const std::optional<uint64_t> value) noexcept { _integer = value; }
+		[[nodiscard]] auto source() const noexcept { return _source; }
+		[[nodiscard]] auto leadingTrivia() const noexcept { return _leadingTrivia; }
+		[[nodiscard]] auto trailingTrivia() const noexcept { return _trailingTrivia; }
 		[[nodiscard]] bool valid() const noexcept { return _type != TokenType::invalid; }
+		[[nodiscard]] bool typeIn(const TokenSet &types) const noexcept { return types.includes(_type); }
 
 		void set(const TokenType type, String &&value = String{})
 		{
 			_type = type;
 			_value = std::move(value);
+			_integer = std::nullopt;
 		}
 
 		void reset()
 		{
 			_type = TokenType::invalid;
 			_value = {};
-			_location.begin = _location.end;
+			_integer = std::nullopt;
+			_source = {_source.end(), 0U};
+			_leadingTrivia = {};
+			_trailingTrivia = {};
 		}
 
-		void beginsAt(const Position position)
-			{ _location.begin = position; }
-		void endsAt(const Position position)
-			{ _location.end = position; }
+		void spans(const size_t beginOffset, const size_t endOffset) noexcept
+			{ _source = {uint32_t(beginOffset), uint32_t(endOffset - beginOffset)}; }
+
+		void trivia(const SourceRange leading, const SourceRange trailing) noexcept
+		{
+			_leadingTrivia = leading;
+			_trailingTrivia = trailing;
+		}
 
 		void swap(Token &token) noexcept;
 	};
+
+	/**
+	 * Compact form of a token for storing whole-file token streams. The value is not held,
+	 * rather the token refers back to its bytes in the source, and its line and column are
+	 * recovered from the file's LineIndex on demand.
+	 */
+	struct PackedToken final
+	{
+	private:
+		TokenType _type{TokenType::invalid};
+		SourceRange _source{};
+
+	public:
+		constexpr PackedToken() noexcept = default;
+		constexpr PackedToken(const TokenType type, const SourceRange source) noexcept :
+			_type{type}, _source{source} { }
+		PackedToken(const Token &token) noexcept : _type{token.type()}, _source{token.source()} { }
+
+		[[nodiscard]] constexpr auto type() const noexcept { return _type; }
+		[[nodiscard]] constexpr auto source() const noexcept { return _source; }
+		[[nodiscard]] constexpr bool valid() const noexcept { return _type != TokenType::invalid; }
+		[[nodiscard]] constexpr bool typeIn(const TokenSet &types) const noexcept { return types.includes(_type); }
+	};
+
+	static_assert(sizeof(PackedToken) == 12U, "PackedToken should pack down to 12 bytes");
 } // namespace mangrove::parser::types
 
 #endif /*PARSER_TYPES_HXX*/
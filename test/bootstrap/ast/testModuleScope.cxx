@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/ast/moduleScope.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using namespace mangrove::core::utf8::literals;
+using mangrove::core::utf8::String;
+using mangrove::ast::symbolTable::ModuleScope;
+using mangrove::ast::symbolTable::Symbol;
+using mangrove::ast::symbolTable::SymbolTypes;
+
+constexpr static size_t threadCount{8U};
+constexpr static size_t identCount{5000U};
+
+class testModuleScope final : public testsuite
+{
+private:
+	static std::vector<String> makeIdents()
+	{
+		std::vector<String> idents{};
+		idents.reserve(identCount);
+		for (size_t ident{}; ident < identCount; ++ident)
+			idents.emplace_back(std::string_view{fmt::format("symbol{}"sv, ident)});
+		return idents;
+	}
+
+	void testInsertFind()
+	{
+		ModuleScope scope{3U};
+		// Bucket counts are rounded up to a power of 2
+		assertEqual(scope.bucketCount(), 4U);
+		assertNull(scope.find(u8"a"_sv));
+
+		const auto [symbolA, insertedA]{scope.insert(u8"a"_sv, SymbolTypes::int32Bit)};
+		assertNotNull(symbolA);
+		assertTrue(insertedA);
+		assertTrue(symbolA->value() == u8"a"_sv);
+		assertTrue(symbolA->type() == SymbolTypes::int32Bit);
+
+		// A second declaration of the same name gets back the original symbol, untouched
+		const auto [symbolB, insertedB]{scope.insert(u8"a"_sv, SymbolTypes::boolVal)};
+		assertFalse(insertedB);
+		assertTrue(symbolB == symbolA);
+		assertTrue(symbolB->type() == SymbolTypes::int32Bit);
+
+		// Enough names that every bucket chains several entries
+		const auto idents{makeIdents()};
+		for (const auto &ident : idents)
+			assertTrue(scope.insert(ident).second);
+		assertEqual(scope.entryCount(), identCount + 1U);
+		for (const auto &ident : idents)
+		{
+			const auto *const symbol{scope.find(ident)};
+			assertNotNull(symbol);
+			assertTrue(symbol->value() == ident);
+		}
+		assertTrue(scope.find(u8"a"_sv) == symbolA);
+		assertNull(scope.find(u8"symbol"_sv));
+	}
+
+	void testRacingInserts()
+	{
+		// Every thread declares every name, so each name is contended by all of them at once
+		ModuleScope scope{64U};
+		const auto idents{makeIdents()};
+		std::array<std::vector<Symbol *>, threadCount> results{};
+		std::array<size_t, threadCount> wins{};
+		std::atomic<bool> start{false};
+		std::vector<std::thread> threads{};
+		for (size_t thread{}; thread < threadCount; ++thread)
+		{
+			threads.emplace_back([&, thread]()
+			{
+				auto &symbols{results[thread]};
+				symbols.reserve(idents.size());
+				while (!start.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (const auto &ident : idents)
+				{
+					const auto [symbol, inserted]{scope.insert(ident)};
+					symbols.push_back(symbol);
+					wins[thread] += inserted ? 1U : 0U;
+				}
+			});
+		}
+		start.store(true, std::memory_order_release);
+		for (auto &thread : threads)
+			thread.join();
+
+		// Exactly one thread won each name, and all of them agree on which symbol it is
+		size_t totalWins{};
+		for (const auto threadWins : wins)
+			totalWins += threadWins;
+		assertEqual(totalWins, identCount);
+		assertEqual(scope.entryCount(), identCount);
+		for (size_t ident{}; ident < identCount; ++ident)
+		{
+			const auto *const symbol{scope.find(idents[ident])};
+			assertNotNull(symbol);
+			for (const auto &symbols : results)
+				assertTrue(symbols[ident] == symbol);
+		}
+	}
+
+	void testConcurrentLookups()
+	{
+		// Readers resolving names while a writer declares them must only ever see complete symbols
+		ModuleScope scope{256U};
+		const auto idents{makeIdents()};
+		std::atomic<bool> done{false};
+		std::atomic<size_t> badLookups{};
+		std::vector<std::thread> readers{};
+		for (size_t reader{}; reader < threadCount - 1U; ++reader)
+		{
+			readers.emplace_back([&]()
+			{
+				while (!done.load(std::memory_order_acquire))
+				{
+					for (const auto &ident : idents)
+					{
+						const auto *const symbol{scope.find(ident)};
+						if (symbol && (!(symbol->value() == ident) || !(symbol->type() == SymbolTypes::character)))
+							badLookups.fetch_add(1U, std::memory_order_relaxed);
+					}
+				}
+			});
+		}
+		for (const auto &ident : idents)
+			assertTrue(scope.insert(ident, SymbolTypes::character).second);
+		done.store(true, std::memory_order_release);
+		for (auto &reader : readers)
+			reader.join();
+		assertEqual(badLookups.load(), 0U);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testInsertFind)
+		CRUNCHpp_TEST(testRacingInserts)
+		CRUNCHpp_TEST(testConcurrentLookups)
+	}
+};
+
+CRUNCHpp_TESTS(testModuleScope)
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/ast/symbolTable.hxx"
+
+using namespace std::literals::string_literals;
+using substrate::console;
+using mangrove::ast::symbolTable::typePool;
+using mangrove::ast::symbolTable::TypeID;
+using mangrove::ast::symbolTable::TypeFlags;
+using mangrove::ast::symbolTable::SymbolType;
+using mangrove::ast::symbolTable::SymbolTypes;
+
+constexpr static size_t threadCount{8U};
+
+class testTypePool final : public testsuite
+{
+private:
+	void testInterning()
+	{
+		// The empty type is always interned first, so default constructed types need no lookup
+		assertTrue(typePool().intern(TypeFlags{}) == TypeID::invalid);
+		assertTrue(SymbolType{}.isInvalid());
+		assertTrue(SymbolType{TypeFlags{}}.isInvalid());
+
+		const SymbolType int32{{SymbolTypes::signedVal, SymbolTypes::int32Bit}};
+		const SymbolType sameInt32{{SymbolTypes::int32Bit, SymbolTypes::signedVal}};
+		const SymbolType uint32{{SymbolTypes::unsignedVal, SymbolTypes::int32Bit}};
+		assertFalse(int32.isInvalid());
+		assertTrue(int32.id() == sameInt32.id());
+		assertTrue(int32 == sameInt32);
+		assertFalse(int32 == uint32);
+		assertTrue(uint32.without(SymbolTypes::unsignedVal) == SymbolType{SymbolTypes::int32Bit});
+		assertTrue(uint32.flags() == TypeFlags{SymbolTypes::unsignedVal, SymbolTypes::int32Bit});
+		assertTrue(SymbolType{SymbolTypes::boolVal} == SymbolTypes::boolVal);
+		// IDs are dense - interning a type once more doesn't use up another
+		const auto typeCount{typePool().typeCount()};
+		assertTrue(typePool().intern(TypeFlags{SymbolTypes::unsignedVal, SymbolTypes::int32Bit}) == uint32.id());
+		assertEqual(typePool().typeCount(), typeCount);
+	}
+
+	void testProperties()
+	{
+		const SymbolType int8{SymbolTypes::int8Bit};
+		assertTrue(int8.isInteger());
+		assertTrue(int8.isSigned());
+		assertEqual(int8.width(), 8U);
+		const SymbolType uint16{{SymbolTypes::unsignedVal, SymbolTypes::int8Bit, SymbolTypes::int16Bit}};
+		assertTrue(uint16.isInteger());
+		assertFalse(uint16.isSigned());
+		assertEqual(uint16.width(), 16U);
+		const SymbolType int64{{SymbolTypes::signedVal, SymbolTypes::int64Bit}};
+		assertEqual(int64.width(), 64U);
+		const SymbolType string{{SymbolTypes::character, SymbolTypes::list}};
+		assertFalse(string.isInteger());
+		assertFalse(string.isSigned());
+		assertEqual(string.width(), 0U);
+		assertFalse(string.isType());
+
+		// Types of types carry their value type precomputed
+		const SymbolType stringType{{SymbolTypes::type, SymbolTypes::character, SymbolTypes::list}};
+		assertTrue(stringType.isType());
+		assertTrue(stringType.includes(SymbolTypes::list));
+		assertTrue(stringType.forValue() == string);
+		const SymbolType type{SymbolTypes::type};
+		assertTrue(type.isType());
+		assertTrue(type.forValue() == type);
+		assertTrue(string.forValue() == string);
+	}
+
+	void testNames()
+	{
+		assertEqual(SymbolType{}.toString(), "invalid"s);
+		assertEqual(SymbolType{{SymbolTypes::signedVal, SymbolTypes::int16Bit}}.toString(), "Int16"s);
+		assertEqual(SymbolType{{SymbolTypes::unsignedVal, SymbolTypes::int64Bit}}.toString(), "uInt64"s);
+		assertEqual(SymbolType{{SymbolTypes::character, SymbolTypes::list}}.toString(), "String"s);
+		assertEqual(SymbolType{{SymbolTypes::reference, SymbolTypes::boolVal}}.toString(), "reference Bool"s);
+		assertEqual(SymbolType{{SymbolTypes::type, SymbolTypes::pointer, SymbolTypes::unsignedVal,
+			SymbolTypes::int8Bit}}.toString(), "type pointer 'uInt8'"s);
+		assertEqual(SymbolType{{SymbolTypes::type, SymbolTypes::structVal, SymbolTypes::array}}.toString(),
+			"type 'Set'"s);
+		assertEqual(SymbolType{SymbolTypes::type}.toString(), "type"s);
+		assertEqual(SymbolType{SymbolTypes::function}.toString(), "function"s);
+		assertEqual(fmt::format("{}", TypeFlags{SymbolTypes::structVal, SymbolTypes::list}), "Dict"s);
+		assertEqual(fmt::format("{}", TypeFlags{SymbolTypes::pack}), "invalid"s);
+	}
+
+	void testConcurrentInterning()
+	{
+		// Every thread interns the same fresh types at once and must get back the same IDs
+		constexpr std::array combinations
+		{
+			TypeFlags{SymbolTypes::pack, SymbolTypes::int8Bit},
+			TypeFlags{SymbolTypes::pack, SymbolTypes::int16Bit},
+			TypeFlags{SymbolTypes::pack, SymbolTypes::character},
+			TypeFlags{SymbolTypes::pack, SymbolTypes::type, SymbolTypes::boolVal},
+			TypeFlags{SymbolTypes::pack, SymbolTypes::pointer, SymbolTypes::function},
+		};
+		std::array<std::array<TypeID, combinations.size()>, threadCount> results{};
+		std::vector<std::thread> threads{};
+		for (size_t thread{}; thread < threadCount; ++thread)
+		{
+			threads.emplace_back([&, thread]()
+			{
+				for (size_t combination{}; combination < combinations.size(); ++combination)
+					results[thread][combination] = typePool().intern(combinations[combination]);
+			});
+		}
+		for (auto &thread : threads)
+			thread.join();
+		for (size_t combination{}; combination < combinations.size(); ++combination)
+		{
+			const auto type{results[0][combination]};
+			assertTrue(typePool().info(type).flags == combinations[combination]);
+			for (const auto &result : results)
+				assertTrue(result[combination] == type);
+		}
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testInterning)
+		CRUNCHpp_TEST(testProperties)
+		CRUNCHpp_TEST(testNames)
+		CRUNCHpp_TEST(testConcurrentInterning)
+	}
+};
+
+CRUNCHpp_TESTS(testTypePool)
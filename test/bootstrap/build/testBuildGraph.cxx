@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/build/buildGraph.hxx"
+#include "../../../src/bootstrap/build/importScanner.hxx"
+
+using namespace std::literals::string_view_literals;
+using namespace std::literals::chrono_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::core::loader::SourceBuffer;
+using mangrove::core::loader::SourceLoader;
+using mangrove::core::loader::LoaderBackend;
+using mangrove::build::scanImports;
+using mangrove::build::hashSource;
+using mangrove::build::moduleNameFor;
+using mangrove::build::BuildGraph;
+using mangrove::build::BuildResult;
+using mangrove::build::Module;
+
+class testBuildGraph final : public testsuite
+{
+private:
+	path directory{std::filesystem::temp_directory_path() / "mangroveTestBuildGraph"};
+	path cacheFile{directory / "build.cache"};
+	std::vector<path> files{};
+
+	[[nodiscard]] static std::vector<std::string> importsOf(const std::string_view source)
+	{
+		SourceBuffer buffer{source.length()};
+		std::memcpy(buffer.data(), source.data(), source.length());
+		return scanImports(std::move(buffer));
+	}
+
+	void writeFile(const path &fileName, const std::string_view content)
+	{
+		const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		assertTrue(file.valid());
+		assertTrue(content.empty() || file.write(content.data(), content.length()));
+	}
+
+	void makeProject()
+	{
+		// app imports lib.b and lib.c, lib.b imports lib.c; tool stands alone but for a module outside the build
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory / "lib");
+		files = {directory / "app.mgv", directory / "lib" / "b.mgv", directory / "lib" / "c.mgv",
+			directory / "tool.mgv"};
+		writeFile(files[0], "import lib.b, lib.c as c\nInt32 x = 1\n"sv);
+		writeFile(files[1], "from lib.c import thing\nInt32 y = 2\n"sv);
+		writeFile(files[2], "Int32 z = 3\n"sv);
+		writeFile(files[3], "import std.io as io\n"sv);
+	}
+
+	// Runs a build, recording the order modules were built in, and failing any whose name is given
+	[[nodiscard]] BuildResult runBuild(std::vector<std::string> &built, const size_t workers,
+		const std::string_view failing = {})
+	{
+		const SourceLoader loader{LoaderBackend::threadPool, workers};
+		BuildGraph graph{cacheFile, directory};
+		graph.scan(files, loader);
+		std::mutex lock{};
+		built.clear();
+		const auto result{graph.build([&](const Module &module)
+		{
+			const std::lock_guard guard{lock};
+			built.emplace_back(module.name);
+			return module.name != failing;
+		}, workers)};
+		assertTrue(graph.save());
+		return result;
+	}
+
+	[[nodiscard]] static size_t positionOf(const std::vector<std::string> &built, const std::string_view name)
+	{
+		return static_cast<size_t>(std::find(built.begin(), built.end(), name) - built.begin());
+	}
+
+	void testScanImports()
+	{
+		assertTrue(importsOf("import a.b as c, d\nfrom e.f import g as h, i\nimport j; import k\n"sv) ==
+			std::vector<std::string>{"a.b", "d", "e.f", "j", "k"});
+		// Blank lines, comments and line breaks after a comma are all part of the header
+		assertTrue(importsOf("# header\n\nimport a, // more\n\tb\n\nimport c\n"sv) ==
+			std::vector<std::string>{"a", "b", "c"});
+		// Scanning stops at the first statement that isn't an import, even if imports follow it
+		assertTrue(importsOf("import a\nInt32 x = 1\nimport b\n"sv) == std::vector<std::string>{"a"});
+		assertTrue(importsOf("Int32 x\n"sv).empty());
+		assertTrue(importsOf(""sv).empty());
+		// As well as at anything malformed
+		assertTrue(importsOf("import a.\nimport b\n"sv).empty());
+		assertTrue(importsOf("import a b\nimport c\n"sv) == std::vector<std::string>{"a"});
+		assertTrue(importsOf("from a\nimport b\n"sv) == std::vector<std::string>{"a"});
+		assertTrue(scanImports(SourceBuffer{}).empty());
+	}
+
+	void testHashSource()
+	{
+		assertEqual(hashSource("import a\n"sv), hashSource("import a\n"sv));
+		assertNotEqual(hashSource("import a\n"sv), hashSource("import b\n"sv));
+		assertNotEqual(hashSource("abcdefgh"sv), hashSource("abcdefgh\0"sv));
+		assertNotEqual(hashSource(""sv), hashSource("\0"sv));
+		assertNotEqual(hashSource("0123456789abcdefX"sv), hashSource("0123456789abcdefY"sv));
+	}
+
+	void testModuleNames()
+	{
+		assertEqual(moduleNameFor("/project/a/b/c.mgv", "/project"), "a.b.c");
+		assertEqual(moduleNameFor("/project/main.mgv", "/project"), "main");
+		assertEqual(moduleNameFor("/elsewhere/tool.mgv", "/project"), "tool");
+	}
+
+	void testIncremental()
+	{
+		makeProject();
+		std::vector<std::string> built{};
+		// The first build does everything, with each module after those it imports
+		auto result{runBuild(built, 4U)};
+		assertEqual(result.built, 4U);
+		assertTrue(result.success());
+		assertTrue(positionOf(built, "lib.c"sv) < positionOf(built, "lib.b"sv));
+		assertTrue(positionOf(built, "lib.b"sv) < positionOf(built, "app"sv));
+
+		// Nothing changed, so nothing gets built
+		result = runBuild(built, 4U);
+		assertEqual(result.built, 0U);
+		assertEqual(result.upToDate, 4U);
+
+		// Touching a file without changing it costs a rehash but no rebuild
+		std::filesystem::last_write_time(files[2], std::filesystem::last_write_time(files[2]) + 1h);
+		result = runBuild(built, 1U);
+		assertEqual(result.built, 0U);
+
+		// Changing lib.c rebuilds it and everything importing it, in order, but not tool
+		writeFile(files[2], "Int32 z = 4 // changed\n"sv);
+		result = runBuild(built, 4U);
+		assertEqual(result.built, 3U);
+		assertEqual(result.upToDate, 1U);
+		assertTrue(built == std::vector<std::string>{"lib.c", "lib.b", "app"});
+
+		// Changing what app imports is picked up from its header
+		writeFile(files[0], "import lib.c\nInt32 x = 1\n"sv);
+		result = runBuild(built, 2U);
+		assertTrue(built == std::vector<std::string>{"app"});
+		writeFile(files[1], "Int32 y = 5\n"sv);
+		result = runBuild(built, 2U);
+		assertTrue(built == std::vector<std::string>{"lib.b"});
+		std::filesystem::remove_all(directory);
+	}
+
+	void testChangedImportSet()
+	{
+		makeProject();
+		std::vector<std::string> built{};
+		auto result{runBuild(built, 4U)};
+		assertEqual(result.built, 4U);
+
+		// Taking lib.c out of the build leaves app and lib.b untouched on disk, but with nothing to import
+		std::filesystem::remove(files[2]);
+		files.erase(files.begin() + 2);
+		result = runBuild(built, 2U);
+		assertTrue(result.success());
+		std::sort(built.begin(), built.end());
+		assertTrue(built == std::vector<std::string>{"app", "lib.b"});
+		result = runBuild(built, 2U);
+		assertEqual(result.built, 0U);
+
+		// As does adding a module that an import which used to look outside the build now finds
+		std::filesystem::create_directories(directory / "std");
+		files.emplace_back(directory / "std" / "io.mgv");
+		writeFile(files.back(), "Int32 stdout\n"sv);
+		result = runBuild(built, 2U);
+		assertTrue(built == std::vector<std::string>{"std.io", "tool"});
+		result = runBuild(built, 2U);
+		assertEqual(result.built, 0U);
+		std::filesystem::remove_all(directory);
+	}
+
+	void testFailures()
+	{
+		makeProject();
+		std::vector<std::string> built{};
+		// lib.b failing means app, which imports it, is never attempted
+		auto result{runBuild(built, 4U, "lib.b"sv)};
+		assertEqual(result.built, 2U);
+		assertEqual(result.failed, 1U);
+		assertEqual(result.skipped, 1U);
+		assertFalse(result.success());
+		assertEqual(positionOf(built, "app"sv), built.size());
+
+		// Both are retried on the next run, without the modules that built being redone
+		result = runBuild(built, 4U);
+		assertTrue(result.success());
+		assertTrue(built == std::vector<std::string>{"lib.b", "app"});
+
+		// A missing file fails, as does everything that imports it
+		files.emplace_back(directory / "missing.mgv");
+		writeFile(files[3], "import missing\n"sv);
+		result = runBuild(built, 1U);
+		assertEqual(result.failed, 1U);
+		assertEqual(result.skipped, 1U);
+		files.pop_back();
+
+		// A corrupt cache is just a full rebuild
+		writeFile(files[3], "Int32 w\n"sv);
+		writeFile(cacheFile, "MBGC garbage"sv);
+		result = runBuild(built, 2U);
+		assertEqual(result.built, 4U);
+		std::filesystem::remove_all(directory);
+	}
+
+	void testCycles()
+	{
+		makeProject();
+		writeFile(files[2], "import lib.b\n"sv);
+		std::vector<std::string> built{};
+		const auto result{runBuild(built, 2U)};
+		// lib.b and lib.c import each other, and app imports them - none can be built
+		assertEqual(result.failed, 3U);
+		assertTrue(built == std::vector<std::string>{"tool"});
+		std::filesystem::remove_all(directory);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testScanImports)
+		CRUNCHpp_TEST(testHashSource)
+		CRUNCHpp_TEST(testModuleNames)
+		CRUNCHpp_TEST(testIncremental)
+		CRUNCHpp_TEST(testChangedImportSet)
+		CRUNCHpp_TEST(testFailures)
+		CRUNCHpp_TEST(testCycles)
+	}
+};
+
+CRUNCHpp_TESTS(testBuildGraph)
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdint>
+#include <new>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/core/memory.hxx"
+
+using substrate::console;
+using mangrove::core::memory::Phase;
+using mangrove::core::memory::PhaseScope;
+using mangrove::core::memory::PhaseStats;
+using mangrove::core::memory::phaseStats;
+using mangrove::core::memory::histogramBucket;
+using mangrove::core::memory::internal::allocate;
+using mangrove::core::memory::internal::deallocate;
+
+// This suite is built with MANGROVE_ALLOC_TRACKING, along with its own copy of memory.cxx, whatever the
+// build's options. Being loaded as a library, its own uses of new bind to the runner's allocator rather than
+// the replacement, so it drives the replacement's allocator directly.
+static_assert(mangrove::core::memory::trackingEnabled);
+
+class testMemory final : public testsuite
+{
+private:
+	void checkDifference(const PhaseStats &before, const PhaseStats &after, const uint64_t allocations,
+		const uint64_t deallocations, const uint64_t bytes)
+	{
+		assertEqual(after.allocations - before.allocations, allocations);
+		assertEqual(after.deallocations - before.deallocations, deallocations);
+		assertEqual(after.bytes - before.bytes, bytes);
+	}
+
+	void testPhaseTotals()
+	{
+		const auto lexBefore{phaseStats(Phase::lex)};
+		const auto parseBefore{phaseStats(Phase::parse)};
+		void *block{nullptr};
+		void *alignedBlock{nullptr};
+		{
+			const PhaseScope phase{Phase::lex};
+			block = allocate(100U);
+			alignedBlock = allocate(5000U, std::align_val_t{64U});
+		}
+		assertNotNull(block);
+		assertNotNull(alignedBlock);
+		assertEqual(reinterpret_cast<uintptr_t>(alignedBlock) % 64U, 0U);
+		const auto lexAllocated{phaseStats(Phase::lex)};
+		checkDifference(lexBefore, lexAllocated, 2U, 0U, 5100U);
+		assertEqual(lexAllocated.sizeHistogram[histogramBucket(100U)] -
+			lexBefore.sizeHistogram[histogramBucket(100U)], 1U);
+		assertEqual(lexAllocated.sizeHistogram[histogramBucket(5000U)] -
+			lexBefore.sizeHistogram[histogramBucket(5000U)], 1U);
+
+		// Freeing from another phase still credits the free to the phase that made the allocation
+		{
+			const PhaseScope phase{Phase::parse};
+			deallocate(block);
+			deallocate(alignedBlock);
+		}
+		checkDifference(lexBefore, phaseStats(Phase::lex), 2U, 2U, 5100U);
+		checkDifference(parseBefore, phaseStats(Phase::parse), 0U, 0U, 0U);
+
+		// And scopes nest, putting the outer phase back when an inner one ends
+		{
+			const PhaseScope outer{Phase::parse};
+			{
+				const PhaseScope inner{Phase::lex};
+			}
+			block = allocate(8U);
+		}
+		checkDifference(parseBefore, phaseStats(Phase::parse), 1U, 0U, 8U);
+		deallocate(block);
+		checkDifference(parseBefore, phaseStats(Phase::parse), 1U, 1U, 8U);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testPhaseTotals)
+	}
+};
+
+CRUNCHpp_TESTS(testMemory)
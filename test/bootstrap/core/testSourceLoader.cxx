@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cerrno>
+#include <array>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/core/sourceLoader.hxx"
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::core::loader::SourceLoader;
+using mangrove::core::loader::SourceBuffer;
+using mangrove::core::loader::LoadedSource;
+using mangrove::core::loader::LoaderBackend;
+using mangrove::core::loader::ioUringAvailable;
+
+constexpr static size_t fileCount{60U};
+
+class testSourceLoader final : public testsuite
+{
+private:
+	path directory{std::filesystem::temp_directory_path() / "mangroveTestSourceLoader"};
+	std::vector<path> files{};
+	std::vector<std::string> contents{};
+
+	// Sizes cycle through empty, tiny, page-sized and multi-megabyte files
+	static std::string contentFor(const size_t index)
+	{
+		constexpr std::array<size_t, 6> sizes{{0U, 1U, 100U, 4096U, 65537U, 1048576U + 7U}};
+		std::string content(sizes[index % sizes.size()], '\0');
+		for (size_t offset{}; offset < content.size(); ++offset)
+			content[offset] = static_cast<char>('a' + ((offset + index) % 26U));
+		return content;
+	}
+
+	void makeFiles()
+	{
+		files.clear();
+		contents.clear();
+		std::filesystem::create_directories(directory);
+		for (size_t index{}; index < fileCount; ++index)
+		{
+			const auto &fileName{files.emplace_back(directory / fmt::format("source{}.mgv"sv, index))};
+			const auto &content{contents.emplace_back(contentFor(index))};
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(content.empty() || file.write(content.data(), content.size()));
+		}
+	}
+
+	void checkBackend(const LoaderBackend backend, const size_t workers)
+	{
+		makeFiles();
+		const SourceLoader loader{backend, workers, 16U};
+		assertTrue(loader.backend() == backend);
+		auto fileNames{files};
+		fileNames.emplace_back(directory / "missing.mgv");
+		// A directory opens and has a size, but fails as soon as it's read
+		fileNames.emplace_back(directory / "unreadable.mgv");
+		std::filesystem::create_directories(fileNames.back());
+		// The handler runs on the loader's threads, so just record what it sees and check it afterwards
+		std::mutex lock{};
+		std::vector<size_t> seen(fileNames.size());
+		std::vector<bool> matched(fileNames.size());
+		int missingError{};
+		int unreadableError{};
+		loader.load(fileNames, [&](LoadedSource &&source)
+		{
+			const std::lock_guard guard{lock};
+			const auto name{source.fileName.filename().string()};
+			if (name == "missing.mgv"sv)
+			{
+				missingError = source.valid() ? 0 : source.error;
+				++seen[files.size()];
+				return;
+			}
+			if (name == "unreadable.mgv"sv)
+			{
+				unreadableError = source.valid() ? 0 : source.error;
+				++seen.back();
+				return;
+			}
+			const auto index{std::stoul(name.substr(6U))};
+			matched[index] = source.valid() && source.buffer.view() == contents[index];
+			++seen[index];
+		});
+		std::filesystem::remove_all(directory);
+
+		// Every file must be handed over exactly once, with its contents intact
+		for (const auto count : seen)
+			assertEqual(count, 1U);
+		for (size_t index{}; index < files.size(); ++index)
+			assertTrue(matched[index]);
+		assertEqual(missingError, ENOENT);
+		assertEqual(unreadableError, EISDIR);
+	}
+
+	void testSerial() { checkBackend(LoaderBackend::serial, 1U); }
+
+	void testThreadPool()
+	{
+		checkBackend(LoaderBackend::threadPool, 1U);
+		checkBackend(LoaderBackend::threadPool, 4U);
+	}
+
+	void testIoUring()
+	{
+		if (!ioUringAvailable())
+		{
+			// Asking for io_uring where it's unavailable gets the thread pool instead
+			assertTrue(SourceLoader{LoaderBackend::ioUring}.backend() == LoaderBackend::threadPool);
+			skip("io_uring is not available");
+			return;
+		}
+		checkBackend(LoaderBackend::ioUring, 1U);
+		checkBackend(LoaderBackend::ioUring, 4U);
+		assertTrue(SourceLoader{}.backend() == LoaderBackend::ioUring);
+	}
+
+	void testEmpty()
+	{
+		size_t calls{};
+		SourceLoader{}.load({}, [&](LoadedSource &&) { ++calls; });
+		assertEqual(calls, 0U);
+		const SourceBuffer buffer{};
+		assertFalse(buffer.valid());
+		assertTrue(SourceBuffer{0U}.valid());
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testSerial)
+		CRUNCHpp_TEST(testThreadPool)
+		CRUNCHpp_TEST(testIoUring)
+		CRUNCHpp_TEST(testEmpty)
+	}
+};
+
+CRUNCHpp_TESTS(testSourceLoader)
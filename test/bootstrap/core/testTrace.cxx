@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/core/trace.hxx"
+
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::core::trace::Counter;
+using mangrove::core::trace::ScopedTimer;
+using mangrove::core::trace::count;
+using mangrove::core::trace::counterTotals;
+using mangrove::core::trace::nameThread;
+using mangrove::core::trace::writeTrace;
+
+// This suite is built with MANGROVE_TRACING, along with its own copy of trace.cxx, whatever the build's options
+static_assert(mangrove::core::trace::enabled);
+
+class testTrace final : public testsuite
+{
+private:
+	const path fileName{std::filesystem::temp_directory_path() / "mangroveTestTrace.json"};
+
+	[[nodiscard]] std::string readTrace()
+	{
+		const fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+		assertTrue(file.valid());
+		std::string result(static_cast<size_t>(file.length()), '\0');
+		assertTrue(file.read(result.data(), result.size()));
+		return result;
+	}
+
+	// Finds the lane (tid) the first record matching starts with was written against
+	[[nodiscard]] std::string_view laneOf(const std::string_view trace, const std::string_view record)
+	{
+		const auto position{trace.find(record)};
+		assertTrue(position != std::string_view::npos);
+		const auto begin{trace.find(R"("tid":)"sv, position)};
+		assertTrue(begin != std::string_view::npos);
+		const auto lane{trace.substr(begin + 6U)};
+		return lane.substr(0U, lane.find_first_not_of("0123456789"sv));
+	}
+
+	// Finds the lane given a name by nameThread(), from its thread_name metadata record
+	[[nodiscard]] std::string_view laneNamed(const std::string_view trace, const std::string_view name)
+	{
+		const auto position{trace.find(R"("args":{"name":")"s + std::string{name} + R"("}})"s)};
+		assertTrue(position != std::string_view::npos);
+		const auto record{trace.rfind(R"({"name":"thread_name")"sv, position)};
+		assertTrue(record != std::string_view::npos);
+		return laneOf(trace.substr(record), R"({"name":"thread_name")"sv);
+	}
+
+	void testWriteTrace()
+	{
+		nameThread("main"sv);
+		{
+			const ScopedTimer timer{"mainEvent"sv};
+			count(Counter::tokensLexed, 3U);
+		}
+		std::thread worker{[]()
+		{
+			nameThread("worker"sv);
+			const ScopedTimer timer{"workerEvent"sv};
+			count(Counter::tokensLexed, 4U);
+			count(Counter::bytesRead, 10U);
+		}};
+		worker.join();
+
+		const auto totals{counterTotals()};
+		assertEqual(totals[static_cast<size_t>(Counter::tokensLexed)], 7U);
+		assertEqual(totals[static_cast<size_t>(Counter::bytesRead)], 10U);
+		assertEqual(totals[static_cast<size_t>(Counter::symbolsInserted)], 0U);
+
+		assertTrue(writeTrace(fileName));
+		const auto trace{readTrace()};
+		std::filesystem::remove(fileName);
+		assertTrue(trace.find(R"({"displayTimeUnit":"ns","traceEvents":[)"sv) == 0U);
+		assertTrue(trace.find("]}\n"sv) == trace.size() - 3U);
+
+		// Each thread gets a named lane, and its events are written against that lane
+		const auto mainLane{laneNamed(trace, "main"sv)};
+		const auto workerLane{laneNamed(trace, "worker"sv)};
+		assertTrue(mainLane != workerLane);
+		assertTrue(laneOf(trace, R"({"name":"mainEvent","cat":"mangrove","ph":"X")"sv) == mainLane);
+		assertTrue(laneOf(trace, R"({"name":"workerEvent","cat":"mangrove","ph":"X")"sv) == workerLane);
+
+		// Counters are written once each, summed across the threads
+		const auto tokens{trace.find(R"({"name":"tokensLexed","ph":"C")"sv)};
+		const auto bytes{trace.find(R"({"name":"bytesRead","ph":"C")"sv)};
+		assertTrue(tokens != std::string::npos);
+		assertTrue(bytes != std::string::npos);
+		assertEqual(trace.find(R"("args":{"value":7}})"sv, tokens), trace.find(R"("args")"sv, tokens));
+		assertEqual(trace.find(R"("args":{"value":10}})"sv, bytes), trace.find(R"("args")"sv, bytes));
+		assertEqual(trace.find(R"({"name":"tokensLexed","ph":"C")"sv, tokens + 1U), std::string::npos);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testWriteTrace)
+	}
+};
+
+CRUNCHpp_TESTS(testTrace)
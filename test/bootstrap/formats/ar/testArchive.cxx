@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../../src/bootstrap/formats/ar/archive.hxx"
+
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::fd_t;
+using substrate::span;
+using substrate::console;
+using mangrove::ar::Archive;
+using mangrove::ar::isArchive;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+
+struct TestMember final
+{
+	std::string_view name;
+	std::vector<uint8_t> contents;
+	// The symbols the archive's index says this member defines
+	std::vector<std::string_view> symbols{};
+};
+
+class testArchive final : public testsuite
+{
+private:
+	const path directory{std::filesystem::temp_directory_path() / "mangroveTestArchive"};
+
+	[[nodiscard]] path file(const std::string_view name) const { return directory / name; }
+
+	[[nodiscard]] static std::vector<uint8_t> readFile(const path &fileName)
+	{
+		const fd_t input{fileName.c_str(), O_RDONLY | O_NOCTTY};
+		std::vector<uint8_t> contents(static_cast<size_t>(input.length()));
+		return input.read(contents.data(), contents.size()) ? contents : std::vector<uint8_t>{};
+	}
+
+	void writeFile(const path &fileName, const std::vector<uint8_t> &contents)
+	{
+		const fd_t output{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		assertTrue(output.valid());
+		assertTrue(output.write(contents.data(), contents.size()));
+	}
+
+	// Builds an x86-64 object holding just a .text section of the length given, and returns its image
+	[[nodiscard]] std::vector<uint8_t> makeObject(const size_t textLength)
+	{
+		const std::vector<uint8_t> text(textLength, 0xc3U);
+		ELF elf{Class::elf64Bit, Endian::little, Machine::x86_64};
+		static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+			{SectionFlag::allocate, SectionFlag::execuable}, span{text.data(), text.size()}, 16U));
+		const auto fileName{file("object.o"sv)};
+		{
+			const fd_t output{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(output.valid());
+			assertTrue(elf.write(output));
+		}
+		return readFile(fileName);
+	}
+
+	static void append(std::vector<uint8_t> &archive, const std::string_view data)
+		{ archive.insert(archive.end(), data.begin(), data.end()); }
+
+	static void appendHeader(std::vector<uint8_t> &archive, const std::string_view name, const size_t length)
+		{ append(archive, fmt::format("{:<16}{:<12}{:<6}{:<6}{:<8}{:<10}`\n"sv, name, 0, 0, 0, 644, length)); }
+
+	static void appendMember(std::vector<uint8_t> &archive, const std::string_view name,
+		const std::vector<uint8_t> &contents)
+	{
+		appendHeader(archive, name, contents.size());
+		archive.insert(archive.end(), contents.begin(), contents.end());
+		if (archive.size() & 1U)
+			archive.push_back('\n');
+	}
+
+	// Lays out an archive as GNU ar does - the "/" symbol index, then "//" with any names over 15 characters
+	[[nodiscard]] static std::vector<uint8_t> gnuArchive(const std::vector<TestMember> &members)
+	{
+		std::string longNames{};
+		std::vector<std::string> names{};
+		size_t symbolCount{};
+		std::string symbolNames{};
+		for (const auto &member : members)
+		{
+			if (member.name.size() > 15U)
+			{
+				names.emplace_back(fmt::format("/{}"sv, longNames.size()));
+				longNames += fmt::format("{}/\n"sv, member.name);
+			}
+			else
+				names.emplace_back(fmt::format("{}/"sv, member.name));
+			for (const auto symbol : member.symbols)
+			{
+				++symbolCount;
+				symbolNames += symbol;
+				symbolNames += '\0';
+			}
+		}
+		const auto indexLength{4U + (symbolCount * 4U) + symbolNames.size()};
+		auto offset{8U + 60U + indexLength + (indexLength & 1U)};
+		if (!longNames.empty())
+			offset += 60U + longNames.size() + (longNames.size() & 1U);
+
+		std::vector<uint8_t> index(4U + (symbolCount * 4U));
+		index.insert(index.end(), symbolNames.begin(), symbolNames.end());
+		const Memory indexStorage{span{index.data(), index.size()}};
+		indexStorage.write(0U, static_cast<uint32_t>(symbolCount), Endian::big);
+		size_t position{4U};
+		for (const auto &member : members)
+		{
+			for (size_t symbol{}; symbol < member.symbols.size(); ++symbol, position += 4U)
+				indexStorage.write(position, static_cast<uint32_t>(offset), Endian::big);
+			offset += 60U + member.contents.size() + (member.contents.size() & 1U);
+		}
+
+		std::vector<uint8_t> archive{};
+		append(archive, "!<arch>\n"sv);
+		appendMember(archive, "/"sv, index);
+		if (!longNames.empty())
+			appendMember(archive, "//"sv, {longNames.begin(), longNames.end()});
+		for (size_t member{}; member < members.size(); ++member)
+			appendMember(archive, names[member], members[member].contents);
+		return archive;
+	}
+
+	// Lays out an archive as BSD ar does - names go after each header, and the index is "__.SYMDEF SORTED"
+	[[nodiscard]] static std::vector<uint8_t> bsdArchive(const std::vector<TestMember> &members)
+	{
+		const auto bsdName{[](const std::string_view name)
+		{
+			// Names are NUL padded so the contents after them stay 8 byte aligned
+			std::string result{name};
+			result.resize((name.size() + 7U) & ~size_t{7U});
+			return result;
+		}};
+		std::string symbolNames{};
+		const auto indexName{bsdName("__.SYMDEF SORTED"sv)};
+		size_t symbolCount{};
+		for (const auto &member : members)
+			symbolCount += member.symbols.size();
+		std::vector<size_t> nameOffsets{};
+		for (const auto &member : members)
+		{
+			for (const auto symbol : member.symbols)
+			{
+				nameOffsets.push_back(symbolNames.size());
+				symbolNames += symbol;
+				symbolNames += '\0';
+			}
+		}
+		const auto indexLength{indexName.size() + 8U + (symbolCount * 8U) + symbolNames.size()};
+		auto offset{8U + 60U + indexLength + (indexLength & 1U)};
+		std::vector<uint8_t> index(indexName.begin(), indexName.end());
+		index.resize(indexLength - symbolNames.size());
+		const Memory indexStorage{span{index.data(), index.size()}};
+		indexStorage.write(indexName.size(), static_cast<uint32_t>(symbolCount * 8U), Endian::little);
+		size_t symbol{};
+		for (const auto &member : members)
+		{
+			for (size_t entry{}; entry < member.symbols.size(); ++entry, ++symbol)
+			{
+				const auto position{indexName.size() + 4U + (symbol * 8U)};
+				indexStorage.write(position, static_cast<uint32_t>(nameOffsets[symbol]), Endian::little);
+				indexStorage.write(position + 4U, static_cast<uint32_t>(offset), Endian::little);
+			}
+			const auto length{bsdName(member.name).size() + member.contents.size()};
+			offset += 60U + length + (length & 1U);
+		}
+		indexStorage.write(indexName.size() + 4U + (symbolCount * 8U), static_cast<uint32_t>(symbolNames.size()),
+			Endian::little);
+		index.insert(index.end(), symbolNames.begin(), symbolNames.end());
+
+		std::vector<uint8_t> archive{};
+		append(archive, "!<arch>\n"sv);
+		const auto appendBSDMember{[&](const std::string &name, const std::vector<uint8_t> &contents)
+		{
+			appendHeader(archive, fmt::format("#1/{}"sv, name.size()), name.size() + contents.size());
+			append(archive, name);
+			archive.insert(archive.end(), contents.begin(), contents.end());
+			if (archive.size() & 1U)
+				archive.push_back('\n');
+		}};
+		appendBSDMember(indexName, {index.begin() + static_cast<std::ptrdiff_t>(indexName.size()), index.end()});
+		for (const auto &member : members)
+			appendBSDMember(bsdName(member.name), member.contents);
+		return archive;
+	}
+
+	// Three members - a long named object, a text file of odd length, and a second object also defining first
+	[[nodiscard]] std::vector<TestMember> makeMembers()
+	{
+		return
+		{
+			{"a_rather_long_member_name.o"sv, makeObject(5U), {"first"sv, "second"sv}},
+			{"notes.txt"sv, {'h', 'e', 'l', 'l', 'o'}},
+			{"b.o"sv, makeObject(32U), {"first"sv, "third"sv}},
+		};
+	}
+
+	void checkArchive(Archive &archive, const std::vector<TestMember> &expected)
+	{
+		assertTrue(archive.valid());
+		assertTrue(archive.hasIndex());
+		// "first" is listed twice, so only counts once
+		assertEqual(archive.symbolCount(), 3U);
+
+		const auto members{archive.members()};
+		assertEqual(members.size(), expected.size());
+		for (size_t index{}; index < members.size(); ++index)
+		{
+			assertTrue(members[index].name == expected[index].name);
+			assertEqual(members[index].data.size(), expected[index].contents.size());
+			assertTrue(std::equal(members[index].data.begin(), members[index].data.end(),
+				expected[index].contents.begin()));
+		}
+
+		// The first member to define a symbol is the one the index gives
+		const auto first{archive.lookup("first"sv)};
+		assertTrue(first.has_value());
+		assertEqual(*first, members[0].headerOffset);
+		const auto third{archive.lookup("third"sv)};
+		assertTrue(third.has_value());
+		assertEqual(*third, members[2].headerOffset);
+		assertFalse(archive.lookup("fourth"sv).has_value());
+		assertFalse(archive.lookup(""sv).has_value());
+
+		// Members are viewed in place, and each view is only built once
+		const auto *const object{archive.resolve("second"sv)};
+		assertNotNull(object);
+		assertTrue(object->valid());
+		const auto text{object->sectionIndex(".text"sv)};
+		assertTrue(text.has_value());
+		assertEqual(object->sectionData(*text).length(), 5U);
+		assertTrue(archive.resolve("first"sv) == object);
+		assertTrue(archive.object(members[0].headerOffset) == object);
+		const auto *const other{archive.resolve("third"sv)};
+		assertNotNull(other);
+		assertTrue(other != object);
+		assertEqual(other->sectionData(*other->sectionIndex(".text"sv)).length(), 32U);
+		assertNull(archive.resolve("fourth"sv));
+		// notes.txt isn't an ELF object, so makes an invalid view
+		const auto *const notes{archive.object(members[1].headerOffset)};
+		assertNotNull(notes);
+		assertFalse(notes->valid());
+		// Offsets that aren't a member header
+		assertNull(archive.object(members[1].headerOffset + 1U));
+		assertNull(archive.object(0U));
+		assertNull(archive.object(1U << 20U));
+	}
+
+	void testGNU()
+	{
+		std::filesystem::create_directories(directory);
+		const auto members{makeMembers()};
+		const auto contents{gnuArchive(members)};
+		assertTrue(isArchive({contents.data(), contents.size()}));
+		writeFile(file("gnu.a"sv), contents);
+		Archive archive{fd_t{file("gnu.a"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		checkArchive(archive, members);
+	}
+
+	void testBSD()
+	{
+		const auto members{makeMembers()};
+		writeFile(file("bsd.a"sv), bsdArchive(members));
+		Archive archive{fd_t{file("bsd.a"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		checkArchive(archive, members);
+	}
+
+	void testNoIndex()
+	{
+		// An archive made without an index (ar rcS) is still readable, but lookups never find anything
+		std::vector<uint8_t> contents{};
+		append(contents, "!<arch>\n"sv);
+		appendMember(contents, "first.o/"sv, makeObject(3U));
+		writeFile(file("noIndex.a"sv), contents);
+		Archive archive{fd_t{file("noIndex.a"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(archive.valid());
+		assertFalse(archive.hasIndex());
+		assertEqual(archive.symbolCount(), 0U);
+		assertNull(archive.resolve("first"sv));
+		const auto members{archive.members()};
+		assertEqual(members.size(), 1U);
+		assertTrue(members[0].name == "first.o"sv);
+		assertNotNull(archive.object(members[0].headerOffset));
+
+		// As is an empty one
+		writeFile(file("empty.a"sv), {'!', '<', 'a', 'r', 'c', 'h', '>', '\n'});
+		Archive empty{fd_t{file("empty.a"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(empty.valid());
+		assertTrue(empty.members().empty());
+	}
+
+	void testMalformed()
+	{
+		const auto open{[&](const std::string_view name, const std::vector<uint8_t> &contents)
+		{
+			writeFile(file(name), contents);
+			return Archive{fd_t{file(name).c_str(), O_RDONLY | O_NOCTTY}};
+		}};
+
+		const std::vector<uint8_t> notArchive{'!', '<', 't', 'h', 'i', 'n', '>', '\n'};
+		assertFalse(isArchive({notArchive.data(), notArchive.size()}));
+		assertFalse(open("thin.a"sv, notArchive).valid());
+		assertFalse(Archive{fd_t{file("missing.a"sv).c_str(), O_RDONLY | O_NOCTTY}}.valid());
+
+		auto contents{gnuArchive(makeMembers())};
+		// A symbol index claiming more symbols than it has room for
+		auto tooMany{contents};
+		Memory{span{tooMany.data(), tooMany.size()}}.write(68U, uint32_t{0x10000U}, Endian::big);
+		assertFalse(open("tooMany.a"sv, tooMany).valid());
+		// A symbol index whose names run off its end
+		auto unterminated{contents};
+		// The index's contents start after the magic and its header, and its names after the count and 4 offsets
+		const auto indexLength{std::stol(std::string{unterminated.begin() + 56, unterminated.begin() + 66})};
+		std::fill(unterminated.begin() + 88, unterminated.begin() + 68 + indexLength, 'x');
+		assertFalse(open("unterminated.a"sv, unterminated).valid());
+		// A broken header terminator
+		auto badHeader{contents};
+		badHeader[66] = ' ';
+		assertFalse(open("badHeader.a"sv, badHeader).valid());
+		// A member that runs off the end of the file
+		contents.resize(contents.size() - 20U);
+		Archive truncated{open("truncated.a"sv, contents)};
+		assertTrue(truncated.valid());
+		assertEqual(truncated.members().size(), 2U);
+		assertNull(truncated.resolve("third"sv));
+		assertNotNull(truncated.resolve("first"sv));
+		std::filesystem::remove_all(directory);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testGNU)
+		CRUNCHpp_TEST(testBSD)
+		CRUNCHpp_TEST(testNoIndex)
+		CRUNCHpp_TEST(testMalformed)
+	}
+};
+
+CRUNCHpp_TESTS(testArchive)
@@ -0,0 +1,583 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <filesystem>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../../src/bootstrap/formats/elf/elf.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::fd_t;
+using substrate::span;
+using substrate::console;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::io::readArray;
+using mangrove::elf::io::readRecords;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::elf::types::StringTable;
+using mangrove::elf::types::StringTableBuilder;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+
+class testELF final : public testsuite
+{
+private:
+	const std::filesystem::path fileName{std::filesystem::temp_directory_path() / "mangroveTestELF.o"};
+
+	// Builds a small object file and returns its on-disk image
+	std::vector<uint8_t> makeImage(const Class elfClass, const Endian endian)
+	{
+		{
+			ELF elf{elfClass, endian, Machine::x86_64};
+			assertTrue(elf.valid());
+			constexpr std::array<uint8_t, 4> text{{0x55U, 0x48U, 0x89U, 0xe5U}};
+			static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+				{SectionFlag::allocate, SectionFlag::execuable}, span{text.data(), text.size()}, 16U));
+			// .bss takes no space in the file, so the length here must not be held against it
+			constexpr std::array<uint8_t, 4096> bss{};
+			static_cast<void>(elf.addSection(".bss"sv, SectionHeaderType::bss,
+				{SectionFlag::allocate, SectionFlag::writeable}, span{bss.data(), bss.size()}, 16U));
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(elf.write(file));
+		}
+		const fd_t file{fileName.c_str(), O_RDONLY | O_NOCTTY};
+		assertTrue(file.valid());
+		std::vector<uint8_t> image(static_cast<size_t>(file.length()));
+		assertTrue(file.read(image.data(), image.size()));
+		return image;
+	}
+
+	// Writes image out and checks whether it loads
+	[[nodiscard]] bool loads(const std::vector<uint8_t> &image, const size_t length)
+	{
+		{
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(file.write(image.data(), length));
+		}
+		const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		if (!elf.valid())
+		{
+			// A file that fails validation must not expose anything for the accessors to trip over
+			assertTrue(elf.programHeaders().empty());
+			assertTrue(elf.sectionHeaders().empty());
+			assertTrue(elf.sectionIndex(".text"sv) == std::nullopt);
+			assertEqual(elf.sectionData(2U).length(), 0U);
+		}
+		return elf.valid();
+	}
+
+	[[nodiscard]] bool loads(const std::vector<uint8_t> &image) { return loads(image, image.size()); }
+
+	void checkValid(const Class elfClass, const Endian endian)
+	{
+		const auto image{makeImage(elfClass, endian)};
+		assertTrue(loads(image));
+		const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.header().elfClass() == elfClass);
+		assertTrue(elf.header().endian() == endian);
+		assertEqual(elf.sectionHeaders().size(), 4U);
+		assertTrue(elf.sectionIndex(".bss"sv) == 3U);
+		assertEqual(elf.sectionData(2U).length(), 4U);
+		assertEqual(elf.sectionData(3U).length(), 0U);
+	}
+
+	void testValid()
+	{
+		checkValid(Class::elf64Bit, Endian::little);
+		checkValid(Class::elf32Bit, Endian::big);
+		std::filesystem::remove(fileName);
+	}
+
+	void testTruncated()
+	{
+		const auto image{makeImage(Class::elf64Bit, Endian::little)};
+		// The section header table is last in the file, so losing even a byte has to be caught
+		for (size_t length{}; length < image.size(); ++length)
+			assertFalse(loads(image, length));
+		std::filesystem::remove(fileName);
+	}
+
+	void testCorruptHeader()
+	{
+		const auto image{makeImage(Class::elf64Bit, Endian::little)};
+		const auto corrupt{[&](auto mutation)
+		{
+			auto copy{image};
+			elf64::ELFHeader header{Memory{span{copy.data(), copy.size()}}};
+			mutation(header);
+			return loads(copy);
+		}};
+
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.magic({{0x7fU, 'E', 'L', 'G'}}); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.elfClass(static_cast<Class>(3U)); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.endian(static_cast<Endian>(0U)); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.headerSize(32U); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.shdrOffset(UINT64_MAX - 8U); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.sectionHeaderSize(32U); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header)
+			{ header.sectionHeaderCount(static_cast<uint16_t>(header.sectionHeaderCount() + 1U)); }));
+		assertFalse(corrupt([](elf64::ELFHeader &header) { header.sectionNamesIndex(4U); }));
+		// Program headers are checked too, even though an object file normally has none
+		assertFalse(corrupt([](elf64::ELFHeader &header)
+		{
+			header.programHeaderSize(56U);
+			header.programHeaderCount(1U);
+			header.phdrOffset(UINT64_MAX);
+		}));
+		std::filesystem::remove(fileName);
+	}
+
+	void testInvalidHeaders()
+	{
+		// Files with no header to speak of each get a zeroed header of their own
+		std::array<uint8_t, 4U> garbage{{'E', 'L', 'F', '!'}};
+		ELF first{span{garbage.data(), garbage.size()}};
+		const ELF second{span{garbage.data(), garbage.size()}};
+		assertFalse(first.valid());
+		assertFalse(second.valid());
+		first.header().sectionHeaderCount(5U);
+		assertEqual(first.header().sectionHeaderCount(), 5U);
+		assertEqual(second.header().sectionHeaderCount(), 0U);
+		// Which stays put as the ELF moves
+		const ELF moved{std::move(first)};
+		assertEqual(moved.header().sectionHeaderCount(), 5U);
+		assertEqual(ELF{span{garbage.data(), garbage.size()}}.header().sectionHeaderCount(), 0U);
+	}
+
+	void testCorruptSections()
+	{
+		const auto image{makeImage(Class::elf64Bit, Endian::little)};
+		const auto corrupt{[&](const size_t section, auto mutation)
+		{
+			auto copy{image};
+			const Memory storage{span{copy.data(), copy.size()}};
+			const elf64::ELFHeader header{storage};
+			mutation(elf64::SectionHeader{storage.dataSpan().subspan(header.shdrOffset() +
+				(section * elf64::SectionHeader::size())), Endian::little});
+			return loads(copy);
+		}};
+
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section) { section.fileOffset(UINT64_MAX); }));
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section) { section.fileLength(1U << 20U); }));
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section) { section.link(4U); }));
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section) { section.nameOffset(UINT32_MAX); }));
+		assertFalse(corrupt(1U, [](const elf64::SectionHeader &section) { section.fileLength(UINT64_MAX); }));
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section)
+		{
+			section.type(SectionHeaderType::symbolTable);
+			section.fileLength(5U);
+		}));
+		// As are relocation tables that don't hold a whole number of entries
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section) { section.type(SectionHeaderType::reloc); }));
+		assertFalse(corrupt(2U, [](const elf64::SectionHeader &section)
+			{ section.type(SectionHeaderType::relocAddend); }));
+		// Sections that take no space in the file are allowed any extent
+		assertTrue(corrupt(3U, [](const elf64::SectionHeader &section) { section.fileOffset(UINT64_MAX); }));
+		std::filesystem::remove(fileName);
+	}
+
+	void testExtendedNumbering()
+	{
+		// Rewrite the header to keep its section count and names index in the null section, as a file
+		// with more than 0xff00 sections has to
+		auto image{makeImage(Class::elf64Bit, Endian::little)};
+		const Memory storage{span{image.data(), image.size()}};
+		const elf64::ELFHeader header{storage};
+		const elf64::SectionHeader nullSection{storage.dataSpan().subspan(header.shdrOffset()), Endian::little};
+		nullSection.fileLength(header.sectionHeaderCount());
+		nullSection.link(header.sectionNamesIndex());
+		header.sectionHeaderCount(0U);
+		header.sectionNamesIndex(0xffffU);
+		assertTrue(loads(image));
+		{
+			const ELF elf{span{image.data(), image.size()}};
+			assertEqual(elf.sectionHeaders().size(), 4U);
+			assertTrue(elf.sectionIndex(".bss"sv) == 3U);
+			assertEqual(elf.sectionData(2U).length(), 4U);
+		}
+
+		// The null section's count is held to the file like any other
+		nullSection.fileLength(5U);
+		assertFalse(loads(image));
+		nullSection.fileLength(4U);
+		nullSection.link(4U);
+		assertFalse(loads(image));
+		// And a table too short to hold even the null section is caught before it's read
+		assertFalse(loads(image, header.shdrOffset() + 8U));
+		std::filesystem::remove(fileName);
+	}
+
+	void testWriteManySections()
+	{
+		// Enough sections that the count no longer fits in the header, so has to go in the null section
+		constexpr size_t sectionCount{0xff00U};
+		{
+			ELF elf{Class::elf64Bit, Endian::little, Machine::x86_64};
+			constexpr std::array<uint8_t, 1> data{{0x90U}};
+			for (size_t index{2U}; index < sectionCount; ++index)
+				static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+					{SectionFlag::allocate, SectionFlag::execuable}, span{data.data(), data.size()}, 1U));
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(elf.write(file));
+		}
+		const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.valid());
+		assertEqual(elf.header().sectionHeaderCount(), 0U);
+		assertEqual(elf.sectionHeaders().size(), sectionCount);
+		assertEqual(elf.sectionHeaders()[0].fileLength(), sectionCount);
+		assertEqual(elf.sectionData(sectionCount - 1U).length(), 1U);
+		std::filesystem::remove(fileName);
+	}
+
+	void checkStrings(const StringTable &table)
+	{
+		assertTrue(table.stringFromOffset(0U) == ""sv);
+		assertTrue(table.stringFromOffset(1U) == ".rela.text"sv);
+		// Offsets into the middle of a string are how linkers share a name's tail between strings
+		assertTrue(table.stringFromOffset(6U) == ".text"sv);
+		assertTrue(table.stringFromOffset(12U) == ".data"sv);
+		assertTrue(table.stringFromOffset(18U) == ""sv);
+		// The last string isn't terminated, so has to stop at the end of the table
+		assertTrue(table.stringFromOffset(19U) == "tail"sv);
+		assertTrue(table.stringFromOffset(21U) == "il"sv);
+		assertTrue(table.stringFromOffset(23U) == ""sv);
+		assertTrue(table.stringFromOffset(SIZE_MAX) == ""sv);
+	}
+
+	void testStringTable()
+	{
+		std::array<uint8_t, 23> data
+		{{
+			0U, '.', 'r', 'e', 'l', 'a', '.', 't', 'e', 'x', 't', 0U,
+			'.', 'd', 'a', 't', 'a', 0U, 0U, 't', 'a', 'i', 'l'
+		}};
+		StringTable table{Memory{span{data.data(), data.size()}}};
+		assertFalse(table.indexed());
+		checkStrings(table);
+		table.buildIndex();
+		assertTrue(table.indexed());
+		checkStrings(table);
+
+		assertTrue(table.matches(6U, ".text"sv));
+		assertTrue(table.matches(19U, "tail"sv));
+		assertTrue(table.matches(0U, ""sv));
+		assertFalse(table.matches(6U, ".tex"sv));
+		assertFalse(table.matches(6U, ".texts"sv));
+		assertFalse(table.matches(19U, "tails"sv));
+		assertFalse(table.matches(23U, ""sv));
+
+		// Reassigning the table's storage has to throw away the now stale index
+		table = Memory{span{data.data(), 12U}};
+		assertFalse(table.indexed());
+		assertTrue(table.stringFromOffset(12U) == ""sv);
+	}
+
+	void testStringTableBuilder()
+	{
+		StringTableBuilder builder{};
+		assertEqual(builder.add(""sv), 0U);
+		assertEqual(builder.add(".text"sv), 1U);
+		assertEqual(builder.add(".data"sv), 7U);
+		// Adding a name a second time hands back the first copy rather than storing it again
+		assertEqual(builder.add(".text"sv), 1U);
+		assertEqual(builder.add(".tex"sv), 13U);
+		assertEqual(builder.stringCount(), 3U);
+		assertEqual(builder.length(), 18U);
+
+		// Grow the hash well past its initial size, checking nothing gets lost along the way
+		std::vector<uint32_t> offsets{};
+		for (size_t index{}; index < 1000U; ++index)
+			offsets.push_back(builder.add(fmt::format("symbol{}"sv, index)));
+		assertEqual(builder.stringCount(), 1003U);
+		const StringTable table{builder.storage()};
+		for (size_t index{}; index < 1000U; ++index)
+		{
+			const auto name{fmt::format("symbol{}"sv, index)};
+			assertEqual(builder.add(name), offsets[index]);
+			assertTrue(table.stringFromOffset(offsets[index]) == name);
+		}
+		assertEqual(builder.stringCount(), 1003U);
+
+		// A builder that's only being read hands out a read-only view of the same bytes
+		const auto &reader{builder};
+		const auto view{reader.storage()};
+		assertEqual(view.size(), builder.length());
+		assertTrue(view.data() == builder.storage().data());
+	}
+
+	void testSharedNames()
+	{
+		ELF elf{Class::elf64Bit};
+		constexpr std::array<uint8_t, 1> data{{0x90U}};
+		const auto first{elf.addSection(".text"sv, SectionHeaderType::program, {}, span{data.data(), data.size()})};
+		const auto second{elf.addSection(".text"sv, SectionHeaderType::program, {}, span{data.data(), data.size()})};
+		const auto &sections{elf.sectionHeaders()};
+		assertEqual(sections[first].nameOffset(), sections[second].nameOffset());
+		assertTrue(elf.sectionIndex(".text"sv) == first);
+		assertTrue(elf.sectionIndex(".tex"sv) == std::nullopt);
+		assertTrue(elf.stringTable(1U).stringFromOffset(sections[first].nameOffset()) == ".text"sv);
+	}
+
+	// A value for field of record with every byte different, so any byte out of place shows up
+	template<typename T> [[nodiscard]] static T pattern(const size_t record, const size_t field) noexcept
+	{
+		uint64_t value{};
+		for (size_t byte{}; byte < sizeof(T); ++byte)
+			value |= uint64_t{static_cast<uint8_t>((record * 37U) + (field * 8U) + byte + 1U)} << (byte * 8U);
+		return static_cast<T>(value);
+	}
+
+	template<typename T> void checkArray(const Endian endian)
+	{
+		// Odd counts leave a tail after the 16 byte blocks the swapped path works in
+		for (size_t count{}; count < 40U; ++count)
+		{
+			std::vector<uint8_t> data(count * sizeof(T));
+			const Memory storage{span{data.data(), data.size()}};
+			for (size_t index{}; index < count; ++index)
+			{
+				if constexpr (sizeof(T) == 1U)
+					storage.write(index, pattern<T>(index, 0U));
+				else
+					storage.write(index * sizeof(T), pattern<T>(index, 0U), endian);
+			}
+			std::vector<T> values(count);
+			readArray(storage.dataSpan(), values.data(), count, endian);
+			for (size_t index{}; index < count; ++index)
+				assertEqual(values[index], pattern<T>(index, 0U));
+		}
+	}
+
+	void testReadArray()
+	{
+		for (const auto endian : {Endian::little, Endian::big})
+		{
+			checkArray<uint8_t>(endian);
+			checkArray<uint16_t>(endian);
+			checkArray<uint32_t>(endian);
+			checkArray<uint64_t>(endian);
+			checkArray<int64_t>(endian);
+		}
+	}
+
+	template<typename Symbol, typename Record> void checkSymbols(const Endian endian)
+	{
+		for (size_t count{}; count < 12U; ++count)
+		{
+			std::vector<uint8_t> data(count * Symbol::size());
+			const Memory storage{span{data.data(), data.size()}};
+			// Lay each entry out a field at a time with the per-field writers, then decode them all at once
+			for (size_t index{}; index < count; ++index)
+			{
+				const auto offset{index * Symbol::size()};
+				size_t fieldOffset{};
+				for (size_t field{}; field < Record::fieldSizes.size(); ++field)
+				{
+					const auto fieldOffsetInStorage{offset + fieldOffset};
+					switch (Record::fieldSizes[field])
+					{
+						case 1U:
+							storage.write(fieldOffsetInStorage, pattern<uint8_t>(index, field));
+							break;
+						case 2U:
+							storage.write(fieldOffsetInStorage, pattern<uint16_t>(index, field), endian);
+							break;
+						case 4U:
+							storage.write(fieldOffsetInStorage, pattern<uint32_t>(index, field), endian);
+							break;
+						default:
+							storage.write(fieldOffsetInStorage, pattern<uint64_t>(index, field), endian);
+					}
+					fieldOffset += Record::fieldSizes[field];
+				}
+			}
+			std::vector<Record> records(count);
+			readRecords(storage.dataSpan(), records.data(), count, endian);
+			for (size_t index{}; index < count; ++index)
+			{
+				const Symbol symbol{storage.dataSpan().subspan(index * Symbol::size(), Symbol::size()), endian};
+				const auto &record{records[index]};
+				assertEqual(record.nameOffset, symbol.nameOffset());
+				assertEqual(record.value, symbol.value());
+				assertEqual(record.symbolLength, symbol.symbolLength());
+				assertEqual(record.info, symbol.info());
+				assertEqual(record.other, symbol.other());
+				assertEqual(record.sectionIndex, symbol.sectionIndex());
+			}
+		}
+	}
+
+	void testReadRecords()
+	{
+		for (const auto endian : {Endian::little, Endian::big})
+		{
+			checkSymbols<elf32::ELFSymbol, elf32::SymbolRecord>(endian);
+			checkSymbols<elf64::ELFSymbol, elf64::SymbolRecord>(endian);
+		}
+
+		// 32-bit relocations with addends come in 12 byte entries, which only line up with the blocks every 4
+		std::vector<uint8_t> data(7U * sizeof(elf32::RelaRecord));
+		const Memory storage{span{data.data(), data.size()}};
+		for (size_t index{}; index < 7U; ++index)
+		{
+			storage.write(index * 12U, uint32_t(0x1000U + index), Endian::big);
+			storage.write((index * 12U) + 4U, uint32_t((index << 8U) | 2U), Endian::big);
+			storage.write((index * 12U) + 8U, int32_t(-4 - int32_t(index)), Endian::big);
+		}
+		std::vector<elf32::RelaRecord> relocations(7U);
+		readRecords(storage.dataSpan(), relocations.data(), relocations.size(), Endian::big);
+		for (size_t index{}; index < 7U; ++index)
+		{
+			assertEqual(relocations[index].offset, 0x1000U + index);
+			assertEqual(relocations[index].symbol(), index);
+			assertEqual(relocations[index].type(), 2U);
+			assertEqual(relocations[index].addend, -4 - int32_t(index));
+		}
+	}
+
+	void testReadTable()
+	{
+		for (const auto endian : {Endian::little, Endian::big})
+		{
+			// A 64-bit symbol table built a field at a time must decode to the same thing in bulk
+			std::vector<uint8_t> table(50U * elf64::ELFSymbol::size());
+			const Memory storage{span{table.data(), table.size()}};
+			for (size_t index{}; index < 50U; ++index)
+			{
+				const auto offset{index * elf64::ELFSymbol::size()};
+				storage.write(offset, pattern<uint32_t>(index, 0U), endian);
+				storage.write(offset + 4U, uint8_t(0x12U));
+				storage.write(offset + 6U, pattern<uint16_t>(index, 3U), endian);
+				storage.write(offset + 8U, pattern<uint64_t>(index, 4U), endian);
+				storage.write(offset + 16U, pattern<uint64_t>(index, 5U), endian);
+			}
+			{
+				ELF elf{Class::elf64Bit, endian, Machine::x86_64};
+				static_cast<void>(elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+					span{table.data(), table.size()}, 8U));
+				const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+				assertTrue(file.valid());
+				assertTrue(elf.write(file));
+			}
+			const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+			assertTrue(elf.valid());
+			const auto section{elf.sectionIndex(".symtab"sv)};
+			assertTrue(section.has_value());
+			std::vector<elf64::SymbolRecord> symbols{};
+			assertEqual(elf.readTable(*section, symbols), 50U);
+			for (size_t index{}; index < symbols.size(); ++index)
+			{
+				const auto symbol{elf.symbol(*section, index)};
+				assertEqual(symbols[index].nameOffset, symbol.nameOffset());
+				assertEqual(symbols[index].info, symbol.info());
+				assertEqual(symbols[index].sectionIndex, symbol.sectionIndex());
+				assertEqual(symbols[index].value, symbol.value());
+				assertEqual(symbols[index].symbolLength, symbol.symbolLength());
+			}
+		}
+		std::filesystem::remove(fileName);
+	}
+
+	void testRelocations()
+	{
+		for (const auto endian : {Endian::little, Endian::big})
+		{
+			// 32-bit entries without addends and 64-bit ones with, read in place against decoded in bulk
+			std::vector<uint8_t> rel32(20U * elf32::ELFRelocation::size(false));
+			std::vector<uint8_t> rela64(20U * elf64::ELFRelocation::size(true));
+			const Memory rel32Storage{span{rel32.data(), rel32.size()}};
+			const Memory rela64Storage{span{rela64.data(), rela64.size()}};
+			for (uint32_t index{}; index < 20U; ++index)
+			{
+				rel32Storage.write(index * 8U, 0x100U + (index * 4U), endian);
+				rel32Storage.write((index * 8U) + 4U, (index << 8U) | 2U, endian);
+				rela64Storage.write(index * 24U, uint64_t{0x200U} + (index * 8U), endian);
+				rela64Storage.write((index * 24U) + 8U, (uint64_t{index} << 32U) | 1U, endian);
+				rela64Storage.write((index * 24U) + 16U, static_cast<uint64_t>(-int64_t{index}), endian);
+			}
+			for (const auto elfClass : {Class::elf32Bit, Class::elf64Bit})
+			{
+				{
+					ELF elf{elfClass, endian, Machine::x86_64};
+					if (elfClass == Class::elf32Bit)
+						static_cast<void>(elf.addSection(".rel.text"sv, SectionHeaderType::reloc, {},
+							span{rel32.data(), rel32.size()}, 4U));
+					else
+						static_cast<void>(elf.addSection(".rela.text"sv, SectionHeaderType::relocAddend, {},
+							span{rela64.data(), rela64.size()}, 8U));
+					const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+					assertTrue(file.valid());
+					assertTrue(elf.write(file));
+				}
+				const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+				assertTrue(elf.valid());
+				assertEqual(elf.relocationCount(2U), 20U);
+				assertEqual(elf.relocationCount(5U), 0U);
+				for (uint32_t index{}; index < 20U; ++index)
+				{
+					const auto relocation{elf.relocation(2U, index)};
+					assertEqual(relocation.symbol(), index);
+					if (elfClass == Class::elf32Bit)
+					{
+						assertFalse(relocation.withAddend());
+						assertEqual(relocation.offset(), 0x100U + (index * 4U));
+						assertEqual(relocation.type(), 2U);
+						assertEqual(relocation.addend(), 0);
+					}
+					else
+					{
+						assertTrue(relocation.withAddend());
+						assertEqual(relocation.offset(), 0x200U + (index * 8U));
+						assertEqual(relocation.type(), 1U);
+						assertEqual(relocation.addend(), -int64_t{index});
+					}
+				}
+				if (elfClass == Class::elf64Bit)
+				{
+					std::vector<elf64::RelaRecord> records{};
+					assertEqual(elf.readTable(2U, records), 20U);
+					for (size_t index{}; index < records.size(); ++index)
+					{
+						const auto relocation{elf.relocation(2U, index)};
+						assertEqual(records[index].offset, relocation.offset());
+						assertEqual(records[index].symbol(), relocation.symbol());
+						assertEqual(records[index].addend, relocation.addend());
+					}
+				}
+			}
+		}
+		std::filesystem::remove(fileName);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testValid)
+		CRUNCHpp_TEST(testTruncated)
+		CRUNCHpp_TEST(testCorruptHeader)
+		CRUNCHpp_TEST(testInvalidHeaders)
+		CRUNCHpp_TEST(testCorruptSections)
+		CRUNCHpp_TEST(testExtendedNumbering)
+		CRUNCHpp_TEST(testWriteManySections)
+		CRUNCHpp_TEST(testStringTable)
+		CRUNCHpp_TEST(testStringTableBuilder)
+		CRUNCHpp_TEST(testSharedNames)
+		CRUNCHpp_TEST(testReadArray)
+		CRUNCHpp_TEST(testReadRecords)
+		CRUNCHpp_TEST(testReadTable)
+		CRUNCHpp_TEST(testRelocations)
+	}
+};
+
+CRUNCHpp_TESTS(testELF)
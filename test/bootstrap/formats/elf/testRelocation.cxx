@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <filesystem>
+#include <vector>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../../src/bootstrap/formats/elf/relocation.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::fd_t;
+using substrate::span;
+using substrate::console;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::elf::relocation::Operation;
+using mangrove::elf::relocation::operationFor;
+using mangrove::elf::relocation::Relocator;
+using mangrove::elf::relocation::RelocationError;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+
+// x86-64 relocation types
+constexpr static uint32_t R_X86_64_NONE{0U};
+constexpr static uint32_t R_X86_64_64{1U};
+constexpr static uint32_t R_X86_64_PC32{2U};
+constexpr static uint32_t R_X86_64_GOTPCREL{9U};
+constexpr static uint32_t R_X86_64_PLT32{4U};
+constexpr static uint32_t R_X86_64_32{10U};
+constexpr static uint32_t R_X86_64_32S{11U};
+constexpr static uint32_t R_X86_64_PC64{24U};
+// ARM relocation types
+constexpr static uint32_t R_ARM_ABS32{2U};
+constexpr static uint32_t R_ARM_REL32{3U};
+constexpr static uint32_t R_ARM_THM_CALL{10U};
+constexpr static uint32_t R_ARM_CALL{28U};
+constexpr static uint32_t R_ARM_JUMP24{29U};
+constexpr static uint32_t R_ARM_THM_JUMP24{30U};
+constexpr static uint32_t R_ARM_THM_MOVW_ABS_NC{47U};
+constexpr static uint32_t R_ARM_THM_MOVT_ABS{48U};
+
+class testRelocation final : public testsuite
+{
+private:
+	const std::filesystem::path fileName{std::filesystem::temp_directory_path() / "mangroveTestRelocation.o"};
+
+	[[nodiscard]] static elf64::RelaRecord rela(const uint64_t offset, const uint32_t symbol, const uint32_t type,
+		const int64_t addend) noexcept
+		{ return {offset, (uint64_t{symbol} << 32U) | type, addend}; }
+
+	[[nodiscard]] static elf32::RelRecord rel(const uint32_t offset, const uint32_t symbol, const uint32_t type) noexcept
+		{ return {offset, (symbol << 8U) | type}; }
+
+	// Thumb-2 instructions are stored as a pair of halfwords, the first making up the top 16 bits here
+	static void writeThumb(const Memory &storage, const size_t offset, const uint32_t instruction,
+		const Endian endian) noexcept
+	{
+		storage.write(offset, static_cast<uint16_t>(instruction >> 16U), endian);
+		storage.write(offset + 2U, static_cast<uint16_t>(instruction), endian);
+	}
+
+	[[nodiscard]] static uint32_t readThumb(const Memory &storage, const size_t offset, const Endian endian) noexcept
+	{
+		return (uint32_t{storage.read<uint16_t>(offset, endian)} << 16U) |
+			storage.read<uint16_t>(offset + 2U, endian);
+	}
+
+	template<typename T> [[nodiscard]] static span<const T> spanOf(const std::vector<T> &values) noexcept
+		{ return {values.data(), values.size()}; }
+
+	void testOperations()
+	{
+		assertTrue(operationFor(Machine::x86_64, R_X86_64_64) == Operation::absolute64);
+		assertTrue(operationFor(Machine::x86_64, R_X86_64_PLT32) == Operation::relative32Signed);
+		assertTrue(operationFor(Machine::x86_64, R_X86_64_GOTPCREL) == Operation::unsupported);
+		assertTrue(operationFor(Machine::x86_64, 0xffffffffU) == Operation::unsupported);
+		assertTrue(operationFor(Machine::arm, R_ARM_JUMP24) == Operation::armBranch24);
+		assertTrue(operationFor(Machine::arm, R_ARM_THM_CALL) == Operation::thumbCall);
+		assertTrue(operationFor(Machine::mips, 0U) == Operation::unsupported);
+		assertTrue(Relocator{Machine::x86_64, Endian::little}.supported());
+		assertFalse(Relocator{Machine::mips, Endian::big}.supported());
+	}
+
+	void testX86_64()
+	{
+		constexpr uint64_t address{0x401000U};
+		const std::vector<uint64_t> symbols{0U, 0x402000U, 0xffffffff80001000U};
+		const std::vector<elf64::RelaRecord> relocations
+		{
+			rela(0U, 1U, R_X86_64_64, 8),
+			rela(8U, 1U, R_X86_64_PC32, -4),
+			rela(12U, 1U, R_X86_64_PLT32, -4),
+			rela(16U, 1U, R_X86_64_32, 0x10),
+			rela(20U, 2U, R_X86_64_32S, 0),
+			rela(24U, 2U, R_X86_64_PC64, 0),
+			rela(32U, 0U, R_X86_64_NONE, 0),
+		};
+		std::vector<uint8_t> section(40U, 0xaaU);
+		const Memory storage{span{section.data(), section.size()}};
+		Relocator relocator{Machine::x86_64, Endian::little};
+		const auto result{relocator.apply(span{section.data(), section.size()}, address, spanOf(relocations),
+			spanOf(symbols))};
+		assertTrue(result.success());
+		assertEqual(result.applied, relocations.size());
+		assertEqual(storage.read<uint64_t>(0U, Endian::little), 0x402008U);
+		assertEqual(storage.read<uint32_t>(8U, Endian::little), 0x402000U - 4U - (address + 8U));
+		assertEqual(storage.read<uint32_t>(12U, Endian::little), 0x402000U - 4U - (address + 12U));
+		assertEqual(storage.read<uint32_t>(16U, Endian::little), 0x402010U);
+		assertEqual(storage.read<uint32_t>(20U, Endian::little), 0x80001000U);
+		assertEqual(storage.read<uint64_t>(24U, Endian::little), 0xffffffff80001000U - (address + 24U));
+		// R_X86_64_NONE leaves its field alone
+		assertEqual(storage.read<uint64_t>(32U, Endian::little), 0xaaaaaaaaaaaaaaaaU);
+	}
+
+	void testOverflow()
+	{
+		const std::vector<uint64_t> symbols{0U, 0x100000000U, 0x80000000U};
+		std::vector<uint8_t> section(16U);
+		Relocator relocator{Machine::x86_64, Endian::little};
+		// R_X86_64_32 has to zero-extend, R_X86_64_32S sign-extend - the lowest failing entry is reported
+		auto result{relocator.apply(span{section.data(), section.size()}, 0U, spanOf(std::vector
+		{
+			rela(0U, 2U, R_X86_64_32, 0),
+			rela(4U, 2U, R_X86_64_32S, 0),
+			rela(8U, 1U, R_X86_64_32, -1),
+			rela(12U, 1U, R_X86_64_32, 0),
+		}), spanOf(symbols))};
+		assertFalse(result.success());
+		assertTrue(result.error == RelocationError::overflow);
+		assertEqual(result.index, 1U);
+		// Entries that fit are still applied
+		assertEqual(Memory{span{section.data(), section.size()}}.read<uint32_t>(8U, Endian::little), 0xffffffffU);
+
+		// A call more than 2GiB away doesn't fit in a PC32 either
+		result = relocator.apply(span{section.data(), section.size()}, 0x100000000U, spanOf(std::vector
+			{rela(0U, 0U, R_X86_64_PC32, 0)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::overflow);
+		assertEqual(result.index, 0U);
+	}
+
+	void testValidation()
+	{
+		const std::vector<uint64_t> symbols{0U, 0x1000U};
+		std::vector<uint8_t> section(16U, 0x55U);
+		const span<uint8_t> contents{section.data(), section.size()};
+		Relocator relocator{Machine::x86_64, Endian::little};
+		// Nothing is written when any entry fails validation, even if entries before it were fine
+		auto result{relocator.apply(contents, 0U, spanOf(std::vector
+			{rela(0U, 1U, R_X86_64_64, 0), rela(8U, 1U, R_X86_64_GOTPCREL, 0)}), spanOf(symbols))};
+		assertTrue(result.error == RelocationError::unsupportedType);
+		assertEqual(result.index, 1U);
+		assertEqual(result.applied, 0U);
+		result = relocator.apply(contents, 0U, spanOf(std::vector
+			{rela(0U, 1U, R_X86_64_64, 0), rela(8U, 2U, R_X86_64_64, 0)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::badSymbol);
+		assertEqual(result.index, 1U);
+		result = relocator.apply(contents, 0U, spanOf(std::vector
+			{rela(0U, 1U, R_X86_64_64, 0), rela(12U, 1U, R_X86_64_64, 0)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::outOfBounds);
+		result = relocator.apply(contents, 0U, spanOf(std::vector
+			{rela(UINT64_MAX - 1U, 1U, R_X86_64_PC32, 0)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::outOfBounds);
+		for (const auto byte : section)
+			assertEqual(byte, 0x55U);
+
+		Relocator unsupported{Machine::mips, Endian::big};
+		result = unsupported.apply(contents, 0U, spanOf(std::vector<elf32::RelRecord>{}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::unsupportedMachine);
+	}
+
+	void checkARM(const Endian endian)
+	{
+		constexpr uint32_t address{0x9000U};
+		const std::vector<uint64_t> symbols{0U, 0x8000U, 0x4000000U};
+		std::vector<uint8_t> section(24U);
+		const Memory storage{span{section.data(), section.size()}};
+		// SHT_REL addends live in the fields being relocated
+		storage.write(0U, uint32_t{4U}, endian);
+		storage.write(4U, uint32_t{0xfffffff8U}, endian);
+		// BL and B with the usual -8 for the pipeline encoded as the addend
+		storage.write(8U, uint32_t{0xebfffffeU}, endian);
+		storage.write(12U, uint32_t{0xeafffffeU}, endian);
+		storage.write(16U, uint32_t{0xebfffffeU}, endian);
+		Relocator relocator{Machine::arm, endian};
+		auto result{relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+		{
+			rel(8U, 1U, R_ARM_CALL),
+			rel(0U, 1U, R_ARM_ABS32),
+			rel(4U, 1U, R_ARM_REL32),
+			rel(12U, 1U, R_ARM_JUMP24),
+		}), spanOf(symbols))};
+		assertTrue(result.success());
+		assertEqual(storage.read<uint32_t>(0U, endian), 0x8004U);
+		assertEqual(storage.read<uint32_t>(4U, endian), 0x8000U - 8U - (address + 4U));
+		// (0x8000 - 8 - 0x9008) >> 2 in the low 24 bits, with the condition and opcode left alone
+		assertEqual(storage.read<uint32_t>(8U, endian), 0xeb000000U | ((0x8000U - 8U - (address + 8U)) >> 2U & 0xffffffU));
+		assertEqual(storage.read<uint32_t>(12U, endian), 0xea000000U | ((0x8000U - 8U - (address + 12U)) >> 2U & 0xffffffU));
+
+		// A branch only reaches +/-32MiB
+		result = relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+			{rel(16U, 2U, R_ARM_CALL)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::overflow);
+	}
+
+	void checkInterworking(const Endian endian)
+	{
+		constexpr uint32_t address{0x9000U};
+		// An ARM function, then two Thumb ones, the second only halfword aligned, marked by bit 0 of their values
+		const std::vector<uint64_t> symbols{0U, 0x8000U, 0x8101U, 0x8103U};
+		std::vector<uint8_t> section(16U);
+		const Memory storage{span{section.data(), section.size()}};
+		// BL with the usual -8 for the pipeline as its addend, and the same as a BLX
+		storage.write(0U, uint32_t{0xebfffffeU}, endian);
+		storage.write(4U, uint32_t{0xebfffffeU}, endian);
+		storage.write(8U, uint32_t{0xfafffffeU}, endian);
+		storage.write(12U, uint32_t{0xeafffffeU}, endian);
+		Relocator relocator{Machine::arm, endian};
+		auto result{relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+		{
+			rel(0U, 2U, R_ARM_CALL),
+			rel(4U, 3U, R_ARM_CALL),
+			rel(8U, 1U, R_ARM_CALL),
+		}), spanOf(symbols))};
+		assertTrue(result.success());
+		// Calls into Thumb code become BLX, with the H bit giving the halfword, and those into ARM code BL
+		assertEqual(storage.read<uint32_t>(0U, endian), 0xfafffc3eU);
+		assertEqual(storage.read<uint32_t>(4U, endian), 0xfbfffc3dU);
+		assertEqual(storage.read<uint32_t>(8U, endian), 0xebfffbfcU);
+
+		// A B can't switch to Thumb, and we don't make veneers
+		result = relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+			{rel(12U, 2U, R_ARM_JUMP24)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::overflow);
+	}
+
+	void checkThumb(const Endian endian)
+	{
+		constexpr uint32_t address{0x9000U};
+		const std::vector<uint64_t> symbols{0U, 0x8000U, 0x8101U, 0x1a345e79U};
+		std::vector<uint8_t> section(24U);
+		const Memory storage{span{section.data(), section.size()}};
+		// BL, BL and B.W with the -4 for the pipeline as their addend, then MOVW and MOVT with an addend of 4
+		writeThumb(storage, 0U, 0xf7fffffeU, endian);
+		writeThumb(storage, 6U, 0xf7fffffeU, endian);
+		writeThumb(storage, 10U, 0xf7ffbffeU, endian);
+		writeThumb(storage, 16U, 0xf2400004U, endian);
+		writeThumb(storage, 20U, 0xf2c00004U, endian);
+		Relocator relocator{Machine::arm, endian};
+		auto result{relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+		{
+			rel(0U, 2U, R_ARM_THM_CALL),
+			rel(6U, 1U, R_ARM_THM_CALL),
+			rel(10U, 2U, R_ARM_THM_JUMP24),
+			rel(16U, 3U, R_ARM_THM_MOVW_ABS_NC),
+			rel(20U, 3U, R_ARM_THM_MOVT_ABS),
+		}), spanOf(symbols))};
+		assertTrue(result.success());
+		// BL by -0xf04 to the Thumb function
+		assertEqual(readThumb(storage, 0U, endian), 0xf7fff87eU);
+		// BLX by -0x1008 from 0x9004, the field's address rounded down to a word, to the ARM one
+		assertEqual(readThumb(storage, 6U, endian), 0xf7feeffcU);
+		// B.W by -0xf0e
+		assertEqual(readThumb(storage, 10U, endian), 0xf7ffb879U);
+		// 0x5e7d and 0x1a34 split up across imm4:i:imm3:imm8, keeping the T bit in the low half
+		assertEqual(readThumb(storage, 16U, endian), 0xf645607dU);
+		assertEqual(readThumb(storage, 20U, endian), 0xf6c12034U);
+
+		// Nor can a B.W switch to ARM
+		result = relocator.apply(span{section.data(), section.size()}, address, spanOf(std::vector
+			{rel(10U, 1U, R_ARM_THM_JUMP24)}), spanOf(symbols));
+		assertTrue(result.error == RelocationError::overflow);
+	}
+
+	void testARM()
+	{
+		checkARM(Endian::little);
+		checkARM(Endian::big);
+		checkInterworking(Endian::little);
+		checkInterworking(Endian::big);
+	}
+
+	void testThumb()
+	{
+		checkThumb(Endian::little);
+		checkThumb(Endian::big);
+	}
+
+	void testApplySection()
+	{
+		// A .text with a .rela.text against it, written out and read back in to be relocated
+		const std::vector<elf64::RelaRecord> relocations{rela(1U, 1U, R_X86_64_PC32, -4), rela(8U, 2U, R_X86_64_64, 0)};
+		for (const auto endian : {Endian::little, Endian::big})
+		{
+			std::vector<uint8_t> table(relocations.size() * elf64::ELFRelocation::size(true));
+			const Memory tableStorage{span{table.data(), table.size()}};
+			for (size_t index{}; index < relocations.size(); ++index)
+			{
+				tableStorage.write(index * 24U, relocations[index].offset, endian);
+				tableStorage.write((index * 24U) + 8U, relocations[index].info, endian);
+				tableStorage.write((index * 24U) + 16U, static_cast<uint64_t>(relocations[index].addend), endian);
+			}
+			{
+				ELF elf{Class::elf64Bit, endian, Machine::x86_64};
+				constexpr std::array<uint8_t, 16> text{{0xe8U}};
+				static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+					{SectionFlag::allocate, SectionFlag::execuable}, span{text.data(), text.size()}, 16U));
+				static_cast<void>(elf.addSection(".rela.text"sv, SectionHeaderType::relocAddend, {},
+					span{table.data(), table.size()}, 8U));
+				const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+				assertTrue(file.valid());
+				assertTrue(elf.write(file));
+			}
+			const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+			assertTrue(elf.valid());
+			const auto textData{elf.sectionData(*elf.sectionIndex(".text"sv))};
+			std::vector<uint8_t> text{textData.data(), textData.data() + textData.length()};
+			const std::vector<uint64_t> symbols{0U, 0x1100U, 0x123456789aU};
+			Relocator relocator{elf.header().machine(), endian};
+			const auto result{relocator.applySection(elf, *elf.sectionIndex(".rela.text"sv),
+				span{text.data(), text.size()}, 0x1000U, spanOf(symbols))};
+			assertTrue(result.success());
+			assertEqual(result.applied, 2U);
+			const Memory storage{span{text.data(), text.size()}};
+			assertEqual(storage.read<uint8_t>(0U), 0xe8U);
+			assertEqual(storage.read<uint32_t>(1U, endian), 0x1100U - 4U - 0x1001U);
+			assertEqual(storage.read<uint64_t>(8U, endian), 0x123456789aU);
+		}
+		std::filesystem::remove(fileName);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testOperations)
+		CRUNCHpp_TEST(testX86_64)
+		CRUNCHpp_TEST(testOverflow)
+		CRUNCHpp_TEST(testValidation)
+		CRUNCHpp_TEST(testARM)
+		CRUNCHpp_TEST(testThumb)
+		CRUNCHpp_TEST(testApplySection)
+	}
+};
+
+CRUNCHpp_TESTS(testRelocation)
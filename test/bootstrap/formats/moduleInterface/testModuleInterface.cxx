@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../../src/bootstrap/formats/moduleInterface/moduleInterface.hxx"
+
+using namespace std::literals::string_view_literals;
+using namespace mangrove::core::utf8::literals;
+using substrate::fd_t;
+using substrate::span;
+using substrate::console;
+using mangrove::core::utf8::String;
+using mangrove::elf::io::Memory;
+using mangrove::elf::ELF;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::ast::symbolTable::SymbolType;
+using mangrove::ast::symbolTable::SymbolTypes;
+using mangrove::moduleInterface::ModuleInterface;
+using mangrove::moduleInterface::InterfaceBuilder;
+using mangrove::moduleInterface::interfaceSectionName;
+using mangrove::moduleInterface::types::InterfaceHeader;
+using mangrove::moduleInterface::types::ExportedSymbol;
+
+constexpr static size_t exportCount{1000U};
+
+class testModuleInterface final : public testsuite
+{
+private:
+	static InterfaceBuilder makeBuilder()
+	{
+		InterfaceBuilder builder{};
+		for (size_t index{}; index < exportCount; ++index)
+		{
+			const String name{std::string_view{fmt::format("export{}"sv, index)}};
+			static_cast<void>(builder.add(name, index & 1U ? SymbolType{SymbolTypes::int32Bit} :
+				SymbolType{{SymbolTypes::type, SymbolTypes::character, SymbolTypes::list}}));
+		}
+		return builder;
+	}
+
+	void checkLookups(const ModuleInterface &interface)
+	{
+		assertTrue(interface.valid());
+		assertEqual(interface.symbolCount(), exportCount);
+		for (size_t index{}; index < exportCount; ++index)
+		{
+			const auto name{fmt::format("export{}"sv, index)};
+			const auto symbol{interface.find(String{std::string_view{name}})};
+			assertTrue(symbol.has_value());
+			assertTrue(interface.name(*symbol) == name);
+			if (index & 1U)
+				assertTrue(ModuleInterface::type(*symbol) == SymbolTypes::int32Bit);
+			else
+				assertTrue(ModuleInterface::type(*symbol).forValue() ==
+					SymbolType{{SymbolTypes::character, SymbolTypes::list}});
+		}
+		assertFalse(interface.find(u8"export"_sv).has_value());
+		assertFalse(interface.find(u8"missing"_sv).has_value());
+		assertFalse(interface.find(u8""_sv).has_value());
+	}
+
+	void testBuilder()
+	{
+		InterfaceBuilder builder{};
+		assertTrue(builder.add(u8"a"_sv, SymbolTypes::boolVal));
+		assertFalse(builder.add(u8"a"_sv, SymbolTypes::character));
+		assertEqual(builder.exportCount(), 1U);
+		// The builder's output doesn't depend on the order exports are added in
+		InterfaceBuilder reversed{};
+		assertTrue(reversed.add(u8"b"_sv, SymbolTypes::none));
+		assertTrue(reversed.add(u8"a"_sv, SymbolTypes::boolVal));
+		assertTrue(builder.add(u8"b"_sv, SymbolTypes::none));
+		assertTrue(builder.build() == reversed.build());
+	}
+
+	void testMapped()
+	{
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveTestModuleInterface.mmi"};
+		{
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(makeBuilder().write(file));
+		}
+		checkLookups(ModuleInterface{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}});
+		std::filesystem::remove(fileName);
+		// A missing file simply fails to load
+		assertFalse(ModuleInterface{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}}.valid());
+	}
+
+	void testEndian()
+	{
+		auto little{makeBuilder().build(Endian::little)};
+		auto big{makeBuilder().build(Endian::big)};
+		assertFalse(little == big);
+		checkLookups(ModuleInterface{Memory{span{little.data(), little.size()}}});
+		checkLookups(ModuleInterface{Memory{span{big.data(), big.size()}}});
+	}
+
+	void testCorrupt()
+	{
+		auto data{makeBuilder().build()};
+		const Memory storage{span{data.data(), data.size()}};
+		// Truncated files and files with tables running off the end are rejected up front
+		assertFalse(ModuleInterface{Memory{span{data.data(), InterfaceHeader::size() - 1U}}}.valid());
+		assertFalse(ModuleInterface{Memory{span{data.data(), data.size() - 1U}}}.valid());
+		auto badMagic{data};
+		badMagic[1] = 'X';
+		assertFalse(ModuleInterface{Memory{span{badMagic.data(), badMagic.size()}}}.valid());
+		auto badBuckets{data};
+		InterfaceHeader{Memory{span{badBuckets.data(), badBuckets.size()}}}.bucketCount(3U);
+		assertFalse(ModuleInterface{Memory{span{badBuckets.data(), badBuckets.size()}}}.valid());
+
+		// A chain that loops back on itself must not make lookups spin
+		const InterfaceHeader header{storage};
+		for (size_t index{}; index < header.symbolCount(); ++index)
+			ExportedSymbol{storage.dataSpan().subspan(header.symbolsOffset() + (index * ExportedSymbol::size())),
+				header.endian()}.next(static_cast<uint32_t>(index + 1U));
+		const ModuleInterface looped{storage};
+		assertTrue(looped.valid());
+		assertFalse(looped.find(u8"missing"_sv).has_value());
+	}
+
+	void checkEmbedded(const Class elfClass, const Endian endian)
+	{
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveTestModuleInterface.o"};
+		{
+			ELF elf{elfClass, endian, Machine::x86_64};
+			constexpr std::array<uint8_t, 4> text{{0x55U, 0x48U, 0x89U, 0xe5U}};
+			assertEqual(elf.addSection(".text"sv, SectionHeaderType::program,
+				{SectionFlag::allocate, SectionFlag::execuable}, span{text.data(), text.size()}, 16U), 2U);
+			assertEqual(makeBuilder().embedInto(elf), 3U);
+			// Sections can be found by name while still being built, too
+			assertTrue(elf.sectionIndex(interfaceSectionName) == 3U);
+			assertTrue(ModuleInterface{elf}.valid());
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(elf.write(file));
+		}
+		const ELF elf{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.header().elfClass() == elfClass);
+		assertTrue(elf.header().endian() == endian);
+		assertEqual(elf.sectionHeaders().size(), 4U);
+		assertTrue(elf.sectionIndex(".text"sv) == 2U);
+		assertTrue(elf.sectionIndex(".data"sv) == std::nullopt);
+		const auto text{elf.sectionData(2U)};
+		assertEqual(text.length(), 4U);
+		assertEqual(text.read<uint8_t>(0), 0x55U);
+		// The interface is read straight out of the object file's mapping
+		const auto section{elf.sectionData(3U)};
+		assertEqual(section.dataSpan().data() - elf.sectionData(2U).dataSpan().data(),
+			static_cast<ptrdiff_t>(elf.sectionHeaders()[3].fileOffset() - elf.sectionHeaders()[2].fileOffset()));
+		assertEqual(elf.sectionHeaders()[3].fileOffset() % 8U, 0U);
+		checkLookups(ModuleInterface{elf});
+		std::filesystem::remove(fileName);
+	}
+
+	void testEmbedded()
+	{
+		checkEmbedded(Class::elf64Bit, Endian::little);
+		checkEmbedded(Class::elf32Bit, Endian::big);
+		// An object file without an embedded interface doesn't provide one
+		const ELF elf{Class::elf64Bit};
+		assertFalse(ModuleInterface{elf}.valid());
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testBuilder)
+		CRUNCHpp_TEST(testMapped)
+		CRUNCHpp_TEST(testEndian)
+		CRUNCHpp_TEST(testCorrupt)
+		CRUNCHpp_TEST(testEmbedded)
+	}
+};
+
+CRUNCHpp_TESTS(testModuleInterface)
@@ -0,0 +1,693 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include <fmt/format.h>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/link/linker.hxx"
+#include "../../../src/bootstrap/formats/elf/elf.hxx"
+
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::fd_t;
+using substrate::span;
+using substrate::console;
+using mangrove::core::Flags;
+using mangrove::elf::ELF;
+using mangrove::elf::io::Memory;
+using mangrove::elf::enums::Class;
+using mangrove::elf::enums::Endian;
+using mangrove::elf::enums::Machine;
+using mangrove::elf::enums::Type;
+using mangrove::elf::enums::ProgramHeaderType;
+using mangrove::elf::enums::SectionFlag;
+using mangrove::elf::enums::SectionHeaderType;
+using mangrove::elf::types::StringTableBuilder;
+using mangrove::link::link;
+using mangrove::link::LinkOptions;
+using mangrove::link::LinkResult;
+namespace elf32 = mangrove::elf::types::elf32;
+namespace elf64 = mangrove::elf::types::elf64;
+
+// x86-64 relocation types
+constexpr static uint32_t R_X86_64_64{1U};
+constexpr static uint32_t R_X86_64_PC32{2U};
+constexpr static uint32_t R_X86_64_PLT32{4U};
+// ARM relocation types
+constexpr static uint32_t R_ARM_ABS32{2U};
+constexpr static uint32_t R_ARM_CALL{28U};
+// SHT_ARM_EXIDX, ARM's unwind tables
+constexpr static auto armExidx{static_cast<SectionHeaderType>(0x70000001U)};
+// Symbol info for each binding, with type NOTYPE
+constexpr static uint8_t localSymbol{0x00U};
+constexpr static uint8_t globalSymbol{0x10U};
+constexpr static uint8_t weakSymbol{0x20U};
+// Where the builder puts each section in the objects made here
+constexpr static uint16_t textSection{2U};
+constexpr static uint16_t dataSection{3U};
+constexpr static uint16_t bssSection{4U};
+
+struct TestSymbol final
+{
+	std::string_view name;
+	uint8_t info;
+	uint16_t section;
+	uint64_t value;
+};
+
+struct TestRelocation final
+{
+	uint64_t offset;
+	uint32_t symbol;
+	uint32_t type;
+	int64_t addend;
+};
+
+struct TestSection final
+{
+	std::string_view name;
+	std::vector<uint8_t> contents;
+	std::vector<TestRelocation> relocations{};
+	SectionHeaderType type{SectionHeaderType::program};
+	Flags<SectionFlag> flags{SectionFlag::allocate, SectionFlag::execuable};
+	uint32_t linkedTo{};
+};
+
+struct TestObject final
+{
+	std::vector<uint8_t> text{};
+	std::vector<uint8_t> data{};
+	uint64_t bssLength{};
+	// Symbol 0, the null symbol, is added automatically
+	std::vector<TestSymbol> symbols{};
+	std::vector<TestRelocation> textRelocations{};
+	std::vector<TestRelocation> dataRelocations{};
+};
+
+class testLinker final : public testsuite
+{
+private:
+	const path directory{std::filesystem::temp_directory_path() / "mangroveTestLinker"};
+
+	[[nodiscard]] path file(const std::string_view name) const { return directory / name; }
+
+	[[nodiscard]] static std::vector<uint8_t> relocationTable(const std::vector<TestRelocation> &relocations)
+	{
+		std::vector<uint8_t> table(relocations.size() * elf64::ELFRelocation::size(true));
+		const Memory storage{span{table.data(), table.size()}};
+		for (size_t index{}; index < relocations.size(); ++index)
+		{
+			const auto &relocation{relocations[index]};
+			storage.write(index * 24U, relocation.offset, Endian::little);
+			storage.write((index * 24U) + 8U, (uint64_t{relocation.symbol} << 32U) | relocation.type, Endian::little);
+			storage.write((index * 24U) + 16U, static_cast<uint64_t>(relocation.addend), Endian::little);
+		}
+		return table;
+	}
+
+	// Writes out an x86-64 object with .text, .data and .bss sections and the symbols and relocations given
+	void writeObject(const path &fileName, const TestObject &object)
+	{
+		StringTableBuilder names{};
+		std::vector<uint8_t> symbols((object.symbols.size() + 1U) * elf64::ELFSymbol::size());
+		const Memory symbolStorage{span{symbols.data(), symbols.size()}};
+		uint32_t firstGlobal{1U};
+		for (size_t index{}; index < object.symbols.size(); ++index)
+		{
+			const auto &symbol{object.symbols[index]};
+			const auto offset{(index + 1U) * elf64::ELFSymbol::size()};
+			symbolStorage.write(offset, names.add(symbol.name), Endian::little);
+			symbolStorage.write(offset + 4U, symbol.info);
+			symbolStorage.write(offset + 6U, symbol.section, Endian::little);
+			symbolStorage.write(offset + 8U, symbol.value, Endian::little);
+			if (symbol.info == localSymbol)
+				firstGlobal = static_cast<uint32_t>(index + 2U);
+		}
+		const auto textRelocations{relocationTable(object.textRelocations)};
+		const auto dataRelocations{relocationTable(object.dataRelocations)};
+		const std::vector<uint8_t> bss(object.bssLength);
+		const auto stringData{names.storage()};
+
+		ELF elf{Class::elf64Bit, Endian::little, Machine::x86_64};
+		static_cast<void>(elf.addSection(".text"sv, SectionHeaderType::program,
+			{SectionFlag::allocate, SectionFlag::execuable}, span{object.text.data(), object.text.size()}, 16U));
+		static_cast<void>(elf.addSection(".data"sv, SectionHeaderType::program,
+			{SectionFlag::allocate, SectionFlag::writeable}, span{object.data.data(), object.data.size()}, 8U));
+		static_cast<void>(elf.addSection(".bss"sv, SectionHeaderType::bss,
+			{SectionFlag::allocate, SectionFlag::writeable}, span{bss.data(), bss.size()}, 8U));
+		const auto strtab{elf.addSection(".strtab"sv, SectionHeaderType::stringTable, {},
+			span{stringData.data(), stringData.length()})};
+		const auto symtab{elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+			span{symbols.data(), symbols.size()}, 8U)};
+		elf.sectionHeaders()[symtab].link(static_cast<uint32_t>(strtab));
+		elf.sectionHeaders()[symtab].info(firstGlobal);
+		elf.sectionHeaders()[symtab].entityLength(elf64::ELFSymbol::size());
+		for (const auto &[name, table, target] : {std::tuple{".rela.text"sv, &textRelocations, textSection},
+			std::tuple{".rela.data"sv, &dataRelocations, dataSection}})
+		{
+			const auto index{elf.addSection(name, SectionHeaderType::relocAddend, {SectionFlag::infoLink},
+				span{table->data(), table->size()}, 8U)};
+			elf.sectionHeaders()[index].link(static_cast<uint32_t>(symtab));
+			elf.sectionHeaders()[index].info(target);
+			elf.sectionHeaders()[index].entityLength(elf64::ELFRelocation::size(true));
+		}
+		const fd_t output{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		assertTrue(output.valid());
+		assertTrue(elf.write(output));
+	}
+
+	/**
+	 * Writes the objects for a program that exits with 42 - start.o calls f() via the PLT and passes what
+	 * it returns to exit(). f.o's f() reads a global, value, which weak.o also defines weakly as 7,
+	 * and start.o also holds a pointer to an undefined weak symbol, which must come out as 0.
+	 */
+	void writeProgram()
+	{
+		TestObject start{};
+		// call f; mov edi, eax; mov eax, 60; syscall
+		start.text = {0xe8U, 0U, 0U, 0U, 0U, 0x89U, 0xc7U, 0xb8U, 0x3cU, 0U, 0U, 0U, 0x0fU, 0x05U};
+		start.data = std::vector<uint8_t>(8U, 0xffU);
+		start.symbols = {{"_start"sv, globalSymbol, textSection, 0U}, {"f"sv, globalSymbol, 0U, 0U},
+			{"missing"sv, weakSymbol, 0U, 0U}};
+		start.textRelocations = {{1U, 2U, R_X86_64_PLT32, -4}};
+		start.dataRelocations = {{0U, 3U, R_X86_64_64, 0}};
+		writeObject(file("start.o"sv), start);
+
+		TestObject function{};
+		// mov eax, [rip + value]; ret
+		function.text = {0x8bU, 0x05U, 0U, 0U, 0U, 0U, 0xc3U};
+		function.data = {42U, 0U, 0U, 0U};
+		function.bssLength = 16U;
+		function.symbols = {{"scratch"sv, localSymbol, bssSection, 0U}, {"f"sv, globalSymbol, textSection, 0U},
+			{"value"sv, globalSymbol, dataSection, 0U}};
+		function.textRelocations = {{2U, 3U, R_X86_64_PC32, -4}};
+		writeObject(file("f.o"sv), function);
+
+		TestObject weak{};
+		weak.data = {7U, 0U, 0U, 0U};
+		weak.symbols = {{"value"sv, weakSymbol, dataSection, 0U}};
+		writeObject(file("weak.o"sv), weak);
+	}
+
+	[[nodiscard]] LinkResult linkProgram(const std::vector<std::string_view> &objects, const size_t workers = 2U,
+		const std::string_view output = "program"sv)
+	{
+		std::vector<path> files{};
+		for (const auto object : objects)
+			files.emplace_back(file(object));
+		LinkOptions options{};
+		options.output = file(output);
+		options.workers = workers;
+		return link(files, options);
+	}
+
+	[[nodiscard]] static std::vector<uint8_t> readFile(const path &fileName)
+	{
+		const fd_t input{fileName.c_str(), O_RDONLY | O_NOCTTY};
+		std::vector<uint8_t> contents(static_cast<size_t>(input.length()));
+		return input.read(contents.data(), contents.size()) ? contents : std::vector<uint8_t>{};
+	}
+
+	// Packs objects already written into a GNU archive, indexing each as defining the symbols given
+	void writeArchive(const std::string_view name,
+		const std::vector<std::pair<std::string_view, std::vector<std::string_view>>> &members)
+	{
+		std::vector<std::vector<uint8_t>> contents{};
+		size_t symbolCount{};
+		std::string symbolNames{};
+		for (const auto &[member, symbols] : members)
+		{
+			contents.emplace_back(readFile(file(member)));
+			for (const auto symbol : symbols)
+			{
+				++symbolCount;
+				symbolNames += symbol;
+				symbolNames += '\0';
+			}
+		}
+		std::vector<uint8_t> index((symbolCount + 1U) * 4U);
+		index.insert(index.end(), symbolNames.begin(), symbolNames.end());
+		const Memory indexStorage{span{index.data(), index.size()}};
+		indexStorage.write(0U, static_cast<uint32_t>(symbolCount), Endian::big);
+		auto offset{8U + 60U + index.size() + (index.size() & 1U)};
+		size_t position{4U};
+		for (size_t member{}; member < members.size(); ++member)
+		{
+			for (size_t symbol{}; symbol < members[member].second.size(); ++symbol, position += 4U)
+				indexStorage.write(position, static_cast<uint32_t>(offset), Endian::big);
+			offset += 60U + contents[member].size() + (contents[member].size() & 1U);
+		}
+
+		std::string archive{"!<arch>\n"};
+		const auto appendMember{[&](const std::string_view memberName, const std::vector<uint8_t> &data)
+		{
+			archive += fmt::format("{:<16}{:<12}{:<6}{:<6}{:<8}{:<10}`\n"sv, memberName, 0, 0, 0, 644, data.size());
+			archive.append(data.begin(), data.end());
+			if (archive.size() & 1U)
+				archive += '\n';
+		}};
+		appendMember("/"sv, index);
+		for (size_t member{}; member < members.size(); ++member)
+			appendMember(fmt::format("{}/"sv, members[member].first), contents[member]);
+		const fd_t output{file(name).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		assertTrue(output.valid());
+		assertTrue(output.write(archive.data(), archive.size()));
+	}
+
+	[[nodiscard]] static bool hasError(const LinkResult &result, const std::string_view message)
+	{
+		for (const auto &error : result.errors)
+		{
+			if (error.find(message) != std::string::npos)
+				return true;
+		}
+		return false;
+	}
+
+	void testLink()
+	{
+		std::filesystem::create_directories(directory);
+		writeProgram();
+		// weak.o going first checks that the strong definition in f.o still wins
+		const auto result{linkProgram({"weak.o"sv, "start.o"sv, "f.o"sv})};
+		for (const auto &error : result.errors)
+			console.error(error);
+		assertTrue(result.success());
+		assertEqual(result.objects, 3U);
+		assertEqual(result.sections, 3U);
+		assertEqual(result.relocations, 3U);
+		assertEqual(result.symbols, 3U);
+		assertEqual(std::filesystem::file_size(file("program"sv)), result.outputLength);
+
+		const ELF elf{fd_t{file("program"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.valid());
+		assertTrue(elf.header().type() == Type::executable);
+		assertTrue(elf.header().machine() == Machine::x86_64);
+		assertEqual(elf.programHeaders().size(), 2U);
+		for (const auto &header : elf.programHeaders())
+		{
+			assertTrue(header.type() == ProgramHeaderType::load);
+			assertEqual(header.alignment(), 0x1000U);
+			assertEqual(header.virtualAddress() % 0x1000U, header.offset() % 0x1000U);
+		}
+		assertEqual(elf.programHeaders()[0].flags(), 5U);
+		assertEqual(elf.programHeaders()[1].flags(), 6U);
+
+		const auto text{elf.sectionIndex(".text"sv)};
+		const auto data{elf.sectionIndex(".data"sv)};
+		assertTrue(text.has_value());
+		assertTrue(data.has_value());
+		assertTrue(elf.sectionIndex(".bss"sv).has_value());
+		const auto &textHeader{elf.sectionHeaders()[*text]};
+		const auto &dataHeader{elf.sectionHeaders()[*data]};
+		// The .bss takes no space in the file, but is still part of the data segment in memory
+		const auto &bssHeader{elf.sectionHeaders()[*elf.sectionIndex(".bss"sv)]};
+		const auto &dataSegment{elf.programHeaders()[1]};
+		assertEqual(dataSegment.fileLength(), dataHeader.fileLength());
+		assertEqual(dataSegment.virtualAddress() + dataSegment.memoryLength(), bssHeader.address() + 16U);
+		// start.o's .text comes first, so the entry point is the start of the section
+		assertEqual(elf.header().entryPoint(), textHeader.address());
+		// weak.o's .data, then start.o's, then f.o's, each 8 byte aligned
+		const auto dataContents{elf.sectionData(*data)};
+		assertEqual(dataContents.length(), 20U);
+		assertEqual(dataContents.read<uint32_t>(0U, Endian::little), 7U);
+		assertEqual(dataContents.read<uint64_t>(8U, Endian::little), 0U);
+		assertEqual(dataContents.read<uint32_t>(16U, Endian::little), 42U);
+		// The call to f, which lands 16 bytes in after start.o's .text
+		const auto textContents{elf.sectionData(*text)};
+		assertEqual(textContents.read<uint32_t>(1U, Endian::little), 16U - 5U);
+		const auto valueAddress{dataHeader.address() + 16U};
+		const auto loadAddress{textHeader.address() + 16U + 6U};
+		assertEqual(textContents.read<uint32_t>(18U, Endian::little), static_cast<uint32_t>(valueAddress - loadAddress));
+
+#if defined(__x86_64__) && defined(__linux__)
+		const auto command{"'" + file("program"sv).string() + "'"};
+		const auto status{std::system(command.c_str())};
+		assertTrue(WIFEXITED(status));
+		assertEqual(WEXITSTATUS(status), 42);
+#endif
+	}
+
+	void testDeterministic()
+	{
+		const auto single{linkProgram({"weak.o"sv, "start.o"sv, "f.o"sv}, 1U, "single"sv)};
+		const auto parallel{linkProgram({"weak.o"sv, "start.o"sv, "f.o"sv}, 8U, "parallel"sv)};
+		assertTrue(single.success());
+		assertTrue(parallel.success());
+		const auto singleContents{readFile(file("single"sv))};
+		assertFalse(singleContents.empty());
+		assertTrue(singleContents == readFile(file("parallel"sv)));
+	}
+
+	void testArchives()
+	{
+		// spare.o defines f() as well, but comes after f.o, so the index's entry for f points at f.o
+		TestObject spare{};
+		spare.text = {0xc3U};
+		spare.symbols = {{"f"sv, globalSymbol, textSection, 0U}};
+		writeObject(file("spare.o"sv), spare);
+		writeArchive("lib.a"sv, {{"f.o"sv, {"f"sv, "value"sv}}, {"weak.o"sv, {"value"sv}}, {"spare.o"sv, {"f"sv}}});
+		// Only f.o is pulled in, as it also defines value, and archives are searched wherever they're given
+		for (const auto &order : {std::vector{"start.o"sv, "lib.a"sv}, std::vector{"lib.a"sv, "start.o"sv}})
+		{
+			const auto result{linkProgram(order, 2U, "archived"sv)};
+			for (const auto &error : result.errors)
+				console.error(error);
+			assertTrue(result.success());
+			assertEqual(result.objects, 2U);
+			assertEqual(result.symbols, 3U);
+#if defined(__x86_64__) && defined(__linux__)
+			const auto command{"'" + file("archived"sv).string() + "'"};
+			const auto status{std::system(command.c_str())};
+			assertTrue(WIFEXITED(status));
+			assertEqual(WEXITSTATUS(status), 42);
+#endif
+		}
+
+		// Members pulled in can need others in turn - needs.o refers to _start, which needs f
+		TestObject needs{};
+		needs.data = std::vector<uint8_t>(8U);
+		needs.symbols = {{"_start"sv, globalSymbol, 0U, 0U}};
+		needs.dataRelocations = {{0U, 1U, R_X86_64_64, 0}};
+		writeObject(file("needs.o"sv), needs);
+		writeArchive("chain.a"sv, {{"f.o"sv, {"f"sv, "value"sv}}, {"start.o"sv, {"_start"sv}}});
+		const auto chained{linkProgram({"needs.o"sv, "chain.a"sv}, 2U, "chained"sv)};
+		assertTrue(chained.success());
+		assertEqual(chained.objects, 3U);
+
+		// What still isn't defined is reported against the member that needed it
+		writeArchive("partial.a"sv, {{"start.o"sv, {"_start"sv}}});
+		const auto partial{linkProgram({"needs.o"sv, "partial.a"sv}, 2U, "failed"sv)};
+		assertFalse(partial.success());
+		assertTrue(hasError(partial, "undefined reference to 'f'"sv));
+		assertTrue(hasError(partial, "partial.a(start.o)"sv));
+		const auto onlyArchives{linkProgram({"lib.a"sv}, 2U, "failed"sv)};
+		assertFalse(onlyArchives.success());
+		assertTrue(hasError(onlyArchives, "no objects to link"sv));
+		{
+			const fd_t badArchive{file("bad.a"sv).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(badArchive.valid());
+			assertTrue(badArchive.write("!<arch>\nnot a member header"sv.data(), 27U));
+		}
+		const auto malformed{linkProgram({"start.o"sv, "bad.a"sv}, 2U, "failed"sv)};
+		assertFalse(malformed.success());
+		assertTrue(hasError(malformed, "bad.a: malformed archive"sv));
+		assertFalse(std::filesystem::exists(file("failed"sv)));
+	}
+
+	void testErrors()
+	{
+		const auto duplicate{linkProgram({"start.o"sv, "f.o"sv, "f.o"sv}, 2U, "failed"sv)};
+		assertFalse(duplicate.success());
+		assertTrue(hasError(duplicate, "duplicate definition of 'f'"sv));
+		assertTrue(hasError(duplicate, "duplicate definition of 'value'"sv));
+
+		const auto undefined{linkProgram({"start.o"sv, "weak.o"sv}, 2U, "failed"sv)};
+		assertFalse(undefined.success());
+		assertTrue(hasError(undefined, "undefined reference to 'f'"sv));
+		assertFalse(std::filesystem::exists(file("failed"sv)));
+
+		std::vector<path> files{file("start.o"sv), file("f.o"sv)};
+		LinkOptions options{};
+		options.output = file("failed"sv);
+		options.entry = "main"sv;
+		const auto noEntry{link(files, options)};
+		assertFalse(noEntry.success());
+		assertTrue(hasError(noEntry, "entry symbol 'main' is not defined"sv));
+
+		const auto noFiles{link({}, options)};
+		assertFalse(noFiles.success());
+
+		{
+			const fd_t notObject{file("notObject.o"sv).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(notObject.valid());
+			assertTrue(notObject.write("not an object"sv.data(), 13U));
+		}
+		const auto invalid{linkProgram({"start.o"sv, "notObject.o"sv, "missing.o"sv}, 2U, "failed"sv)};
+		assertFalse(invalid.success());
+		assertEqual(invalid.errors.size(), 2U);
+		assertTrue(hasError(invalid, "notObject.o: not a relocatable ELF object"sv));
+		assertTrue(hasError(invalid, "missing.o: could not open file"sv));
+		assertFalse(std::filesystem::exists(file("failed"sv)));
+		std::filesystem::remove_all(directory);
+	}
+
+	// Writes out a 32-bit ARM object with the sections given, each at index 2 onwards, using SHT_REL relocations
+	void writeARMObject(const path &fileName, const std::vector<TestSection> &sections,
+		const std::vector<TestSymbol> &symbolList)
+	{
+		StringTableBuilder names{};
+		std::vector<uint8_t> symbols((symbolList.size() + 1U) * elf32::ELFSymbol::size());
+		const Memory symbolStorage{span{symbols.data(), symbols.size()}};
+		for (size_t index{}; index < symbolList.size(); ++index)
+		{
+			const auto &symbol{symbolList[index]};
+			const auto offset{(index + 1U) * elf32::ELFSymbol::size()};
+			symbolStorage.write(offset, names.add(symbol.name), Endian::little);
+			symbolStorage.write(offset + 4U, static_cast<uint32_t>(symbol.value), Endian::little);
+			symbolStorage.write(offset + 12U, symbol.info);
+			symbolStorage.write(offset + 14U, symbol.section, Endian::little);
+		}
+		const auto stringData{names.storage()};
+
+		ELF elf{Class::elf32Bit, Endian::little, Machine::arm};
+		for (const auto &section : sections)
+		{
+			const auto index{elf.addSection(section.name, section.type, section.flags,
+				span{section.contents.data(), section.contents.size()}, 4U)};
+			if (section.linkedTo)
+				elf.sectionHeaders()[index].link(section.linkedTo);
+		}
+		const auto strtab{elf.addSection(".strtab"sv, SectionHeaderType::stringTable, {},
+			span{stringData.data(), stringData.length()})};
+		const auto symtab{elf.addSection(".symtab"sv, SectionHeaderType::symbolTable, {},
+			span{symbols.data(), symbols.size()}, 4U)};
+		elf.sectionHeaders()[symtab].link(static_cast<uint32_t>(strtab));
+		elf.sectionHeaders()[symtab].info(1U);
+		for (size_t index{}; index < sections.size(); ++index)
+		{
+			const auto &relocations{sections[index].relocations};
+			if (relocations.empty())
+				continue;
+			std::vector<uint8_t> table(relocations.size() * elf32::ELFRelocation::size(false));
+			const Memory storage{span{table.data(), table.size()}};
+			for (size_t entry{}; entry < relocations.size(); ++entry)
+			{
+				storage.write(entry * 8U, static_cast<uint32_t>(relocations[entry].offset), Endian::little);
+				storage.write((entry * 8U) + 4U, (relocations[entry].symbol << 8U) | relocations[entry].type,
+					Endian::little);
+			}
+			const auto relocationSection{elf.addSection(".rel"s + std::string{sections[index].name},
+				SectionHeaderType::reloc, {SectionFlag::infoLink}, span{table.data(), table.size()}, 4U)};
+			elf.sectionHeaders()[relocationSection].link(static_cast<uint32_t>(symtab));
+			elf.sectionHeaders()[relocationSection].info(static_cast<uint32_t>(index + 2U));
+		}
+		const fd_t output{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		assertTrue(output.valid());
+		assertTrue(elf.write(output));
+	}
+
+	/**
+	 * Writes a small ARM program for collection and folding - _start calls used(), which calls twinA(),
+	 * twinB() and, in the other object, twinC(), all three being the same code. Nothing calls dead(),
+	 * so it goes, along with its unwind table, the helper in the other object only it calls, and the
+	 * read-only data nothing refers to. The exported pointer in .data refers to twinB(), so must come out
+	 * as twinA().
+	 */
+	void writeARMProgram()
+	{
+		const auto bl{[]() { return std::vector<uint8_t>{0xfeU, 0xffU, 0xffU, 0xebU}; }};
+		const auto concat{[](std::vector<uint8_t> a, const std::vector<uint8_t> &b)
+			{ a.insert(a.end(), b.begin(), b.end()); return a; }};
+		// add r0, r0, #1; bx lr
+		const std::vector<uint8_t> twin{0x01U, 0x00U, 0x80U, 0xe2U, 0x1eU, 0xffU, 0x2fU, 0xe1U};
+		const Flags<SectionFlag> data{SectionFlag::allocate, SectionFlag::writeable};
+		writeARMObject(file("main.o"sv), {
+			{".text.start"sv, bl(), {{0U, 2U, R_ARM_CALL, 0}}},
+			{".text.used"sv, concat(concat(bl(), bl()), bl()),
+				{{0U, 3U, R_ARM_CALL, 0}, {4U, 4U, R_ARM_CALL, 0}, {8U, 5U, R_ARM_CALL, 0}}},
+			{".text.twinA"sv, twin},
+			{".text.twinB"sv, twin},
+			{".text.dead"sv, concat(bl(), twin), {{0U, 6U, R_ARM_CALL, 0}}},
+			{".ARM.exidx.text.dead"sv, std::vector<uint8_t>(8U), {}, armExidx,
+				{SectionFlag::allocate, SectionFlag::linkOrder}, 6U},
+			{".rodata.dead"sv, std::vector<uint8_t>(32U, 0x55U), {}, SectionHeaderType::program, {SectionFlag::allocate}},
+			{".data.pointer"sv, std::vector<uint8_t>(4U), {{0U, 4U, R_ARM_ABS32, 0}}, SectionHeaderType::program, data},
+		}, {{"_start"sv, globalSymbol, 2U, 0U}, {"used"sv, globalSymbol, 3U, 0U}, {"twinA"sv, globalSymbol, 4U, 0U},
+			{"twinB"sv, globalSymbol, 5U, 0U}, {"twinC"sv, globalSymbol, 0U, 0U}, {"helper"sv, globalSymbol, 0U, 0U},
+			{"dead"sv, globalSymbol, 6U, 0U}, {"pointer"sv, globalSymbol, 9U, 0U}});
+		writeARMObject(file("other.o"sv), {
+			{".text.twinC"sv, twin},
+			{".text.helper"sv, std::vector<uint8_t>{0x1eU, 0xffU, 0x2fU, 0xe1U}},
+		}, {{"twinC"sv, globalSymbol, 2U, 0U}, {"helper"sv, globalSymbol, 3U, 0U}});
+	}
+
+	void testCollectAndFold()
+	{
+		std::filesystem::create_directories(directory);
+		writeARMProgram();
+		std::vector<path> files{file("main.o"sv), file("other.o"sv)};
+		LinkOptions options{};
+		options.output = file("arm"sv);
+		options.workers = 2U;
+		options.collectGarbage = true;
+		options.foldIdentical = true;
+		options.exports = {"pointer"s};
+		const auto result{link(files, options)};
+		for (const auto &error : result.errors)
+			console.error(error);
+		assertTrue(result.success());
+
+		// .text loses dead() and helper(), and twinB() and twinC() are folded into twinA()
+		assertEqual(result.savings.size(), 3U);
+		assertEqual(result.savings[0].name, ".text"sv);
+		assertEqual(result.savings[0].collected, 16U);
+		assertEqual(result.savings[0].folded, 16U);
+		assertEqual(result.savings[1].name, ".ARM.exidx"sv);
+		assertEqual(result.savings[1].collected, 8U);
+		assertEqual(result.savings[2].name, ".rodata"sv);
+		assertEqual(result.savings[2].collected, 32U);
+
+		const ELF elf{fd_t{file("arm"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.valid());
+		assertTrue(elf.header().elfClass() == Class::elf32Bit);
+		assertTrue(elf.header().machine() == Machine::arm);
+		assertFalse(elf.sectionIndex(".rodata"sv).has_value());
+		assertFalse(elf.sectionIndex(".ARM.exidx"sv).has_value());
+		const auto text{elf.sectionIndex(".text"sv)};
+		const auto data{elf.sectionIndex(".data"sv)};
+		assertTrue(text.has_value());
+		assertTrue(data.has_value());
+		// _start, used() and twinA()
+		const auto &textHeader{elf.sectionHeaders()[*text]};
+		assertEqual(textHeader.fileLength(), 24U);
+		const auto twinA{textHeader.address() + 16U};
+		assertEqual(elf.header().entryPoint(), textHeader.address());
+		assertEqual(elf.sectionData(*data).read<uint32_t>(0U, Endian::little), twinA);
+		// Each of used()'s calls goes to twinA(), as a BL's offset from 8 bytes past itself in words
+		const auto textContents{elf.sectionData(*text)};
+		for (size_t call{}; call < 3U; ++call)
+		{
+			const auto place{textHeader.address() + 4U + (call * 4U)};
+			const auto instruction{textContents.read<uint32_t>(4U + (call * 4U), Endian::little)};
+			assertEqual(instruction >> 24U, 0xebU);
+			assertEqual(instruction & 0x00ffffffU, ((twinA - (place + 8U)) >> 2U) & 0x00ffffffU);
+		}
+
+		// Collection alone folds nothing, and folding alone collects nothing
+		options.foldIdentical = false;
+		const auto collected{link(files, options)};
+		assertTrue(collected.success());
+		assertEqual(collected.savings[0].collected, 16U);
+		assertEqual(collected.savings[0].folded, 0U);
+		options.collectGarbage = false;
+		options.foldIdentical = true;
+		const auto folded{link(files, options)};
+		assertTrue(folded.success());
+		assertEqual(folded.savings.size(), 1U);
+		assertEqual(folded.savings[0].collected, 0U);
+		assertEqual(folded.savings[0].folded, 16U);
+
+		// Exporting dead() keeps it, and what it needs
+		options.collectGarbage = true;
+		options.exports = {"pointer"s, "dead"s};
+		const auto exported{link(files, options)};
+		assertTrue(exported.success());
+		assertEqual(exported.savings[0].name, ".text"sv);
+		assertEqual(exported.savings[0].collected, 0U);
+		options.exports = {"nonexistent"s};
+		const auto badExport{link(files, options)};
+		assertFalse(badExport.success());
+		assertTrue(hasError(badExport, "exported symbol 'nonexistent' is not defined"sv));
+	}
+
+	void testFoldAcrossObjects()
+	{
+		// Two callers of target(), one in each object, whose relocations name it by different symbol indices,
+		// and a third, identical but for calling other(), which must not be folded into them
+		// bl target; bx lr
+		const std::vector<uint8_t> caller{0xfeU, 0xffU, 0xffU, 0xebU, 0x1eU, 0xffU, 0x2fU, 0xe1U};
+		std::filesystem::create_directories(directory);
+		writeARMObject(file("callerA.o"sv), {
+			// bl callerA; bl callerB
+			{".text.start"sv, std::vector<uint8_t>{0xfeU, 0xffU, 0xffU, 0xebU, 0xfeU, 0xffU, 0xffU, 0xebU},
+				{{0U, 2U, R_ARM_CALL, 0}, {4U, 4U, R_ARM_CALL, 0}}},
+			{".text.callerA"sv, caller, {{0U, 3U, R_ARM_CALL, 0}}},
+			{".text.target"sv, std::vector<uint8_t>{0x1eU, 0xffU, 0x2fU, 0xe1U}},
+		}, {{"_start"sv, globalSymbol, 2U, 0U}, {"callerA"sv, globalSymbol, 3U, 0U},
+			{"target"sv, globalSymbol, 4U, 0U}, {"callerB"sv, globalSymbol, 0U, 0U}});
+		writeARMObject(file("callerB.o"sv), {
+			{".text.callerB"sv, caller, {{0U, 2U, R_ARM_CALL, 0}}},
+			{".text.callerC"sv, caller, {{0U, 4U, R_ARM_CALL, 0}}},
+			// mov r0, #0; bx lr
+			{".text.other"sv, std::vector<uint8_t>{0x00U, 0x00U, 0xa0U, 0xe3U, 0x1eU, 0xffU, 0x2fU, 0xe1U}},
+		}, {{"callerB"sv, globalSymbol, 2U, 0U}, {"target"sv, globalSymbol, 0U, 0U},
+			{"callerC"sv, globalSymbol, 3U, 0U}, {"other"sv, globalSymbol, 4U, 0U}});
+
+		LinkOptions options{};
+		options.output = file("folded"sv);
+		options.foldIdentical = true;
+		const auto result{link({file("callerA.o"sv), file("callerB.o"sv)}, options)};
+		for (const auto &error : result.errors)
+			console.error(error);
+		assertTrue(result.success());
+		assertEqual(result.savings.size(), 1U);
+		assertEqual(result.savings[0].name, ".text"sv);
+		assertEqual(result.savings[0].folded, 8U);
+
+		// _start(), callerA(), target(), callerC() and other(), with _start()'s call to callerB() going to callerA()
+		const ELF elf{fd_t{file("folded"sv).c_str(), O_RDONLY | O_NOCTTY}};
+		assertTrue(elf.valid());
+		const auto text{elf.sectionIndex(".text"sv)};
+		assertTrue(text.has_value());
+		const auto &textHeader{elf.sectionHeaders()[*text]};
+		assertEqual(textHeader.fileLength(), 36U);
+		const auto textContents{elf.sectionData(*text)};
+		const auto callerA{textHeader.address() + 8U};
+		for (size_t call{}; call < 2U; ++call)
+		{
+			const auto place{textHeader.address() + (call * 4U)};
+			const auto instruction{textContents.read<uint32_t>(call * 4U, Endian::little)};
+			assertEqual(instruction & 0x00ffffffU, ((callerA - (place + 8U)) >> 2U) & 0x00ffffffU);
+		}
+	}
+
+	void testCollectRunnable()
+	{
+		// The x86-64 program still runs with both on
+		std::vector<path> files{file("weak.o"sv), file("start.o"sv), file("f.o"sv)};
+		LinkOptions options{};
+		options.output = file("reduced"sv);
+		options.collectGarbage = true;
+		options.foldIdentical = true;
+		const auto result{link(files, options)};
+		assertTrue(result.success());
+#if defined(__x86_64__) && defined(__linux__)
+		const auto command{"'" + file("reduced"sv).string() + "'"};
+		const auto status{std::system(command.c_str())};
+		assertTrue(WIFEXITED(status));
+		assertEqual(WEXITSTATUS(status), 42);
+#endif
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testLink)
+		CRUNCHpp_TEST(testDeterministic)
+		CRUNCHpp_TEST(testCollectAndFold)
+		CRUNCHpp_TEST(testFoldAcrossObjects)
+		CRUNCHpp_TEST(testCollectRunnable)
+		CRUNCHpp_TEST(testArchives)
+		CRUNCHpp_TEST(testErrors)
+	}
+};
+
+CRUNCHpp_TESTS(testLinker)
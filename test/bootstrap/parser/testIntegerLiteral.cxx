@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/integerLiteral.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using namespace mangrove::parser::integerLiteral;
+
+class testIntegerLiteral final : public testsuite
+{
+private:
+	template<uint64_t base> void checkDecode(const std::string_view digits, const uint64_t expected)
+	{
+		const auto value{decode<base>(digits)};
+		assertTrue(value.has_value());
+		assertEqual(*value, expected);
+	}
+
+	template<uint64_t base> void checkOverflow(const std::string_view digits)
+		{ assertFalse(decode<base>(digits).has_value()); }
+
+	template<uint64_t base> void checkAccumulator(const std::string_view digits)
+	{
+		Accumulator<base> accumulator{};
+		for (const auto digit : digits)
+			accumulator.push(digit);
+		assertFalse(accumulator.empty());
+		assertTrue(accumulator.value() == decode<base>(digits));
+	}
+
+	void testCountDigits()
+	{
+		assertEqual(countDigits<10U>(""sv), 0U);
+		assertEqual(countDigits<10U>("a1"sv), 0U);
+		assertEqual(countDigits<10U>("1234567"sv), 7U);
+		assertEqual(countDigits<10U>("12345678"sv), 8U);
+		assertEqual(countDigits<10U>("12345678901234567890;"sv), 20U);
+		// The bytes either side of each range must not count
+		assertEqual(countDigits<10U>("0123456789/:"sv), 10U);
+		assertEqual(countDigits<2U>("0110112"sv), 6U);
+		assertEqual(countDigits<8U>("012345678"sv), 8U);
+		assertEqual(countDigits<16U>("09afAF@G`g"sv), 6U);
+		assertEqual(countDigits<16U>("0123456789abcdefABCDEFg"sv), 22U);
+		// Bytes with the high bit set must never look like digits, even when the low 7 bits do
+		assertEqual(countDigits<10U>("12\xb3"sv), 2U);
+		assertEqual(countDigits<16U>("ab\xe1\xc1"sv), 2U);
+	}
+
+	void testDecode()
+	{
+		checkDecode<10U>("0"sv, 0U);
+		checkDecode<10U>("7"sv, 7U);
+		checkDecode<10U>("12345678"sv, 12345678U);
+		checkDecode<10U>("123456789"sv, 123456789U);
+		checkDecode<10U>("0000000000000000000000000042"sv, 42U);
+		checkDecode<10U>("18446744073709551615"sv, UINT64_MAX);
+		checkDecode<2U>("1001"sv, 9U);
+		checkDecode<2U>("1111111111111111111111111111111111111111111111111111111111111111"sv, UINT64_MAX);
+		checkDecode<8U>("17"sv, 15U);
+		checkDecode<8U>("1777777777777777777777"sv, UINT64_MAX);
+		checkDecode<16U>("95"sv, 0x95U);
+		checkDecode<16U>("DeadBeef"sv, 0xdeadbeefU);
+		checkDecode<16U>("0123456789abcdef"sv, UINT64_C(0x0123456789abcdef));
+		checkDecode<16U>("ffffffffffffffff"sv, UINT64_MAX);
+	}
+
+	void testOverflow()
+	{
+		checkOverflow<10U>("18446744073709551616"sv);
+		checkOverflow<10U>("99999999999999999999"sv);
+		checkOverflow<10U>("100000000000000000000000000000"sv);
+		checkOverflow<2U>("10000000000000000000000000000000000000000000000000000000000000000"sv);
+		checkOverflow<8U>("2000000000000000000000"sv);
+		checkOverflow<16U>("10000000000000000"sv);
+	}
+
+	void testAccumulator()
+	{
+		// The digit-at-a-time path must agree with the word-at-a-time one, including on overflow
+		std::minstd_rand rng{0x6c697473U};
+		std::uniform_int_distribution<size_t> lengths{1U, 24U};
+		std::uniform_int_distribution<size_t> digits{0U, 15U};
+		constexpr auto alphabet{"0123456789abcdef"sv};
+		for (size_t iteration{}; iteration < 1000U; ++iteration)
+		{
+			std::string decimal{};
+			std::string hex{};
+			std::string octal{};
+			const auto length{lengths(rng)};
+			for (size_t index{}; index < length; ++index)
+			{
+				const auto digit{digits(rng)};
+				decimal += alphabet[digit % 10U];
+				hex += alphabet[digit];
+				octal += alphabet[digit % 8U];
+			}
+			checkAccumulator<10U>(decimal);
+			checkAccumulator<16U>(hex);
+			checkAccumulator<8U>(octal);
+		}
+		assertTrue(Accumulator<10U>{}.empty());
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testCountDigits)
+		CRUNCHpp_TEST(testDecode)
+		CRUNCHpp_TEST(testOverflow)
+		CRUNCHpp_TEST(testAccumulator)
+	}
+};
+
+CRUNCHpp_TESTS(testIntegerLiteral)
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/tokeniser.hxx"
+#include "../../../src/bootstrap/parser/lexerTable.hxx"
+
+using std::filesystem::path;
+using std::filesystem::current_path;
+using std::filesystem::canonical;
+using std::filesystem::directory_iterator;
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+using substrate::fd_t;
+using substrate::console;
+using mangrove::parser::Tokeniser;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::types::TokenType;
+using mangrove::core::loader::SourceLoader;
+using mangrove::core::loader::SourceBuffer;
+using mangrove::core::loader::LoadedSource;
+using mangrove::core::loader::LoaderBackend;
+
+// Fragments the fuzzer strings together - a mix of well-formed tokens and the awkward cases around them
+constexpr static std::array fragments
+{
+	" "sv, "\t"sv, "\n"sv, "\r\n"sv, "\r"sv, "."sv, ".."sv, "..."sv, ";"sv, "{"sv, "}"sv, "("sv, ")"sv, "["sv,
+	"]"sv, ","sv, ":"sv, "~"sv, "!"sv, "/"sv, "/="sv, "*"sv, "*="sv, "%"sv, "%="sv, "+"sv, "+="sv, "++"sv,
+	"-"sv, "-="sv, "--"sv, "->"sv, "&"sv, "&="sv, "&&"sv, "|"sv, "|="sv, "||"sv, "^"sv, "^="sv, "<"sv, "<="sv,
+	"<<"sv, "<<="sv, ">"sv, ">="sv, ">>"sv, ">>="sv, "="sv, "=="sv, "!="sv, "@"sv, "?"sv, "$"sv, "\\"sv, "`"sv,
+	"\x01"sv, "\x7f"sv, "a"sv, "_b1"sv, "ident"sv, "true"sv, "false"sv, "nullptr"sv, "and"sv, "or"sv, "not"sv,
+	"const"sv, "static"sv, "flash"sv, "if"sv, "elif"sv, "else"sv, "for"sv, "while"sv, "do"sv, "return"sv,
+	"import"sv, "from"sv, "as"sv, "new"sv, "delete"sv, "none"sv, "class"sv, "enum"sv, "function"sv,
+	"operator"sv, "public"sv, "unsafe"sv, "café"sv, "λx"sv, "𝔘nicode"sv, "©"sv, "—"sv, "0"sv, "007"sv,
+	"08"sv, "123"sv, "0b101"sv, "0B1"sv, "0b"sv, "0b12"sv, "0c17"sv, "0C"sv, "0c8"sv, "0x1F"sv, "0Xab"sv,
+	"0x"sv, "0xg"sv, "123456789"sv, "18446744073709551615"sv, "18446744073709551616"sv, "0x0123456789abcdefA"sv,
+	"0b10101010101"sv, "0c12345670"sv, "\"abc\""sv, "\"a'b\""sv, "\"a\\nb\\t\""sv, "\"\\\\\\\"\""sv, "\"\\u41\""sv,
+	"\"\\u3bbx\""sv, "\"\\u\""sv, "\"\\uFFFFFF\"x"sv, "\"\\uFFFFFF\""sv, "\"tab\there\""sv, "\"unterminated"sv,
+	"\"bad\\q\""sv, "\"\\'\""sv, "\"λ—©\""sv, "'a'"sv, "'\"'"sv, "'\\n'"sv, "'\\''"sv, "'\\\"'"sv, "''"sv,
+	"'ab'"sv, "'\\u3bb'"sv, "'\\uFFFFFF'"sv, "'\\u41"sv, "'λ'"sv, "'"sv, "'\t'"sv, "# comment"sv,
+	"// comment"sv, "/* block */"sv, "/* ** */"sv, "/*/"sv, "/* unterminated *"sv, "*/"sv,
+	"\"The quick brown fox jumped over the lazy dog\""sv, "\"abcdefgh\\u3bb-ijklmnopλ\""sv,
+};
+
+class testLexerTable final : public testsuite
+{
+private:
+	path casesPath{canonical(current_path() / ".." / ".." / "cases")};
+
+	void crossCheck(const path &fileName)
+	{
+		Tokeniser scalar{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, LexerEngine::scalar};
+		Tokeniser table{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, LexerEngine::table};
+		// Lexing a file the source loader has read into memory must be no different to lexing the mapped file
+		SourceBuffer buffer{};
+		SourceLoader{LoaderBackend::serial}.load({fileName}, [&](LoadedSource &&source)
+			{ buffer = std::move(source.buffer); });
+		assertTrue(buffer.valid());
+		Tokeniser loaded{std::move(buffer)};
+		assertEqual(scalar.engine(), LexerEngine::scalar);
+		assertEqual(loaded.engine(), LexerEngine::table);
+		while (true)
+		{
+			const auto &expected{scalar.next()};
+			for (const auto *const actual : {&table.next(), &loaded.next()})
+			{
+				assertEqual(actual->type(), expected.type());
+				assertEqual(actual->source().offset, expected.source().offset);
+				assertEqual(actual->source().length, expected.source().length);
+				assertTrue(actual->value() == expected.value());
+				assertTrue(actual->integer() == expected.integer());
+			}
+			if (expected.type() == TokenType::eof)
+				break;
+		}
+	}
+
+	void crossCheck(const std::string &source)
+	{
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveTestLexerTable.case"};
+		{
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(file.write(source.data(), source.size()));
+		}
+		crossCheck(fileName);
+		std::filesystem::remove(fileName);
+	}
+
+	void testAutomaton()
+	{
+		using namespace mangrove::parser::lexerTable;
+		static_assert(automaton.accept[step(step(startState, '-'), '>')] == TokenType::arrow);
+		static_assert(automaton.accept[step(step(startState, '0'), 'x')] == TokenType::invalid);
+		static_assert(step(step(startState, 'a'), '1') == static_cast<State>(Named::ident));
+		assertTrue(automaton.stateCount > static_cast<size_t>(Named::count));
+	}
+
+	void testCaseFiles()
+	{
+		// Every test case file, for both tokenisation and parsing, must lex identically under both engines
+		for (const auto &directory : {casesPath / "tokenisation", casesPath / "parsing"})
+		{
+			for (const auto &entry : directory_iterator{directory})
+				crossCheck(canonical(entry.path()));
+		}
+	}
+
+	void testEdgeCases()
+	{
+		// Keywords running up to EOF must still be classified
+		crossCheck("return"s);
+		crossCheck("a += 0b"s);
+		crossCheck("\"\\uFFFFFFFF\\tab\"\n"s);
+		crossCheck("'\\uFFFFFFFF'x\n"s);
+		// \u escapes whose value overflows 32 or 64 bits are invalid rather than wrapping
+		crossCheck("\"\\u100000041\"\n"s);
+		crossCheck("'\\u10000000000000000041'\n"s);
+		// Dots that turn out not to start an ellipsis, right up against EOF
+		crossCheck("a."s);
+		crossCheck("a.."s);
+		crossCheck("a...."s);
+		crossCheck("/* unterminated"s);
+		crossCheck("\"unterminated"s);
+		// Long literals, with their plain runs broken up at and either side of word boundaries
+		crossCheck("\"The quick brown fox jumped over the lazy dog\"\n"s);
+		crossCheck("\"abcdefg\\nabcdefgh\\tabcdefghi\\u3bb-ijklmnop\"\n"s);
+		crossCheck("\"abcdefgλabcdefgh—abcdefg🎉\"\n"s);
+		crossCheck("\"abcdefgh\x01" "abcdefgh\"\n\"abcdefg\x7f\"\n"s);
+		crossCheck("\"abcdefgh\xed\xa0\x80" "abcdefgh\"\n"s);
+		crossCheck("\"abcdefghijklmnopqrstuvwxyz"s);
+	}
+
+	void testFuzz()
+	{
+		std::minstd_rand rng{0x6d616e67U};
+		std::uniform_int_distribution<size_t> fragmentIndex{0U, fragments.size() - 1U};
+		std::uniform_int_distribution<size_t> fragmentCount{1U, 200U};
+		for (size_t iteration{}; iteration < 250U; ++iteration)
+		{
+			std::string source{};
+			const auto count{fragmentCount(rng)};
+			for (size_t fragment{}; fragment < count; ++fragment)
+				source += fragments[fragmentIndex(rng)];
+			crossCheck(source);
+		}
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testAutomaton)
+		CRUNCHpp_TEST(testCaseFiles)
+		CRUNCHpp_TEST(testEdgeCases)
+		CRUNCHpp_TEST(testFuzz)
+	}
+};
+
+CRUNCHpp_TESTS(testLexerTable)
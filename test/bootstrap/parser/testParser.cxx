@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <filesystem>
+#include <string>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/parser.hxx"
+
+using std::filesystem::path;
+using std::filesystem::current_path;
+using std::filesystem::canonical;
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using substrate::fd_t;
+using mangrove::parser::Parser;
+using mangrove::ast::Tree;
+using mangrove::ast::NodeIndex;
+using mangrove::ast::NodeType;
+using mangrove::ast::Operator;
+using mangrove::ast::noNode;
+
+class testParser final : public testsuite
+{
+private:
+	path casesPath{canonical(current_path() / ".." / ".." / "cases" / "parsing")};
+
+	NodeIndex checkNode(const Tree &tree, const NodeIndex parent, const size_t childIndex, const NodeType type,
+		const Operator op = Operator::none)
+	{
+		const auto index{tree.child(parent, childIndex)};
+		assertNotEqual(index, noNode);
+		assertEqual(tree[index].type, type);
+		assertEqual(tree[index].op, op);
+		return index;
+	}
+
+	void checkIdent(const Tree &tree, const NodeIndex parent, const size_t childIndex, const std::string_view name)
+	{
+		const auto index{checkNode(tree, parent, childIndex, NodeType::ident)};
+		assertTrue(tree.value(index) == name);
+	}
+
+	void testExpressions()
+	{
+		Parser parser{casesPath / "expressions.case"};
+		assertTrue(parser.parse());
+		const auto &tree{parser.ast()};
+		const auto root{parser.root()};
+		assertEqual(tree[root].childCount, 8U);
+
+		// a = b + c * d
+		auto statement{checkNode(tree, root, 0, NodeType::assignment, Operator::assign)};
+		assertEqual(tree[statement].source.offset, 0U);
+		assertEqual(tree[statement].source.length, 13U);
+		checkIdent(tree, statement, 0, "a"sv);
+		auto node{checkNode(tree, statement, 1, NodeType::binaryOp, Operator::add)};
+		checkIdent(tree, node, 0, "b"sv);
+		node = checkNode(tree, node, 1, NodeType::binaryOp, Operator::multiply);
+		checkIdent(tree, node, 1, "d"sv);
+
+		// e = (b + c) * d
+		statement = checkNode(tree, root, 1, NodeType::assignment, Operator::assign);
+		node = checkNode(tree, statement, 1, NodeType::binaryOp, Operator::multiply);
+		node = checkNode(tree, node, 0, NodeType::binaryOp, Operator::add);
+		// Parenthesised expressions cover their parentheses
+		assertEqual(tree[node].source.length, 7U);
+
+		// f = -a << 2 | b & 1 - '&' binds tighter than '|'
+		statement = checkNode(tree, root, 2, NodeType::assignment, Operator::assign);
+		const auto bitOr{checkNode(tree, statement, 1, NodeType::binaryOp, Operator::bitOr)};
+		node = checkNode(tree, bitOr, 1, NodeType::binaryOp, Operator::bitAnd);
+		checkIdent(tree, node, 0, "b"sv);
+		// Integer literals carry their decoded value rather than their text
+		assertEqual(tree.integer(checkNode(tree, node, 1, NodeType::intLit)), 1U);
+		node = checkNode(tree, bitOr, 0, NodeType::binaryOp, Operator::shiftLeft);
+		node = checkNode(tree, node, 0, NodeType::unaryOp, Operator::negate);
+		checkIdent(tree, node, 0, "a"sv);
+
+		// a += f(b, c)[0].d++
+		statement = checkNode(tree, root, 3, NodeType::assignment, Operator::add);
+		node = checkNode(tree, statement, 1, NodeType::postfixOp, Operator::increment);
+		node = checkNode(tree, node, 0, NodeType::member);
+		checkIdent(tree, node, 1, "d"sv);
+		node = checkNode(tree, node, 0, NodeType::index);
+		node = checkNode(tree, node, 0, NodeType::call);
+		assertEqual(tree[node].childCount, 3U);
+		checkIdent(tree, node, 0, "f"sv);
+		checkIdent(tree, node, 2, "c"sv);
+
+		// g = not a and b or c
+		statement = checkNode(tree, root, 4, NodeType::assignment, Operator::assign);
+		node = checkNode(tree, statement, 1, NodeType::binaryOp, Operator::logicOr);
+		node = checkNode(tree, node, 0, NodeType::binaryOp, Operator::logicAnd);
+		checkNode(tree, node, 0, NodeType::unaryOp, Operator::logicNot);
+
+		// h = a = b - assignment associates right
+		statement = checkNode(tree, root, 5, NodeType::assignment, Operator::assign);
+		checkIdent(tree, statement, 0, "h"sv);
+		node = checkNode(tree, statement, 1, NodeType::assignment, Operator::assign);
+		checkIdent(tree, node, 0, "a"sv);
+
+		// i = a | b ^ c & d - each bitwise operator has a level of its own, '&' over '^' over '|'
+		statement = checkNode(tree, root, 6, NodeType::assignment, Operator::assign);
+		node = checkNode(tree, statement, 1, NodeType::binaryOp, Operator::bitOr);
+		checkIdent(tree, node, 0, "a"sv);
+		node = checkNode(tree, node, 1, NodeType::binaryOp, Operator::bitXor);
+		checkIdent(tree, node, 0, "b"sv);
+		node = checkNode(tree, node, 1, NodeType::binaryOp, Operator::bitAnd);
+		checkIdent(tree, node, 0, "c"sv);
+
+		// j = a or b and c - 'and' binds tighter than 'or'
+		statement = checkNode(tree, root, 7, NodeType::assignment, Operator::assign);
+		node = checkNode(tree, statement, 1, NodeType::binaryOp, Operator::logicOr);
+		checkIdent(tree, node, 0, "a"sv);
+		node = checkNode(tree, node, 1, NodeType::binaryOp, Operator::logicAnd);
+		checkIdent(tree, node, 0, "b"sv);
+	}
+
+	void testStatements()
+	{
+		Parser parser{casesPath / "statements.case"};
+		assertTrue(parser.parse());
+		const auto &tree{parser.ast()};
+		const auto root{parser.root()};
+		assertEqual(tree[root].childCount, 8U);
+
+		auto statement{checkNode(tree, root, 0, NodeType::importStmt)};
+		assertEqual(tree[statement].childCount, 2U);
+		auto node{checkNode(tree, statement, 0, NodeType::importName)};
+		checkIdent(tree, node, 0, "std.io"sv);
+		checkIdent(tree, node, 1, "io"sv);
+
+		statement = checkNode(tree, root, 1, NodeType::fromImportStmt);
+		checkIdent(tree, statement, 0, "a.b"sv);
+		assertEqual(tree[statement].childCount, 3U);
+
+		statement = checkNode(tree, root, 2, NodeType::declaration);
+		checkNode(tree, statement, 0, NodeType::specifier);
+		checkIdent(tree, statement, 1, "Int32"sv);
+		checkIdent(tree, statement, 2, "x"sv);
+		checkNode(tree, statement, 3, NodeType::intLit);
+		statement = checkNode(tree, root, 3, NodeType::declaration);
+		assertEqual(tree[statement].childCount, 2U);
+
+		// if/elif/else - elif chains nest as the else-branch of the preceding if
+		statement = checkNode(tree, root, 4, NodeType::ifStmt);
+		assertEqual(tree[statement].childCount, 3U);
+		checkNode(tree, statement, 1, NodeType::block);
+		node = checkNode(tree, statement, 2, NodeType::ifStmt);
+		checkNode(tree, node, 1, NodeType::block);
+		node = checkNode(tree, node, 2, NodeType::block);
+		// The inner declaration of x shadows the outer one in its own scope
+		checkNode(tree, node, 0, NodeType::declaration);
+
+		statement = checkNode(tree, root, 5, NodeType::forStmt);
+		assertEqual(tree[statement].childCount, 4U);
+		checkNode(tree, statement, 0, NodeType::declaration);
+		checkNode(tree, statement, 1, NodeType::binaryOp, Operator::less);
+		checkNode(tree, statement, 2, NodeType::unaryOp, Operator::increment);
+		checkNode(tree, statement, 3, NodeType::block);
+
+		statement = checkNode(tree, root, 6, NodeType::doStmt);
+		checkNode(tree, statement, 0, NodeType::block);
+		checkNode(tree, statement, 1, NodeType::binaryOp, Operator::greater);
+		statement = checkNode(tree, root, 7, NodeType::whileStmt);
+		checkIdent(tree, statement, 0, "flag"sv);
+
+		// The return inside the elif block has no value
+		node = tree.child(tree.child(tree.child(root, 4), 2), 1);
+		checkNode(tree, node, 0, NodeType::returnStmt);
+		assertEqual(tree[tree.child(node, 0)].childCount, 0U);
+	}
+
+	void testErrorRecovery()
+	{
+		Parser parser{casesPath / "errors.case"};
+		assertFalse(parser.parse());
+		assertEqual(parser.errorCount(), 4U);
+		// Every statement still gets a node so later passes can keep going
+		const auto &tree{parser.ast()};
+		assertEqual(tree[parser.root()].childCount, 2U);
+		checkNode(tree, parser.root(), 0, NodeType::declaration);
+	}
+
+	[[nodiscard]] static path writeSource(const std::string &source)
+	{
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveTestParser.case"};
+		const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+		if (!file.valid() || !file.write(source.data(), source.size()))
+			return {};
+		return fileName;
+	}
+
+	void testNestingLimit()
+	{
+		// Far more nesting than the parser's limit, both through brackets and through prefix operators
+		constexpr size_t depth{100000U};
+		std::string source{"a = "};
+		source.append(depth, '(').append("1").append(depth, ')').append("\nb = ");
+		for (size_t level{}; level < depth; ++level)
+			source.append("- ");
+		source.append("1\nc = f((((1))), 2)\n");
+		auto fileName{writeSource(source)};
+		assertFalse(fileName.empty());
+		Parser parser{fileName};
+		const auto result{parser.parse()};
+		std::filesystem::remove(fileName);
+		// Each too-deep expression is one error, and parsing carries on with the statement after it
+		assertFalse(result);
+		assertEqual(parser.errorCount(), 2U);
+		const auto &tree{parser.ast()};
+		assertEqual(tree[parser.root()].childCount, 3U);
+		const auto statement{checkNode(tree, parser.root(), 2, NodeType::assignment, Operator::assign)};
+		assertEqual(tree[checkNode(tree, statement, 1, NodeType::call)].childCount, 3U);
+
+		// Blocks nested as deeply are one error too, skipped up to the brace closing the one too deep
+		source.assign(depth, '{').append("a = 1\n").append(depth, '}').append("\nb = 2\n");
+		fileName = writeSource(source);
+		assertFalse(fileName.empty());
+		Parser blocks{fileName};
+		assertFalse(blocks.parse());
+		std::filesystem::remove(fileName);
+		assertEqual(blocks.errorCount(), 1U);
+		assertEqual(blocks.ast()[blocks.root()].childCount, 2U);
+		checkNode(blocks.ast(), blocks.root(), 1, NodeType::assignment, Operator::assign);
+	}
+
+	void testLongElifChain()
+	{
+		// An elif chain is as long as it likes, without nesting the parse
+		constexpr size_t length{100000U};
+		std::string source{"if a {}"};
+		for (size_t link{}; link < length; ++link)
+			source.append("\nelif a {}");
+		source.append(" else {}\n");
+		const auto fileName{writeSource(source)};
+		assertFalse(fileName.empty());
+		Parser parser{fileName};
+		const auto result{parser.parse()};
+		std::filesystem::remove(fileName);
+		assertTrue(result);
+		const auto &tree{parser.ast()};
+		assertEqual(tree[parser.root()].childCount, 1U);
+		// Each elif is the else-branch of the if before it, and all of them end with the final else
+		auto node{checkNode(tree, parser.root(), 0, NodeType::ifStmt)};
+		const auto end{tree[node].source.end()};
+		for (size_t link{}; link < length; ++link)
+		{
+			assertEqual(tree[node].childCount, 3U);
+			node = checkNode(tree, node, 2, NodeType::ifStmt);
+			assertEqual(tree[node].source.end(), end);
+		}
+		assertEqual(tree[node].childCount, 3U);
+		checkNode(tree, node, 2, NodeType::block);
+	}
+
+	void testManyChildren()
+	{
+		// More statements than a 16-bit count could hold
+		constexpr size_t statements{70000U};
+		std::string source{};
+		for (size_t statement{}; statement < statements; ++statement)
+			source.append("a = 1\n");
+		const auto fileName{writeSource(source)};
+		assertFalse(fileName.empty());
+		Parser parser{fileName};
+		const auto result{parser.parse()};
+		std::filesystem::remove(fileName);
+		assertTrue(result);
+		assertEqual(parser.ast()[parser.root()].childCount, statements);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testExpressions)
+		CRUNCHpp_TEST(testStatements)
+		CRUNCHpp_TEST(testErrorRecovery)
+		CRUNCHpp_TEST(testNestingLimit)
+		CRUNCHpp_TEST(testLongElifChain)
+		CRUNCHpp_TEST(testManyChildren)
+	}
+};
+
+CRUNCHpp_TESTS(testParser)
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/stringLiteral.hxx"
+
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using namespace mangrove::parser::stringLiteral;
+
+class testStringLiteral final : public testsuite
+{
+private:
+	void checkRun(const std::string_view text, const char quote, const size_t bytes, const size_t chars)
+	{
+		const auto run{plainRun(text, quote)};
+		assertEqual(run.bytes, bytes);
+		assertEqual(run.chars, chars);
+	}
+
+	void testASCII()
+	{
+		checkRun(""sv, '"', 0U, 0U);
+		checkRun("\""sv, '"', 0U, 0U);
+		checkRun("abc\""sv, '"', 3U, 3U);
+		checkRun("abcdefgh"sv, '"', 8U, 8U);
+		checkRun("abcdefghi\""sv, '"', 9U, 9U);
+		checkRun("The quick brown fox jumped over the lazy dog\"; x"sv, '"', 44U, 44U);
+		// Escapes stop a run wherever they fall in a word
+		checkRun("abcdefg\\n"sv, '"', 7U, 7U);
+		checkRun("abcdefgh\\n"sv, '"', 8U, 8U);
+		// Each literal is only ended by its own quote
+		checkRun("it's\""sv, '"', 4U, 4U);
+		checkRun("say \"hi\"'"sv, '\'', 8U, 8U);
+		// The bytes either side of the printable range, and control characters, are never plain
+		checkRun(" ~\x1f"sv, '"', 2U, 2U);
+		checkRun("abc\x7f"sv, '"', 3U, 3U);
+		checkRun("tab\there"sv, '"', 3U, 3U);
+		checkRun("a\nb"sv, '"', 1U, 1U);
+		checkRun("abc\0def"sv, '"', 3U, 3U);
+	}
+
+	void testUnicode()
+	{
+		checkRun("λ\""sv, '"', 2U, 1U);
+		checkRun("café au lait\""sv, '"', 13U, 12U);
+		checkRun("🎉 unicode literals 🎊\""sv, '"', 26U, 20U);
+		checkRun("ab—cdefghijklmnop\\"sv, '"', 19U, 17U);
+		// Truncated, stray continuation and overlong sequences are left to the per-character path
+		checkRun("ab\xce"sv, '"', 2U, 2U);
+		checkRun("ab\x80""cd"sv, '"', 2U, 2U);
+		checkRun("ab\xc1\x81"sv, '"', 2U, 2U);
+		// As are characters that aren't normal text, such as surrogates
+		checkRun("ab\xed\xa0\x80"sv, '"', 2U, 2U);
+	}
+
+	void testLong()
+	{
+		std::string text(1000U, 'x');
+		text[500U] = '\\';
+		checkRun(text, '"', 500U, 500U);
+		text[500U] = 'x';
+		checkRun(text, '"', 1000U, 1000U);
+		text.replace(997U, 1U, "é");
+		checkRun(text, '"', 1001U, 1000U);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testASCII)
+		CRUNCHpp_TEST(testUnicode)
+		CRUNCHpp_TEST(testLong)
+	}
+};
+
+CRUNCHpp_TESTS(testStringLiteral)
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <array>
+#include <filesystem>
+#include <string>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/tokenPipe.hxx"
+#include "../../../src/bootstrap/parser/parser.hxx"
+
+using std::filesystem::path;
+using std::filesystem::current_path;
+using std::filesystem::canonical;
+using std::filesystem::directory_iterator;
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using substrate::fd_t;
+using substrate::span;
+using mangrove::parser::Tokeniser;
+using mangrove::parser::TokenPipe;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::TriviaMode;
+using mangrove::parser::Pipelining;
+using mangrove::parser::Parser;
+using mangrove::parser::types::Token;
+using mangrove::parser::types::TokenType;
+
+class testTokenPipe final : public testsuite
+{
+private:
+	path casesPath{canonical(current_path() / ".." / ".." / "cases")};
+
+	void crossCheck(const path &fileName, const LexerEngine engine, const size_t capacity, const size_t batch)
+	{
+		Tokeniser expected{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, TriviaMode::coalesce};
+		Tokeniser lexer{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, TriviaMode::coalesce};
+		TokenPipe pipe{lexer, capacity};
+		std::array<Token, 100U> tokens{};
+		bool finished{false};
+		while (!finished)
+		{
+			const auto count{pipe.next(span{tokens.data(), batch})};
+			assertNotEqual(count, 0U);
+			for (size_t index{}; index < count; ++index)
+			{
+				const auto &token{expected.next()};
+				const auto &actual{tokens[index]};
+				assertEqual(actual.type(), token.type());
+				assertEqual(actual.source().offset, token.source().offset);
+				assertEqual(actual.source().length, token.source().length);
+				assertTrue(actual.value() == token.value());
+				assertTrue(actual.integer() == token.integer());
+				finished = token.type() == TokenType::eof;
+				if (finished)
+					assertEqual(index, count - 1U);
+			}
+		}
+		// Once drained, the pipe keeps handing out EOF
+		for (size_t check{}; check < 3U; ++check)
+		{
+			assertEqual(pipe.next(span{tokens.data(), batch}), 1U);
+			assertEqual(tokens[0].type(), TokenType::eof);
+			assertEqual(tokens[0].source().offset, expected.token().source().offset);
+		}
+	}
+
+	void testCaseFiles()
+	{
+		for (const auto &directory : {casesPath / "tokenisation", casesPath / "parsing"})
+		{
+			for (const auto &entry : directory_iterator{directory})
+			{
+				const auto fileName{canonical(entry.path())};
+				crossCheck(fileName, LexerEngine::scalar, TokenPipe::defaultCapacity, 64U);
+				crossCheck(fileName, LexerEngine::table, TokenPipe::defaultCapacity, 64U);
+				// A tiny ring and odd batch sizes make both sides wrap and wait on each other a lot
+				crossCheck(fileName, LexerEngine::scalar, 1U, 7U);
+				crossCheck(fileName, LexerEngine::table, 1U, 100U);
+				crossCheck(fileName, LexerEngine::table, 1U, 1U);
+			}
+		}
+	}
+
+	void testCapacity()
+	{
+		const auto fileName{casesPath / "parsing" / "statements.case"};
+		Tokeniser lexer{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		assertEqual(TokenPipe{lexer, 1U}.capacity(), TokenPipe::batchSize);
+		assertEqual(TokenPipe{lexer, 100U}.capacity(), 128U);
+		assertEqual(TokenPipe{lexer, 1024U}.capacity(), 1024U);
+	}
+
+	void testEarlyShutdown()
+	{
+		// Abandoning a pipe part way through must stop the producer, even if it's waiting for space
+		const auto fileName{casesPath / "tokenisation" / "keywords.case"};
+		Tokeniser lexer{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}};
+		TokenPipe pipe{lexer, 1U};
+		std::array<Token, 1U> tokens{};
+		assertEqual(pipe.next(tokens), 1U);
+		assertNotEqual(tokens[0].type(), TokenType::eof);
+	}
+
+	void testParser()
+	{
+		// Parsing through the pipe must produce exactly the same tree and diagnostics as parsing directly
+		for (const auto &entry : directory_iterator{casesPath / "parsing"})
+		{
+			const auto fileName{canonical(entry.path())};
+			Parser direct{fileName, LexerEngine::table};
+			Parser pipelined{fileName, LexerEngine::table, Pipelining::threaded};
+			assertEqual(pipelined.parse(), direct.parse());
+			assertEqual(pipelined.errorCount(), direct.errorCount());
+			const auto &expected{direct.ast()};
+			const auto &actual{pipelined.ast()};
+			assertEqual(actual.nodeCount(), expected.nodeCount());
+			assertEqual(actual.bytesUsed(), expected.bytesUsed());
+			for (size_t index{}; index < expected.nodeCount(); ++index)
+			{
+				const auto node{static_cast<mangrove::ast::NodeIndex>(index)};
+				assertEqual(actual[node].type, expected[node].type);
+				assertEqual(actual[node].op, expected[node].op);
+				assertEqual(actual[node].childCount, expected[node].childCount);
+				assertEqual(actual[node].source.offset, expected[node].source.offset);
+				assertEqual(actual[node].source.length, expected[node].source.length);
+			}
+		}
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testCaseFiles)
+		CRUNCHpp_TEST(testCapacity)
+		CRUNCHpp_TEST(testEarlyShutdown)
+		CRUNCHpp_TEST(testParser)
+	}
+};
+
+CRUNCHpp_TESTS(testTokenPipe)
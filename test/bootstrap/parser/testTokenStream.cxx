@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <filesystem>
+#include <substrate/console>
+#include <crunch++.h>
+#include "../../../src/bootstrap/parser/tokenStream.hxx"
+
+using std::filesystem::path;
+using std::filesystem::current_path;
+using std::filesystem::canonical;
+using namespace std::literals::string_view_literals;
+using substrate::console;
+using mangrove::parser::TokenStream;
+using mangrove::parser::LineIndex;
+using mangrove::parser::types::TokenType;
+using mangrove::parser::types::TokenSet;
+using mangrove::parser::types::PackedToken;
+using mangrove::parser::types::triviaTokens;
+
+class testTokenStream final : public testsuite
+{
+private:
+	path casesPath{canonical(current_path() / ".." / ".." / "cases" / "tokenisation")};
+
+	void checkToken(const TokenStream &stream, const size_t index, const TokenType type, const std::string_view text,
+		const size_t line, const size_t column)
+	{
+		const auto &token{stream[index]};
+		assertEqual(token.type(), type);
+		assertTrue(stream.text(token) == text);
+		const auto location{stream.location(token)};
+		assertEqual(location.begin.line, line);
+		assertEqual(location.begin.character, column);
+	}
+
+	void testTokenSet()
+	{
+		constexpr TokenSet operators{TokenType::addOp, TokenType::mulOp};
+		static_assert(operators.includes(TokenType::addOp));
+		static_assert(!operators.includes(TokenType::relOp));
+		assertTrue(triviaTokens.includes(TokenType::whitespace));
+		assertFalse(triviaTokens.includes(TokenType::ident));
+		assertTrue(PackedToken{TokenType::comment, {}}.typeIn(triviaTokens));
+	}
+
+	void testLineIndex()
+	{
+		const LineIndex lines{"a\nbc\r\nd\re🦊f"sv};
+		assertEqual(lines.lineCount(), 4U);
+		assertEqual(lines.position(0).line, 0U);
+		assertEqual(lines.position(3).line, 1U);
+		assertEqual(lines.position(3).character, 1U);
+		// The LF of a CR-LF pair belongs to the line the CR ends
+		assertEqual(lines.position(5).line, 1U);
+		assertEqual(lines.position(6).line, 2U);
+		assertEqual(lines.position(8).line, 3U);
+		// Columns are counted in code points, not bytes
+		assertEqual(lines.position(13).character, 2U);
+	}
+
+	void testAssignments()
+	{
+		const TokenStream stream{casesPath / "assignments.case"};
+		// Each line is 'ident<ws>assignOp<ws>intLit<newline>', and the stream ends in an EOF token
+		assertEqual(stream.size() % 6U, 1U);
+		checkToken(stream, 0, TokenType::ident, "a"sv, 0, 0);
+		checkToken(stream, 1, TokenType::whitespace, " "sv, 0, 1);
+		checkToken(stream, 2, TokenType::assignOp, "="sv, 0, 2);
+		checkToken(stream, 4, TokenType::intLit, "1"sv, 0, 4);
+		checkToken(stream, 5, TokenType::newline, "\n"sv, 0, 5);
+		checkToken(stream, 6, TokenType::ident, "b"sv, 1, 0);
+		checkToken(stream, 8, TokenType::assignOp, "+="sv, 1, 2);
+		checkToken(stream, 56, TokenType::assignOp, "<<="sv, 9, 2);
+		checkToken(stream, 58, TokenType::intLit, "10"sv, 9, 6);
+		assertEqual(stream[stream.size() - 1U].type(), TokenType::eof);
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testTokenSet)
+		CRUNCHpp_TEST(testLineIndex)
+		CRUNCHpp_TEST(testAssignments)
+	}
+};
+
+CRUNCHpp_TESTS(testTokenStream)
@@ -1,5 +1,9 @@
 // SPDX-License-Identifier: BSD-3-Clause
+#include <array>
 #include <filesystem>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
 #include <substrate/console>
 #include <crunch++.h>
 #include "../../../src/bootstrap/parser/tokeniser.hxx"
@@ -13,7 +17,12 @@ using substrate::console;
 using namespace mangrove::core::utf8::literals;
 using mangrove::core::utf8::StringView;
 using mangrove::parser::Tokeniser;
+using mangrove::parser::LineIndex;
+using mangrove::parser::LexerEngine;
+using mangrove::parser::TriviaMode;
+using mangrove::parser::types::Token;
 using mangrove::parser::types::TokenType;
+using mangrove::parser::types::SourceRange;
 
 class testTokeniser final : public testsuite
 {
@@ -59,6 +68,24 @@ private:
 		assertTrue(token.value() == expectedValue);
 	}
 
+	void readInteger(Tokeniser &tokeniser, const TokenType expectedType, const uint64_t expectedValue)
+	{
+		const auto &token{tokeniser.next()};
+		assertTrue(token.valid());
+		assertEqual(token.type(), expectedType);
+		// Integer literals are decoded while lexing and carry no text
+		assertTrue(token.value().isEmpty());
+		assertTrue(token.integer() == expectedValue);
+	}
+
+	void readOverflow(Tokeniser &tokeniser, const TokenType expectedType)
+	{
+		const auto &token{tokeniser.next()};
+		assertTrue(token.valid());
+		assertEqual(token.type(), expectedType);
+		assertFalse(token.integer().has_value());
+	}
+
 	void readEmptyValue(Tokeniser &tokeniser, const TokenType expectedType)
 	{
 		const auto &token{tokeniser.next()};
@@ -76,16 +103,26 @@ private:
 	}
 
 	void readAssignment(Tokeniser &tokeniser, const StringView &identValue, const StringView &assignOpValue,
-		const StringView &literalValue)
+		const uint64_t literalValue)
 	{
 		readValue(tokeniser, TokenType::ident, identValue);
 		readWhitespace(tokeniser);
 		readValue(tokeniser, TokenType::assignOp, assignOpValue);
 		readWhitespace(tokeniser);
-		readValue(tokeniser, TokenType::intLit, literalValue);
+		readInteger(tokeniser, TokenType::intLit, literalValue);
 		readNewline(tokeniser);
 	}
 
+	void checkLocation(const Tokeniser &tokeniser, const size_t line, const size_t beginColumn,
+		const size_t endColumn)
+	{
+		const auto location{tokeniser.location(tokeniser.token())};
+		assertEqual(location.begin.line, line);
+		assertEqual(location.begin.character, beginColumn);
+		assertEqual(location.end.line, line);
+		assertEqual(location.end.character, endColumn);
+	}
+
 	void testBadFileConstruction()
 	{
 		Tokeniser tokeniser{fd_t{}};
@@ -95,6 +132,69 @@ private:
 		assertFalse(token.valid());
 	}
 
+	void testOversizedFileConstruction()
+	{
+		// A sparse file one byte past what a token's 32-bit offsets can reach
+		const auto fileName{std::filesystem::temp_directory_path() / "mangroveTestTokeniser.case"};
+		{
+			const fd_t file{fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(file.resize(int64_t{UINT32_MAX} + 1));
+		}
+		bool rejected{false};
+		try
+			{ Tokeniser tokeniser{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}}; }
+		catch (const std::system_error &error)
+			{ rejected = error.code() == std::errc::file_too_large; }
+		std::filesystem::remove(fileName);
+		assertTrue(rejected);
+	}
+
+	void testPipedFile()
+	{
+		// Pipes can't be mapped, so the tokeniser reads them into a buffer and indexes that instead
+		std::array<int, 2U> ends{};
+		assertEqual(pipe(ends.data()), 0);
+		fd_t input{ends[0]};
+		{
+			const fd_t output{ends[1]};
+			const auto text{"a = 1\nb += 2\n"sv};
+			assertTrue(output.write(text.data(), text.length()));
+		}
+		Tokeniser tokeniser{std::move(input)};
+		readAssignment(tokeniser, u8"a"_sv, u8"="_sv, 1U);
+		readValue(tokeniser, TokenType::ident, u8"b"_sv);
+		checkLocation(tokeniser, 1, 0, 1);
+		readWhitespace(tokeniser);
+		readValue(tokeniser, TokenType::assignOp, u8"+="_sv);
+		checkLocation(tokeniser, 1, 2, 4);
+		readWhitespace(tokeniser);
+		readInteger(tokeniser, TokenType::intLit, 2U);
+		readNewline(tokeniser);
+		readEOF(tokeniser);
+	}
+
+	void testBorrowedSource()
+	{
+		const auto text{"a = 1\nb += 2\n"sv};
+		const LineIndex lines{text};
+		for (const auto engine : {LexerEngine::scalar, LexerEngine::table})
+		{
+			Tokeniser tokeniser{text, lines, engine};
+			// The caller's index is used as-is rather than being built again
+			assertTrue(&tokeniser.lines() == &lines);
+			readAssignment(tokeniser, u8"a"_sv, u8"="_sv, 1U);
+			readValue(tokeniser, TokenType::ident, u8"b"_sv);
+			checkLocation(tokeniser, 1, 0, 1);
+			readWhitespace(tokeniser);
+			readValue(tokeniser, TokenType::assignOp, u8"+="_sv);
+			readWhitespace(tokeniser);
+			readInteger(tokeniser, TokenType::intLit, 2U);
+			readNewline(tokeniser);
+			readEOF(tokeniser);
+		}
+	}
+
 	void testIntegralLiterals()
 	{
 		auto tokeniser{tokeniserFor("integralLiterals.case"sv)};
@@ -105,42 +205,57 @@ private:
 		// It is assumed after each test value that a single Linux-style new line follows
 		// Consume the first token from the input and start testing tokenisation
 		console.info("Checking tokenisation of '0'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"0"_sv);
+		readInteger(tokeniser, TokenType::intLit, 0U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '07'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"07"_sv);
+		readInteger(tokeniser, TokenType::intLit, 7U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '08'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"08"_sv);
+		readInteger(tokeniser, TokenType::intLit, 8U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0b1001'"sv);
-		readValue(tokeniser, TokenType::binLit, u8"1001"_sv);
+		readInteger(tokeniser, TokenType::binLit, 0b1001U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0b'"sv);
 		readInvalid(tokeniser);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0c11'"sv);
-		readValue(tokeniser, TokenType::octLit, u8"11"_sv);
+		readInteger(tokeniser, TokenType::octLit, 011U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0c'"sv);
 		readInvalid(tokeniser);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0x95'"sv);
-		readValue(tokeniser, TokenType::hexLit, u8"95"_sv);
+		readInteger(tokeniser, TokenType::hexLit, 0x95U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0x'"sv);
 		readInvalid(tokeniser);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '100'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"100"_sv);
+		readInteger(tokeniser, TokenType::intLit, 100U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '6'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"6"_sv);
+		readInteger(tokeniser, TokenType::intLit, 6U);
 		readNewline(tokeniser);
 		console.info("Checking tokenisation of '0a'"sv);
-		readValue(tokeniser, TokenType::intLit, u8"0"_sv);
+		readInteger(tokeniser, TokenType::intLit, 0U);
 		readValue(tokeniser, TokenType::ident, u8"a"_sv);
 		readNewline(tokeniser);
+		console.info("Checking decoding of literals at the limits of 64 bits"sv);
+		readInteger(tokeniser, TokenType::intLit, UINT64_MAX);
+		readNewline(tokeniser);
+		readOverflow(tokeniser, TokenType::intLit);
+		readNewline(tokeniser);
+		readInteger(tokeniser, TokenType::hexLit, UINT64_MAX);
+		readNewline(tokeniser);
+		readOverflow(tokeniser, TokenType::hexLit);
+		readNewline(tokeniser);
+		readInteger(tokeniser, TokenType::binLit, UINT64_MAX);
+		readNewline(tokeniser);
+		readInteger(tokeniser, TokenType::octLit, UINT64_MAX);
+		readNewline(tokeniser);
+		readOverflow(tokeniser, TokenType::octLit);
+		readNewline(tokeniser);
 		// Finally, consume one last token and make sure it's the EOF token
 		readEOF(tokeniser);
 	}
@@ -240,27 +355,27 @@ private:
 		// It is assumed after each test value that a single Linux-style new line follows
 		// Consume the first token from the input and start testing tokenisation
 		console.info("Checking tokenisation of 'a = 1'"sv);
-		readAssignment(tokeniser, u8"a"_sv, u8"="_sv, u8"1"_sv);
+		readAssignment(tokeniser, u8"a"_sv, u8"="_sv, 1U);
 		console.info("Checking tokenisation of 'b += 2'"sv);
-		readAssignment(tokeniser, u8"b"_sv, u8"+="_sv, u8"2"_sv);
+		readAssignment(tokeniser, u8"b"_sv, u8"+="_sv, 2U);
 		console.info("Checking tokenisation of 'c -= 3'"sv);
-		readAssignment(tokeniser, u8"c"_sv, u8"-="_sv, u8"3"_sv);
+		readAssignment(tokeniser, u8"c"_sv, u8"-="_sv, 3U);
 		console.info("Checking tokenisation of 'd *= 4'"sv);
-		readAssignment(tokeniser, u8"d"_sv, u8"*="_sv, u8"4"_sv);
+		readAssignment(tokeniser, u8"d"_sv, u8"*="_sv, 4U);
 		console.info("Checking tokenisation of 'e /= 5'"sv);
-		readAssignment(tokeniser, u8"e"_sv, u8"/="_sv, u8"5"_sv);
+		readAssignment(tokeniser, u8"e"_sv, u8"/="_sv, 5U);
 		console.info("Checking tokenisation of 'f %= 6'"sv);
-		readAssignment(tokeniser, u8"f"_sv, u8"%="_sv, u8"6"_sv);
+		readAssignment(tokeniser, u8"f"_sv, u8"%="_sv, 6U);
 		console.info("Checking tokenisation of 'g &= 7'"sv);
-		readAssignment(tokeniser, u8"g"_sv, u8"&="_sv, u8"7"_sv);
+		readAssignment(tokeniser, u8"g"_sv, u8"&="_sv, 7U);
 		console.info("Checking tokenisation of 'h |= 8'"sv);
-		readAssignment(tokeniser, u8"h"_sv, u8"|="_sv, u8"8"_sv);
+		readAssignment(tokeniser, u8"h"_sv, u8"|="_sv, 8U);
 		console.info("Checking tokenisation of 'i ^= 9'"sv);
-		readAssignment(tokeniser, u8"i"_sv, u8"^="_sv, u8"9"_sv);
+		readAssignment(tokeniser, u8"i"_sv, u8"^="_sv, 9U);
 		console.info("Checking tokenisation of 'j >>= 10'"sv);
-		readAssignment(tokeniser, u8"j"_sv, u8"<<="_sv, u8"10"_sv);
+		readAssignment(tokeniser, u8"j"_sv, u8"<<="_sv, 10U);
 		console.info("Checking tokenisation of 'k <<= 11'"sv);
-		readAssignment(tokeniser, u8"k"_sv, u8">>="_sv, u8"11"_sv);
+		readAssignment(tokeniser, u8"k"_sv, u8">>="_sv, 11U);
 		// Finally, consume one last token and make sure it's the EOF token
 		readEOF(tokeniser);
 		readEOF(tokeniser);
@@ -507,16 +622,166 @@ private:
 		readEOF(tokeniser);
 	}
 
+	void testLocations()
+	{
+		auto tokeniser{tokeniserFor("assignments.case"sv)};
+		readValue(tokeniser, TokenType::ident, u8"a"_sv);
+		checkLocation(tokeniser, 0, 0, 1);
+		readWhitespace(tokeniser);
+		readValue(tokeniser, TokenType::assignOp, u8"="_sv);
+		checkLocation(tokeniser, 0, 2, 3);
+		readWhitespace(tokeniser);
+		readInteger(tokeniser, TokenType::intLit, 1U);
+		checkLocation(tokeniser, 0, 4, 5);
+		readNewline(tokeniser);
+		readValue(tokeniser, TokenType::ident, u8"b"_sv);
+		checkLocation(tokeniser, 1, 0, 1);
+		readWhitespace(tokeniser);
+		readValue(tokeniser, TokenType::assignOp, u8"+="_sv);
+		checkLocation(tokeniser, 1, 2, 4);
+	}
+
+	void testBatches()
+	{
+		// Lex the file a token at a time as the reference
+		std::vector<Token> expected{};
+		auto reference{tokeniserFor("keywords.case"sv)};
+		do
+			expected.emplace_back(reference.next());
+		while (expected.back().type() != TokenType::eof);
+
+		// Now lex it again in batches that don't divide the token count evenly
+		auto tokeniser{tokeniserFor("keywords.case"sv)};
+		std::array<Token, 7U> batch{};
+		size_t index{};
+		while (true)
+		{
+			const auto count{tokeniser.next(batch)};
+			assertNotEqual(count, 0U);
+			for (size_t token{}; token < count; ++token, ++index)
+			{
+				assertTrue(index < expected.size());
+				assertEqual(batch[token].type(), expected[index].type());
+				assertEqual(batch[token].source().offset, expected[index].source().offset);
+				assertEqual(batch[token].source().length, expected[index].source().length);
+				assertTrue(batch[token].value() == expected[index].value());
+			}
+			assertEqual(tokeniser.token().type(), batch[count - 1U].type());
+			assertTrue(tokeniser.token().value() == batch[count - 1U].value());
+			if (batch[count - 1U].type() == TokenType::eof)
+				break;
+			// Only the batch containing EOF may come up short
+			assertEqual(count, batch.size());
+		}
+		assertEqual(index, expected.size());
+		// Once exhausted, the tokeniser keeps producing single EOF tokens
+		assertEqual(tokeniser.next(batch), 1U);
+		assertEqual(batch[0].type(), TokenType::eof);
+	}
+
+	struct ExpectedToken final
+	{
+		TokenType type;
+		SourceRange source;
+		SourceRange leading;
+		SourceRange trailing;
+	};
+
+	void checkRange(const SourceRange &range, const SourceRange &expected)
+	{
+		assertEqual(range.offset, expected.offset);
+		assertEqual(range.length, expected.length);
+	}
+
+	void checkTrivia(const LexerEngine engine)
+	{
+		constexpr std::array<ExpectedToken, 13U> expected
+		{{
+			{TokenType::ident, {0U, 1U}, {0U, 0U}, {1U, 1U}},
+			{TokenType::assignOp, {2U, 1U}, {2U, 0U}, {3U, 1U}},
+			// Trailing trivia takes in a comment at the end of the line, but not the newline
+			{TokenType::intLit, {4U, 1U}, {4U, 0U}, {5U, 7U}},
+			{TokenType::newline, {12U, 1U}, {12U, 0U}, {13U, 0U}},
+			// Indentation and comments before a token on a new line lead it
+			{TokenType::ident, {25U, 1U}, {13U, 12U}, {26U, 8U}},
+			{TokenType::newline, {34U, 1U}, {34U, 0U}, {35U, 0U}},
+			{TokenType::newline, {35U, 1U}, {35U, 0U}, {36U, 0U}},
+			// A line holding only a comment gives it to the line's newline
+			{TokenType::newline, {48U, 1U}, {36U, 12U}, {49U, 0U}},
+			{TokenType::ident, {49U, 1U}, {49U, 0U}, {50U, 11U}},
+			{TokenType::addOp, {61U, 1U}, {61U, 0U}, {62U, 1U}},
+			{TokenType::ident, {63U, 1U}, {63U, 0U}, {64U, 0U}},
+			{TokenType::newline, {64U, 1U}, {64U, 0U}, {65U, 0U}},
+			// An unterminated block comment runs to the end of the file
+			{TokenType::eof, {72U, 0U}, {65U, 7U}, {72U, 0U}},
+		}};
+
+		const auto fileName{casesPath / "trivia.case"sv};
+		Tokeniser tokeniser{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, TriviaMode::coalesce};
+		assertTrue(tokeniser.trivia() == TriviaMode::coalesce);
+		for (const auto &token : expected)
+		{
+			const auto &result{tokeniser.next()};
+			assertEqual(result.type(), token.type);
+			checkRange(result.source(), token.source);
+			checkRange(result.leadingTrivia(), token.leading);
+			checkRange(result.trailingTrivia(), token.trailing);
+		}
+	}
+
+	// Checks coalescing only drops trivia, and that the trivia and tokens tile the whole file between them
+	void checkCoalesced(const std::string_view file, const LexerEngine engine)
+	{
+		const auto fileName{casesPath / file};
+		Tokeniser reference{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine};
+		Tokeniser tokeniser{fd_t{fileName.c_str(), O_RDONLY | O_NOCTTY}, engine, TriviaMode::coalesce};
+		uint32_t offset{};
+		while (true)
+		{
+			const auto *expected{&reference.next()};
+			while (expected->typeIn({TokenType::whitespace, TokenType::comment}))
+				expected = &reference.next();
+			const auto &token{tokeniser.next()};
+			assertEqual(token.type(), expected->type());
+			checkRange(token.source(), expected->source());
+			assertTrue(token.value() == expected->value());
+			assertEqual(token.leadingTrivia().offset, offset);
+			assertEqual(token.leadingTrivia().end(), token.source().offset);
+			assertEqual(token.trailingTrivia().offset, token.source().end());
+			offset = token.trailingTrivia().end();
+			if (token.type() == TokenType::eof)
+				break;
+		}
+	}
+
+	void testTrivia()
+	{
+		checkTrivia(LexerEngine::scalar);
+		checkTrivia(LexerEngine::table);
+		for (const auto file : {"trivia.case"sv, "punctuation.case"sv, "keywords.case"sv, "stringLiterals.case"sv,
+			"integralLiterals.case"sv, "assignments.case"sv})
+		{
+			checkCoalesced(file, LexerEngine::scalar);
+			checkCoalesced(file, LexerEngine::table);
+		}
+	}
+
 public:
 	void registerTests() final
 	{
 		console = {stdout, stderr};
 		CRUNCHpp_TEST(testBadFileConstruction)
+		CRUNCHpp_TEST(testOversizedFileConstruction)
+		CRUNCHpp_TEST(testPipedFile)
+		CRUNCHpp_TEST(testBorrowedSource)
 		CRUNCHpp_TEST(testIntegralLiterals)
 		CRUNCHpp_TEST(testStringLiterals)
 		CRUNCHpp_TEST(testAssignments)
 		CRUNCHpp_TEST(testKeywords)
 		CRUNCHpp_TEST(testPunctuation)
+		CRUNCHpp_TEST(testLocations)
+		CRUNCHpp_TEST(testBatches)
+		CRUNCHpp_TEST(testTrivia)
 	}
 };
 
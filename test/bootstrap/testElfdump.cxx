@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: BSD-3-Clause
+#include <cstdio>
+#include <cstdlib>
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <substrate/console>
+#include <substrate/fd>
+#include <crunch++.h>
+
+using namespace std::literals::string_literals;
+using namespace std::literals::string_view_literals;
+using std::filesystem::path;
+using substrate::fd_t;
+using substrate::console;
+
+class testElfdump final : public testsuite
+{
+private:
+	const path badFile{std::filesystem::temp_directory_path() / "mangroveTestElfdump.o"};
+
+	// Runs mangrove-elfdump (as built, found through $ELFDUMP) over files, returning its output a line at a time
+	std::vector<std::string> elfdump(const std::string_view arguments)
+	{
+		const auto *const program{std::getenv("ELFDUMP")};
+		assertNotNull(program);
+		const auto command{std::string{"'"} + program + "' "s + std::string{arguments}};
+		auto *const output{popen(command.c_str(), "r")};
+		assertNotNull(output);
+		std::vector<std::string> lines{};
+		std::string line{};
+		std::array<char, 4096U> buffer{};
+		while (std::fgets(buffer.data(), static_cast<int>(buffer.size()), output))
+		{
+			line += buffer.data();
+			if (line.back() != '\n')
+				continue;
+			line.pop_back();
+			lines.emplace_back(std::move(line));
+			line.clear();
+		}
+		static_cast<void>(pclose(output));
+		return lines;
+	}
+
+	// Splits a CSV record into its fields, unquoting any that were quoted
+	[[nodiscard]] static std::vector<std::string> fields(const std::string_view record)
+	{
+		std::vector<std::string> result{{}};
+		bool quoted{false};
+		for (size_t index{}; index < record.size(); ++index)
+		{
+			const auto value{record[index]};
+			if (quoted && value == '"' && index + 1U < record.size() && record[index + 1U] == '"')
+			{
+				result.back() += '"';
+				++index;
+			}
+			else if (value == '"')
+				quoted = !quoted;
+			else if (value == ',' && !quoted)
+				result.emplace_back();
+			else
+				result.back() += value;
+		}
+		return result;
+	}
+
+	void testCSVErrorRows()
+	{
+		{
+			const fd_t file{badFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644};
+			assertTrue(file.valid());
+			assertTrue(file.write("not an ELF file"sv.data(), 15U));
+		}
+		// The valid file is elfdump itself, so there's a row of each kind to check against the header
+		const auto lines{elfdump("--format=csv '"s + badFile.string() + "' \"$ELFDUMP\""s)};
+		std::filesystem::remove(badFile);
+		assertEqual(lines.size(), 3U);
+
+		const auto header{fields(lines[0])};
+		assertEqual(header.size(), 17U);
+		assertTrue(header.back() == "error"sv);
+
+		const auto failure{fields(lines[1])};
+		assertEqual(failure.size(), header.size());
+		assertTrue(failure.front() == badFile.string());
+		assertFalse(failure.back().empty());
+		for (size_t index{1U}; index + 1U < failure.size(); ++index)
+			assertTrue(failure[index].empty());
+
+		const auto success{fields(lines[2])};
+		assertEqual(success.size(), header.size());
+		assertTrue(success.back().empty());
+	}
+
+public:
+	void registerTests() final
+	{
+		console = {stdout, stderr};
+		CRUNCHpp_TEST(testCSVErrorRows)
+	}
+};
+
+CRUNCHpp_TESTS(testElfdump)